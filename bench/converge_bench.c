@@ -0,0 +1,270 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "optimizer.h"
+#include "scenario.h"
+#include "ensemble.h"
+
+/*
+ * Measures how quickly each optimizer mode improves a fixed set of scenarios:
+ * every mode is run on every scenario for a number of seeded repetitions, and
+ * the best fitness is recorded against evaluations, CPU seconds and wall
+ * seconds after every generation.  Prints a summary of final quality and of
+ * the effort to first beat the seed by the target gain; the curves and the
+ * summary can also be written as CSV, to compare across commits.
+ *
+ * The repetition seeds are the same for every mode and every build, so the
+ * same --seed and --reps always run the same searches.
+ */
+
+#define CONVERGE_BENCH_REPS 5
+#define CONVERGE_BENCH_GENERATIONS 16
+#define CONVERGE_BENCH_SEED 1
+#define CONVERGE_BENCH_TARGET_GAIN 1.0 //m/s over the seed.
+#define CONVERGE_BENCH_BEAM_WIDTH 2
+
+typedef struct ConvergeScenario {
+    const char *name;
+    InitFunc rocket_func;
+    double cutoff_altitude;
+} ConvergeScenario;
+
+typedef struct ConvergeMode {
+    const char *name;
+    OptimizerMode mode;
+} ConvergeMode;
+
+typedef struct ConvergePoint {
+    unsigned long evaluations;
+    double cpu_seconds;
+    double wall_seconds;
+    double fitness;
+} ConvergePoint;
+
+//The trace of one run, appended to by the progress callback.
+typedef struct ConvergeCurve {
+    ConvergePoint *points;
+    size_t count;
+    size_t capacity;
+    double start;
+} ConvergeCurve;
+
+static const ConvergeScenario converge_scenarios[] = {
+    {"large-70k", (InitFunc)init_large_rocket, 70000.0},
+    {"large-80k", (InitFunc)init_large_rocket, 80000.0},
+    {"large-100k", (InitFunc)init_large_rocket, 100000.0},
+    {"small-70k", (InitFunc)init_small_rocket, 70000.0},
+    {"small-80k", (InitFunc)init_small_rocket, 80000.0},
+    {"small-100k", (InitFunc)init_small_rocket, 100000.0},
+};
+#define CONVERGE_SCENARIO_COUNT (sizeof(converge_scenarios)/sizeof(converge_scenarios[0]))
+
+static const ConvergeMode converge_modes[] = {
+    {"generational", OPTIMIZER_MODE_GENERATIONAL},
+    {"halving", OPTIMIZER_MODE_SUCCESSIVE_HALVING},
+    {"steady-state", OPTIMIZER_MODE_STEADY_STATE},
+    {"beam", OPTIMIZER_MODE_BEAM},
+    {"tempering", OPTIMIZER_MODE_TEMPERING},
+};
+#define CONVERGE_MODE_COUNT (sizeof(converge_modes)/sizeof(converge_modes[0]))
+
+static double converge_bench_clock(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + 1e-9*now.tv_nsec;
+}
+
+static void converge_record(const Optimizer *optimizer, void *context) {
+    ConvergeCurve *curve = (ConvergeCurve *)context;
+    if(curve->count == curve->capacity) {
+        curve->capacity = curve->capacity ? 2*curve->capacity : 64;
+        curve->points = (ConvergePoint *)realloc(curve->points, sizeof(ConvergePoint) * curve->capacity);
+    }
+    ConvergePoint *point = &curve->points[curve->count++];
+    point->evaluations = optimizer->evaluations;
+    point->cpu_seconds = optimizer->busy_seconds;
+    point->wall_seconds = converge_bench_clock() - curve->start;
+    point->fitness = optimizer->best_fitness;
+}
+
+static int converge_compare_ascending(const void *a, const void *b) {
+    double fa = *(const double *)a;
+    double fb = *(const double *)b;
+    return (fa > fb) - (fa < fb);
+}
+
+static double converge_seed_fitness(const Planetoid *planetoid, const ConvergeScenario *scenario, const Program *throttle_program, const Program *altitude_angle_program) {
+    Optimizer *optimizer = optimizer_init(optimizer_alloc());
+    optimizer->rocket_factory_func = scenario->rocket_func;
+    optimizer->planetoid = planetoid;
+    optimizer->throttle_cutoff_radius = planetoid->radius + scenario->cutoff_altitude;
+
+    System *system = optimizer_make_system(optimizer, throttle_program, altitude_angle_program);
+    OptimizerSystemResult *result = optimizer_run_system(system);
+    double fitness = result->fitness;
+
+    free(result);
+    rocket_dealloc(system->rocket);
+    system_dealloc(system);
+    optimizer_dealloc(optimizer);
+    return fitness;
+}
+
+static void usage(const char *name) {
+    fprintf(stderr, "usage: %s [--reps N] [--generations N] [--seed N] [--target-gain M/S]\n", name);
+    fprintf(stderr, "       [--beam-width N] [--modes generational,halving,steady-state,beam,tempering]\n");
+    fprintf(stderr, "       [--curves FILE] [--summary FILE]\n");
+}
+
+int main(int argc, char **argv) {
+    unsigned reps = CONVERGE_BENCH_REPS;
+    unsigned generations = CONVERGE_BENCH_GENERATIONS;
+    unsigned long seed = CONVERGE_BENCH_SEED;
+    double target_gain = CONVERGE_BENCH_TARGET_GAIN;
+    unsigned beam_width = CONVERGE_BENCH_BEAM_WIDTH;
+    const char *modes = NULL;
+    const char *curves_path = NULL;
+    const char *summary_path = NULL;
+
+    for(int i=1; i<argc; i++) {
+        if( strcmp(argv[i], "--reps") == 0 && i+1 < argc && atoi(argv[i+1]) > 0 ) {
+            reps = (unsigned)atoi(argv[++i]);
+        } else if( strcmp(argv[i], "--generations") == 0 && i+1 < argc && atoi(argv[i+1]) > 0 ) {
+            generations = (unsigned)atoi(argv[++i]);
+        } else if( strcmp(argv[i], "--seed") == 0 && i+1 < argc ) {
+            seed = strtoul(argv[++i], NULL, 10);
+        } else if( strcmp(argv[i], "--target-gain") == 0 && i+1 < argc ) {
+            target_gain = atof(argv[++i]);
+        } else if( strcmp(argv[i], "--beam-width") == 0 && i+1 < argc && atoi(argv[i+1]) > 0 ) {
+            beam_width = (unsigned)atoi(argv[++i]);
+        } else if( strcmp(argv[i], "--modes") == 0 && i+1 < argc ) {
+            modes = argv[++i];
+        } else if( strcmp(argv[i], "--curves") == 0 && i+1 < argc ) {
+            curves_path = argv[++i];
+        } else if( strcmp(argv[i], "--summary") == 0 && i+1 < argc ) {
+            summary_path = argv[++i];
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    FILE *curves = curves_path ? fopen(curves_path, "w") : NULL;
+    FILE *summary = summary_path ? fopen(summary_path, "w") : NULL;
+    if((curves_path && !curves) || (summary_path && !summary)) {
+        perror(curves_path && !curves ? curves_path : summary_path);
+        return 1;
+    }
+    if(curves)
+        fprintf(curves, "mode,scenario,rep,evaluations,cpu_seconds,wall_seconds,fitness\n");
+    if(summary)
+        fprintf(summary, "mode,scenario,runs,seed_fitness,target,reached,evaluations_p50,evaluations_p90,wall_seconds_p50,wall_seconds_p90,final_p10,final_p50,final_p90,final_mean,cpu_seconds_mean\n");
+
+    Planetoid *kerbin = planetoid_init(planetoid_alloc());
+    kerbin_radius = kerbin->radius;
+
+    Program *throttle_program = init_throttle_seed(program_init(program_alloc(), SCENARIO_SEED_LENGTH));
+    Program *altitude_angle_program = init_altitude_angle_seed(program_init(program_alloc(), SCENARIO_SEED_LENGTH));
+
+    double *final = (double *)malloc(sizeof(double) * reps);
+    double *evaluations = (double *)malloc(sizeof(double) * reps);
+    double *wall_seconds = (double *)malloc(sizeof(double) * reps);
+
+    printf("%u reps x %u generations, seed %lu; time to target is to beat the seed by %g m/s\n", reps, generations, seed, target_gain);
+    printf("%-13s %-11s %8s %7s %10s %10s %10s %10s %10s\n", "mode", "scenario", "seed", "reached", "evals p50", "wall p50", "final p10", "final p50", "final p90");
+
+    for(size_t m=0; m<CONVERGE_MODE_COUNT; m++) {
+        const ConvergeMode *mode = &converge_modes[m];
+        if(modes && !strstr(modes, mode->name))
+            continue;
+
+        for(size_t s=0; s<CONVERGE_SCENARIO_COUNT; s++) {
+            const ConvergeScenario *scenario = &converge_scenarios[s];
+            double seed_fitness = converge_seed_fitness(kerbin, scenario, throttle_program, altitude_angle_program);
+            double target = seed_fitness + target_gain;
+
+            unsigned reached = 0;
+            double cpu_seconds = 0.0;
+            for(unsigned rep=0; rep<reps; rep++) {
+                ConvergeCurve curve = {NULL, 0, 0, converge_bench_clock()};
+
+                Optimizer *optimizer = optimizer_init(optimizer_alloc());
+                optimizer->rocket_factory_func = scenario->rocket_func;
+                optimizer->planetoid = kerbin;
+                optimizer->seed_throttle_program = throttle_program;
+                optimizer->seed_altitude_angle_program = altitude_angle_program;
+                optimizer->throttle_cutoff_radius = kerbin->radius + scenario->cutoff_altitude;
+                optimizer->generations = generations;
+                optimizer->mode = mode->mode;
+                optimizer->beam_width = beam_width;
+                optimizer->quiet = true;
+                optimizer->progress_func = converge_record;
+                optimizer->progress_context = &curve;
+                rng_init(&optimizer->rng, seed + rep);
+
+                final[rep] = optimizer_run(optimizer);
+                cpu_seconds += optimizer->busy_seconds;
+
+                //The first point to reach the target, if any.
+                evaluations[rep] = INFINITY;
+                wall_seconds[rep] = INFINITY;
+                for(size_t i=0; i<curve.count; i++) {
+                    if(curve.points[i].fitness >= target) {
+                        evaluations[rep] = (double)curve.points[i].evaluations;
+                        wall_seconds[rep] = curve.points[i].wall_seconds;
+                        reached++;
+                        break;
+                    }
+                }
+
+                if(curves) {
+                    for(size_t i=0; i<curve.count; i++) {
+                        const ConvergePoint *point = &curve.points[i];
+                        fprintf(curves, "%s,%s,%u,%lu,%.6f,%.6f,%.6f\n", mode->name, scenario->name, rep, point->evaluations, point->cpu_seconds, point->wall_seconds, point->fitness);
+                    }
+                }
+
+                free(curve.points);
+                optimizer_dealloc(optimizer);
+            }
+
+            qsort(final, reps, sizeof(double), converge_compare_ascending);
+            qsort(evaluations, reps, sizeof(double), converge_compare_ascending);
+            qsort(wall_seconds, reps, sizeof(double), converge_compare_ascending);
+            double mean = 0.0;
+            for(unsigned rep=0; rep<reps; rep++)
+                mean += final[rep] / reps;
+
+            printf("%-13s %-11s %8.2f %3u/%-3u %10.0f %10.2f %10.2f %10.2f %10.2f\n",
+                    mode->name, scenario->name, seed_fitness, reached, reps,
+                    ensemble_percentile(evaluations, reps, 0.50), ensemble_percentile(wall_seconds, reps, 0.50),
+                    ensemble_percentile(final, reps, 0.10), ensemble_percentile(final, reps, 0.50), ensemble_percentile(final, reps, 0.90));
+            fflush(stdout);
+            if(summary) {
+                fprintf(summary, "%s,%s,%u,%.6f,%.6f,%u,%.0f,%.0f,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f\n",
+                        mode->name, scenario->name, reps, seed_fitness, target, reached,
+                        ensemble_percentile(evaluations, reps, 0.50), ensemble_percentile(evaluations, reps, 0.90),
+                        ensemble_percentile(wall_seconds, reps, 0.50), ensemble_percentile(wall_seconds, reps, 0.90),
+                        ensemble_percentile(final, reps, 0.10), ensemble_percentile(final, reps, 0.50), ensemble_percentile(final, reps, 0.90),
+                        mean, cpu_seconds / reps);
+            }
+        }
+    }
+
+    if(curves)
+        fclose(curves);
+    if(summary)
+        fclose(summary);
+
+    free(wall_seconds);
+    free(evaluations);
+    free(final);
+    program_dealloc(throttle_program);
+    program_dealloc(altitude_angle_program);
+    planetoid_dealloc(kerbin);
+
+    return 0;
+}
@@ -0,0 +1,110 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "system.h"
+#include "parareal.h"
+#include "scenario.h"
+
+/*
+ * Measures Parareal against a serial run of one high-rate flight: the seed
+ * programs on the large rocket are flown serially at the given tick rate, then
+ * with Parareal on 1, 2, 4, ... workers (one slice each), and the wall time,
+ * iterations and difference from the serial apex are reported.  The bound is
+ * slices/iterations, the speed up the fine sweeps allow given enough cores,
+ * and the work is the fine ticks flown over the serial run's.
+ */
+
+#define PARAREAL_BENCH_TICKS_PER_SECOND 10000.0
+#define PARAREAL_BENCH_MAX_WORKERS 16
+
+typedef struct PararealBenchFlight {
+    Rocket rocket;
+    System system;
+} PararealBenchFlight;
+
+static double parareal_bench_clock(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + 1e-9*now.tv_nsec;
+}
+
+static void parareal_bench_ready(PararealBenchFlight *flight, const Planetoid *planetoid, const Program *throttle_program, const Program *altitude_angle_program, double ticks_per_second) {
+    system_init(&flight->system);
+    flight->system.planetoid = planetoid;
+    flight->system.rocket = init_large_rocket(&flight->rocket);
+    flight->system.throttle_program = throttle_program;
+    flight->system.altitude_angle_program = altitude_angle_program;
+    flight->system.throttle_cutoff_radius = planetoid->radius + 80000.0;
+    flight->system.delta_t = 1.0/ticks_per_second;
+}
+
+int main(int argc, char **argv) {
+    double ticks_per_second = PARAREAL_BENCH_TICKS_PER_SECOND;
+    unsigned max_workers = PARAREAL_BENCH_MAX_WORKERS;
+    double coarse_ticks_per_second = PARAREAL_COARSE_TICKS_PER_SECOND;
+    for(int i=1; i<argc; i++) {
+        if( strcmp(argv[i], "--rate") == 0 && i+1 < argc && atof(argv[i+1]) > 0.0 ) {
+            ticks_per_second = atof(argv[++i]);
+        } else if( strcmp(argv[i], "--workers") == 0 && i+1 < argc && atoi(argv[i+1]) > 0 ) {
+            max_workers = (unsigned)atoi(argv[++i]);
+        } else if( strcmp(argv[i], "--coarse-rate") == 0 && i+1 < argc && atof(argv[i+1]) > 0.0 ) {
+            coarse_ticks_per_second = atof(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: %s [--rate HZ] [--workers N] [--coarse-rate HZ]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    Planetoid *kerbin = planetoid_init(planetoid_alloc());
+    kerbin_radius = kerbin->radius;
+    Program *throttle_program = init_throttle_seed(program_init(program_alloc(), SCENARIO_SEED_LENGTH));
+    Program *altitude_angle_program = init_altitude_angle_seed(program_init(program_alloc(), SCENARIO_SEED_LENGTH));
+
+    PararealBenchFlight serial;
+    parareal_bench_ready(&serial, kerbin, throttle_program, altitude_angle_program, ticks_per_second);
+    double start = parareal_bench_clock();
+    system_run(&serial.system);
+    double serial_seconds = parareal_bench_clock() - start;
+    const Frame *apex = &serial.system.stats.frame;
+
+    printf("rate: %.0f Hz, coarse: %.0f Hz\n", ticks_per_second, coarse_ticks_per_second);
+    printf("serial: %lu ticks in %f s, apex %.3f m at %.3f s\n", serial.system.ticks, serial_seconds, apex->altitude, apex->time);
+    printf("%8s %10s %10s %10s %8s %8s %12s %12s %8s\n", "workers", "wall(s)", "speedup", "iterations", "bound", "work", "d_alt(m)", "d_speed(m/s)", "d_ticks");
+
+    for(unsigned workers=1; workers<=max_workers; workers*=2) {
+        PararealBenchFlight flight;
+        parareal_bench_ready(&flight, kerbin, throttle_program, altitude_angle_program, ticks_per_second);
+        Parareal *parareal = parareal_init(parareal_alloc(), workers);
+        parareal->coarse_ticks_per_second = coarse_ticks_per_second;
+
+        start = parareal_bench_clock();
+        parareal_run(parareal, &flight.system);
+        double seconds = parareal_bench_clock() - start;
+
+        const Frame *parallel_apex = &flight.system.stats.frame;
+        double altitude_error = parallel_apex->altitude - apex->altitude;
+        double speed_error = vector_mag(parallel_apex->velocity) - vector_mag(apex->velocity);
+        printf(
+            "%8u %10.4f %10.2f %10u %8.2f %8.2f %12.3g %12.3g %8ld%s\n",
+            workers,
+            seconds,
+            serial_seconds/seconds,
+            parareal->iterations,
+            (double)parareal->slices/parareal->iterations,
+            (double)parareal->fine_ticks/serial.system.ticks,
+            altitude_error,
+            speed_error,
+            (long)flight.system.ticks - (long)serial.system.ticks,
+            parareal->converged ? "" : " (not converged)"
+        );
+        parareal_dealloc(parareal);
+    }
+
+    program_dealloc(throttle_program);
+    program_dealloc(altitude_angle_program);
+    planetoid_dealloc(kerbin);
+    return 0;
+}
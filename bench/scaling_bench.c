@@ -0,0 +1,186 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "optimizer.h"
+#include "scenario.h"
+
+/*
+ * Measures how the optimizer scales over threads: a fixed, seeded search is
+ * run at 1, 2, 4, ... threads up to --max-threads, and its wall time taken
+ * with the monotonic clock.  Strong scaling keeps the work fixed (--children
+ * mutants a generation at every thread count); weak scaling grows it with
+ * the threads (--per-thread mutants a generation per thread).
+ *
+ * For each point prints evaluations per second, the speedup over one thread
+ * and the parallel efficiency (for weak scaling, the scaled speedup and the
+ * one thread time over this one), and the fraction of thread time spent idle
+ * at the generation barrier waiting for the slowest flight.  Each point is the
+ * fastest of --reps runs.  The generational search is the same at any thread
+ * count, so strong scaling also checks that every point finds the same
+ * fitness.
+ */
+
+#define SCALING_BENCH_GENERATIONS 8
+#define SCALING_BENCH_CHILDREN 64 //Strong scaling: mutants per generation at every thread count.
+#define SCALING_BENCH_PER_THREAD 8 //Weak scaling: mutants per generation per thread.
+#define SCALING_BENCH_REPS 3
+#define SCALING_BENCH_SEED 1
+
+typedef struct ScalingPoint {
+    unsigned threads;
+    unsigned children;
+    unsigned long evaluations;
+    double wall_seconds;
+    double idle_fraction;
+    double fitness;
+} ScalingPoint;
+
+static void scaling_run(const Planetoid *planetoid, const Program *throttle_program, const Program *altitude_angle_program, OptimizerMode mode, unsigned generations, unsigned long seed, unsigned reps, ScalingPoint *point) {
+    point->wall_seconds = INFINITY;
+    for(unsigned rep=0; rep<reps; rep++) {
+        Optimizer *optimizer = optimizer_init(optimizer_alloc());
+        optimizer->rocket_factory_func = (InitFunc)init_large_rocket;
+        optimizer->planetoid = planetoid;
+        optimizer->seed_throttle_program = throttle_program;
+        optimizer->seed_altitude_angle_program = altitude_angle_program;
+        optimizer->throttle_cutoff_radius = planetoid->radius + 80000.0;
+        optimizer->generations = generations;
+        optimizer->children = point->children;
+        optimizer->workers = point->threads;
+        optimizer->mode = mode;
+        optimizer->quiet = true;
+        rng_init(&optimizer->rng, seed);
+
+        //The wall time covers the generations only, not the seed flight.
+        optimizer_run(optimizer);
+        if(optimizer->wall_seconds < point->wall_seconds) {
+            point->evaluations = optimizer->evaluations;
+            point->wall_seconds = optimizer->wall_seconds;
+            point->idle_fraction = optimizer_idle_fraction(optimizer);
+            point->fitness = optimizer->best_fitness;
+        }
+        optimizer_dealloc(optimizer);
+    }
+}
+
+static void usage(const char *name) {
+    fprintf(stderr, "usage: %s [--max-threads N] [--generations N] [--children N] [--per-thread N]\n", name);
+    fprintf(stderr, "       [--reps N] [--seed N] [--steady-state] [--strong-only | --weak-only] [--csv FILE]\n");
+}
+
+int main(int argc, char **argv) {
+    unsigned max_threads = OPTIMIZER_CHILDREN;
+    unsigned generations = SCALING_BENCH_GENERATIONS;
+    unsigned children = SCALING_BENCH_CHILDREN;
+    unsigned per_thread = SCALING_BENCH_PER_THREAD;
+    unsigned reps = SCALING_BENCH_REPS;
+    unsigned long seed = SCALING_BENCH_SEED;
+    OptimizerMode mode = OPTIMIZER_MODE_GENERATIONAL;
+    bool strong = true;
+    bool weak = true;
+    const char *csv_path = NULL;
+
+    for(int i=1; i<argc; i++) {
+        if( strcmp(argv[i], "--max-threads") == 0 && i+1 < argc && atoi(argv[i+1]) > 0 ) {
+            max_threads = (unsigned)atoi(argv[++i]);
+        } else if( strcmp(argv[i], "--generations") == 0 && i+1 < argc && atoi(argv[i+1]) > 0 ) {
+            generations = (unsigned)atoi(argv[++i]);
+        } else if( strcmp(argv[i], "--children") == 0 && i+1 < argc && atoi(argv[i+1]) > 0 ) {
+            children = (unsigned)atoi(argv[++i]);
+        } else if( strcmp(argv[i], "--per-thread") == 0 && i+1 < argc && atoi(argv[i+1]) > 0 ) {
+            per_thread = (unsigned)atoi(argv[++i]);
+        } else if( strcmp(argv[i], "--reps") == 0 && i+1 < argc && atoi(argv[i+1]) > 0 ) {
+            reps = (unsigned)atoi(argv[++i]);
+        } else if( strcmp(argv[i], "--seed") == 0 && i+1 < argc ) {
+            seed = strtoul(argv[++i], NULL, 10);
+        } else if( strcmp(argv[i], "--steady-state") == 0 ) {
+            mode = OPTIMIZER_MODE_STEADY_STATE;
+        } else if( strcmp(argv[i], "--strong-only") == 0 ) {
+            weak = false;
+        } else if( strcmp(argv[i], "--weak-only") == 0 ) {
+            strong = false;
+        } else if( strcmp(argv[i], "--csv") == 0 && i+1 < argc ) {
+            csv_path = argv[++i];
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    FILE *csv = csv_path ? fopen(csv_path, "w") : NULL;
+    if(csv_path && !csv) {
+        perror(csv_path);
+        return 1;
+    }
+    if(csv)
+        fprintf(csv, "scaling,mode,threads,children,generations,evaluations,wall_seconds,evaluations_per_second,speedup,efficiency,idle_fraction,fitness\n");
+
+    //1, 2, 4, ... and max_threads itself.
+    unsigned counts[8*sizeof(unsigned)+1];
+    size_t count_length = 0;
+    for(unsigned threads=1; threads<max_threads; threads*=2)
+        counts[count_length++] = threads;
+    counts[count_length++] = max_threads;
+
+    Planetoid *kerbin = planetoid_init(planetoid_alloc());
+    kerbin_radius = kerbin->radius;
+
+    Program *throttle_program = init_throttle_seed(program_init(program_alloc(), SCENARIO_SEED_LENGTH));
+    Program *altitude_angle_program = init_altitude_angle_seed(program_init(program_alloc(), SCENARIO_SEED_LENGTH));
+
+    const char *mode_name = (mode == OPTIMIZER_MODE_STEADY_STATE) ? "steady-state" : "generational";
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    printf("%s, %u generations, seed %lu, best of %u; %ld cores online\n", mode_name, generations, seed, reps, cores);
+    printf("%-7s %7s %8s %11s %9s %10s %8s %10s %6s %11s\n", "scaling", "threads", "children", "evaluations", "wall s", "evals/s", "speedup", "efficiency", "idle", "fitness");
+
+    int status = 0;
+    for(int pass=0; pass<2; pass++) {
+        bool weak_pass = (pass == 1);
+        if((weak_pass && !weak) || (!weak_pass && !strong))
+            continue;
+
+        ScalingPoint base;
+        for(size_t c=0; c<count_length; c++) {
+            ScalingPoint point = {0};
+            point.threads = counts[c];
+            point.children = weak_pass ? per_thread * counts[c] : children;
+            scaling_run(kerbin, throttle_program, altitude_angle_program, mode, generations, seed, reps, &point);
+            if(c == 0)
+                base = point;
+
+            //Weak scaling does threads times the work, so its speedup is scaled by the threads.
+            double ratio = base.wall_seconds / point.wall_seconds;
+            double speedup = weak_pass ? ratio * point.threads : ratio;
+            double efficiency = weak_pass ? ratio : ratio / point.threads;
+            double rate = point.evaluations / point.wall_seconds;
+
+            printf("%-7s %7u %8u %11lu %9.3f %10.1f %8.2f %9.1f%% %5.1f%% %11.4f\n",
+                    weak_pass ? "weak" : "strong", point.threads, point.children, point.evaluations,
+                    point.wall_seconds, rate, speedup, 100.0*efficiency, 100.0*point.idle_fraction, point.fitness);
+            fflush(stdout);
+            if(csv) {
+                fprintf(csv, "%s,%s,%u,%u,%u,%lu,%.6f,%.3f,%.6f,%.6f,%.6f,%.6f\n",
+                        weak_pass ? "weak" : "strong", mode_name, point.threads, point.children, generations, point.evaluations,
+                        point.wall_seconds, rate, speedup, efficiency, point.idle_fraction, point.fitness);
+            }
+
+            if(!weak_pass && mode == OPTIMIZER_MODE_GENERATIONAL && point.fitness != base.fitness) {
+                fprintf(stderr, "%u threads found fitness %f, not %f as on one thread\n", point.threads, point.fitness, base.fitness);
+                status = 1;
+            }
+        }
+    }
+
+    if(csv)
+        fclose(csv);
+
+    program_dealloc(throttle_program);
+    program_dealloc(altitude_angle_program);
+    planetoid_dealloc(kerbin);
+
+    return status;
+}
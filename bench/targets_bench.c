@@ -0,0 +1,142 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "optimizer.h"
+#include "scenario.h"
+#include "targets.h"
+
+/*
+ * Measures what flying a family of targets at once costs: a fixed set of
+ * mutants of the seed programs is flown against each target altitude
+ * separately, against the highest alone, and once forking at every cutoff
+ * (targets.h), all on one thread.  Prints the wall time and ticks of each and
+ * the forked time over the highest alone's, and exits non-zero unless every
+ * forked fitness is exactly the separate flight's.
+ *
+ *   targets_bench [--targets ALT,ALT,...] [--candidates N] [--seed N]
+ */
+
+#define TARGETS_BENCH_CANDIDATES 200
+#define TARGETS_BENCH_SEED 1
+
+static double targets_bench_clock(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + 1e-9*now.tv_nsec;
+}
+
+//Flies every candidate against one cutoff radius; returns the seconds taken.
+static double targets_bench_single(Optimizer *optimizer, System **systems, size_t count, double cutoff_radius, double *fitness, unsigned long *ticks) {
+    optimizer->throttle_cutoff_radius = cutoff_radius;
+    double start = targets_bench_clock();
+    for(size_t i=0; i<count; i++) {
+        optimizer_reset_system(optimizer, systems[i], SYSTEM_TICKS_PER_SECOND);
+        system_run(systems[i]);
+        fitness[i] = optimizer_fitness(systems[i]);
+        *ticks += systems[i]->ticks;
+    }
+    return targets_bench_clock() - start;
+}
+
+static bool targets_bench_parse(char *text, double *altitudes, unsigned *count) {
+    *count = 0;
+    char *save = NULL;
+    for(char *item = strtok_r(text, ",", &save); item; item = strtok_r(NULL, ",", &save)) {
+        if(*count == OPTIMIZER_MAX_TARGETS || atof(item) <= 0.0)
+            return false;
+        altitudes[(*count)++] = atof(item);
+    }
+    return *count > 0;
+}
+
+int main(int argc, char **argv) {
+    double altitudes[OPTIMIZER_MAX_TARGETS] = {70000.0, 80000.0, 90000.0, 100000.0};
+    unsigned target_count = 4;
+    size_t count = TARGETS_BENCH_CANDIDATES;
+    unsigned long seed = TARGETS_BENCH_SEED;
+    for(int i=1; i<argc; i++) {
+        if( strcmp(argv[i], "--targets") == 0 && i+1 < argc && targets_bench_parse(argv[i+1], altitudes, &target_count) ) {
+            i++;
+        } else if( strcmp(argv[i], "--candidates") == 0 && i+1 < argc && atoi(argv[i+1]) > 0 ) {
+            count = (size_t)atoi(argv[++i]);
+        } else if( strcmp(argv[i], "--seed") == 0 && i+1 < argc ) {
+            seed = strtoul(argv[++i], NULL, 10);
+        } else {
+            fprintf(stderr, "usage: %s [--targets ALT,ALT,...] [--candidates N] [--seed N]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    Planetoid *kerbin = planetoid_init(planetoid_alloc());
+    kerbin_radius = kerbin->radius;
+    Program *throttle_program = init_throttle_seed(program_init(program_alloc(), SCENARIO_SEED_LENGTH));
+    Program *altitude_angle_program = init_altitude_angle_seed(program_init(program_alloc(), SCENARIO_SEED_LENGTH));
+
+    Optimizer *optimizer = optimizer_init(optimizer_alloc());
+    optimizer->rocket_factory_func = (InitFunc)init_large_rocket;
+    optimizer->planetoid = kerbin;
+    double radii[OPTIMIZER_MAX_TARGETS];
+    for(unsigned t=0; t<target_count; t++)
+        radii[t] = kerbin->radius + altitudes[t];
+    optimizer_set_targets(optimizer, radii, target_count);
+
+    //The seed programs, then mutants of them.
+    Rng rng;
+    rng_init(&rng, seed);
+    System **systems = (System **)malloc(sizeof(System *) * count);
+    for(size_t i=0; i<count; i++) {
+        Program *throttle = (i == 0) ? program_init_copy(program_alloc(), throttle_program) : optimizer_mutate_throttle_program(throttle_program, &rng);
+        Program *altitude_angle = (i == 0) ? program_init_copy(program_alloc(), altitude_angle_program) : optimizer_mutate_altitude_angle_program(altitude_angle_program, &rng);
+        systems[i] = optimizer_make_system(optimizer, throttle, altitude_angle);
+    }
+
+    double *separate = (double *)malloc(sizeof(double) * count * target_count);
+    unsigned long separate_ticks = 0;
+    double separate_seconds = 0.0;
+    for(unsigned t=0; t<target_count; t++)
+        separate_seconds += targets_bench_single(optimizer, systems, count, optimizer->target_radii[t], &separate[t*count], &separate_ticks);
+
+    unsigned long highest_ticks = 0;
+    double *highest = (double *)malloc(sizeof(double) * count);
+    double highest_seconds = targets_bench_single(optimizer, systems, count, optimizer->target_radii[target_count-1], highest, &highest_ticks);
+
+    //Forked, checked against the separate flights.
+    optimizer->throttle_cutoff_radius = optimizer->target_radii[target_count-1];
+    unsigned long forked_ticks = 0;
+    size_t mismatches = 0;
+    double start = targets_bench_clock();
+    for(size_t i=0; i<count; i++) {
+        optimizer_reset_system(optimizer, systems[i], SYSTEM_TICKS_PER_SECOND);
+        OptimizerSystemResult *result = optimizer_run_targets(optimizer, systems[i]);
+        forked_ticks += result->ticks;
+        for(unsigned t=0; t<target_count; t++) {
+            double expected = separate[t*count + i];
+            if(result->target_fitness[t] != expected && !(isinf(expected) && isinf(result->target_fitness[t])))
+                mismatches++;
+        }
+        free(result);
+    }
+    double forked_seconds = targets_bench_clock() - start;
+
+    printf("%u targets, %zu candidates\n", target_count, count);
+    printf("%-14s %10s %12s\n", "", "wall s", "ticks");
+    printf("%-14s %10.3f %12lu\n", "separate", separate_seconds, separate_ticks);
+    printf("%-14s %10.3f %12lu\n", "highest alone", highest_seconds, highest_ticks);
+    printf("%-14s %10.3f %12lu\n", "forked", forked_seconds, forked_ticks);
+    printf("forked / highest alone: %.2fx time, %.2fx ticks; separate / forked: %.2fx time\n",
+            forked_seconds / highest_seconds, (double)forked_ticks / (double)highest_ticks, separate_seconds / forked_seconds);
+    if(mismatches > 0)
+        fprintf(stderr, "%zu forked fitnesses differ from the separate flights\n", mismatches);
+
+    free(highest);
+    free(separate);
+    optimizer_destroy_systems(systems, count);
+    optimizer_dealloc(optimizer);
+    program_dealloc(throttle_program);
+    program_dealloc(altitude_angle_program);
+    planetoid_dealloc(kerbin);
+    return mismatches > 0 ? 1 : 0;
+}
@@ -0,0 +1,97 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "system.h"
+#include "system3.h"
+#include "scenario.h"
+
+/*
+ * Measures raw simulation speed: flies the seed programs on the large rocket
+ * repeatedly on one thread and reports ticks per second of wall time, for
+ * System and then for System3 in the same plane (which should reach the same
+ * apex) and at an inclination.
+ */
+
+#define TICK_BENCH_FLIGHTS 200
+#define TICK_BENCH_INCLINATION (30.0*DEGREE)
+
+static double tick_bench_clock(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + 1e-9*now.tv_nsec;
+}
+
+int main(int argc, char **argv) {
+    unsigned flights = (argc > 1) ? (unsigned)atoi(argv[1]) : TICK_BENCH_FLIGHTS;
+
+    Planetoid *kerbin = planetoid_init(planetoid_alloc());
+    kerbin_radius = kerbin->radius;
+
+    Program *throttle_program = init_throttle_seed(program_init(program_alloc(), SCENARIO_SEED_LENGTH));
+    Program *altitude_angle_program = init_altitude_angle_seed(program_init(program_alloc(), SCENARIO_SEED_LENGTH));
+
+    Rocket *rocket = rocket_alloc();
+    System *system = system_alloc();
+
+    unsigned long ticks = 0;
+    double apex = 0.0;
+    double start = tick_bench_clock();
+    for(unsigned i=0; i<flights; i++) {
+        system_init(system);
+        system->planetoid = kerbin;
+        system->rocket = init_large_rocket(rocket);
+        system->throttle_program = throttle_program;
+        system->altitude_angle_program = altitude_angle_program;
+        system->throttle_cutoff_radius = kerbin->radius + 80000.0;
+
+        system_run(system);
+        ticks += system->ticks;
+        apex = system->stats.frame.altitude;
+    }
+    double seconds = tick_bench_clock() - start;
+
+    printf("flights: %u, ticks: %lu, apex: %f m\n", flights, ticks, apex);
+    printf("time   : %f s\n", seconds);
+    printf("rate   : %f ticks/s (%f ns/tick)\n", ticks/seconds, 1e9*seconds/ticks);
+
+    System3 *system3 = system3_alloc();
+    double inclinations[] = {0.0, TICK_BENCH_INCLINATION};
+    for(int k=0; k<2; k++) {
+        ticks = 0;
+        double inclination = 0.0;
+        start = tick_bench_clock();
+        for(unsigned i=0; i<flights; i++) {
+            system3_init(system3);
+            system3->planetoid = kerbin;
+            system3->rocket = init_large_rocket(rocket);
+            system3_place(system3, rocket, inclinations[k]);
+            system3->throttle_program = throttle_program;
+            system3->altitude_angle_program = altitude_angle_program;
+            system3->throttle_cutoff_radius = kerbin->radius + 80000.0;
+
+            system3_run(system3);
+            ticks += system3->ticks;
+            Vector3 relative = system3_relative_position(system3, system3->last_position);
+            apex = vector3_mag(relative) - kerbin->radius;
+            //The System flight goes clockwise, so its orbit normal is (0,0,-1).
+            Vector3 angular_momentum = vector3_cross(relative, system3->last_velocity);
+            inclination = acos(-VZ(angular_momentum) / vector3_mag(angular_momentum));
+        }
+        seconds = tick_bench_clock() - start;
+
+        printf("3D, inclined %.1f deg:\n", inclinations[k]*RADIAN);
+        printf("flights: %u, ticks: %lu, apex: %f m, inclination: %.3f deg\n", flights, ticks, apex, inclination*RADIAN);
+        printf("time   : %f s\n", seconds);
+        printf("rate   : %f ticks/s (%f ns/tick)\n", ticks/seconds, 1e9*seconds/ticks);
+    }
+
+    system3_dealloc(system3);
+    system_dealloc(system);
+    rocket_dealloc(rocket);
+    program_dealloc(throttle_program);
+    program_dealloc(altitude_angle_program);
+    planetoid_dealloc(kerbin);
+
+    return 0;
+}
@@ -0,0 +1,85 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "vector.h"
+#include "orbit.h"
+#include "vector_outline.h"
+
+/*
+ * Compares the header-inline vector layer against the original out-of-line
+ * functions on the vector work of one simulation tick: gravity, drag and
+ * thrust forces, their sum, the position update and the orbital energy and
+ * angular momentum.  Both kernels do the same arithmetic in the same order.
+ */
+
+#define VECTOR_BENCH_STEPS 20000000
+#define VECTOR_BENCH_MU 3531600000000.0
+#define VECTOR_BENCH_DT 0.01
+
+static double vector_bench_clock(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + 1e-9*now.tv_nsec;
+}
+
+static double vector_bench_inline(unsigned long steps) {
+    Vector r = vector_rect(0.0, 600072.0);
+    Vector v = vector_rect(174.5, 0.0);
+    double checksum = 0.0;
+    for(unsigned long i=0; i<steps; i++) {
+        double rmag = vector_mag(r);
+        Vector gravity = vector_polar(-VECTOR_BENCH_MU/(rmag*rmag), vector_azm(r));
+        Vector drag = vector_polar(-1e-4 * vector_inner(v,v), vector_azm(v));
+        Vector thrust = vector_polar(15.0, vector_azm(r) + 0.1);
+        Vector a = vector_add(vector_add(gravity, drag), thrust);
+        v = vector_add(v, vector_rect(VX(a)*VECTOR_BENCH_DT, VY(a)*VECTOR_BENCH_DT));
+        r = vector_add(r, vector_rect(VX(v)*VECTOR_BENCH_DT, VY(v)*VECTOR_BENCH_DT));
+
+        double periapsis, apoapsis;
+        double energy = 0.5*vector_inner(v,v) - VECTOR_BENCH_MU/vector_mag(r);
+        orbit_apses(VECTOR_BENCH_MU, vector_cross(r, v), energy, &periapsis, &apoapsis);
+        checksum += apoapsis;
+    }
+    return checksum;
+}
+
+static double vector_bench_outline(unsigned long steps) {
+    OutlineVector r = outline_vector_rect(0.0, 600072.0);
+    OutlineVector v = outline_vector_rect(174.5, 0.0);
+    double checksum = 0.0;
+    for(unsigned long i=0; i<steps; i++) {
+        double rmag = outline_vector_mag(r);
+        OutlineVector gravity = outline_vector_polar(-VECTOR_BENCH_MU/(rmag*rmag), outline_vector_azm(r));
+        OutlineVector drag = outline_vector_polar(-1e-4 * outline_vector_inner(v,v), outline_vector_azm(v));
+        OutlineVector thrust = outline_vector_polar(15.0, outline_vector_azm(r) + 0.1);
+        OutlineVector a = outline_vector_add(outline_vector_add(gravity, drag), thrust);
+        v = outline_vector_add(v, outline_vector_rect(a.v[0]*VECTOR_BENCH_DT, a.v[1]*VECTOR_BENCH_DT));
+        r = outline_vector_add(r, outline_vector_rect(v.v[0]*VECTOR_BENCH_DT, v.v[1]*VECTOR_BENCH_DT));
+
+        double periapsis, apoapsis;
+        double energy = 0.5*outline_vector_inner(v,v) - VECTOR_BENCH_MU/outline_vector_mag(r);
+        orbit_apses(VECTOR_BENCH_MU, outline_vector_cross(r, v), energy, &periapsis, &apoapsis);
+        checksum += apoapsis;
+    }
+    return checksum;
+}
+
+int main(int argc, char **argv) {
+    unsigned long steps = (argc > 1) ? strtoul(argv[1], NULL, 10) : VECTOR_BENCH_STEPS;
+
+    double start = vector_bench_clock();
+    double outline_checksum = vector_bench_outline(steps);
+    double outline_seconds = vector_bench_clock() - start;
+
+    start = vector_bench_clock();
+    double inline_checksum = vector_bench_inline(steps);
+    double inline_seconds = vector_bench_clock() - start;
+
+    printf("steps      : %lu\n", steps);
+    printf("out-of-line: %f ns/step (checksum %e)\n", 1e9*outline_seconds/steps, outline_checksum);
+    printf("inline     : %f ns/step (checksum %e)\n", 1e9*inline_seconds/steps, inline_checksum);
+    printf("speedup    : %fx\n", outline_seconds/inline_seconds);
+
+    return (outline_checksum == inline_checksum) ? 0 : 1;
+}
@@ -0,0 +1,52 @@
+#include <stdlib.h>
+#include <math.h>
+
+#include "vector.h"
+#include "vector_outline.h"
+
+OutlineVector outline_vector_rect(double x, double y) {
+    OutlineVector v;
+    v.v[0] = x;
+    v.v[1] = y;
+    return v;
+}
+
+OutlineVector outline_vector_polar(double mag, double azm) {
+    OutlineVector v;
+    v.v[0] = mag * kerbal_cos(azm);
+    v.v[1] = mag * kerbal_sin(azm);
+    return v;
+}
+
+double outline_vector_mag(OutlineVector v) {
+    return sqrt(outline_vector_inner(v,v));
+}
+
+double outline_vector_azm(OutlineVector v) {
+    return kerbal_atan2(v.v[1], v.v[0]);
+}
+
+double outline_vector_inner(OutlineVector v, OutlineVector u) {
+    double sum = 0.0;
+    for(size_t i=0; i<VECTOR_DIMS; i++)
+        sum += (u.v[i]*v.v[i]);
+    return sum;
+}
+
+double outline_vector_cross(OutlineVector v, OutlineVector u) {
+    return v.v[0]*u.v[1] -  v.v[1]*u.v[0];
+}
+
+OutlineVector outline_vector_add(OutlineVector v, OutlineVector u) {
+    OutlineVector w;
+    for(size_t i=0; i<VECTOR_DIMS; i++)
+        w.v[i] = v.v[i] + u.v[i];
+    return w;
+}
+
+OutlineVector outline_vector_sub(OutlineVector v, OutlineVector u) {
+    OutlineVector w;
+    for(size_t i=0; i<VECTOR_DIMS; i++)
+        w.v[i] = v.v[i] - u.v[i];
+    return w;
+}
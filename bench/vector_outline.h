@@ -0,0 +1,25 @@
+#ifndef KERBAL_LAUNCH_VECTOR_OUTLINE_H
+#define KERBAL_LAUNCH_VECTOR_OUTLINE_H
+
+/*
+ * The original out-of-line vector functions, kept only as the baseline for
+ * bench/vector_bench.  They live in their own translation unit so that, as
+ * before, every call is a real call.
+ */
+typedef struct OutlineVector {
+    double v[2];
+} OutlineVector;
+
+OutlineVector outline_vector_rect(double x, double y);
+OutlineVector outline_vector_polar(double mag, double azm);
+
+double outline_vector_mag(OutlineVector v);
+double outline_vector_azm(OutlineVector v);
+
+double outline_vector_inner(OutlineVector v, OutlineVector u);
+double outline_vector_cross(OutlineVector v, OutlineVector u);
+
+OutlineVector outline_vector_add(OutlineVector v, OutlineVector u);
+OutlineVector outline_vector_sub(OutlineVector v, OutlineVector u);
+
+#endif
@@ -0,0 +1,79 @@
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+
+#include "cache.h"
+
+FitnessCache *fitness_cache_alloc(void) {
+    return (FitnessCache *)malloc(sizeof(FitnessCache));
+}
+
+void fitness_cache_dealloc(FitnessCache *self) {
+    pthread_mutex_destroy(&self->mutex);
+    free(self->entries);
+    free(self);
+}
+
+FitnessCache *fitness_cache_init(FitnessCache *self, size_t capacity) {
+    assert(capacity > 0 && (capacity & (capacity-1)) == 0);
+    self->capacity = capacity;
+    self->entries = (FitnessCacheEntry *)calloc(capacity, sizeof(FitnessCacheEntry));
+    self->hits = 0;
+    self->misses = 0;
+    pthread_mutex_init(&self->mutex, NULL);
+    return self;
+}
+
+bool fitness_cache_lookup(FitnessCache *self, uint64_t key, double *fitness, unsigned long *ticks) {
+    key = key ? key : 1;
+    pthread_mutex_lock(&self->mutex);
+    const FitnessCacheEntry *entry = &self->entries[key & (self->capacity-1)];
+    bool hit = entry->key == key;
+    if(hit) {
+        *fitness = entry->fitness;
+        *ticks = entry->ticks;
+        self->hits++;
+    } else {
+        self->misses++;
+    }
+    pthread_mutex_unlock(&self->mutex);
+    return hit;
+}
+
+void fitness_cache_store(FitnessCache *self, uint64_t key, double fitness, unsigned long ticks) {
+    key = key ? key : 1;
+    pthread_mutex_lock(&self->mutex);
+    FitnessCacheEntry *entry = &self->entries[key & (self->capacity-1)];
+    entry->key = key;
+    entry->fitness = fitness;
+    entry->ticks = ticks;
+    pthread_mutex_unlock(&self->mutex);
+}
+
+double fitness_cache_hit_rate(FitnessCache *self) {
+    pthread_mutex_lock(&self->mutex);
+    unsigned long lookups = self->hits + self->misses;
+    double rate = lookups ? (double)self->hits / (double)lookups : NAN;
+    pthread_mutex_unlock(&self->mutex);
+    return rate;
+}
+
+/*
+ * Copies the occupied entries into a new array the caller frees, and returns
+ * how many there are.
+ */
+size_t fitness_cache_snapshot(FitnessCache *self, FitnessCacheEntry **entries) {
+    pthread_mutex_lock(&self->mutex);
+    size_t count = 0;
+    for(size_t i=0; i<self->capacity; i++)
+        count += self->entries[i].key != 0;
+    *entries = (FitnessCacheEntry *)malloc(sizeof(FitnessCacheEntry) * (count ? count : 1));
+    size_t n = 0;
+    for(size_t i=0; i<self->capacity; i++) {
+        if(self->entries[i].key != 0)
+            memcpy(&(*entries)[n++], &self->entries[i], sizeof(FitnessCacheEntry));
+    }
+    pthread_mutex_unlock(&self->mutex);
+    return count;
+}
@@ -0,0 +1,52 @@
+#ifndef KERBAL_LAUNCH_CACHE_H
+#define KERBAL_LAUNCH_CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#define FITNESS_CACHE_DEFAULT_CAPACITY 65536 //Must be a power of two.
+
+#define FITNESS_CACHE_HASH_SEED 0xcbf29ce484222325ULL
+
+/*
+ * A direct-mapped cache from a hash of (scenario, programs, tick rate) to the
+ * fitness it scored.  Mutation often redraws a gene's current value, so the
+ * same candidate comes up again and again; a hit skips the whole flight.
+ * A colliding store simply replaces the older entry.  Thread safe.
+ */
+typedef struct FitnessCacheEntry {
+    uint64_t key; //0 marks an empty slot.
+    double fitness;
+    unsigned long ticks;
+} FitnessCacheEntry;
+
+typedef struct FitnessCache {
+    size_t capacity;
+    FitnessCacheEntry *entries;
+    unsigned long hits;
+    unsigned long misses;
+    pthread_mutex_t mutex;
+} FitnessCache;
+
+FitnessCache *fitness_cache_alloc(void);
+void fitness_cache_dealloc(FitnessCache *self);
+FitnessCache *fitness_cache_init(FitnessCache *self, size_t capacity);
+
+bool fitness_cache_lookup(FitnessCache *self, uint64_t key, double *fitness, unsigned long *ticks);
+void fitness_cache_store(FitnessCache *self, uint64_t key, double fitness, unsigned long ticks);
+double fitness_cache_hit_rate(FitnessCache *self);
+size_t fitness_cache_snapshot(FitnessCache *self, FitnessCacheEntry **entries);
+
+//FNV-1a, chained through hash so a key can be built from several pieces.
+static inline uint64_t fitness_cache_hash(uint64_t hash, const void *bytes, size_t size) {
+    const unsigned char *p = (const unsigned char *)bytes;
+    for(size_t i=0; i<size; i++) {
+        hash ^= p[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+#endif
@@ -0,0 +1,396 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#include "checkpoint.h"
+#include "cache.h"
+
+typedef struct CheckpointBuffer {
+    unsigned char *bytes;
+    size_t size;
+    size_t capacity;
+} CheckpointBuffer;
+
+typedef struct CheckpointReader {
+    const unsigned char *bytes;
+    size_t size;
+    size_t offset;
+    bool error;
+} CheckpointReader;
+
+static void *checkpointer_main(Checkpointer *self);
+
+static void checkpoint_put(CheckpointBuffer *buffer, uint64_t value, size_t width);
+static void checkpoint_put_double(CheckpointBuffer *buffer, double value);
+static void checkpoint_put_program(CheckpointBuffer *buffer, const Program *program);
+static uint64_t checkpoint_get(CheckpointReader *reader, size_t width);
+static double checkpoint_get_double(CheckpointReader *reader);
+static Program *checkpoint_get_program(CheckpointReader *reader);
+static uint64_t checkpoint_hash(const unsigned char *bytes, size_t size);
+
+Checkpointer *checkpointer_alloc(void) {
+    return (Checkpointer *)malloc(sizeof(Checkpointer));
+}
+
+void checkpointer_dealloc(Checkpointer *self) {
+    free(self->pending);
+    free(self->path);
+    pthread_cond_destroy(&self->cond);
+    pthread_mutex_destroy(&self->mutex);
+    free(self);
+}
+
+Checkpointer *checkpointer_init(Checkpointer *self, const char *path) {
+    self->path = strdup(path);
+
+    pthread_mutex_init(&self->mutex, NULL);
+    pthread_cond_init(&self->cond, NULL);
+
+    self->pending = NULL;
+    self->pending_size = 0;
+    self->stopping = false;
+
+    self->written = 0;
+    self->failed = false;
+
+    pthread_create(&self->thread, NULL, (void *(*)(void *))checkpointer_main, self);
+
+    return self;
+}
+
+/*
+ * Hands an encoded image (and its ownership) to the writer thread.  Returns at
+ * once; the caller never waits on the disk.
+ */
+void checkpointer_submit(Checkpointer *self, unsigned char *image, size_t size) {
+    pthread_mutex_lock(&self->mutex);
+    free(self->pending);
+    self->pending = image;
+    self->pending_size = size;
+    pthread_cond_signal(&self->cond);
+    pthread_mutex_unlock(&self->mutex);
+}
+
+/*
+ * Writes any pending image and stops the writer thread.
+ */
+void checkpointer_finish(Checkpointer *self) {
+    pthread_mutex_lock(&self->mutex);
+    self->stopping = true;
+    pthread_cond_signal(&self->cond);
+    pthread_mutex_unlock(&self->mutex);
+    pthread_join(self->thread, NULL);
+}
+
+static void *checkpointer_main(Checkpointer *self) {
+    pthread_mutex_lock(&self->mutex);
+    while(true) {
+        while(self->pending == NULL && !self->stopping)
+            pthread_cond_wait(&self->cond, &self->mutex);
+        if(self->pending == NULL)
+            break;
+
+        unsigned char *image = self->pending;
+        size_t size = self->pending_size;
+        self->pending = NULL;
+
+        //Write without the lock held so submissions never block on the disk.
+        pthread_mutex_unlock(&self->mutex);
+        bool ok = checkpoint_write_file(self->path, image, size);
+        free(image);
+        pthread_mutex_lock(&self->mutex);
+
+        if(ok)
+            self->written++;
+        else
+            self->failed = true;
+    }
+    pthread_mutex_unlock(&self->mutex);
+    return NULL;
+}
+
+unsigned char *checkpoint_encode(const Optimizer *optimizer, size_t *size) {
+    CheckpointBuffer buffer = {NULL, 0, 0};
+
+    checkpoint_put(&buffer, 'K' | 'L'<<8 | 'C'<<16 | (uint64_t)'K'<<24, 4);
+    checkpoint_put(&buffer, CHECKPOINT_VERSION, 4);
+
+    checkpoint_put(&buffer, optimizer->mode, 4);
+    checkpoint_put(&buffer, optimizer->generation, 4);
+    checkpoint_put(&buffer, optimizer->generations, 4);
+    checkpoint_put(&buffer, optimizer->evaluations, 8);
+
+    checkpoint_put_double(&buffer, optimizer->throttle_cutoff_radius);
+    checkpoint_put_double(&buffer, optimizer->best_fitness);
+    for(int i=0; i<4; i++)
+        checkpoint_put(&buffer, optimizer->rng.state[i], 8);
+
+    checkpoint_put_program(&buffer, optimizer->best_throttle_program);
+    checkpoint_put_program(&buffer, optimizer->best_altitude_angle_program);
+
+    checkpoint_put(&buffer, OPTIMIZER_MAX_RUNGS, 4);
+    for(unsigned i=0; i<OPTIMIZER_MAX_RUNGS; i++) {
+        checkpoint_put_double(&buffer, optimizer->halving_correlation_sum[i]);
+        checkpoint_put(&buffer, optimizer->halving_correlation_count[i], 4);
+    }
+
+    //A resumed run would otherwise fly again every candidate it has already seen.
+    FitnessCacheEntry *cached = NULL;
+    size_t cached_count = optimizer->cache ? fitness_cache_snapshot(optimizer->cache, &cached) : 0;
+    checkpoint_put(&buffer, cached_count, 8);
+    for(size_t i=0; i<cached_count; i++) {
+        checkpoint_put(&buffer, cached[i].key, 8);
+        checkpoint_put_double(&buffer, cached[i].fitness);
+        checkpoint_put(&buffer, cached[i].ticks, 8);
+    }
+    free(cached);
+
+    checkpoint_put(&buffer, optimizer->targets, 4);
+    for(unsigned t=0; t<optimizer->targets; t++) {
+        checkpoint_put_double(&buffer, optimizer->target_radii[t]);
+        checkpoint_put_double(&buffer, optimizer->target_fitness[t]);
+        checkpoint_put_program(&buffer, optimizer->target_throttle_programs[t]);
+        checkpoint_put_program(&buffer, optimizer->target_altitude_angle_programs[t]);
+    }
+
+    checkpoint_put(&buffer, checkpoint_hash(buffer.bytes, buffer.size), 8);
+
+    *size = buffer.size;
+    return buffer.bytes;
+}
+
+/*
+ * Restores the search state into an initialized optimizer, which takes
+ * ownership of the restored best programs and whose cache, if it has one,
+ * takes the cached fitnesses.  Fails if the checkpoint was written in another
+ * mode, or for other targets, than the optimizer's.  On failure the optimizer
+ * is left untouched.
+ */
+bool checkpoint_decode(Optimizer *optimizer, const unsigned char *image, size_t size) {
+    if(size < 16)
+        return false;
+
+    CheckpointReader reader = {image, size, 0, false};
+    if(checkpoint_get(&reader, 4) != ('K' | 'L'<<8 | 'C'<<16 | (uint64_t)'K'<<24))
+        return false;
+    if(checkpoint_get(&reader, 4) != CHECKPOINT_VERSION)
+        return false;
+
+    CheckpointReader trailer = {image, size, size-8, false};
+    if(checkpoint_get(&trailer, 8) != checkpoint_hash(image, size-8))
+        return false;
+
+    if((OptimizerMode)checkpoint_get(&reader, 4) != optimizer->mode)
+        return false;
+    unsigned generation = (unsigned)checkpoint_get(&reader, 4);
+    unsigned generations = (unsigned)checkpoint_get(&reader, 4);
+    unsigned long evaluations = (unsigned long)checkpoint_get(&reader, 8);
+
+    double throttle_cutoff_radius = checkpoint_get_double(&reader);
+    double best_fitness = checkpoint_get_double(&reader);
+    Rng rng;
+    for(int i=0; i<4; i++)
+        rng.state[i] = checkpoint_get(&reader, 8);
+
+    Program *best_throttle_program = checkpoint_get_program(&reader);
+    Program *best_altitude_angle_program = checkpoint_get_program(&reader);
+
+    unsigned rungs = (unsigned)checkpoint_get(&reader, 4);
+    if(rungs > OPTIMIZER_MAX_RUNGS)
+        reader.error = true;
+    double correlation_sum[OPTIMIZER_MAX_RUNGS] = {0.0};
+    unsigned correlation_count[OPTIMIZER_MAX_RUNGS] = {0};
+    for(unsigned i=0; i<rungs && !reader.error; i++) {
+        correlation_sum[i] = checkpoint_get_double(&reader);
+        correlation_count[i] = (unsigned)checkpoint_get(&reader, 4);
+    }
+
+    size_t cached_count = (size_t)checkpoint_get(&reader, 8);
+    if(cached_count > (size - reader.offset) / 24)
+        reader.error = true;
+    FitnessCacheEntry *cached = reader.error ? NULL : (FitnessCacheEntry *)malloc(sizeof(FitnessCacheEntry) * (cached_count ? cached_count : 1));
+    for(size_t i=0; i<cached_count && !reader.error; i++) {
+        cached[i].key = checkpoint_get(&reader, 8);
+        cached[i].fitness = checkpoint_get_double(&reader);
+        cached[i].ticks = (unsigned long)checkpoint_get(&reader, 8);
+    }
+
+    //The targets must be the ones the optimizer was given.
+    Program *target_throttle_programs[OPTIMIZER_MAX_TARGETS] = {NULL};
+    Program *target_altitude_angle_programs[OPTIMIZER_MAX_TARGETS] = {NULL};
+    double target_fitness[OPTIMIZER_MAX_TARGETS];
+    if((unsigned)checkpoint_get(&reader, 4) != optimizer->targets)
+        reader.error = true;
+    for(unsigned t=0; t<optimizer->targets && !reader.error; t++) {
+        if(checkpoint_get_double(&reader) != optimizer->target_radii[t])
+            reader.error = true;
+        target_fitness[t] = checkpoint_get_double(&reader);
+        target_throttle_programs[t] = checkpoint_get_program(&reader);
+        target_altitude_angle_programs[t] = checkpoint_get_program(&reader);
+    }
+
+    if(reader.error || reader.offset != size-8) {
+        if(best_throttle_program)
+            program_dealloc(best_throttle_program);
+        if(best_altitude_angle_program)
+            program_dealloc(best_altitude_angle_program);
+        for(unsigned t=0; t<optimizer->targets; t++) {
+            if(target_throttle_programs[t])
+                program_dealloc(target_throttle_programs[t]);
+            if(target_altitude_angle_programs[t])
+                program_dealloc(target_altitude_angle_programs[t]);
+        }
+        free(cached);
+        return false;
+    }
+
+    optimizer->generation = generation;
+    optimizer->generations = generations;
+    optimizer->evaluations = evaluations;
+    optimizer->throttle_cutoff_radius = throttle_cutoff_radius;
+    optimizer->best_fitness = best_fitness;
+    optimizer->rng = rng;
+    if(optimizer->best_throttle_program)
+        program_dealloc(optimizer->best_throttle_program);
+    optimizer->best_throttle_program = best_throttle_program;
+    if(optimizer->best_altitude_angle_program)
+        program_dealloc(optimizer->best_altitude_angle_program);
+    optimizer->best_altitude_angle_program = best_altitude_angle_program;
+    for(unsigned i=0; i<OPTIMIZER_MAX_RUNGS; i++) {
+        optimizer->halving_correlation_sum[i] = correlation_sum[i];
+        optimizer->halving_correlation_count[i] = correlation_count[i];
+    }
+    if(optimizer->cache) {
+        for(size_t i=0; i<cached_count; i++)
+            fitness_cache_store(optimizer->cache, cached[i].key, cached[i].fitness, cached[i].ticks);
+    }
+    free(cached);
+    for(unsigned t=0; t<optimizer->targets; t++) {
+        if(optimizer->target_throttle_programs[t])
+            program_dealloc(optimizer->target_throttle_programs[t]);
+        optimizer->target_throttle_programs[t] = target_throttle_programs[t];
+        if(optimizer->target_altitude_angle_programs[t])
+            program_dealloc(optimizer->target_altitude_angle_programs[t]);
+        optimizer->target_altitude_angle_programs[t] = target_altitude_angle_programs[t];
+        optimizer->target_fitness[t] = target_fitness[t];
+    }
+
+    return true;
+}
+
+bool checkpoint_write_file(const char *path, const unsigned char *image, size_t size) {
+    size_t path_length = strlen(path);
+    char *temp_path = (char *)malloc(path_length + 5);
+    memcpy(temp_path, path, path_length);
+    memcpy(temp_path + path_length, ".tmp", 5);
+
+    FILE *file = fopen(temp_path, "wb");
+    bool ok = file != NULL;
+    if(ok) {
+        ok = fwrite(image, 1, size, file) == size;
+        ok = (fflush(file) == 0) && ok;
+        ok = (fsync(fileno(file)) == 0) && ok;
+        ok = (fclose(file) == 0) && ok;
+    }
+    if(ok)
+        ok = rename(temp_path, path) == 0;
+    else
+        remove(temp_path);
+
+    free(temp_path);
+    return ok;
+}
+
+unsigned char *checkpoint_read_file(const char *path, size_t *size) {
+    FILE *file = fopen(path, "rb");
+    if(file == NULL)
+        return NULL;
+
+    size_t capacity = 4096;
+    size_t length = 0;
+    unsigned char *image = (unsigned char *)malloc(capacity);
+    size_t count;
+    while((count = fread(image + length, 1, capacity - length, file)) > 0) {
+        length += count;
+        if(length == capacity) {
+            capacity *= 2;
+            image = (unsigned char *)realloc(image, capacity);
+        }
+    }
+    fclose(file);
+
+    *size = length;
+    return image;
+}
+
+static void checkpoint_put(CheckpointBuffer *buffer, uint64_t value, size_t width) {
+    if(buffer->size + width > buffer->capacity) {
+        buffer->capacity = buffer->capacity ? 2*buffer->capacity : 256;
+        buffer->bytes = (unsigned char *)realloc(buffer->bytes, buffer->capacity);
+    }
+    for(size_t i=0; i<width; i++)
+        buffer->bytes[buffer->size++] = (unsigned char)(value >> (8*i));
+}
+
+static void checkpoint_put_double(CheckpointBuffer *buffer, double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    checkpoint_put(buffer, bits, 8);
+}
+
+static void checkpoint_put_program(CheckpointBuffer *buffer, const Program *program) {
+    checkpoint_put(buffer, program->kind, 4);
+    checkpoint_put(buffer, program->length, 4);
+    for(size_t i=0; i<program->length; i++)
+        checkpoint_put_double(buffer, program->altitudes[i]);
+    for(size_t i=0; i<program->length; i++)
+        checkpoint_put_double(buffer, program->settings[i]);
+}
+
+static uint64_t checkpoint_get(CheckpointReader *reader, size_t width) {
+    if(reader->error || reader->offset + width > reader->size) {
+        reader->error = true;
+        return 0;
+    }
+    uint64_t value = 0;
+    for(size_t i=0; i<width; i++)
+        value |= (uint64_t)reader->bytes[reader->offset++] << (8*i);
+    return value;
+}
+
+static double checkpoint_get_double(CheckpointReader *reader) {
+    uint64_t bits = checkpoint_get(reader, 8);
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+static Program *checkpoint_get_program(CheckpointReader *reader) {
+    //Custom programs are code, not data, so they cannot be restored.
+    ProgramKind kind = (ProgramKind)checkpoint_get(reader, 4);
+    size_t length = (size_t)checkpoint_get(reader, 4);
+    if(reader->error || kind >= PROGRAM_KIND_CUSTOM || length == 0 || reader->offset + 16*length > reader->size) {
+        reader->error = true;
+        return NULL;
+    }
+
+    Program *program = program_init(program_alloc(), length);
+    program->kind = kind;
+    for(size_t i=0; i<length; i++)
+        program->altitudes[i] = checkpoint_get_double(reader);
+    for(size_t i=0; i<length; i++)
+        program->settings[i] = checkpoint_get_double(reader);
+    return program;
+}
+
+//FNV-1a, to catch truncated or corrupted files.
+static uint64_t checkpoint_hash(const unsigned char *bytes, size_t size) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for(size_t i=0; i<size; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
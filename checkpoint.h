@@ -0,0 +1,61 @@
+#ifndef KERBAL_LAUNCH_CHECKPOINT_H
+#define KERBAL_LAUNCH_CHECKPOINT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <pthread.h>
+
+#include "optimizer.h"
+
+/*
+ * Checkpoints are a versioned little-endian binary image of the optimizer's
+ * search state: progress counters, best programs and fitness, RNG state, the
+ * fitness cache's entries and each target's incumbent.
+ * They are written atomically (to a temporary file that is renamed over the
+ * old checkpoint), so a killed run always leaves a complete checkpoint behind.
+ *
+ * Layout (version 4):
+ *   "KLCK" u32:version
+ *   u32:mode u32:generation u32:generations u64:evaluations
+ *   f64:throttle_cutoff_radius f64:best_fitness u64[4]:rng
+ *   program:best_throttle program:best_altitude_angle
+ *   u32:rungs (f64:correlation_sum u32:correlation_count)[rungs]
+ *   u64:cached (u64:key f64:fitness u64:ticks)[cached]
+ *   u32:targets (f64:radius f64:fitness program:throttle program:altitude_angle)[targets]
+ *   u64:fnv1a of everything before it
+ * where a program is u32:kind u32:length f64[length]:altitudes f64[length]:settings.
+ * A checkpoint only resumes a search in the mode, and with the targets, it was
+ * written with.
+ */
+#define CHECKPOINT_VERSION 4
+
+typedef struct Checkpointer {
+    char *path;
+
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+
+    //Only the newest submitted image is kept; an older unwritten one is dropped.
+    unsigned char *pending;
+    size_t pending_size;
+    bool stopping;
+
+    unsigned long written;
+    bool failed;
+} Checkpointer;
+
+Checkpointer *checkpointer_alloc(void);
+void checkpointer_dealloc(Checkpointer *self);
+Checkpointer *checkpointer_init(Checkpointer *self, const char *path);
+
+void checkpointer_submit(Checkpointer *self, unsigned char *image, size_t size);
+void checkpointer_finish(Checkpointer *self);
+
+unsigned char *checkpoint_encode(const Optimizer *optimizer, size_t *size);
+bool checkpoint_decode(Optimizer *optimizer, const unsigned char *image, size_t size);
+
+bool checkpoint_write_file(const char *path, const unsigned char *image, size_t size);
+unsigned char *checkpoint_read_file(const char *path, size_t *size);
+
+#endif
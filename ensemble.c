@@ -0,0 +1,250 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <assert.h>
+#include <math.h>
+#include <pthread.h>
+
+#include "ensemble.h"
+#include "optimizer.h"
+
+//A contiguous run of members flown by one thread.
+typedef struct EnsembleSlice {
+    const Ensemble *ensemble;
+    const System *system;
+    size_t begin;
+    size_t end;
+    double *fitness;
+    double *apex;
+    unsigned long ticks;
+} EnsembleSlice;
+
+static double ensemble_factor(Rng *rng, double deviation);
+static void *ensemble_run_slice(EnsembleSlice *slice);
+static int ensemble_compare(const void *a, const void *b);
+
+Ensemble *ensemble_alloc(void) {
+    return (Ensemble *)malloc(sizeof(Ensemble));
+}
+
+void ensemble_dealloc(Ensemble *self) {
+    free(self->rockets);
+    free(self->planetoids);
+    free(self);
+}
+
+/*
+ * Builds size members around the given rocket and planetoid.  The first member
+ * is the unperturbed pair, so the nominal flight is always part of the picture.
+ */
+Ensemble *ensemble_init(Ensemble *self, size_t size, const Rocket *rocket, const Planetoid *planetoid, const EnsembleSpread *spread) {
+    assert(size > 0);
+    self->size = size;
+    self->rockets = (Rocket *)malloc(size * sizeof(Rocket));
+    self->planetoids = (Planetoid *)malloc(size * sizeof(Planetoid));
+    self->spread = *spread;
+    self->robust_quantile = ENSEMBLE_ROBUST_QUANTILE;
+
+    Rng rng;
+    rng_init(&rng, ENSEMBLE_SEED);
+    for(size_t i=0; i<size; i++) {
+        Rocket *member = &self->rockets[i];
+        Planetoid *world = &self->planetoids[i];
+        *member = *rocket;
+        *world = *planetoid;
+        if(i == 0)
+            continue;
+
+        member->max_thrust *= ensemble_factor(&rng, spread->thrust);
+
+        double isp = ensemble_factor(&rng, spread->isp);
+        member->isp_vac *= isp;
+        member->isp_atm *= isp;
+
+        member->max_drag *= ensemble_factor(&rng, spread->drag);
+
+        double dry_mass_change = member->empty_mass * (ensemble_factor(&rng, spread->dry_mass) - 1.0);
+        member->empty_mass += dry_mass_change;
+        member->mass += dry_mass_change;
+
+        world->atmospheric_attenuation *= ensemble_factor(&rng, spread->atmosphere);
+    }
+
+    return self;
+}
+
+void ensemble_default_spread(EnsembleSpread *spread) {
+    spread->thrust = 0.03;
+    spread->isp = 0.01;
+    spread->drag = 0.10;
+    spread->dry_mass = 0.02;
+    spread->atmosphere = 0.05;
+}
+
+/*
+ * Flies the system's programs against every member.  Each thread takes a
+ * contiguous slice and steps its members in lockstep, one tick each in turn,
+ * so they share the program tables while they are hot in cache.  With one
+ * thread everything runs on the caller's thread, which is how the optimizer
+ * uses it from its own workers.
+ */
+void ensemble_evaluate(const Ensemble *self, const System *system, unsigned threads, EnsembleResult *result) {
+    assert(result->size == self->size);
+    if(threads == 0)
+        threads = 1;
+    if(threads > self->size)
+        threads = (unsigned)self->size;
+
+    EnsembleSlice *slices = (EnsembleSlice *)malloc(threads * sizeof(EnsembleSlice));
+    pthread_t *thread_ids = (pthread_t *)malloc(threads * sizeof(pthread_t));
+    for(unsigned t=0; t<threads; t++) {
+        EnsembleSlice *slice = &slices[t];
+        slice->ensemble = self;
+        slice->system = system;
+        slice->begin = self->size * t / threads;
+        slice->end = self->size * (t+1) / threads;
+        slice->fitness = result->fitness;
+        slice->apex = result->apex;
+        slice->ticks = 0;
+        if(t > 0)
+            pthread_create(&thread_ids[t], NULL, (void *(*)(void *))ensemble_run_slice, slice);
+    }
+    ensemble_run_slice(&slices[0]);
+    for(unsigned t=1; t<threads; t++)
+        pthread_join(thread_ids[t], NULL);
+
+    //Summarize.
+    result->ticks = 0;
+    for(unsigned t=0; t<threads; t++)
+        result->ticks += slices[t].ticks;
+    free(thread_ids);
+    free(slices);
+
+    size_t size = self->size;
+    double fitness_sum = 0.0, fitness_sum2 = 0.0;
+    double apex_sum = 0.0, apex_sum2 = 0.0;
+    result->successes = 0;
+    for(size_t i=0; i<size; i++) {
+        apex_sum += result->apex[i];
+        apex_sum2 += result->apex[i] * result->apex[i];
+        if(isfinite(result->fitness[i])) {
+            result->successes++;
+            fitness_sum += result->fitness[i];
+            fitness_sum2 += result->fitness[i] * result->fitness[i];
+        }
+    }
+
+    size_t n = result->successes;
+    result->fitness_mean = (n > 0) ? fitness_sum / n : -INFINITY;
+    result->fitness_stddev = (n > 1) ? sqrt(fmax(0.0, (fitness_sum2 - fitness_sum*fitness_sum/n) / (n-1))) : 0.0;
+    result->apex_mean = apex_sum / size;
+    result->apex_stddev = (size > 1) ? sqrt(fmax(0.0, (apex_sum2 - apex_sum*apex_sum/size) / (size-1))) : 0.0;
+
+    qsort(result->fitness, size, sizeof(double), ensemble_compare);
+    qsort(result->apex, size, sizeof(double), ensemble_compare);
+    result->robust_fitness = ensemble_percentile(result->fitness, size, self->robust_quantile);
+}
+
+EnsembleResult *ensemble_result_alloc(void) {
+    return (EnsembleResult *)malloc(sizeof(EnsembleResult));
+}
+
+void ensemble_result_dealloc(EnsembleResult *self) {
+    free(self->fitness);
+    free(self->apex);
+    free(self);
+}
+
+EnsembleResult *ensemble_result_init(EnsembleResult *self, size_t size) {
+    self->size = size;
+    self->successes = 0;
+    self->fitness = (double *)calloc(size, sizeof(double));
+    self->apex = (double *)calloc(size, sizeof(double));
+    self->fitness_mean = -INFINITY;
+    self->fitness_stddev = 0.0;
+    self->apex_mean = 0.0;
+    self->apex_stddev = 0.0;
+    self->robust_fitness = -INFINITY;
+    self->ticks = 0;
+    return self;
+}
+
+//Nearest-rank percentile of an ascending array.
+double ensemble_percentile(const double *sorted, size_t size, double quantile) {
+    assert(size > 0);
+    size_t rank = (size_t)ceil(quantile * size);
+    return sorted[rank > 0 ? rank-1 : 0];
+}
+
+void ensemble_result_display(const EnsembleResult *self) {
+    printf("<ensemble %zu members, %zu succeeded\n", self->size, self->successes);
+    printf("\tfitness mean %f stddev %f\n", self->fitness_mean, self->fitness_stddev);
+    printf("\tfitness min %f p10 %f p50 %f p90 %f max %f\n",
+        self->fitness[0],
+        ensemble_percentile(self->fitness, self->size, 0.10),
+        ensemble_percentile(self->fitness, self->size, 0.50),
+        ensemble_percentile(self->fitness, self->size, 0.90),
+        self->fitness[self->size-1]);
+    printf("\tapex mean %f stddev %f\n", self->apex_mean, self->apex_stddev);
+    printf("\tapex min %f p10 %f p50 %f p90 %f max %f\n",
+        self->apex[0],
+        ensemble_percentile(self->apex, self->size, 0.10),
+        ensemble_percentile(self->apex, self->size, 0.50),
+        ensemble_percentile(self->apex, self->size, 0.90),
+        self->apex[self->size-1]);
+    printf("\trobust fitness %f\n", self->robust_fitness);
+    printf(">\n");
+}
+
+static double ensemble_factor(Rng *rng, double deviation) {
+    double z = rng_gaussian(rng);
+    z = fmax(-ENSEMBLE_MAX_DEVIATIONS, fmin(ENSEMBLE_MAX_DEVIATIONS, z));
+    return 1.0 + deviation*z;
+}
+
+static void *ensemble_run_slice(EnsembleSlice *slice) {
+    const Ensemble *ensemble = slice->ensemble;
+    size_t count = slice->end - slice->begin;
+    Rocket *rockets = (Rocket *)malloc(count * sizeof(Rocket));
+    System *systems = (System *)malloc(count * sizeof(System));
+    Frame *frames = (Frame *)malloc(count * sizeof(Frame));
+
+    for(size_t i=0; i<count; i++) {
+        size_t member = slice->begin + i;
+        rockets[i] = ensemble->rockets[member];
+
+        System *system = system_init(&systems[i]);
+        system->rocket = &rockets[i];
+        system->planetoid = &ensemble->planetoids[member];
+        system->throttle_program = slice->system->throttle_program;
+        system->altitude_angle_program = slice->system->altitude_angle_program;
+        system->throttle_cutoff_radius = slice->system->throttle_cutoff_radius;
+        system->delta_t = slice->system->delta_t;
+        system_start(system, &frames[i]);
+    }
+
+    //Step every member one tick at a time until all have landed or reached apex.
+    size_t running = count;
+    while(running > 0) {
+        running = 0;
+        for(size_t i=0; i<count; i++)
+            running += system_step(&systems[i]);
+    }
+
+    for(size_t i=0; i<count; i++) {
+        system_finish(&systems[i]);
+        slice->fitness[slice->begin + i] = optimizer_fitness(&systems[i]);
+        slice->apex[slice->begin + i] = systems[i].stats.frame.altitude;
+        slice->ticks += systems[i].ticks;
+    }
+
+    free(frames);
+    free(systems);
+    free(rockets);
+    return NULL;
+}
+
+static int ensemble_compare(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
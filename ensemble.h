@@ -0,0 +1,70 @@
+#ifndef KERBAL_LAUNCH_ENSEMBLE_H
+#define KERBAL_LAUNCH_ENSEMBLE_H
+
+#include <stddef.h>
+
+#include "rocket.h"
+#include "planetoid.h"
+#include "system.h"
+#include "rng.h"
+
+#define ENSEMBLE_SEED 0x4b4c454eULL //Fixed, so every program is judged against the same members.
+#define ENSEMBLE_ROBUST_QUANTILE 0.10 //The robust fitness is this percentile of the members' fitness.
+#define ENSEMBLE_MAX_DEVIATIONS 3.0 //Perturbations are clipped to this many standard deviations.
+
+/*
+ * Relative standard deviations of the perturbations applied to each member.
+ * Isp is perturbed as one factor for both vacuum and atmosphere, and mass as a
+ * change in dry mass, so the fuel load stays the same.
+ */
+typedef struct EnsembleSpread {
+    double thrust;
+    double isp;
+    double drag;
+    double dry_mass;
+    double atmosphere; //Atmospheric attenuation (scale height).
+} EnsembleSpread;
+
+/*
+ * A fixed set of perturbed rockets and planetoids that a program pair is flown
+ * against.  The members are only read while evaluating, so one ensemble can be
+ * shared by every thread.
+ */
+typedef struct Ensemble {
+    size_t size;
+    Rocket *rockets;
+    Planetoid *planetoids;
+    EnsembleSpread spread;
+    double robust_quantile;
+} Ensemble;
+
+//The outcome of one program pair over every member.
+typedef struct EnsembleResult {
+    size_t size;
+    size_t successes;
+    double *fitness; //Ascending; failed flights are -INFINITY.
+    double *apex; //Ascending apex altitudes.
+    double fitness_mean; //Over successes.
+    double fitness_stddev;
+    double apex_mean;
+    double apex_stddev;
+    double robust_fitness;
+    unsigned long ticks;
+} EnsembleResult;
+
+Ensemble *ensemble_alloc(void);
+void ensemble_dealloc(Ensemble *self);
+Ensemble *ensemble_init(Ensemble *self, size_t size, const Rocket *rocket, const Planetoid *planetoid, const EnsembleSpread *spread);
+
+void ensemble_default_spread(EnsembleSpread *spread);
+
+void ensemble_evaluate(const Ensemble *self, const System *system, unsigned threads, EnsembleResult *result);
+
+EnsembleResult *ensemble_result_alloc(void);
+void ensemble_result_dealloc(EnsembleResult *self);
+EnsembleResult *ensemble_result_init(EnsembleResult *self, size_t size);
+
+double ensemble_percentile(const double *sorted, size_t size, double quantile);
+void ensemble_result_display(const EnsembleResult *self);
+
+#endif
@@ -0,0 +1,420 @@
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "evaluate.h"
+
+typedef void *(*pthread_func)(void *);
+
+//Where the candidates come from: a mapped file, or a stream such as stdin.
+typedef struct EvaluatorSource {
+    FILE *file;
+    const unsigned char *map;
+    size_t size;
+    size_t offset;
+} EvaluatorSource;
+
+typedef struct EvaluatorCandidate {
+    Program *throttle_program;
+    Program *altitude_angle_program;
+    const char *error; //Set if the candidate could not be read.
+    EvaluatorFlight flight;
+} EvaluatorCandidate;
+
+//A batch being flown; workers claim candidates by index.
+typedef struct EvaluatorBatch {
+    const Evaluator *evaluator;
+    EvaluatorCandidate *candidates;
+    size_t count;
+    atomic_size_t next;
+} EvaluatorBatch;
+
+static bool evaluator_source_open(EvaluatorSource *source, const char *path);
+static void evaluator_source_close(EvaluatorSource *source);
+static int evaluator_source_peek(EvaluatorSource *source);
+static bool evaluator_source_read(EvaluatorSource *source, void *bytes, size_t size);
+static bool evaluator_source_line(EvaluatorSource *source, char *line, size_t size, bool *truncated);
+static GenomeTable *evaluator_read_genome_header(EvaluatorSource *source);
+static bool evaluator_read_candidate(EvaluatorSource *source, const GenomeTable *table, EvaluatorCandidate *candidate);
+static Program *evaluator_parse_program(char *text, double conversion);
+static void evaluator_fly(Evaluator *self, EvaluatorCandidate *candidates, size_t count);
+static void evaluator_fly_scenario(Evaluator *self, EvaluatorCandidate *candidates, size_t count);
+static KerbalLaunchProgram evaluator_library_program(const Program *program);
+static void *evaluator_worker(EvaluatorBatch *batch);
+static void evaluator_write(const EvaluatorCandidate *candidate, FILE *out);
+static double evaluator_clock(void);
+
+Evaluator *evaluator_alloc(void) {
+    return (Evaluator *)malloc(sizeof(Evaluator));
+}
+
+void evaluator_dealloc(Evaluator *self) {
+    free(self);
+}
+
+Evaluator *evaluator_init(Evaluator *self, const Optimizer *optimizer, unsigned workers) {
+    assert(workers > 0);
+    self->optimizer = optimizer;
+    self->workers = workers;
+    self->scenario = NULL;
+    self->batch = EVALUATOR_BATCH;
+
+    self->candidates = 0;
+    self->errors = 0;
+    self->ticks = 0;
+    self->wall_seconds = 0.0;
+    return self;
+}
+
+/*
+ * Evaluates every candidate in the file (stdin if path is NULL or "-").
+ * Returns false if the input could not be opened or has a bad genome header;
+ * candidates that cannot be read are reported in place and do not stop the run.
+ */
+bool evaluator_run(Evaluator *self, const char *path, FILE *out) {
+    EvaluatorSource source;
+    if(!evaluator_source_open(&source, path))
+        return false;
+
+    //The genome format announces itself; no line can start with its magic.
+    GenomeTable *table = NULL;
+    if(evaluator_source_peek(&source) == EVALUATOR_GENOME_MAGIC[0]) {
+        table = evaluator_read_genome_header(&source);
+        if(table == NULL) {
+            evaluator_source_close(&source);
+            return false;
+        }
+    }
+
+    double start = evaluator_clock();
+    EvaluatorCandidate *candidates = (EvaluatorCandidate *)malloc(sizeof(EvaluatorCandidate) * self->batch);
+    fprintf(out, "# fitness altitude time horizontal_velocity radial_velocity remaining_delta_v ticks\n");
+    for(;;) {
+        size_t count = 0;
+        while(count < self->batch && evaluator_read_candidate(&source, table, &candidates[count]))
+            count++;
+        if(count == 0)
+            break;
+
+        evaluator_fly(self, candidates, count);
+
+        for(size_t i=0; i<count; i++) {
+            evaluator_write(&candidates[i], out);
+            if(candidates[i].error)
+                self->errors++;
+            if(candidates[i].throttle_program)
+                program_dealloc(candidates[i].throttle_program);
+            if(candidates[i].altitude_angle_program)
+                program_dealloc(candidates[i].altitude_angle_program);
+        }
+        self->candidates += count;
+    }
+    fflush(out);
+    self->wall_seconds += evaluator_clock() - start;
+
+    free(candidates);
+    if(table)
+        genome_table_dealloc(table);
+    evaluator_source_close(&source);
+    return true;
+}
+
+//Reads the next candidate; false at the end of the input.
+static bool evaluator_read_candidate(EvaluatorSource *source, const GenomeTable *table, EvaluatorCandidate *candidate) {
+    candidate->throttle_program = NULL;
+    candidate->altitude_angle_program = NULL;
+    candidate->error = NULL;
+
+    if(table) {
+        uint8_t genes[GENOME_MAX_GENES];
+        if(!evaluator_source_read(source, genes, table->genes))
+            return false;
+        if(genome_valid(table, genes))
+            genome_make_programs(table, genes, &candidate->throttle_program, &candidate->altitude_angle_program);
+        else
+            candidate->error = "gene off the grid";
+        return true;
+    }
+
+    char line[EVALUATOR_LINE_LENGTH];
+    bool truncated;
+    for(;;) {
+        if(!evaluator_source_line(source, line, sizeof(line), &truncated))
+            return false;
+        size_t skip = strspn(line, " \t\r\n");
+        if(line[skip] != '\0' && line[skip] != '#')
+            break;
+    }
+    if(truncated) {
+        candidate->error = "line too long";
+        return true;
+    }
+
+    char *bar = strchr(line, '|');
+    if(bar == NULL) {
+        candidate->error = "expected THROTTLE | ALTITUDE_ANGLE";
+        return true;
+    }
+    *bar = '\0';
+    candidate->throttle_program = evaluator_parse_program(line, 1.0);
+    candidate->altitude_angle_program = evaluator_parse_program(bar+1, M_PI/180.0);
+    if(candidate->throttle_program == NULL || candidate->altitude_angle_program == NULL)
+        candidate->error = candidate->throttle_program ? "bad altitude_angle program" : "bad throttle program";
+    return true;
+}
+
+//Parses "KIND ALTITUDE:SETTING...".
+static Program *evaluator_parse_program(char *text, double conversion) {
+    char *save = NULL;
+    char *name = strtok_r(text, " \t\r\n", &save);
+    char *rest = strtok_r(NULL, "\r\n", &save);
+    ProgramKind kind;
+    if(name == NULL || rest == NULL || !program_kind_parse(name, &kind))
+        return NULL;
+
+    Program *program = program_parse(rest, conversion);
+    if(program)
+        program->kind = kind;
+    return program;
+}
+
+static void evaluator_fly(Evaluator *self, EvaluatorCandidate *candidates, size_t count) {
+    if(self->scenario) {
+        evaluator_fly_scenario(self, candidates, count);
+        return;
+    }
+
+    EvaluatorBatch batch;
+    batch.evaluator = self;
+    batch.candidates = candidates;
+    batch.count = count;
+    atomic_init(&batch.next, 0);
+
+    unsigned workers = (count < self->workers) ? (unsigned)count : self->workers;
+    pthread_t *threads = (pthread_t *)malloc(sizeof(pthread_t) * workers);
+    for(unsigned i=0; i<workers; i++)
+        pthread_create(&threads[i], NULL, (pthread_func)evaluator_worker, &batch);
+    for(unsigned i=0; i<workers; i++)
+        pthread_join(threads[i], NULL);
+    free(threads);
+
+    for(size_t i=0; i<count; i++)
+        self->ticks += candidates[i].flight.ticks;
+}
+
+//Flies the batch through the library API; candidates that could not be read go as empty programs, which it skips.
+static void evaluator_fly_scenario(Evaluator *self, EvaluatorCandidate *candidates, size_t count) {
+    KerbalLaunchProgram *throttle_programs = (KerbalLaunchProgram *)malloc(sizeof(KerbalLaunchProgram) * count);
+    KerbalLaunchProgram *altitude_angle_programs = (KerbalLaunchProgram *)malloc(sizeof(KerbalLaunchProgram) * count);
+    KerbalLaunchFlight *flights = (KerbalLaunchFlight *)malloc(sizeof(KerbalLaunchFlight) * count);
+    for(size_t i=0; i<count; i++) {
+        KerbalLaunchProgram empty = {KERBAL_LAUNCH_PROGRAM_STEP, 0, NULL, NULL};
+        throttle_programs[i] = candidates[i].error ? empty : evaluator_library_program(candidates[i].throttle_program);
+        altitude_angle_programs[i] = candidates[i].error ? empty : evaluator_library_program(candidates[i].altitude_angle_program);
+    }
+
+    kerbal_launch_evaluate(self->scenario, count, throttle_programs, altitude_angle_programs, flights);
+
+    for(size_t i=0; i<count; i++) {
+        EvaluatorCandidate *candidate = &candidates[i];
+        candidate->flight.fitness = flights[i].fitness;
+        candidate->flight.altitude = flights[i].altitude;
+        candidate->flight.time = flights[i].time;
+        candidate->flight.horizontal_velocity = flights[i].horizontal_velocity;
+        candidate->flight.radial_velocity = flights[i].radial_velocity;
+        candidate->flight.remaining_delta_v = flights[i].remaining_delta_v;
+        candidate->flight.ticks = flights[i].ticks;
+        if(!candidate->error && isnan(flights[i].fitness) && flights[i].ticks == 0)
+            candidate->error = "malformed program";
+        self->ticks += candidate->flight.ticks;
+    }
+
+    free(throttle_programs);
+    free(altitude_angle_programs);
+    free(flights);
+}
+
+//Borrows the program's arrays; the built-in kinds have the same values in both enums.
+static KerbalLaunchProgram evaluator_library_program(const Program *program) {
+    KerbalLaunchProgram view = {(KerbalLaunchProgramKind)program->kind, program->length, program->altitudes, program->settings};
+    return view;
+}
+
+static void *evaluator_worker(EvaluatorBatch *batch) {
+    const Optimizer *optimizer = batch->evaluator->optimizer;
+    size_t i;
+    while((i = atomic_fetch_add(&batch->next, 1)) < batch->count) {
+        EvaluatorCandidate *candidate = &batch->candidates[i];
+        candidate->flight.ticks = 0;
+        if(candidate->error)
+            continue;
+        evaluator_fly_candidate(optimizer, candidate->throttle_program, candidate->altitude_angle_program, &candidate->flight);
+    }
+    return NULL;
+}
+
+/*
+ * Flies one candidate in the optimizer's scenario, on the calling thread.
+ * The programs are only read, so they may be borrowed from the caller.
+ */
+void evaluator_fly_candidate(const Optimizer *optimizer, const Program *throttle_program, const Program *altitude_angle_program, EvaluatorFlight *flight) {
+    const Planetoid *planetoid = optimizer->planetoid;
+    System *system = optimizer_make_system(optimizer, throttle_program, altitude_angle_program);
+    OptimizerSystemResult *result = optimizer_run_system(system);
+
+    const Frame *apex = &system->stats.frame;
+    flight->fitness = result->fitness;
+    flight->altitude = apex->altitude;
+    flight->time = apex->time;
+    flight->horizontal_velocity = planetoid_horizontal_velocity(planetoid, apex->position, apex->velocity);
+    flight->radial_velocity = planetoid_radial_velocity(planetoid, apex->position, apex->velocity);
+    flight->remaining_delta_v = apex->rocket_remaining_ideal_delta_v;
+    flight->ticks = result->ticks;
+
+    free(result);
+    rocket_dealloc(system->rocket);
+    system_dealloc(system);
+}
+
+static void evaluator_write(const EvaluatorCandidate *candidate, FILE *out) {
+    if(candidate->error) {
+        fprintf(out, "error %s\n", candidate->error);
+        return;
+    }
+    const EvaluatorFlight *flight = &candidate->flight;
+    fprintf(out, "%.6f %.3f %.2f %.3f %.3f %.3f %lu\n",
+            flight->fitness, flight->altitude, flight->time,
+            flight->horizontal_velocity, flight->radial_velocity, flight->remaining_delta_v,
+            flight->ticks);
+}
+
+static GenomeTable *evaluator_read_genome_header(EvaluatorSource *source) {
+    char magic[4];
+    uint32_t version;
+    if(!evaluator_source_read(source, magic, sizeof(magic)) || memcmp(magic, EVALUATOR_GENOME_MAGIC, sizeof(magic)) != 0)
+        return NULL;
+    if(!evaluator_source_read(source, &version, sizeof(version)) || version != EVALUATOR_GENOME_VERSION)
+        return NULL;
+
+    uint32_t kinds[2], lengths[2];
+    double altitudes[2][GENOME_MAX_GENES];
+    for(int p=0; p<2; p++) {
+        if(!evaluator_source_read(source, &kinds[p], sizeof(uint32_t)) || !evaluator_source_read(source, &lengths[p], sizeof(uint32_t)))
+            return NULL;
+        if(lengths[p] > GENOME_MAX_GENES || !evaluator_source_read(source, altitudes[p], sizeof(double) * lengths[p]))
+            return NULL;
+    }
+
+    GenomeTable *table = genome_table_alloc();
+    if(!genome_table_init_altitudes(table, (ProgramKind)kinds[0], lengths[0], altitudes[0], (ProgramKind)kinds[1], lengths[1], altitudes[1])) {
+        genome_table_dealloc(table);
+        return NULL;
+    }
+    return table;
+}
+
+static bool evaluator_source_open(EvaluatorSource *source, const char *path) {
+    source->file = NULL;
+    source->map = NULL;
+    source->size = 0;
+    source->offset = 0;
+
+    if(path == NULL || strcmp(path, "-") == 0) {
+        source->file = stdin;
+        return true;
+    }
+
+    int fd = open(path, O_RDONLY);
+    if(fd < 0)
+        return false;
+    struct stat status;
+    if(fstat(fd, &status) != 0) {
+        close(fd);
+        return false;
+    }
+    source->size = (size_t)status.st_size;
+    if(source->size > 0) {
+        void *map = mmap(NULL, source->size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(map == MAP_FAILED) {
+            close(fd);
+            return false;
+        }
+        madvise(map, source->size, MADV_SEQUENTIAL);
+        source->map = (const unsigned char *)map;
+    }
+    close(fd);
+    return true;
+}
+
+static void evaluator_source_close(EvaluatorSource *source) {
+    if(source->map)
+        munmap((void *)source->map, source->size);
+    source->map = NULL;
+}
+
+static int evaluator_source_peek(EvaluatorSource *source) {
+    if(source->file) {
+        int c = getc(source->file);
+        if(c != EOF)
+            ungetc(c, source->file);
+        return c;
+    }
+    return (source->offset < source->size) ? source->map[source->offset] : EOF;
+}
+
+static bool evaluator_source_read(EvaluatorSource *source, void *bytes, size_t size) {
+    if(source->file)
+        return fread(bytes, 1, size, source->file) == size;
+    if(source->size - source->offset < size)
+        return false;
+    memcpy(bytes, source->map + source->offset, size);
+    source->offset += size;
+    return true;
+}
+
+//Reads a line, without its newline; a longer line than fits is consumed and flagged.
+static bool evaluator_source_line(EvaluatorSource *source, char *line, size_t size, bool *truncated) {
+    *truncated = false;
+    if(source->file) {
+        if(fgets(line, (int)size, source->file) == NULL)
+            return false;
+        size_t length = strlen(line);
+        if(length > 0 && line[length-1] == '\n') {
+            line[length-1] = '\0';
+        } else if(!feof(source->file)) {
+            int c;
+            while((c = getc(source->file)) != EOF && c != '\n')
+                ;
+            *truncated = true;
+        }
+        return true;
+    }
+
+    if(source->offset >= source->size)
+        return false;
+    const unsigned char *start = source->map + source->offset;
+    const unsigned char *end = memchr(start, '\n', source->size - source->offset);
+    size_t length = end ? (size_t)(end - start) : source->size - source->offset;
+    source->offset += length + (end ? 1 : 0);
+    if(length >= size) {
+        *truncated = true;
+        length = size-1;
+    }
+    memcpy(line, start, length);
+    line[length] = '\0';
+    return true;
+}
+
+static double evaluator_clock(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + 1e-9*now.tv_nsec;
+}
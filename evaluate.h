@@ -0,0 +1,67 @@
+#ifndef KERBAL_LAUNCH_EVALUATE_H
+#define KERBAL_LAUNCH_EVALUATE_H
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "optimizer.h"
+#include "genome.h"
+#include "kerbal_launch.h"
+
+#define EVALUATOR_BATCH 4096 //Candidates read, flown and written at a time; bounds the memory held.
+#define EVALUATOR_LINE_LENGTH 4096
+#define EVALUATOR_GENOME_MAGIC "KLGN"
+#define EVALUATOR_GENOME_VERSION 1
+
+/*
+ * Bulk evaluation for search tools outside this program: candidate program
+ * pairs are read from a file (memory-mapped) or stdin, flown in parallel, and
+ * their fitness, as optimizer_run_system scores it, and apex written to out in
+ * input order.  The input is taken a batch at a time, so memory stays bounded
+ * however long it is.
+ *
+ * Two input formats are accepted.  The line format is one candidate a line,
+ *   THROTTLE_KIND ALTITUDE:SETTING... | ALTITUDE_ANGLE_KIND ALTITUDE:DEGREES...
+ * with blank lines and '#' comments skipped.  The genome format is binary, in
+ * native byte order:
+ *   "KLGN", u32 version,
+ *   u32 throttle kind, u32 length, f64 altitudes[length],
+ *   u32 altitude angle kind, u32 length, f64 altitudes[length],
+ * then one record per candidate of one byte per setting, each the index of the
+ * setting on its grid, throttle first (see genome.h).
+ *
+ * Each candidate gives one output line,
+ *   FITNESS ALTITUDE TIME HORIZONTAL_VELOCITY RADIAL_VELOCITY REMAINING_DELTA_V TICKS
+ * describing the final frame, or "error MESSAGE" if it could not be read.
+ */
+//Where a candidate's flight ended, as written for it.
+typedef struct EvaluatorFlight {
+    double fitness;
+    double altitude;
+    double time;
+    double horizontal_velocity;
+    double radial_velocity;
+    double remaining_delta_v;
+    unsigned long ticks;
+} EvaluatorFlight;
+
+typedef struct Evaluator {
+    const Optimizer *optimizer; //Supplies the rocket, planetoid and target; not owned.
+    unsigned workers;
+    KerbalLaunchScenario *scenario; //If set, flies each batch through kerbal_launch_evaluate on its threads instead; not owned.
+    size_t batch;
+
+    unsigned long candidates;
+    unsigned long errors;
+    unsigned long ticks;
+    double wall_seconds;
+} Evaluator;
+
+Evaluator *evaluator_alloc(void);
+void evaluator_dealloc(Evaluator *self);
+Evaluator *evaluator_init(Evaluator *self, const Optimizer *optimizer, unsigned workers);
+
+bool evaluator_run(Evaluator *self, const char *path, FILE *out);
+void evaluator_fly_candidate(const Optimizer *optimizer, const Program *throttle_program, const Program *altitude_angle_program, EvaluatorFlight *flight);
+
+#endif
@@ -0,0 +1,107 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "kerbal_launch.h"
+
+/*
+ * Drives the simulator in process through libkerballaunch, using nothing but
+ * kerbal_launch.h: a short search from the standard seeds, reporting its
+ * progress, then one batch flying the best programs with their throttle
+ * scaled from 0.5 to 1.0.  Every candidate borrows the same altitude arrays,
+ * and the throttle settings are rows of one flat matrix, as they would be in
+ * a numpy array.  Exits non-zero if the batch does not reproduce the best
+ * fitness at full scale.
+ *
+ *   library_client [GENERATIONS] [CANDIDATES] [THREADS]
+ */
+
+#define LIBRARY_CLIENT_GENERATIONS 32
+#define LIBRARY_CLIENT_CANDIDATES 256
+
+static void library_client_progress(const KerbalLaunchProgress *progress, void *context) {
+    unsigned *reports = (unsigned *)context;
+    if((*reports)++ % 8 == 0)
+        printf("generation %u/%u: %lu flights, best %f\n", progress->generation, progress->generations, progress->evaluations, progress->best_fitness);
+}
+
+int main(int argc, char **argv) {
+    unsigned generations = (argc > 1 && atoi(argv[1]) > 0) ? (unsigned)atoi(argv[1]) : LIBRARY_CLIENT_GENERATIONS;
+    size_t count = (argc > 2 && atoi(argv[2]) > 1) ? (size_t)atoi(argv[2]) : LIBRARY_CLIENT_CANDIDATES;
+    unsigned threads = (argc > 3 && atoi(argv[3]) > 0) ? (unsigned)atoi(argv[3]) : 0;
+
+    if(kerbal_launch_api_version() != KERBAL_LAUNCH_API_VERSION) {
+        fprintf(stderr, "libkerballaunch has API version %u, not %u\n", kerbal_launch_api_version(), KERBAL_LAUNCH_API_VERSION);
+        return 1;
+    }
+
+    KerbalLaunchScenario *scenario = kerbal_launch_scenario_alloc();
+    if(kerbal_launch_scenario_init(scenario, KERBAL_LAUNCH_ROCKET_LARGE, 80000.0) == NULL) {
+        kerbal_launch_scenario_dealloc(scenario);
+        return 1;
+    }
+    if(threads > 0)
+        kerbal_launch_set_threads(scenario, threads);
+
+    double throttle_altitudes[KERBAL_LAUNCH_SEED_LENGTH], throttle_settings[KERBAL_LAUNCH_SEED_LENGTH];
+    double angle_altitudes[KERBAL_LAUNCH_SEED_LENGTH], angle_settings[KERBAL_LAUNCH_SEED_LENGTH];
+    KerbalLaunchProgram best_throttle = {KERBAL_LAUNCH_PROGRAM_STEP, KERBAL_LAUNCH_SEED_LENGTH, throttle_altitudes, throttle_settings};
+    KerbalLaunchProgram best_angle = {KERBAL_LAUNCH_PROGRAM_STEP, KERBAL_LAUNCH_SEED_LENGTH, angle_altitudes, angle_settings};
+    double best_fitness;
+
+    KerbalLaunchSearch search;
+    kerbal_launch_search_defaults(&search);
+    search.generations = generations;
+    unsigned reports = 0;
+    search.progress_func = library_client_progress;
+    search.progress_context = &reports;
+    if(!kerbal_launch_optimize(scenario, &search, NULL, NULL, &best_throttle, &best_angle, &best_fitness, NULL)) {
+        fprintf(stderr, "Search failed\n");
+        kerbal_launch_scenario_dealloc(scenario);
+        return 1;
+    }
+    printf("Best fitness: %f on %u threads\n", best_fitness, kerbal_launch_threads(scenario));
+
+    //Candidate i flies row i of the settings matrix; the last row is the best unscaled.
+    size_t length = best_throttle.length;
+    double *settings = (double *)malloc(sizeof(double) * count * length);
+    KerbalLaunchProgram *throttles = (KerbalLaunchProgram *)malloc(sizeof(KerbalLaunchProgram) * count);
+    KerbalLaunchProgram *angles = (KerbalLaunchProgram *)malloc(sizeof(KerbalLaunchProgram) * count);
+    KerbalLaunchFlight *flights = (KerbalLaunchFlight *)malloc(sizeof(KerbalLaunchFlight) * count);
+    for(size_t i=0; i<count; i++) {
+        double scale = 0.5 + 0.5 * (double)i / (double)(count-1);
+        for(size_t j=0; j<length; j++)
+            settings[i*length + j] = best_throttle.settings[j] * scale;
+        throttles[i] = best_throttle;
+        throttles[i].settings = &settings[i*length];
+        angles[i] = best_angle;
+    }
+
+    int status = 0;
+    if(kerbal_launch_evaluate(scenario, count, throttles, angles, flights)) {
+        size_t best = 0;
+        unsigned long ticks = 0;
+        for(size_t i=0; i<count; i++) {
+            ticks += flights[i].ticks;
+            if(flights[i].fitness > flights[best].fitness)
+                best = i;
+        }
+        printf("Batch: %zu candidates, %lu ticks; best at scale %.3f with fitness %f, apex %.0f m\n",
+                count, ticks, 0.5 + 0.5 * (double)best / (double)(count-1), flights[best].fitness, flights[best].altitude);
+        if(flights[count-1].fitness != best_fitness) {
+            fprintf(stderr, "Full scale flew fitness %f, not the search's %f\n", flights[count-1].fitness, best_fitness);
+            status = 1;
+        }
+    } else {
+        fprintf(stderr, "Batch failed\n");
+        status = 1;
+    }
+
+    free(flights);
+    free(angles);
+    free(throttles);
+    free(settings);
+    kerbal_launch_scenario_dealloc(scenario);
+    return status;
+}
@@ -0,0 +1,57 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "stream.h"
+
+/*
+ * Follows a live trajectory stream, printing each frame as a CSV row as the
+ * simulation produces it.  Waits for the stream to appear, and exits when the
+ * writer closes it.
+ *
+ *   stream_follow [NAME]
+ */
+
+#define STREAM_FOLLOW_POLL_NANOSECONDS 1000000
+
+static void stream_follow_sleep(void) {
+    struct timespec pause = {0, STREAM_FOLLOW_POLL_NANOSECONDS};
+    nanosleep(&pause, NULL);
+}
+
+int main(int argc, char **argv) {
+    const char *name = (argc > 1) ? argv[1] : STREAM_DEFAULT_NAME;
+
+    StreamReader *reader = stream_reader_alloc();
+    while(!stream_reader_is_open(stream_reader_init(reader, name)))
+        stream_follow_sleep();
+
+    printf("tick, time, m, x, y, vx, vy, alt, apoapsis, throttle, altitude_angle\n");
+
+    Frame frame;
+    StreamRead status;
+    while((status = stream_reader_next(reader, &frame)) != STREAM_READ_CLOSED) {
+        if(status == STREAM_READ_EMPTY) {
+            stream_follow_sleep();
+            continue;
+        }
+        printf(
+            "%lu, %f, %f, %f, %f, %f, %f, %f, %f, %f, %f\n",
+            frame.ticks,
+            frame.time,
+            frame.mass,
+            VX(frame.position),
+            VY(frame.position),
+            VX(frame.velocity),
+            VY(frame.velocity),
+            frame.altitude,
+            frame.apoapsis,
+            frame.throttle,
+            frame.altitude_angle
+        );
+    }
+
+    fprintf(stderr, "dropped frames: %lu\n", reader->dropped);
+    stream_reader_dealloc(reader);
+    return 0;
+}
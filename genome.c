@@ -0,0 +1,149 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "genome.h"
+#include "cache.h"
+
+static bool genome_table_accepts(ProgramKind kind, size_t length);
+static bool genome_encode_setting(const double *grid, size_t grid_length, double setting, uint8_t *gene);
+
+GenomeTable *genome_table_alloc(void) {
+    return (GenomeTable *)malloc(sizeof(GenomeTable));
+}
+
+void genome_table_dealloc(GenomeTable *self) {
+    free(self->throttle_altitudes);
+    free(self->altitude_angle_altitudes);
+    free(self);
+}
+
+/*
+ * Takes the kinds and altitudes from the programs, and the grid values from the
+ * same formulas as the mutations.  Returns false, leaving nothing to free but
+ * the table itself, if the programs cannot be encoded: a kind whose mutations
+ * move breakpoints, too many settings, or a setting off the grid.
+ */
+bool genome_table_init(GenomeTable *self, const Program *throttle_program, const Program *altitude_angle_program) {
+    if(!genome_table_init_altitudes(self, throttle_program->kind, throttle_program->length, throttle_program->altitudes, altitude_angle_program->kind, altitude_angle_program->length, altitude_angle_program->altitudes))
+        return false;
+
+    uint8_t genes[GENOME_MAX_GENES];
+    return genome_encode(self, throttle_program, altitude_angle_program, genes);
+}
+
+//As genome_table_init, from the kinds and altitudes alone.
+bool genome_table_init_altitudes(GenomeTable *self, ProgramKind throttle_kind, size_t throttle_length, const double *throttle_altitudes, ProgramKind altitude_angle_kind, size_t altitude_angle_length, const double *altitude_angle_altitudes) {
+    self->throttle_altitudes = NULL;
+    self->altitude_angle_altitudes = NULL;
+    if(!genome_table_accepts(throttle_kind, throttle_length) || !genome_table_accepts(altitude_angle_kind, altitude_angle_length))
+        return false;
+    if(throttle_length + altitude_angle_length > GENOME_MAX_GENES)
+        return false;
+
+    for(unsigned i=0; i<=THROTTLE_INTERVALS; i++)
+        self->throttle_grid[i] = (double)i / (double)THROTTLE_INTERVALS;
+    for(unsigned i=0; i<=ALTITUDE_ANGLE_INTERVALS; i++)
+        self->altitude_angle_grid[i] = (M_PI/2.0) * ((double)i / (double)ALTITUDE_ANGLE_INTERVALS);
+
+    self->throttle_kind = throttle_kind;
+    self->altitude_angle_kind = altitude_angle_kind;
+    self->throttle_length = throttle_length;
+    self->altitude_angle_length = altitude_angle_length;
+    self->genes = throttle_length + altitude_angle_length;
+
+    self->throttle_altitudes = (double *)malloc(sizeof(double) * throttle_length);
+    memcpy(self->throttle_altitudes, throttle_altitudes, sizeof(double) * throttle_length);
+    self->altitude_angle_altitudes = (double *)malloc(sizeof(double) * altitude_angle_length);
+    memcpy(self->altitude_angle_altitudes, altitude_angle_altitudes, sizeof(double) * altitude_angle_length);
+    return true;
+}
+
+//Room for count genomes, contiguous.
+uint8_t *genome_alloc(const GenomeTable *self, size_t count) {
+    return (uint8_t *)malloc(self->genes * count);
+}
+
+//False if the programs do not match the table or have a setting off the grid.
+bool genome_encode(const GenomeTable *self, const Program *throttle_program, const Program *altitude_angle_program, uint8_t *genes) {
+    if(throttle_program->kind != self->throttle_kind || throttle_program->length != self->throttle_length)
+        return false;
+    if(altitude_angle_program->kind != self->altitude_angle_kind || altitude_angle_program->length != self->altitude_angle_length)
+        return false;
+    if(memcmp(throttle_program->altitudes, self->throttle_altitudes, sizeof(double) * self->throttle_length) != 0)
+        return false;
+    if(memcmp(altitude_angle_program->altitudes, self->altitude_angle_altitudes, sizeof(double) * self->altitude_angle_length) != 0)
+        return false;
+
+    for(size_t i=0; i<self->throttle_length; i++)
+        if(!genome_encode_setting(self->throttle_grid, THROTTLE_INTERVALS+1, throttle_program->settings[i], &genes[i]))
+            return false;
+    uint8_t *altitude_angle_genes = genes + self->throttle_length;
+    for(size_t i=0; i<self->altitude_angle_length; i++)
+        if(!genome_encode_setting(self->altitude_angle_grid, ALTITUDE_ANGLE_INTERVALS+1, altitude_angle_program->settings[i], &altitude_angle_genes[i]))
+            return false;
+    return true;
+}
+
+//Writes the settings of programs made by genome_make_programs.
+void genome_decode(const GenomeTable *self, const uint8_t *genes, Program *throttle_program, Program *altitude_angle_program) {
+    for(size_t i=0; i<self->throttle_length; i++)
+        throttle_program->settings[i] = self->throttle_grid[genes[i]];
+    const uint8_t *altitude_angle_genes = genes + self->throttle_length;
+    for(size_t i=0; i<self->altitude_angle_length; i++)
+        altitude_angle_program->settings[i] = self->altitude_angle_grid[altitude_angle_genes[i]];
+}
+
+//Programs that borrow the table's altitudes, so must not outlive it.
+void genome_make_programs(const GenomeTable *self, const uint8_t *genes, Program **throttle_program, Program **altitude_angle_program) {
+    *throttle_program = program_init_shared(program_alloc(), self->throttle_length, self->throttle_altitudes);
+    (*throttle_program)->kind = self->throttle_kind;
+    *altitude_angle_program = program_init_shared(program_alloc(), self->altitude_angle_length, self->altitude_angle_altitudes);
+    (*altitude_angle_program)->kind = self->altitude_angle_kind;
+    genome_decode(self, genes, *throttle_program, *altitude_angle_program);
+}
+
+//Redraws one throttle gene and one altitude angle gene, as the program mutations do.
+void genome_mutate(const GenomeTable *self, uint8_t *genes, Rng *rng) {
+    size_t i = rng_uniform(rng, (unsigned)self->throttle_length);
+    genes[i] = (uint8_t)rng_uniform(rng, THROTTLE_INTERVALS+1);
+
+    size_t j = rng_uniform(rng, (unsigned)self->altitude_angle_length);
+    genes[self->throttle_length + j] = (uint8_t)rng_uniform(rng, ALTITUDE_ANGLE_INTERVALS+1);
+}
+
+//False if a gene is off its grid, as in a corrupt genome read from a file.
+bool genome_valid(const GenomeTable *self, const uint8_t *genes) {
+    for(size_t i=0; i<self->throttle_length; i++)
+        if(genes[i] > THROTTLE_INTERVALS)
+            return false;
+    for(size_t i=self->throttle_length; i<self->genes; i++)
+        if(genes[i] > ALTITUDE_ANGLE_INTERVALS)
+            return false;
+    return true;
+}
+
+uint64_t genome_hash(const GenomeTable *self, uint64_t hash, const uint8_t *genes) {
+    return fitness_cache_hash(hash, genes, self->genes);
+}
+
+static bool genome_table_accepts(ProgramKind kind, size_t length) {
+    switch(kind) {
+        case PROGRAM_KIND_STEP:
+        case PROGRAM_KIND_LINEAR:
+        case PROGRAM_KIND_SPLINE:
+            return length > 0;
+        default:
+            return false;
+    }
+}
+
+static bool genome_encode_setting(const double *grid, size_t grid_length, double setting, uint8_t *gene) {
+    for(size_t i=0; i<grid_length; i++) {
+        if(fabs(grid[i] - setting) <= GENOME_GRID_TOLERANCE) {
+            *gene = (uint8_t)i;
+            return true;
+        }
+    }
+    return false;
+}
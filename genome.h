@@ -0,0 +1,51 @@
+#ifndef KERBAL_LAUNCH_GENOME_H
+#define KERBAL_LAUNCH_GENOME_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "program.h"
+#include "rng.h"
+#include "optimizer.h"
+
+#define GENOME_MAX_GENES 64
+#define GENOME_GRID_TOLERANCE 1e-9 //How far a setting may be from a grid value and still encode to it.
+
+/*
+ * A candidate pair of programs as one byte per setting: the index of the
+ * setting on the THROTTLE_INTERVALS or ALTITUDE_ANGLE_INTERVALS grid, throttle
+ * genes first.  Mutation never moves a breakpoint (gravity turns aside, which
+ * do not encode), so the altitudes and kinds live once in a GenomeTable shared
+ * by the whole search; a population is just table->genes bytes per candidate,
+ * and copying, comparing and hashing a candidate are over those bytes.
+ *
+ * Genomes are decoded into programs that borrow the table's altitudes, just
+ * before they are flown, so the tick loop is unchanged.
+ */
+typedef struct GenomeTable {
+    ProgramKind throttle_kind;
+    ProgramKind altitude_angle_kind;
+    size_t throttle_length;
+    size_t altitude_angle_length;
+    size_t genes;
+    double *throttle_altitudes;
+    double *altitude_angle_altitudes;
+    double throttle_grid[THROTTLE_INTERVALS+1];
+    double altitude_angle_grid[ALTITUDE_ANGLE_INTERVALS+1];
+} GenomeTable;
+
+GenomeTable *genome_table_alloc(void);
+void genome_table_dealloc(GenomeTable *self);
+bool genome_table_init(GenomeTable *self, const Program *throttle_program, const Program *altitude_angle_program);
+bool genome_table_init_altitudes(GenomeTable *self, ProgramKind throttle_kind, size_t throttle_length, const double *throttle_altitudes, ProgramKind altitude_angle_kind, size_t altitude_angle_length, const double *altitude_angle_altitudes);
+
+uint8_t *genome_alloc(const GenomeTable *self, size_t count);
+bool genome_encode(const GenomeTable *self, const Program *throttle_program, const Program *altitude_angle_program, uint8_t *genes);
+void genome_decode(const GenomeTable *self, const uint8_t *genes, Program *throttle_program, Program *altitude_angle_program);
+void genome_make_programs(const GenomeTable *self, const uint8_t *genes, Program **throttle_program, Program **altitude_angle_program);
+bool genome_valid(const GenomeTable *self, const uint8_t *genes);
+void genome_mutate(const GenomeTable *self, uint8_t *genes, Rng *rng);
+uint64_t genome_hash(const GenomeTable *self, uint64_t hash, const uint8_t *genes);
+
+#endif
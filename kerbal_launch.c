@@ -0,0 +1,364 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+
+#include "kerbal_launch.h"
+#include "optimizer.h"
+#include "evaluate.h"
+#include "scenario.h"
+#include "cache.h"
+
+#define KERBAL_LAUNCH_GENERATIONS 1024 //As the executable searches: 16384 flights at OPTIMIZER_CHILDREN a generation.
+
+typedef void *(*pthread_func)(void *);
+
+struct KerbalLaunchScenario {
+    Planetoid planetoid;
+    Rocket rocket; //On the planetoid's pad; every flight starts from a copy.
+    double target_altitude;
+    unsigned threads;
+
+    Optimizer *optimizer; //The flight configuration for evaluations; no search is run on it.
+};
+
+//A batch being flown; workers claim candidates by index.
+typedef struct KerbalLaunchBatch {
+    const KerbalLaunchScenario *scenario;
+    const KerbalLaunchProgram *throttle_programs;
+    const KerbalLaunchProgram *altitude_angle_programs;
+    KerbalLaunchFlight *flights;
+    size_t count;
+    atomic_size_t next;
+} KerbalLaunchBatch;
+
+static Optimizer *kerbal_launch_make_optimizer(const KerbalLaunchScenario *self);
+static bool kerbal_launch_program_view(const KerbalLaunchProgram *program, Program *view);
+static bool kerbal_launch_mode(KerbalLaunchMode mode, OptimizerMode *optimizer_mode);
+static void *kerbal_launch_worker(KerbalLaunchBatch *batch);
+static void kerbal_launch_report_progress(const Optimizer *optimizer, void *context);
+static bool kerbal_launch_has_room(const KerbalLaunchProgram *out);
+static void kerbal_launch_copy_program(const Program *program, KerbalLaunchProgram *out);
+
+unsigned kerbal_launch_api_version(void) {
+    return KERBAL_LAUNCH_API_VERSION;
+}
+
+KerbalLaunchScenario *kerbal_launch_scenario_alloc(void) {
+    KerbalLaunchScenario *self = (KerbalLaunchScenario *)malloc(sizeof(KerbalLaunchScenario));
+    if(self)
+        self->optimizer = NULL;
+    return self;
+}
+
+void kerbal_launch_scenario_dealloc(KerbalLaunchScenario *self) {
+    if(self == NULL)
+        return;
+    if(self->optimizer)
+        optimizer_dealloc(self->optimizer);
+    free(self);
+}
+
+/*
+ * Launches the rocket from Kerbin, cutting the throttle at the target altitude
+ * (m); evaluations run on a thread per online core until set otherwise.
+ * Returns NULL, leaving self to be deallocated, if the arguments are bad.
+ */
+KerbalLaunchScenario *kerbal_launch_scenario_init(KerbalLaunchScenario *self, KerbalLaunchRocket rocket, double target_altitude) {
+    if(self == NULL || !(target_altitude > 0.0))
+        return NULL;
+    switch(rocket) {
+        case KERBAL_LAUNCH_ROCKET_SMALL:
+            init_small_rocket(&self->rocket);
+            break;
+        case KERBAL_LAUNCH_ROCKET_LARGE:
+            init_large_rocket(&self->rocket);
+            break;
+        default:
+            return NULL;
+    }
+
+    //Placed from our own planetoid, not the shared kerbin_radius, so scenarios never race on it.
+    planetoid_init(&self->planetoid);
+    scenario_place_rocket(&self->rocket, self->planetoid.radius);
+    self->target_altitude = target_altitude;
+
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    self->threads = (cores > 0) ? (unsigned)cores : 1;
+
+    self->optimizer = kerbal_launch_make_optimizer(self);
+    return self;
+}
+
+bool kerbal_launch_set_threads(KerbalLaunchScenario *self, unsigned threads) {
+    if(threads == 0)
+        return false;
+    self->threads = threads;
+    return true;
+}
+
+unsigned kerbal_launch_threads(const KerbalLaunchScenario *self) {
+    return self->threads;
+}
+
+/*
+ * Flies candidate i, throttle_programs[i] with altitude_angle_programs[i], into
+ * flights[i] for every i below count, on up to the scenario's threads.  The
+ * programs are read in place.  A candidate whose programs are malformed (an
+ * unknown kind, no breakpoints, or altitudes not strictly increasing) is not
+ * flown: its flight is NaN with no ticks.  Returns false only if an array is
+ * missing.
+ */
+bool kerbal_launch_evaluate(KerbalLaunchScenario *self, size_t count,
+        const KerbalLaunchProgram *throttle_programs, const KerbalLaunchProgram *altitude_angle_programs,
+        KerbalLaunchFlight *flights) {
+    if(count == 0)
+        return true;
+    if(throttle_programs == NULL || altitude_angle_programs == NULL || flights == NULL)
+        return false;
+
+    KerbalLaunchBatch batch;
+    batch.scenario = self;
+    batch.throttle_programs = throttle_programs;
+    batch.altitude_angle_programs = altitude_angle_programs;
+    batch.flights = flights;
+    batch.count = count;
+    atomic_init(&batch.next, 0);
+
+    //A small batch is not worth a thread start.
+    unsigned workers = (count < self->threads) ? (unsigned)count : self->threads;
+    if(workers == 1) {
+        kerbal_launch_worker(&batch);
+        return true;
+    }
+
+    //Workers claim candidates until none are left, so any that failed to start are not missed.
+    pthread_t *threads = (pthread_t *)malloc(sizeof(pthread_t) * workers);
+    unsigned started = 0;
+    while(started < workers && pthread_create(&threads[started], NULL, (pthread_func)kerbal_launch_worker, &batch) == 0)
+        started++;
+    if(started == 0)
+        kerbal_launch_worker(&batch);
+    for(unsigned i=0; i<started; i++)
+        pthread_join(threads[i], NULL);
+    free(threads);
+    return true;
+}
+
+void kerbal_launch_search_defaults(KerbalLaunchSearch *search) {
+    search->mode = KERBAL_LAUNCH_MODE_GENERATIONAL;
+    search->generations = KERBAL_LAUNCH_GENERATIONS;
+    search->children = OPTIMIZER_CHILDREN;
+    search->seed = 1;
+    search->beam_width = OPTIMIZER_BEAM_WIDTH;
+    search->replicas = OPTIMIZER_TEMPERING_REPLICAS;
+    search->cache = true;
+    search->progress_func = NULL;
+    search->progress_context = NULL;
+}
+
+/*
+ * Searches from the seed programs (the standard step seeds, of
+ * KERBAL_LAUNCH_SEED_LENGTH breakpoints, where NULL) on the scenario's
+ * threads, and writes the best programs found into the caller's arrays.  Each
+ * best program must have room for the breakpoints of its seed; its kind and
+ * length are set to those written, and stats, unless NULL, to how the search
+ * went.  Returns false, writing nothing, if the search or seeds are malformed
+ * or a best program has too little room.
+ */
+bool kerbal_launch_optimize(KerbalLaunchScenario *self, const KerbalLaunchSearch *search,
+        const KerbalLaunchProgram *seed_throttle_program, const KerbalLaunchProgram *seed_altitude_angle_program,
+        KerbalLaunchProgram *best_throttle_program, KerbalLaunchProgram *best_altitude_angle_program,
+        double *best_fitness, KerbalLaunchSearchStats *stats) {
+    OptimizerMode mode;
+    if(search == NULL || best_fitness == NULL || !kerbal_launch_has_room(best_throttle_program) || !kerbal_launch_has_room(best_altitude_angle_program))
+        return false;
+    if(search->generations == 0 || search->children == 0 || !kerbal_launch_mode(search->mode, &mode))
+        return false;
+    if(search->beam_width == 0 || search->replicas == 0 || search->replicas > OPTIMIZER_MAX_REPLICAS)
+        return false;
+
+    Program throttle_view, altitude_angle_view;
+    if(seed_throttle_program && !kerbal_launch_program_view(seed_throttle_program, &throttle_view))
+        return false;
+    if(seed_altitude_angle_program && !kerbal_launch_program_view(seed_altitude_angle_program, &altitude_angle_view))
+        return false;
+    size_t throttle_length = seed_throttle_program ? throttle_view.length : SCENARIO_SEED_LENGTH;
+    size_t altitude_angle_length = seed_altitude_angle_program ? altitude_angle_view.length : SCENARIO_SEED_LENGTH;
+    if(throttle_length > best_throttle_program->length || altitude_angle_length > best_altitude_angle_program->length)
+        return false;
+
+    Program *throttle_seed = NULL, *altitude_angle_seed = NULL;
+    if(seed_throttle_program == NULL)
+        throttle_seed = init_throttle_seed(program_init(program_alloc(), SCENARIO_SEED_LENGTH));
+    if(seed_altitude_angle_program == NULL)
+        altitude_angle_seed = init_altitude_angle_seed(program_init(program_alloc(), SCENARIO_SEED_LENGTH));
+
+    Optimizer *optimizer = kerbal_launch_make_optimizer(self);
+    optimizer->seed_throttle_program = throttle_seed ? throttle_seed : &throttle_view;
+    optimizer->seed_altitude_angle_program = altitude_angle_seed ? altitude_angle_seed : &altitude_angle_view;
+    optimizer->mode = mode;
+    optimizer->generations = search->generations;
+    optimizer->children = search->children;
+    optimizer->beam_width = search->beam_width;
+    optimizer->tempering_replicas = search->replicas;
+    optimizer->workers = self->threads;
+    if(search->cache)
+        optimizer->cache = fitness_cache_init(fitness_cache_alloc(), FITNESS_CACHE_DEFAULT_CAPACITY);
+    optimizer->quiet = true;
+    optimizer->progress_func = kerbal_launch_report_progress;
+    optimizer->progress_context = (void *)search;
+    rng_init(&optimizer->rng, search->seed);
+
+    optimizer_run(optimizer);
+
+    //Mutation keeps the number of breakpoints, so the best fit where their seeds did.
+    kerbal_launch_copy_program(optimizer->best_throttle_program, best_throttle_program);
+    kerbal_launch_copy_program(optimizer->best_altitude_angle_program, best_altitude_angle_program);
+    *best_fitness = optimizer->best_fitness;
+    if(stats) {
+        stats->generations = optimizer->generation;
+        stats->children = optimizer->children;
+        stats->evaluations = optimizer->evaluations;
+        stats->wall_seconds = optimizer->wall_seconds;
+        stats->utilization = optimizer_utilization(optimizer);
+        stats->barrier_idle = (optimizer->barrier_seconds > 0.0) ? optimizer_idle_fraction(optimizer) : 0.0;
+        stats->cache_hit_rate = optimizer->cache ? fitness_cache_hit_rate(optimizer->cache) : NAN;
+    }
+
+    if(optimizer->cache)
+        fitness_cache_dealloc(optimizer->cache);
+    optimizer_dealloc(optimizer);
+    if(throttle_seed)
+        program_dealloc(throttle_seed);
+    if(altitude_angle_seed)
+        program_dealloc(altitude_angle_seed);
+    return true;
+}
+
+static Optimizer *kerbal_launch_make_optimizer(const KerbalLaunchScenario *self) {
+    Optimizer *optimizer = optimizer_init(optimizer_alloc());
+    optimizer->rocket_prototype = &self->rocket;
+    optimizer->planetoid = &self->planetoid;
+    optimizer->throttle_cutoff_radius = self->planetoid.radius + self->target_altitude;
+    return optimizer;
+}
+
+//Borrows the caller's arrays as a program, if they make a well formed one.
+static bool kerbal_launch_program_view(const KerbalLaunchProgram *program, Program *view) {
+    switch(program->kind) {
+        case KERBAL_LAUNCH_PROGRAM_STEP:
+            view->kind = PROGRAM_KIND_STEP;
+            break;
+        case KERBAL_LAUNCH_PROGRAM_LINEAR:
+            view->kind = PROGRAM_KIND_LINEAR;
+            break;
+        case KERBAL_LAUNCH_PROGRAM_SPLINE:
+            view->kind = PROGRAM_KIND_SPLINE;
+            break;
+        case KERBAL_LAUNCH_PROGRAM_GRAVITY_TURN:
+            view->kind = PROGRAM_KIND_GRAVITY_TURN;
+            break;
+        default:
+            return false;
+    }
+    if(program->length == 0 || program->altitudes == NULL || program->settings == NULL)
+        return false;
+    for(size_t i=0; i<program->length; i++) {
+        if(!isfinite(program->altitudes[i]) || !isfinite(program->settings[i]))
+            return false;
+        if(i > 0 && !(program->altitudes[i] > program->altitudes[i-1]))
+            return false;
+    }
+
+    //Never deallocated, so neither array is freed.
+    view->length = program->length;
+    view->altitudes = program->altitudes;
+    view->settings = program->settings;
+    view->owns_altitudes = false;
+    view->func = NULL;
+    view->context = NULL;
+    return true;
+}
+
+static bool kerbal_launch_mode(KerbalLaunchMode mode, OptimizerMode *optimizer_mode) {
+    switch(mode) {
+        case KERBAL_LAUNCH_MODE_GENERATIONAL:
+            *optimizer_mode = OPTIMIZER_MODE_GENERATIONAL;
+            return true;
+        case KERBAL_LAUNCH_MODE_SUCCESSIVE_HALVING:
+            *optimizer_mode = OPTIMIZER_MODE_SUCCESSIVE_HALVING;
+            return true;
+        case KERBAL_LAUNCH_MODE_STEADY_STATE:
+            *optimizer_mode = OPTIMIZER_MODE_STEADY_STATE;
+            return true;
+        case KERBAL_LAUNCH_MODE_BEAM:
+            *optimizer_mode = OPTIMIZER_MODE_BEAM;
+            return true;
+        case KERBAL_LAUNCH_MODE_TEMPERING:
+            *optimizer_mode = OPTIMIZER_MODE_TEMPERING;
+            return true;
+    }
+    return false;
+}
+
+static void *kerbal_launch_worker(KerbalLaunchBatch *batch) {
+    const Optimizer *optimizer = batch->scenario->optimizer;
+    size_t i;
+    while((i = atomic_fetch_add(&batch->next, 1)) < batch->count) {
+        KerbalLaunchFlight *flight = &batch->flights[i];
+        Program throttle_program, altitude_angle_program;
+        if(!kerbal_launch_program_view(&batch->throttle_programs[i], &throttle_program)
+                || !kerbal_launch_program_view(&batch->altitude_angle_programs[i], &altitude_angle_program)) {
+            flight->fitness = flight->altitude = flight->time = NAN;
+            flight->horizontal_velocity = flight->radial_velocity = flight->remaining_delta_v = NAN;
+            flight->ticks = 0;
+            continue;
+        }
+
+        EvaluatorFlight result;
+        evaluator_fly_candidate(optimizer, &throttle_program, &altitude_angle_program, &result);
+        flight->fitness = result.fitness;
+        flight->altitude = result.altitude;
+        flight->time = result.time;
+        flight->horizontal_velocity = result.horizontal_velocity;
+        flight->radial_velocity = result.radial_velocity;
+        flight->remaining_delta_v = result.remaining_delta_v;
+        flight->ticks = result.ticks;
+    }
+    return NULL;
+}
+
+static void kerbal_launch_report_progress(const Optimizer *optimizer, void *context) {
+    const KerbalLaunchSearch *search = (const KerbalLaunchSearch *)context;
+    if(search->progress_func == NULL)
+        return;
+    KerbalLaunchProgress progress = {optimizer->generation, optimizer->generations, optimizer->evaluations, optimizer->best_fitness};
+    search->progress_func(&progress, search->progress_context);
+}
+
+static bool kerbal_launch_has_room(const KerbalLaunchProgram *out) {
+    return out != NULL && out->altitudes != NULL && out->settings != NULL;
+}
+
+static void kerbal_launch_copy_program(const Program *program, KerbalLaunchProgram *out) {
+    switch(program->kind) {
+        case PROGRAM_KIND_LINEAR:
+            out->kind = KERBAL_LAUNCH_PROGRAM_LINEAR;
+            break;
+        case PROGRAM_KIND_SPLINE:
+            out->kind = KERBAL_LAUNCH_PROGRAM_SPLINE;
+            break;
+        case PROGRAM_KIND_GRAVITY_TURN:
+            out->kind = KERBAL_LAUNCH_PROGRAM_GRAVITY_TURN;
+            break;
+        default:
+            out->kind = KERBAL_LAUNCH_PROGRAM_STEP;
+            break;
+    }
+    out->length = program->length;
+    memcpy(out->altitudes, program->altitudes, sizeof(double) * program->length);
+    memcpy(out->settings, program->settings, sizeof(double) * program->length);
+}
@@ -0,0 +1,139 @@
+#ifndef KERBAL_LAUNCH_H
+#define KERBAL_LAUNCH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * The stable C API of libkerballaunch, for calling the simulator and optimizer
+ * in process from C, C++ or a foreign function interface (ctypes, cffi).
+ * Only this header is installed; the types behind the opaque scenario, and the
+ * rest of the headers, may change between releases.
+ *
+ * A scenario is a rocket and a target cutoff altitude above Kerbin.  Batches of
+ * candidate program pairs are flown on the scenario's threads straight from
+ * the caller's arrays, and their flights written to the caller's array; nothing
+ * is copied or parsed.  Distinct scenarios may be used from different threads
+ * at once; one scenario must not.
+ *
+ * KERBAL_LAUNCH_API_VERSION is bumped whenever a declaration here changes
+ * incompatibly; compare it with kerbal_launch_api_version() when loading the
+ * library at run time.
+ */
+
+#define KERBAL_LAUNCH_API_VERSION 2
+#define KERBAL_LAUNCH_SEED_LENGTH 9 //Breakpoints of the standard seed programs.
+
+#if defined(__GNUC__)
+#define KERBAL_LAUNCH_API __attribute__((visibility("default")))
+#else
+#define KERBAL_LAUNCH_API
+#endif
+
+typedef struct KerbalLaunchScenario KerbalLaunchScenario;
+
+typedef enum KerbalLaunchRocket {
+    KERBAL_LAUNCH_ROCKET_SMALL=0,
+    KERBAL_LAUNCH_ROCKET_LARGE
+} KerbalLaunchRocket;
+
+typedef enum KerbalLaunchProgramKind {
+    KERBAL_LAUNCH_PROGRAM_STEP=0, //Hold each setting until the next breakpoint.
+    KERBAL_LAUNCH_PROGRAM_LINEAR, //Interpolate linearly between breakpoints.
+    KERBAL_LAUNCH_PROGRAM_SPLINE, //Monotone cubic between breakpoints.
+    KERBAL_LAUNCH_PROGRAM_GRAVITY_TURN //Follow surface prograde, limited by the breakpoints.
+} KerbalLaunchProgramKind;
+
+typedef enum KerbalLaunchMode {
+    KERBAL_LAUNCH_MODE_GENERATIONAL=0,
+    KERBAL_LAUNCH_MODE_SUCCESSIVE_HALVING,
+    KERBAL_LAUNCH_MODE_STEADY_STATE,
+    KERBAL_LAUNCH_MODE_BEAM,
+    KERBAL_LAUNCH_MODE_TEMPERING
+} KerbalLaunchMode;
+
+/*
+ * A program as a table of breakpoints: altitudes (m, strictly increasing)
+ * and settings (throttle from 0 to 1, or altitude angle in radians).  The
+ * arrays belong to the caller and are only read when passed as input.
+ */
+typedef struct KerbalLaunchProgram {
+    KerbalLaunchProgramKind kind;
+    size_t length;
+    double *altitudes;
+    double *settings;
+} KerbalLaunchProgram;
+
+//Where a flight ended: its apex, or where it failed.
+typedef struct KerbalLaunchFlight {
+    double fitness; //As the optimizer scores it; NaN if the programs were malformed and not flown.
+    double altitude;
+    double time;
+    double horizontal_velocity;
+    double radial_velocity;
+    double remaining_delta_v;
+    unsigned long ticks;
+} KerbalLaunchFlight;
+
+typedef struct KerbalLaunchProgress {
+    unsigned generation;
+    unsigned generations;
+    unsigned long evaluations;
+    double best_fitness;
+} KerbalLaunchProgress;
+
+//Called on the calling thread after each generation's worth of evaluations.
+typedef void (*KerbalLaunchProgressFunc)(const KerbalLaunchProgress *progress, void *context);
+
+//How to search; start from kerbal_launch_search_defaults.
+typedef struct KerbalLaunchSearch {
+    KerbalLaunchMode mode;
+    unsigned generations;
+    unsigned children; //Mutants per generation.
+    unsigned long seed; //Of the random number generator; a seeded generational search repeats exactly.
+    unsigned beam_width; //Partial flights kept per breakpoint by the beam search.
+    unsigned replicas; //Chains run by the tempering search, each on its own thread.
+    bool cache; //Remember the fitness of candidates already flown.
+    KerbalLaunchProgressFunc progress_func; //May be NULL.
+    void *progress_context;
+} KerbalLaunchSearch;
+
+//How a search went; written by kerbal_launch_optimize if asked for.
+typedef struct KerbalLaunchSearchStats {
+    unsigned generations; //Run, of those searched for.
+    unsigned children;
+    unsigned long evaluations;
+    double wall_seconds;
+    double utilization; //Fraction of the usable cores' time spent flying.
+    double barrier_idle; //Fraction of the threads' time at the generation barrier spent waiting; 0 without one.
+    double cache_hit_rate; //NaN without the cache.
+} KerbalLaunchSearchStats;
+
+KERBAL_LAUNCH_API unsigned kerbal_launch_api_version(void);
+
+KERBAL_LAUNCH_API KerbalLaunchScenario *kerbal_launch_scenario_alloc(void);
+KERBAL_LAUNCH_API void kerbal_launch_scenario_dealloc(KerbalLaunchScenario *self);
+KERBAL_LAUNCH_API KerbalLaunchScenario *kerbal_launch_scenario_init(KerbalLaunchScenario *self, KerbalLaunchRocket rocket, double target_altitude);
+
+KERBAL_LAUNCH_API bool kerbal_launch_set_threads(KerbalLaunchScenario *self, unsigned threads);
+KERBAL_LAUNCH_API unsigned kerbal_launch_threads(const KerbalLaunchScenario *self);
+
+KERBAL_LAUNCH_API bool kerbal_launch_evaluate(KerbalLaunchScenario *self, size_t count,
+        const KerbalLaunchProgram *throttle_programs, const KerbalLaunchProgram *altitude_angle_programs,
+        KerbalLaunchFlight *flights);
+
+KERBAL_LAUNCH_API void kerbal_launch_search_defaults(KerbalLaunchSearch *search);
+KERBAL_LAUNCH_API bool kerbal_launch_optimize(KerbalLaunchScenario *self, const KerbalLaunchSearch *search,
+        const KerbalLaunchProgram *seed_throttle_program, const KerbalLaunchProgram *seed_altitude_angle_program,
+        KerbalLaunchProgram *best_throttle_program, KerbalLaunchProgram *best_altitude_angle_program,
+        double *best_fitness, KerbalLaunchSearchStats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
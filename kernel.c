@@ -0,0 +1,445 @@
+#define _XOPEN_SOURCE 700 //mkdtemp, popen and M_PI under strict C11.
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <dlfcn.h>
+
+#include "kernel.h"
+
+#define KERNEL_COMMAND_LENGTH 1024
+
+static bool kernel_supports(const System *system, char *error, size_t size);
+static void kernel_write_program(FILE *out, const char *macro, const char *name, const Program *program);
+static bool kernel_compile(Kernel *self, const char *source_path, const char *object_path);
+static bool kernel_calibrate(Kernel *self, const System *system);
+static void kernel_fly_scenario(const Kernel *kernel, const System *system, Rocket *rocket, System *flight);
+static double kernel_clock(void);
+
+/*
+ * The scenario-independent part of the generated source; it follows
+ * system_step and system_run_one_tick (and the planetoid, rocket and orbit
+ * functions they call) expression for expression.  K_ constants and the
+ * program tables are written ahead of it.  It is kept a line per string, as
+ * C11 compilers need only support literals of 4095 characters.
+ */
+static const char *const kernel_template[] = {
+    "static double kernel_program(int kind, const double *altitudes, size_t length, const double *settings, double altitude) {\n",
+    "    size_t i = 0;\n",
+    "    while(i < length-1) {\n",
+    "        if(altitude < altitudes[i+1])\n",
+    "            break;\n",
+    "        i++;\n",
+    "    }\n",
+    "    if(kind == K_KIND_STEP || i == length-1)\n",
+    "        return settings[i];\n",
+    "    double t = (altitude - altitudes[i]) / (altitudes[i+1] - altitudes[i]);\n",
+    "    return settings[i] + t*(settings[i+1] - settings[i]);\n",
+    "}\n",
+    "\n",
+    "int kernel_fly(double *state, unsigned long *ticks_io, int *ran, const double *throttle_settings, const double *altitude_angle_settings, double delta_t) {\n",
+    "    double x = state[0], y = state[1], vx = state[2], vy = state[3], m = state[4];\n",
+    "    unsigned long ticks = *ticks_io;\n",
+    "    int result;\n",
+    "    *ran = 0;\n",
+    "    for(;;) {\n",
+    "        double rx = x - K_PLANETOID_X, ry = y - K_PLANETOID_Y;\n",
+    "        double r = sqrt(rx*rx + ry*ry);\n",
+    "        double altitude = r - K_RADIUS;\n",
+    "        double azm = kerbal_atan2(ry, rx);\n",
+    "        double theta = -(azm);\n",
+    "        double radial_velocity = vx*kerbal_cos(theta) - vy*kerbal_sin(theta);\n",
+    "        if( altitude < 0.0 || radial_velocity < -0.0001 ) {\n",
+    "            result = K_STATE_SUCCESS;\n",
+    "            break;\n",
+    "        }\n",
+    "        if( ticks * delta_t > K_MAX_MISSION_TIME ) {\n",
+    "            result = K_STATE_ERROR;\n",
+    "            break;\n",
+    "        }\n",
+    "        state[0] = x; state[1] = y; state[2] = vx; state[3] = vy; state[4] = m;\n",
+    "        *ticks_io = ticks;\n",
+    "        *ran = 1;\n",
+    "\n",
+    "        double speed = sqrt(vx*vx + vy*vy);\n",
+    "        double throttle;\n",
+    "        if(K_CUTOFF_RADIUS > 0.0) {\n",
+    "            double angular_momentum = x*vy - y*vx;\n",
+    "            double energy = 0.5 * speed * speed + -(K_MU) / r;\n",
+    "            double apoapsis;\n",
+    "            int closed;\n",
+    "            if(energy == 0.0) {\n",
+    "                apoapsis = INFINITY;\n",
+    "                closed = 0;\n",
+    "            } else {\n",
+    "                double radicand = 1.0 + (2.0 * angular_momentum * angular_momentum * energy)/(K_MU * K_MU);\n",
+    "                if(radicand < 0.0)\n",
+    "                    radicand = 0.0;\n",
+    "                double eccentricity = sqrt(radicand);\n",
+    "                double semimajor_axis = -(K_MU)/(2.0*energy);\n",
+    "                apoapsis = semimajor_axis * (1.0 + eccentricity);\n",
+    "                closed = (energy > 0.0) ? 0 : 1;\n",
+    "            }\n",
+    "            if(!closed || (apoapsis >= K_CUTOFF_RADIUS))\n",
+    "                throttle = 0.0;\n",
+    "            else\n",
+    "                throttle = kernel_program(K_THROTTLE_KIND, k_throttle_altitudes, K_THROTTLE_LENGTH, throttle_settings, altitude);\n",
+    "        } else {\n",
+    "            throttle = kernel_program(K_THROTTLE_KIND, k_throttle_altitudes, K_THROTTLE_LENGTH, throttle_settings, altitude);\n",
+    "        }\n",
+    "        double altitude_angle = kernel_program(K_ALTITUDE_ANGLE_KIND, k_altitude_angle_altitudes, K_ALTITUDE_ANGLE_LENGTH, altitude_angle_settings, altitude);\n",
+    "\n",
+    "        double atm;\n",
+    "        if( altitude >= K_MAX_ATMOSPHERIC_ALTITUDE )\n",
+    "            atm = 0.0;\n",
+    "        else if( altitude >= 0.0 )\n",
+    "            atm = exp(-altitude / K_ATMOSPHERIC_ATTENUATION);\n",
+    "        else\n",
+    "            atm = 1.0;\n",
+    "\n",
+    "        double thrust = (m <= K_EMPTY_MASS) ? 0.0 : throttle * K_MAX_THRUST;\n",
+    "        double dm = 0.0;\n",
+    "        if(thrust != 0.0)\n",
+    "            dm = thrust / ((atm*K_ISP_ATM + (1.0-atm)*K_ISP_VAC) * K_ISP_SURFACE_GRAVITY) * delta_t;\n",
+    "\n",
+    "        double gravity = -(m * K_MU)/(r*r);\n",
+    "        double fx = gravity * kerbal_cos(azm);\n",
+    "        double fy = gravity * kerbal_sin(azm);\n",
+    "        if(atm != 0.0) {\n",
+    "            double rho = atm * 1.2230948554874 * 0.008;\n",
+    "            double drag = -0.5 * rho * m * K_MAX_DRAG * speed * speed;\n",
+    "            double drag_azm = kerbal_atan2(vy, vx);\n",
+    "            fx = fx + drag * kerbal_cos(drag_azm);\n",
+    "            fy = fy + drag * kerbal_sin(drag_azm);\n",
+    "        }\n",
+    "        if(thrust != 0.0) {\n",
+    "            double thrust_azm = azm - K_HALF_PI + altitude_angle;\n",
+    "            fx = fx + thrust * kerbal_cos(thrust_azm);\n",
+    "            fy = fy + thrust * kerbal_sin(thrust_azm);\n",
+    "        }\n",
+    "\n",
+    "        double ax = fx/m, ay = fy/m;\n",
+    "        double dvx = ax*delta_t;\n",
+    "        double dvy = ay*delta_t;\n",
+    "        double dx = 0.5*ax*delta_t*delta_t + vx*delta_t;\n",
+    "        double dy = 0.5*ay*delta_t*delta_t + vy*delta_t;\n",
+    "\n",
+    "        m -= dm;\n",
+    "        vx += dvx;\n",
+    "        vy += dvy;\n",
+    "        x += dx;\n",
+    "        y += dy;\n",
+    "        ticks++;\n",
+    "    }\n",
+    "    if(!*ran) {\n",
+    "        state[0] = x; state[1] = y; state[2] = vx; state[3] = vy; state[4] = m;\n",
+    "        *ticks_io = ticks;\n",
+    "    }\n",
+    "    return result;\n",
+    "}\n"
+};
+
+Kernel *kernel_alloc(void) {
+    return (Kernel *)malloc(sizeof(Kernel));
+}
+
+void kernel_dealloc(Kernel *self) {
+    if(self->handle)
+        dlclose(self->handle);
+    free(self);
+}
+
+Kernel *kernel_init(Kernel *self) {
+    self->handle = NULL;
+    self->fly = NULL;
+    self->throttle_length = 0;
+    self->altitude_angle_length = 0;
+    self->compile_seconds = 0.0;
+    self->tick_speedup = 0.0;
+    self->error[0] = '\0';
+    return self;
+}
+
+/*
+ * Generates, compiles and loads the kernel for the system's scenario, then
+ * checks it against the generic path and times both.  On false the reason is
+ * in error, and systems keep to the generic path.
+ */
+bool kernel_build(Kernel *self, const System *system) {
+    if(!kernel_supports(system, self->error, sizeof(self->error)))
+        return false;
+
+    const char *tmp = getenv("TMPDIR");
+    if(tmp == NULL || tmp[0] == '\0')
+        tmp = "/tmp";
+    char directory[KERNEL_COMMAND_LENGTH/4];
+    snprintf(directory, sizeof(directory), "%s/kerbal_kernel.XXXXXX", tmp);
+    if(mkdtemp(directory) == NULL) {
+        snprintf(self->error, sizeof(self->error), "could not make a build directory in %s", tmp);
+        return false;
+    }
+    char source_path[sizeof(directory) + 16], object_path[sizeof(directory) + 16];
+    snprintf(source_path, sizeof(source_path), "%s/kernel.c", directory);
+    snprintf(object_path, sizeof(object_path), "%s/kernel.so", directory);
+
+    bool ok = false;
+    FILE *source = fopen(source_path, "w");
+    bool written = source && kernel_write_source(system, source);
+    if(source && fclose(source) != 0)
+        written = false;
+    if(written)
+        ok = kernel_compile(self, source_path, object_path);
+    else
+        snprintf(self->error, sizeof(self->error), "could not write the kernel source");
+    //Once loaded, the object stays mapped without its file.
+    unlink(source_path);
+    unlink(object_path);
+    rmdir(directory);
+    if(!ok)
+        return false;
+
+    //Record what was baked in.
+    self->planetoid = *system->planetoid;
+    self->rocket = *system->rocket;
+    self->throttle_cutoff_radius = system->throttle_cutoff_radius;
+    self->throttle_kind = system->throttle_program->kind;
+    self->altitude_angle_kind = system->altitude_angle_program->kind;
+    self->throttle_length = system->throttle_program->length;
+    self->altitude_angle_length = system->altitude_angle_program->length;
+    memcpy(self->throttle_altitudes, system->throttle_program->altitudes, sizeof(double) * self->throttle_length);
+    memcpy(self->altitude_angle_altitudes, system->altitude_angle_program->altitudes, sizeof(double) * self->altitude_angle_length);
+
+    if(!kernel_calibrate(self, system)) {
+        dlclose(self->handle);
+        self->handle = NULL;
+        self->fly = NULL;
+        return false;
+    }
+    return true;
+}
+
+//Writes the kernel source for the system's scenario; constants are in hex so they round trip exactly.
+bool kernel_write_source(const System *system, FILE *out) {
+    const Planetoid *planetoid = system->planetoid;
+    const Rocket *rocket = system->rocket;
+
+    fprintf(out, "/* Simulation kernel generated for one scenario; see kernel.h. */\n");
+    fprintf(out, "#include <stddef.h>\n#include <math.h>\n\n");
+#ifdef KERBAL_LAUNCH_FLOAT_TRIG
+    fprintf(out, "#define kerbal_atan2(y,x) (atan2f((y),(x)))\n#define kerbal_sin(theta) (sinf(theta))\n#define kerbal_cos(theta) (cosf(theta))\n\n");
+#else
+    fprintf(out, "#define kerbal_atan2(y,x) (atan2((y),(x)))\n#define kerbal_sin(theta) (sin(theta))\n#define kerbal_cos(theta) (cos(theta))\n\n");
+#endif
+    fprintf(out, "#define K_STATE_SUCCESS %d\n", SYSTEM_STATE_SUCCESS);
+    fprintf(out, "#define K_STATE_ERROR %d\n", SYSTEM_STATE_ERROR);
+    fprintf(out, "#define K_KIND_STEP %d\n", PROGRAM_KIND_STEP);
+    fprintf(out, "#define K_MAX_MISSION_TIME %a\n", SYSTEM_MAX_MISSION_TIME);
+    fprintf(out, "#define K_HALF_PI %a\n", M_PI/2.0);
+    fprintf(out, "#define K_ISP_SURFACE_GRAVITY %a\n\n", ISP_SURFACE_GRAVITY);
+
+    fprintf(out, "#define K_PLANETOID_X %a\n", VX(planetoid->position));
+    fprintf(out, "#define K_PLANETOID_Y %a\n", VY(planetoid->position));
+    fprintf(out, "#define K_RADIUS %a\n", planetoid->radius);
+    fprintf(out, "#define K_MU %a\n", planetoid->gravitational_parameter);
+    fprintf(out, "#define K_ATMOSPHERIC_ATTENUATION %a\n", planetoid->atmospheric_attenuation);
+    fprintf(out, "#define K_MAX_ATMOSPHERIC_ALTITUDE %a\n\n", planetoid->max_atmospheric_altitude);
+
+    fprintf(out, "#define K_MAX_THRUST %a\n", rocket->max_thrust);
+    fprintf(out, "#define K_ISP_VAC %a\n", rocket->isp_vac);
+    fprintf(out, "#define K_ISP_ATM %a\n", rocket->isp_atm);
+    fprintf(out, "#define K_EMPTY_MASS %a\n", rocket->empty_mass);
+    fprintf(out, "#define K_MAX_DRAG %a\n", rocket->max_drag);
+    fprintf(out, "#define K_CUTOFF_RADIUS %a\n\n", system->throttle_cutoff_radius);
+
+    kernel_write_program(out, "THROTTLE", "throttle", system->throttle_program);
+    kernel_write_program(out, "ALTITUDE_ANGLE", "altitude_angle", system->altitude_angle_program);
+
+    for(size_t i=0; i<sizeof(kernel_template)/sizeof(kernel_template[0]); i++)
+        fputs(kernel_template[i], out);
+    return !ferror(out);
+}
+
+static void kernel_write_program(FILE *out, const char *macro, const char *name, const Program *program) {
+    fprintf(out, "#define K_%s_KIND %d\n", macro, program->kind);
+    fprintf(out, "#define K_%s_LENGTH %zu\n", macro, program->length);
+    fprintf(out, "static const double k_%s_altitudes[] = {", name);
+    for(size_t i=0; i<program->length; i++)
+        fprintf(out, "%s%a", (i > 0) ? ", " : "", program->altitudes[i]);
+    fprintf(out, "};\n\n");
+}
+
+//Only what the generated source models: no logging, streaming or stats, and step or linear programs.
+static bool kernel_supports(const System *system, char *error, size_t size) {
+    const Program *programs[] = {system->throttle_program, system->altitude_angle_program};
+    for(int p=0; p<2; p++) {
+        if(programs[p]->kind != PROGRAM_KIND_STEP && programs[p]->kind != PROGRAM_KIND_LINEAR) {
+            snprintf(error, size, "%s programs are not supported", program_kind_name(programs[p]->kind));
+            return false;
+        }
+        if(programs[p]->length == 0 || programs[p]->length > KERNEL_MAX_BREAKPOINTS) {
+            snprintf(error, size, "programs must have 1 to %d breakpoints", KERNEL_MAX_BREAKPOINTS);
+            return false;
+        }
+        //The generic path asserts below the first breakpoint; the kernel would carry on.
+        if(programs[p]->altitudes[0] > 0.0) {
+            snprintf(error, size, "programs must start at the ground");
+            return false;
+        }
+    }
+    if(system->logging || system->stream || system->collect_stats) {
+        snprintf(error, size, "logging, streaming and stats are not supported");
+        return false;
+    }
+    return true;
+}
+
+static bool kernel_compile(Kernel *self, const char *source_path, const char *object_path) {
+    const char *compiler = getenv("CC");
+    if(compiler == NULL || compiler[0] == '\0')
+        compiler = KERNEL_DEFAULT_COMPILER;
+
+    char command[KERNEL_COMMAND_LENGTH];
+    snprintf(command, sizeof(command), "%s %s -o '%s' '%s' -lm 2>&1", compiler, KERNEL_COMPILER_FLAGS, object_path, source_path);
+
+    double start = kernel_clock();
+    FILE *pipe = popen(command, "r");
+    if(pipe == NULL) {
+        snprintf(self->error, sizeof(self->error), "could not run %s", compiler);
+        return false;
+    }
+    //Keep the first line of the compiler's complaints, if any.
+    char line[sizeof(self->error)];
+    bool complained = false;
+    while(fgets(line, sizeof(line), pipe)) {
+        if(!complained) {
+            line[strcspn(line, "\n")] = '\0';
+            snprintf(self->error, sizeof(self->error), "%s", line);
+            complained = true;
+        }
+    }
+    int status = pclose(pipe);
+    self->compile_seconds = kernel_clock() - start;
+    if(status != 0) {
+        if(!complained)
+            snprintf(self->error, sizeof(self->error), "%s failed", compiler);
+        return false;
+    }
+
+    self->handle = dlopen(object_path, RTLD_NOW | RTLD_LOCAL);
+    if(self->handle == NULL) {
+        snprintf(self->error, sizeof(self->error), "%s", dlerror());
+        return false;
+    }
+    *(void **)(&self->fly) = dlsym(self->handle, "kernel_fly");
+    if(self->fly == NULL) {
+        snprintf(self->error, sizeof(self->error), "no kernel_fly in the compiled kernel");
+        dlclose(self->handle);
+        self->handle = NULL;
+        return false;
+    }
+    self->error[0] = '\0';
+    return true;
+}
+
+/*
+ * Flies the scenario on both paths: the kernel is rejected unless it lands
+ * exactly where the generic path does, and the ratio of their times per tick
+ * is the speedup.
+ */
+static bool kernel_calibrate(Kernel *self, const System *system) {
+    Rocket generic_rocket, kernel_rocket;
+    System generic, flight;
+
+    double generic_seconds = 0.0, kernel_seconds = 0.0;
+    for(int i=0; i<KERNEL_CALIBRATION_FLIGHTS; i++) {
+        double start = kernel_clock();
+        kernel_fly_scenario(NULL, system, &generic_rocket, &generic);
+        generic_seconds += kernel_clock() - start;
+
+        start = kernel_clock();
+        kernel_fly_scenario(self, system, &kernel_rocket, &flight);
+        kernel_seconds += kernel_clock() - start;
+    }
+
+    bool same = generic.ticks == flight.ticks && generic.state == flight.state
+        && memcmp(&generic_rocket.position, &kernel_rocket.position, sizeof(Vector)) == 0
+        && memcmp(&generic_rocket.velocity, &kernel_rocket.velocity, sizeof(Vector)) == 0
+        && generic_rocket.mass == kernel_rocket.mass;
+    if(!same) {
+        snprintf(self->error, sizeof(self->error), "the kernel's flight differs from the generic path's (%lu ticks against %lu)", flight.ticks, generic.ticks);
+        return false;
+    }
+
+    self->tick_speedup = (kernel_seconds > 0.0) ? generic_seconds / kernel_seconds : 0.0;
+    return true;
+}
+
+static void kernel_fly_scenario(const Kernel *kernel, const System *system, Rocket *rocket, System *flight) {
+    *rocket = *system->rocket;
+    *flight = *system;
+    flight->rocket = rocket;
+    flight->kernel = kernel;
+    system_run(flight);
+}
+
+//A system the kernel was built for, apart from its settings.
+bool kernel_accepts(const Kernel *self, const System *system) {
+    if(self->fly == NULL || system->logging || system->stream || system->collect_stats)
+        return false;
+
+    const Planetoid *planetoid = system->planetoid;
+    const Rocket *rocket = system->rocket;
+    const Program *throttle_program = system->throttle_program;
+    const Program *altitude_angle_program = system->altitude_angle_program;
+    return planetoid->radius == self->planetoid.radius
+        && planetoid->gravitational_parameter == self->planetoid.gravitational_parameter
+        && planetoid->atmospheric_attenuation == self->planetoid.atmospheric_attenuation
+        && planetoid->max_atmospheric_altitude == self->planetoid.max_atmospheric_altitude
+        && VX(planetoid->position) == VX(self->planetoid.position)
+        && VY(planetoid->position) == VY(self->planetoid.position)
+        && rocket->max_thrust == self->rocket.max_thrust
+        && rocket->isp_vac == self->rocket.isp_vac
+        && rocket->isp_atm == self->rocket.isp_atm
+        && rocket->empty_mass == self->rocket.empty_mass
+        && rocket->max_drag == self->rocket.max_drag
+        && system->throttle_cutoff_radius == self->throttle_cutoff_radius
+        && throttle_program->kind == self->throttle_kind
+        && altitude_angle_program->kind == self->altitude_angle_kind
+        && throttle_program->length == self->throttle_length
+        && altitude_angle_program->length == self->altitude_angle_length
+        && memcmp(throttle_program->altitudes, self->throttle_altitudes, sizeof(double) * self->throttle_length) == 0
+        && memcmp(altitude_angle_program->altitudes, self->altitude_angle_altitudes, sizeof(double) * self->altitude_angle_length) == 0;
+}
+
+/*
+ * system_run through the kernel.  The kernel hands back the state before the
+ * last tick it ran, which is then replayed on the generic path so the apex
+ * frame is filled in exactly as system_run fills it.
+ */
+void kernel_run(const Kernel *self, System *system) {
+    Rocket *rocket = system->rocket;
+    double state[5] = {VX(rocket->position), VY(rocket->position), VX(rocket->velocity), VY(rocket->velocity), rocket->mass};
+    unsigned long ticks = system->ticks;
+    int ran;
+
+    Frame frame;
+    system_start(system, &frame);
+    int result = self->fly(state, &ticks, &ran, system->throttle_program->settings, system->altitude_angle_program->settings, system->delta_t);
+
+    rocket->position = vector_rect(state[0], state[1]);
+    rocket->velocity = vector_rect(state[2], state[3]);
+    rocket->mass = state[4];
+    system->ticks = ticks;
+    if(ran)
+        system_run_one_tick(system);
+    system->state = (SystemState)result;
+    system_finish(system);
+}
+
+static double kernel_clock(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + 1e-9*now.tv_nsec;
+}
@@ -0,0 +1,60 @@
+#ifndef KERBAL_LAUNCH_KERNEL_H
+#define KERBAL_LAUNCH_KERNEL_H
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "system.h"
+
+#define KERNEL_DEFAULT_COMPILER "cc"
+#define KERNEL_COMPILER_FLAGS "-O2 -fPIC -shared"
+#define KERNEL_MAX_BREAKPOINTS 64
+#define KERNEL_CALIBRATION_FLIGHTS 8 //Flights of the scenario timed on each path to measure the speedup.
+
+/*
+ * A simulation kernel specialized to one scenario: the planetoid and rocket
+ * constants, the throttle cutoff and the programs' kinds and breakpoint
+ * altitudes are written into a C source as constants, compiled with the local
+ * compiler ($CC, or cc) into a shared object and loaded.  The compiler then
+ * folds the constants, drops the atmosphere and thrust work where they are
+ * zero, and shares the trigonometry that the generic path recomputes in each
+ * planetoid call.  The arithmetic is otherwise the generic path's, operation
+ * for operation, so flights are bit for bit the same; kernel_build checks
+ * this on the scenario before accepting the kernel.
+ *
+ * Only the settings vary between flights, so one kernel serves a whole
+ * optimization.  system_run uses it for any system it accepts (see
+ * kernel_accepts) and the generic path otherwise.  Step and linear programs
+ * are supported.
+ */
+typedef struct Kernel {
+    void *handle;
+    int (*fly)(double *state, unsigned long *ticks, int *ran, const double *throttle_settings, const double *altitude_angle_settings, double delta_t);
+
+    //What was baked in.
+    Planetoid planetoid;
+    Rocket rocket;
+    double throttle_cutoff_radius;
+    ProgramKind throttle_kind;
+    ProgramKind altitude_angle_kind;
+    size_t throttle_length;
+    size_t altitude_angle_length;
+    double throttle_altitudes[KERNEL_MAX_BREAKPOINTS];
+    double altitude_angle_altitudes[KERNEL_MAX_BREAKPOINTS];
+
+    double compile_seconds;
+    double tick_speedup; //Generic seconds per tick over the kernel's, on the scenario.
+    char error[256]; //Why kernel_build failed.
+} Kernel;
+
+Kernel *kernel_alloc(void);
+void kernel_dealloc(Kernel *self);
+Kernel *kernel_init(Kernel *self);
+
+bool kernel_build(Kernel *self, const System *system);
+bool kernel_write_source(const System *system, FILE *out);
+
+bool kernel_accepts(const Kernel *self, const System *system);
+void kernel_run(const Kernel *self, System *system);
+
+#endif
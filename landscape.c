@@ -0,0 +1,469 @@
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+
+#include "landscape.h"
+#include "rng.h"
+
+typedef void *(*pthread_func)(void *);
+
+//A batch of design rows being flown; workers claim flights by index.
+typedef struct LandscapeBatch {
+    const Landscape *landscape;
+    const double *points; //Per row, the settings of A then of B.
+    double *fitness; //Per row, A, B, then A with each setting from B.
+    size_t flights;
+    atomic_size_t next;
+    atomic_ulong ticks;
+} LandscapeBatch;
+
+static void landscape_ranges(Landscape *self);
+static double landscape_fly(const Landscape *self, const Program *throttle_program, const Program *altitude_angle_program, unsigned long *ticks);
+static void landscape_fly_batch(Landscape *self, const double *points, double *fitness, size_t rows);
+static void *landscape_worker(LandscapeBatch *batch);
+static void landscape_accumulate(Landscape *self, const double *fitness, size_t rows);
+static void landscape_finish(Landscape *self);
+static bool landscape_write_header(const Landscape *self, FILE *out);
+static bool landscape_write_rows(const Landscape *self, unsigned long first, const double *points, const double *fitness, size_t rows, FILE *out);
+static double landscape_point(const Landscape *self, uint32_t (*directions)[LANDSCAPE_SOBOL_BITS], unsigned long row, size_t dimension);
+static void landscape_sobol_init(uint32_t (*directions)[LANDSCAPE_SOBOL_BITS], size_t dimensions);
+static uint32_t landscape_next_primitive(uint32_t polynomial);
+static unsigned landscape_degree(uint64_t polynomial);
+static uint64_t landscape_permute(uint64_t i, uint64_t length, uint64_t key);
+static uint64_t landscape_mix(uint64_t x);
+static double landscape_clock(void);
+
+Landscape *landscape_alloc(void) {
+    return (Landscape *)malloc(sizeof(Landscape));
+}
+
+void landscape_dealloc(Landscape *self) {
+    free(self);
+}
+
+Landscape *landscape_init(Landscape *self, const Optimizer *optimizer, const Program *throttle_program, const Program *altitude_angle_program, unsigned workers) {
+    assert(workers > 0);
+    assert(throttle_program->length + altitude_angle_program->length <= LANDSCAPE_MAX_DIMENSIONS);
+
+    self->optimizer = optimizer;
+    self->base_throttle_program = throttle_program;
+    self->base_altitude_angle_program = altitude_angle_program;
+
+    self->design = LANDSCAPE_DESIGN_SOBOL;
+    self->samples = 1024;
+    self->throttle_radius = LANDSCAPE_THROTTLE_RADIUS;
+    self->altitude_angle_radius = LANDSCAPE_ALTITUDE_ANGLE_RADIUS;
+    self->seed = 1;
+    self->workers = workers;
+    self->batch = LANDSCAPE_BATCH;
+
+    self->dimensions = throttle_program->length + altitude_angle_program->length;
+    landscape_ranges(self);
+
+    self->base_fitness = -INFINITY;
+    self->rows = 0;
+    self->failed_rows = 0;
+    self->flights = 0;
+    self->ticks = 0;
+    self->wall_seconds = 0.0;
+    self->variance = 0.0;
+
+    self->sum = 0.0;
+    self->sum_squares = 0.0;
+    for(size_t i=0; i<LANDSCAPE_MAX_DIMENSIONS; i++) {
+        self->main_effect[i] = 0.0;
+        self->total_effect[i] = 0.0;
+        self->main_sum[i] = 0.0;
+        self->total_sum[i] = 0.0;
+    }
+    return self;
+}
+
+/*
+ * Flies the whole design, writing each batch of rows to out as it completes,
+ * and leaves the sensitivity indices in main_effect and total_effect.
+ * Returns false if out could not be written.
+ */
+bool landscape_run(Landscape *self, FILE *out) {
+    assert(self->samples > 0 && self->samples <= UINT32_MAX); //Sobol indices are 32 bit.
+    landscape_ranges(self);
+
+    double start = landscape_clock();
+    unsigned long ticks = 0;
+    self->base_fitness = landscape_fly(self, self->base_throttle_program, self->base_altitude_angle_program, &ticks);
+    self->ticks += ticks;
+    if(!landscape_write_header(self, out))
+        return false;
+
+    size_t dimensions = self->dimensions;
+    uint32_t (*directions)[LANDSCAPE_SOBOL_BITS] = NULL;
+    if(self->design == LANDSCAPE_DESIGN_SOBOL) {
+        directions = malloc(sizeof(uint32_t[LANDSCAPE_SOBOL_BITS]) * 2 * dimensions);
+        landscape_sobol_init(directions, 2*dimensions);
+    }
+    double *points = (double *)malloc(sizeof(double) * self->batch * 2 * dimensions);
+    double *fitness = (double *)malloc(sizeof(double) * self->batch * (dimensions + 2));
+
+    bool ok = true;
+    for(unsigned long first=0; ok && first<self->samples; first+=self->batch) {
+        size_t rows = (self->samples - first < self->batch) ? (size_t)(self->samples - first) : self->batch;
+
+        //Design dimensions j and dimensions+j both map to setting j.
+        for(size_t r=0; r<rows; r++) {
+            for(size_t j=0; j<2*dimensions; j++) {
+                size_t setting = j % dimensions;
+                double u = landscape_point(self, directions, first + r, j);
+                points[r*2*dimensions + j] = self->lower[setting] + u*(self->upper[setting] - self->lower[setting]);
+            }
+        }
+
+        landscape_fly_batch(self, points, fitness, rows);
+        landscape_accumulate(self, fitness, rows);
+        ok = landscape_write_rows(self, first, points, fitness, rows, out);
+    }
+    if(fflush(out) != 0)
+        ok = false;
+    landscape_finish(self);
+    self->wall_seconds += landscape_clock() - start;
+
+    free(points);
+    free(fitness);
+    free(directions);
+    return ok;
+}
+
+void landscape_display(const Landscape *self) {
+    printf("Design: %s, %lu rows x %zu flights (%lu rows left out)\n",
+           landscape_design_name(self->design), self->samples, self->dimensions + 2, self->failed_rows);
+    printf("Flights: %lu in %f s (%f/s)\n", self->flights, self->wall_seconds, self->flights/self->wall_seconds);
+    printf("Base Fitness: %f\n", self->base_fitness);
+    printf("Fitness Variance: %f\n", self->variance);
+    printf("%-15s %10s %21s %8s %8s\n", "Setting", "Altitude", "Range", "Main", "Total");
+
+    size_t throttle_length = self->base_throttle_program->length;
+    for(size_t j=0; j<self->dimensions; j++) {
+        bool throttle = j < throttle_length;
+        const Program *program = throttle ? self->base_throttle_program : self->base_altitude_angle_program;
+        size_t i = throttle ? j : j - throttle_length;
+        double conversion = throttle ? 1.0 : 180.0/M_PI;
+        printf("%-15s %10.0f %10.3f %10.3f %8.4f %8.4f\n",
+               throttle ? "throttle" : "altitude_angle", program->altitudes[i],
+               self->lower[j]*conversion, self->upper[j]*conversion,
+               self->main_effect[j], self->total_effect[j]);
+    }
+}
+
+static const char *landscape_design_names[] = {"sobol", "lhs"};
+
+const char *landscape_design_name(LandscapeDesign design) {
+    return landscape_design_names[design];
+}
+
+bool landscape_design_parse(const char *name, LandscapeDesign *design) {
+    for(size_t i=0; i<sizeof(landscape_design_names)/sizeof(landscape_design_names[0]); i++) {
+        if(strcmp(name, landscape_design_names[i]) == 0) {
+            *design = (LandscapeDesign)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+//Each setting ranges over its base plus or minus the radius, within the mutation grid's range.
+static void landscape_ranges(Landscape *self) {
+    size_t throttle_length = self->base_throttle_program->length;
+    for(size_t j=0; j<self->dimensions; j++) {
+        if(j < throttle_length) {
+            double base = self->base_throttle_program->settings[j];
+            self->lower[j] = fmax(0.0, base - self->throttle_radius);
+            self->upper[j] = fmin(1.0, base + self->throttle_radius);
+        } else {
+            double base = self->base_altitude_angle_program->settings[j - throttle_length];
+            self->lower[j] = fmax(0.0, base - self->altitude_angle_radius);
+            self->upper[j] = fmin(M_PI/2.0, base + self->altitude_angle_radius);
+        }
+    }
+}
+
+static double landscape_fly(const Landscape *self, const Program *throttle_program, const Program *altitude_angle_program, unsigned long *ticks) {
+    System *system = optimizer_make_system(self->optimizer, throttle_program, altitude_angle_program);
+    OptimizerSystemResult *result = optimizer_run_system(system);
+    double fitness = result->fitness;
+    *ticks += result->ticks;
+
+    free(result);
+    rocket_dealloc(system->rocket);
+    system_dealloc(system);
+    return fitness;
+}
+
+static void landscape_fly_batch(Landscape *self, const double *points, double *fitness, size_t rows) {
+    LandscapeBatch batch;
+    batch.landscape = self;
+    batch.points = points;
+    batch.fitness = fitness;
+    batch.flights = rows * (self->dimensions + 2);
+    atomic_init(&batch.next, 0);
+    atomic_init(&batch.ticks, 0);
+
+    unsigned workers = (batch.flights < self->workers) ? (unsigned)batch.flights : self->workers;
+    pthread_t *threads = (pthread_t *)malloc(sizeof(pthread_t) * workers);
+    for(unsigned i=0; i<workers; i++)
+        pthread_create(&threads[i], NULL, (pthread_func)landscape_worker, &batch);
+    for(unsigned i=0; i<workers; i++)
+        pthread_join(threads[i], NULL);
+    free(threads);
+
+    self->flights += batch.flights;
+    self->ticks += atomic_load(&batch.ticks);
+}
+
+static void *landscape_worker(LandscapeBatch *batch) {
+    const Landscape *landscape = batch->landscape;
+    size_t dimensions = landscape->dimensions;
+    size_t throttle_length = landscape->base_throttle_program->length;
+
+    //The breakpoints and kinds are the base's; only the settings are rewritten.
+    Program *throttle_program = program_init_copy(program_alloc(), landscape->base_throttle_program);
+    Program *altitude_angle_program = program_init_copy(program_alloc(), landscape->base_altitude_angle_program);
+
+    unsigned long ticks = 0;
+    size_t flight;
+    while((flight = atomic_fetch_add(&batch->next, 1)) < batch->flights) {
+        size_t row = flight / (dimensions + 2);
+        size_t which = flight % (dimensions + 2); //0 is A, 1 is B, 2+i is A with setting i from B.
+        const double *a = &batch->points[row*2*dimensions];
+        const double *b = a + dimensions;
+
+        for(size_t j=0; j<dimensions; j++) {
+            double setting = (which == 1 || which == 2+j) ? b[j] : a[j];
+            if(j < throttle_length)
+                throttle_program->settings[j] = setting;
+            else
+                altitude_angle_program->settings[j - throttle_length] = setting;
+        }
+        batch->fitness[flight] = landscape_fly(landscape, throttle_program, altitude_angle_program, &ticks);
+    }
+    atomic_fetch_add(&batch->ticks, ticks);
+
+    program_dealloc(throttle_program);
+    program_dealloc(altitude_angle_program);
+    return NULL;
+}
+
+//Adds the rows to the running sums, in row order so that the result does not depend on the workers.
+static void landscape_accumulate(Landscape *self, const double *fitness, size_t rows) {
+    size_t dimensions = self->dimensions;
+    //Sums are taken about the base fitness, which keeps the variance from cancelling.
+    double center = isfinite(self->base_fitness) ? self->base_fitness : 0.0;
+
+    for(size_t r=0; r<rows; r++) {
+        const double *f = &fitness[r*(dimensions + 2)];
+        bool finite = true;
+        for(size_t k=0; k<dimensions+2; k++)
+            finite = finite && isfinite(f[k]);
+        if(!finite) {
+            self->failed_rows++;
+            continue;
+        }
+
+        double ya = f[0] - center;
+        double yb = f[1] - center;
+        self->sum += ya + yb;
+        self->sum_squares += ya*ya + yb*yb;
+        for(size_t i=0; i<dimensions; i++) {
+            double yab = f[2+i] - center;
+            self->main_sum[i] += yb * (yab - ya);
+            self->total_sum[i] += (ya - yab) * (ya - yab);
+        }
+        self->rows++;
+    }
+}
+
+static void landscape_finish(Landscape *self) {
+    self->variance = 0.0;
+    for(size_t i=0; i<self->dimensions; i++) {
+        self->main_effect[i] = 0.0;
+        self->total_effect[i] = 0.0;
+    }
+    if(self->rows == 0)
+        return;
+
+    double n = (double)self->rows;
+    double mean = self->sum / (2.0*n);
+    self->variance = self->sum_squares / (2.0*n) - mean*mean;
+    if(self->variance <= 0.0)
+        return;
+
+    for(size_t i=0; i<self->dimensions; i++) {
+        self->main_effect[i] = (self->main_sum[i] / n) / self->variance;
+        self->total_effect[i] = (self->total_sum[i] / (2.0*n)) / self->variance;
+    }
+}
+
+static bool landscape_write_header(const Landscape *self, FILE *out) {
+    uint32_t version = LANDSCAPE_VERSION;
+    uint32_t design = (uint32_t)self->design;
+    uint32_t dimensions = (uint32_t)self->dimensions;
+    uint64_t samples = self->samples;
+    bool ok = fwrite(LANDSCAPE_MAGIC, 1, 4, out) == 4
+        && fwrite(&version, sizeof(version), 1, out) == 1
+        && fwrite(&design, sizeof(design), 1, out) == 1
+        && fwrite(&dimensions, sizeof(dimensions), 1, out) == 1
+        && fwrite(&samples, sizeof(samples), 1, out) == 1
+        && fwrite(&self->base_fitness, sizeof(double), 1, out) == 1;
+
+    size_t throttle_length = self->base_throttle_program->length;
+    for(size_t j=0; ok && j<self->dimensions; j++) {
+        uint32_t program = (j < throttle_length) ? 0 : 1;
+        uint32_t breakpoint = (uint32_t)((j < throttle_length) ? j : j - throttle_length);
+        double altitude = (program == 0) ? self->base_throttle_program->altitudes[breakpoint] : self->base_altitude_angle_program->altitudes[breakpoint];
+        ok = fwrite(&program, sizeof(program), 1, out) == 1
+            && fwrite(&breakpoint, sizeof(breakpoint), 1, out) == 1
+            && fwrite(&altitude, sizeof(double), 1, out) == 1
+            && fwrite(&self->lower[j], sizeof(double), 1, out) == 1
+            && fwrite(&self->upper[j], sizeof(double), 1, out) == 1;
+    }
+    return ok;
+}
+
+static bool landscape_write_rows(const Landscape *self, unsigned long first, const double *points, const double *fitness, size_t rows, FILE *out) {
+    size_t dimensions = self->dimensions;
+    for(size_t r=0; r<rows; r++) {
+        uint64_t row = first + r;
+        if(fwrite(&row, sizeof(row), 1, out) != 1
+                || fwrite(&points[r*2*dimensions], sizeof(double), 2*dimensions, out) != 2*dimensions
+                || fwrite(&fitness[r*(dimensions + 2)], sizeof(double), dimensions + 2, out) != dimensions + 2)
+            return false;
+    }
+    return true;
+}
+
+//The row's coordinate in [0,1) along a design dimension.
+static double landscape_point(const Landscape *self, uint32_t (*directions)[LANDSCAPE_SOBOL_BITS], unsigned long row, size_t dimension) {
+    if(self->design == LANDSCAPE_DESIGN_SOBOL) {
+        //Skip the first point, which is the origin in every dimension.
+        uint64_t index = (uint64_t)row + 1;
+        uint32_t x = 0;
+        for(unsigned bit=0; index; bit++, index >>= 1) {
+            if(index & 1)
+                x ^= directions[dimension][bit];
+        }
+        return x / 4294967296.0;
+    }
+
+    //Latin hypercube: the row's bin in this dimension, jittered within it.
+    uint64_t key = landscape_mix(self->seed ^ landscape_mix(dimension));
+    uint64_t bin = landscape_permute(row, self->samples, key);
+    double jitter = (landscape_mix(key ^ row) >> 11) * (1.0/9007199254740992.0);
+    return (bin + jitter) / (double)self->samples;
+}
+
+/*
+ * Direction numbers for the first dimensions of a Sobol sequence.  The first
+ * is the van der Corput sequence; each further one takes the next primitive
+ * polynomial, of degree s, and odd initial direction numbers m_k < 2^k for
+ * k <= s, extended by the polynomial's recurrence.
+ */
+static void landscape_sobol_init(uint32_t (*directions)[LANDSCAPE_SOBOL_BITS], size_t dimensions) {
+    Rng rng;
+    rng_init(&rng, LANDSCAPE_SOBOL_SEED);
+
+    for(unsigned k=0; k<LANDSCAPE_SOBOL_BITS; k++)
+        directions[0][k] = (uint32_t)1 << (LANDSCAPE_SOBOL_BITS - 1 - k);
+
+    uint32_t polynomial = 1;
+    for(size_t d=1; d<dimensions; d++) {
+        polynomial = landscape_next_primitive(polynomial);
+        unsigned s = landscape_degree(polynomial);
+
+        uint64_t m[LANDSCAPE_SOBOL_BITS + 1];
+        for(unsigned k=1; k<=s && k<=LANDSCAPE_SOBOL_BITS; k++)
+            m[k] = (rng_next(&rng) & (((uint64_t)1 << k) - 1)) | 1;
+        for(unsigned k=s+1; k<=LANDSCAPE_SOBOL_BITS; k++) {
+            m[k] = m[k-s] ^ (m[k-s] << s);
+            for(unsigned j=1; j<s; j++) {
+                if((polynomial >> (s-j)) & 1)
+                    m[k] ^= m[k-j] << j;
+            }
+        }
+        for(unsigned k=1; k<=LANDSCAPE_SOBOL_BITS; k++)
+            directions[d][k-1] = (uint32_t)(m[k] << (LANDSCAPE_SOBOL_BITS - k));
+    }
+}
+
+//The next primitive polynomial over GF(2), as bits of its coefficients: x is primitive when its order is 2^s - 1.
+static uint32_t landscape_next_primitive(uint32_t polynomial) {
+    for(;;) {
+        polynomial++;
+        if((polynomial & 1) == 0)
+            continue;
+        unsigned s = landscape_degree(polynomial);
+        if(s == 0)
+            continue;
+
+        uint64_t period = ((uint64_t)1 << s) - 1;
+        uint64_t power = 1;
+        uint64_t order = 0;
+        for(uint64_t k=1; k<=period; k++) {
+            power <<= 1;
+            if(power & ((uint64_t)1 << s))
+                power ^= polynomial;
+            if(power == 1) {
+                order = k;
+                break;
+            }
+        }
+        if(order == period)
+            return polynomial;
+    }
+}
+
+static unsigned landscape_degree(uint64_t polynomial) {
+    unsigned s = 0;
+    while(polynomial >>= 1)
+        s++;
+    return s;
+}
+
+/*
+ * A permutation of [0,length) keyed by key, without tables: rounds of xor,
+ * odd multiply and xorshift are each a bijection on the smallest power of two
+ * range covering length, and values that land outside [0,length) are mapped
+ * again until they fall inside (cycle walking).
+ */
+static uint64_t landscape_permute(uint64_t i, uint64_t length, uint64_t key) {
+    uint64_t mask = length - 1;
+    for(unsigned shift=1; shift<64; shift<<=1)
+        mask |= mask >> shift;
+    unsigned bits = landscape_degree(mask) + 1;
+    unsigned shift = (bits > 1) ? bits/2 : 1;
+
+    do {
+        for(unsigned round=0; round<4; round++) {
+            uint64_t round_key = landscape_mix(key + round);
+            i = (i ^ round_key) & mask;
+            i = (i * (round_key | 1)) & mask;
+            i ^= i >> shift;
+        }
+    } while(i >= length);
+    return i;
+}
+
+//The splitmix64 finalizer.
+static uint64_t landscape_mix(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+static double landscape_clock(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + 1e-9*now.tv_nsec;
+}
@@ -0,0 +1,102 @@
+#ifndef KERBAL_LAUNCH_LANDSCAPE_H
+#define KERBAL_LAUNCH_LANDSCAPE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "optimizer.h"
+
+#define LANDSCAPE_MAX_DIMENSIONS 64 //Settings varied, over both programs.
+#define LANDSCAPE_BATCH 256 //Design rows flown and written at a time; bounds the memory held.
+#define LANDSCAPE_THROTTLE_RADIUS (3.0/15.0) //Default range of each throttle setting about the base.
+#define LANDSCAPE_ALTITUDE_ANGLE_RADIUS (10.0*DEGREE) //Default range of each altitude angle setting about the base.
+#define LANDSCAPE_SOBOL_BITS 32
+#define LANDSCAPE_SOBOL_SEED 0x50b01 //Draws the Sobol initial direction numbers; fixed so designs repeat.
+#define LANDSCAPE_MAGIC "KLLS"
+#define LANDSCAPE_VERSION 1
+
+typedef enum LandscapeDesign {
+    LANDSCAPE_DESIGN_SOBOL=0,
+    LANDSCAPE_DESIGN_LATIN_HYPERCUBE
+} LandscapeDesign;
+
+/*
+ * Samples fitness over the throttle and altitude angle settings about a pair
+ * of base programs, for a sense of which breakpoints matter; the breakpoint
+ * altitudes and kinds are kept.  Each setting ranges uniformly over the base
+ * value plus or minus its radius, clipped to the settings' grid range.
+ *
+ * The design has samples rows, each two points A and B in the settings space,
+ * drawn from a Sobol sequence or a Latin hypercube in twice the dimensions.
+ * Each row flies A, B and, for every setting i, A with setting i taken from B
+ * (Saltelli's scheme), so samples * (dimensions + 2) flights in all.  From
+ * these, for each setting, the main effect (the fraction of the fitness
+ * variance due to the setting alone; Saltelli 2010) and the total effect (the
+ * fraction it has a hand in, interactions included; Jansen 1999) are
+ * estimated.  Only running sums are kept, and each batch of rows is written
+ * out and dropped, so designs of millions of rows run in bounded memory.  Rows
+ * with a flight that did not finish (fitness -inf) are left out of the sums.
+ *
+ * The Sobol sequence is the plain (unscrambled) one; its direction numbers
+ * come from the primitive polynomials in order of degree with initial values
+ * drawn from a fixed seed, as tables are only published for so many
+ * dimensions.  Its balance is best when samples is a power of two.  The Latin
+ * hypercube stratifies each dimension into samples bins, permuted by a keyed
+ * bijection so no permutation tables are held.
+ *
+ * The output is binary, in native byte order:
+ *   "KLLS", u32 version, u32 design, u32 dimensions, u64 samples, f64 base fitness,
+ *   then per dimension u32 program (0 throttle, 1 altitude angle), u32 breakpoint,
+ *     f64 altitude, f64 lower, f64 upper,
+ * then one record per row of
+ *   u64 row, f64 a[dimensions], f64 b[dimensions],
+ *   f64 fitness(A), f64 fitness(B), f64 fitness(A with b[i])[dimensions],
+ * with the settings as flown (altitude angles in radians).
+ */
+typedef struct Landscape {
+    const Optimizer *optimizer; //Supplies the rocket, planetoid, target and any kernel; not owned.
+    const Program *base_throttle_program;
+    const Program *base_altitude_angle_program;
+
+    LandscapeDesign design;
+    unsigned long samples;
+    double throttle_radius;
+    double altitude_angle_radius;
+    uint64_t seed; //Keys the Latin hypercube.
+    unsigned workers;
+    size_t batch;
+
+    size_t dimensions;
+    double lower[LANDSCAPE_MAX_DIMENSIONS];
+    double upper[LANDSCAPE_MAX_DIMENSIONS];
+
+    //Results.
+    double base_fitness;
+    unsigned long rows; //Rows in the sums.
+    unsigned long failed_rows;
+    unsigned long flights;
+    unsigned long ticks;
+    double wall_seconds;
+    double variance;
+    double main_effect[LANDSCAPE_MAX_DIMENSIONS];
+    double total_effect[LANDSCAPE_MAX_DIMENSIONS];
+
+    //Running sums of the fitness less the base fitness, y.
+    double sum; //Of y(A) and y(B).
+    double sum_squares;
+    double main_sum[LANDSCAPE_MAX_DIMENSIONS]; //Of y(B) (y(AB_i) - y(A)).
+    double total_sum[LANDSCAPE_MAX_DIMENSIONS]; //Of (y(A) - y(AB_i))^2.
+} Landscape;
+
+Landscape *landscape_alloc(void);
+void landscape_dealloc(Landscape *self);
+Landscape *landscape_init(Landscape *self, const Optimizer *optimizer, const Program *throttle_program, const Program *altitude_angle_program, unsigned workers);
+
+bool landscape_run(Landscape *self, FILE *out);
+void landscape_display(const Landscape *self);
+
+const char *landscape_design_name(LandscapeDesign design);
+bool landscape_design_parse(const char *name, LandscapeDesign *design);
+
+#endif
@@ -0,0 +1,317 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "library.h"
+#include "optimizer.h"
+
+//Features closer than this are considered the same scenario.
+#define LIBRARY_SAME_DISTANCE 1e-9
+
+static const char library_magic[4] = {'K', 'L', 'L', 'B'};
+
+static bool library_map(Library *self, size_t size);
+static void library_unmap(Library *self);
+static double library_distance(const double *a, const double *b);
+static bool library_same_tables(const LibraryEntry *a, const LibraryEntry *b);
+static bool library_entry_valid(const LibraryEntry *entry);
+static void library_fill_entry(LibraryEntry *entry, const double *features, double fitness, const Program *throttle_program, const Program *altitude_angle_program);
+static double library_snap(double value, double full_scale, unsigned intervals);
+
+Library *library_alloc(void) {
+    return (Library *)malloc(sizeof(Library));
+}
+
+void library_dealloc(Library *self) {
+    library_close(self);
+    pthread_mutex_destroy(&self->mutex);
+    free(self);
+}
+
+Library *library_init(Library *self) {
+    self->fd = -1;
+    self->mapped_size = 0;
+    self->header = NULL;
+    self->entries = NULL;
+    pthread_mutex_init(&self->mutex, NULL);
+    return self;
+}
+
+/*
+ * Opens the library at path, creating an empty one if it does not exist.
+ */
+bool library_open(Library *self, const char *path) {
+    library_close(self);
+
+    self->fd = open(path, O_RDWR | O_CREAT, 0644);
+    if(self->fd < 0)
+        return false;
+
+    flock(self->fd, LOCK_EX);
+    struct stat st;
+    bool ok = fstat(self->fd, &st) == 0;
+    if(ok && st.st_size == 0) {
+        LibraryHeader header;
+        memcpy(header.magic, library_magic, sizeof(header.magic));
+        header.version = LIBRARY_VERSION;
+        header.features = LIBRARY_FEATURES;
+        header.max_length = LIBRARY_MAX_LENGTH;
+        header.count = 0;
+        ok = write(self->fd, &header, sizeof(header)) == (ssize_t)sizeof(header);
+        st.st_size = sizeof(header);
+    }
+    ok = ok && (size_t)st.st_size >= sizeof(LibraryHeader) && library_map(self, (size_t)st.st_size);
+    flock(self->fd, LOCK_UN);
+
+    //Refuse libraries from another version, layout or byte order.
+    if(ok) {
+        const LibraryHeader *header = self->header;
+        ok = memcmp(header->magic, library_magic, sizeof(header->magic)) == 0
+            && header->version == LIBRARY_VERSION
+            && header->features == LIBRARY_FEATURES
+            && header->max_length == LIBRARY_MAX_LENGTH;
+    }
+
+    if(!ok)
+        library_close(self);
+    return ok;
+}
+
+void library_close(Library *self) {
+    library_unmap(self);
+    if(self->fd >= 0)
+        close(self->fd);
+    self->fd = -1;
+}
+
+size_t library_count(const Library *self) {
+    if(self->header == NULL)
+        return 0;
+
+    //Another process may have appended past the end of our mapping.
+    size_t mapped = (self->mapped_size - sizeof(LibraryHeader)) / sizeof(LibraryEntry);
+    return (self->header->count < mapped) ? (size_t)self->header->count : mapped;
+}
+
+/*
+ * Dimensionless features of a launch, each of order one, so that scenarios can
+ * be compared by plain Euclidean distance:
+ *   0: pad thrust to weight ratio
+ *   1: log of the wet to dry mass ratio
+ *   2: vacuum exhaust velocity over surface orbital velocity
+ *   3: atmospheric over vacuum isp
+ *   4: max drag relative to the usual 0.2
+ *   5: target altitude over the atmosphere's height
+ *   6: atmospheric scale height over planetoid radius, times 100
+ *   7: initial (rotational) speed over surface orbital velocity
+ */
+void library_features(double *features, const Rocket *rocket, const Planetoid *planetoid, double target_radius) {
+    double mu = planetoid->gravitational_parameter;
+    double radius = planetoid->radius;
+    double surface_gravity = mu / (radius*radius);
+    double orbital_velocity = sqrt(mu / radius);
+
+    features[0] = rocket->max_thrust / (rocket->mass * surface_gravity);
+    features[1] = log(rocket->mass / rocket->empty_mass);
+    features[2] = rocket->isp_vac * ISP_SURFACE_GRAVITY / orbital_velocity;
+    features[3] = rocket->isp_atm / rocket->isp_vac;
+    features[4] = rocket->max_drag / 0.2;
+    features[5] = (target_radius - radius) / planetoid->max_atmospheric_altitude;
+    features[6] = 100.0 * planetoid->atmospheric_attenuation / radius;
+    features[7] = vector_mag(rocket->velocity) / orbital_velocity;
+}
+
+/*
+ * Records a result.  If the library already holds the same scenario, the entry
+ * is replaced when the new fitness is better, otherwise a new entry is appended.
+ */
+bool library_add(Library *self, const double *features, double fitness, const Program *throttle_program, const Program *altitude_angle_program) {
+    if(self->header == NULL || !isfinite(fitness))
+        return false;
+    if(throttle_program->length > LIBRARY_MAX_LENGTH || altitude_angle_program->length > LIBRARY_MAX_LENGTH)
+        return false;
+    if(throttle_program->kind == PROGRAM_KIND_CUSTOM || altitude_angle_program->kind == PROGRAM_KIND_CUSTOM)
+        return false;
+
+    pthread_mutex_lock(&self->mutex);
+    flock(self->fd, LOCK_EX);
+
+    //Pick up anything appended by other processes since we mapped.
+    struct stat st;
+    bool ok = fstat(self->fd, &st) == 0;
+    if(ok && (size_t)st.st_size != self->mapped_size)
+        ok = library_map(self, (size_t)st.st_size);
+
+    size_t count = ok ? library_count(self) : 0;
+    size_t index = count;
+    for(size_t i=0; i<count; i++) {
+        if(library_distance(self->entries[i].features, features) < LIBRARY_SAME_DISTANCE) {
+            index = i;
+            break;
+        }
+    }
+
+    if(ok && index < count) {
+        if(fitness > self->entries[index].fitness)
+            library_fill_entry(&self->entries[index], features, fitness, throttle_program, altitude_angle_program);
+    } else if(ok) {
+        size_t size = sizeof(LibraryHeader) + (count+1) * sizeof(LibraryEntry);
+        ok = ftruncate(self->fd, (off_t)size) == 0 && library_map(self, size);
+        if(ok) {
+            library_fill_entry(&self->entries[count], features, fitness, throttle_program, altitude_angle_program);
+            self->header->count = count+1;
+        }
+    }
+
+    flock(self->fd, LOCK_UN);
+    pthread_mutex_unlock(&self->mutex);
+    return ok;
+}
+
+/*
+ * Finds up to k entries nearest the given features, nearest first.  A linear
+ * scan; at tens of thousands of entries it is well under a millisecond, and
+ * far cheaper than a single simulation.
+ */
+size_t library_nearest(const Library *self, const double *features, size_t k, size_t *indices, double *distances) {
+    size_t found = 0;
+    size_t count = library_count(self);
+    for(size_t i=0; i<count; i++) {
+        //Entries come from the file as is; skip any that could not have been added.
+        if(!library_entry_valid(&self->entries[i]))
+            continue;
+        double distance = library_distance(self->entries[i].features, features);
+        if(found == k && distance >= distances[k-1])
+            continue;
+
+        //Insertion into the sorted short list.
+        size_t j = (found < k) ? found++ : k-1;
+        while(j > 0 && distances[j-1] > distance) {
+            distances[j] = distances[j-1];
+            indices[j] = indices[j-1];
+            j--;
+        }
+        distances[j] = distance;
+        indices[j] = i;
+    }
+    return found;
+}
+
+/*
+ * Builds warm-start programs from the nearest entries.  Neighbours that share
+ * the nearest entry's program kinds and breakpoint tables are blended by
+ * inverse distance and snapped back onto the optimizer's grid; others are
+ * ignored.
+ */
+bool library_seed(Library *self, const double *features, Program **throttle_program, Program **altitude_angle_program) {
+    //library_add may remap the entries from another thread.
+    pthread_mutex_lock(&self->mutex);
+    size_t indices[LIBRARY_NEIGHBOURS];
+    double distances[LIBRARY_NEIGHBOURS];
+    size_t found = library_nearest(self, features, LIBRARY_NEIGHBOURS, indices, distances);
+    if(found == 0) {
+        pthread_mutex_unlock(&self->mutex);
+        return false;
+    }
+
+    const LibraryEntry *nearest = &self->entries[indices[0]];
+    Program *throttle = program_init(program_alloc(), nearest->throttle_length);
+    Program *altitude_angle = program_init(program_alloc(), nearest->altitude_angle_length);
+    throttle->kind = (ProgramKind)nearest->throttle_kind;
+    altitude_angle->kind = (ProgramKind)nearest->altitude_angle_kind;
+    memcpy(throttle->altitudes, nearest->throttle_altitudes, throttle->length * sizeof(double));
+    memcpy(altitude_angle->altitudes, nearest->altitude_angle_altitudes, altitude_angle->length * sizeof(double));
+    memset(throttle->settings, 0, throttle->length * sizeof(double));
+    memset(altitude_angle->settings, 0, altitude_angle->length * sizeof(double));
+
+    double total_weight = 0.0;
+    for(size_t n=0; n<found; n++) {
+        const LibraryEntry *entry = &self->entries[indices[n]];
+        if(!library_same_tables(entry, nearest))
+            continue;
+
+        //An exact match takes everything.
+        double weight = (distances[0] < LIBRARY_SAME_DISTANCE) ? (n == 0 ? 1.0 : 0.0) : 1.0/distances[n];
+        for(size_t i=0; i<throttle->length; i++)
+            throttle->settings[i] += weight * entry->throttle_settings[i];
+        for(size_t i=0; i<altitude_angle->length; i++)
+            altitude_angle->settings[i] += weight * entry->altitude_angle_settings[i];
+        total_weight += weight;
+    }
+
+    for(size_t i=0; i<throttle->length; i++)
+        throttle->settings[i] = library_snap(throttle->settings[i] / total_weight, 1.0, THROTTLE_INTERVALS);
+    for(size_t i=0; i<altitude_angle->length; i++)
+        altitude_angle->settings[i] = library_snap(altitude_angle->settings[i] / total_weight, M_PI/2.0, ALTITUDE_ANGLE_INTERVALS);
+
+    pthread_mutex_unlock(&self->mutex);
+
+    *throttle_program = throttle;
+    *altitude_angle_program = altitude_angle;
+    return true;
+}
+
+static bool library_map(Library *self, size_t size) {
+    library_unmap(self);
+    void *map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, self->fd, 0);
+    if(map == MAP_FAILED)
+        return false;
+    self->mapped_size = size;
+    self->header = (LibraryHeader *)map;
+    self->entries = (LibraryEntry *)((char *)map + sizeof(LibraryHeader));
+    return true;
+}
+
+static void library_unmap(Library *self) {
+    if(self->header)
+        munmap(self->header, self->mapped_size);
+    self->mapped_size = 0;
+    self->header = NULL;
+    self->entries = NULL;
+}
+
+static double library_distance(const double *a, const double *b) {
+    double sum = 0.0;
+    for(size_t i=0; i<LIBRARY_FEATURES; i++)
+        sum += (a[i]-b[i])*(a[i]-b[i]);
+    return sqrt(sum);
+}
+
+static bool library_same_tables(const LibraryEntry *a, const LibraryEntry *b) {
+    return a->throttle_kind == b->throttle_kind
+        && a->altitude_angle_kind == b->altitude_angle_kind
+        && a->throttle_length == b->throttle_length
+        && a->altitude_angle_length == b->altitude_angle_length
+        && memcmp(a->throttle_altitudes, b->throttle_altitudes, a->throttle_length * sizeof(double)) == 0
+        && memcmp(a->altitude_angle_altitudes, b->altitude_angle_altitudes, a->altitude_angle_length * sizeof(double)) == 0;
+}
+
+static bool library_entry_valid(const LibraryEntry *entry) {
+    return entry->throttle_length > 0 && entry->throttle_length <= LIBRARY_MAX_LENGTH
+        && entry->altitude_angle_length > 0 && entry->altitude_angle_length <= LIBRARY_MAX_LENGTH
+        && entry->throttle_kind < PROGRAM_KIND_CUSTOM
+        && entry->altitude_angle_kind < PROGRAM_KIND_CUSTOM;
+}
+
+static void library_fill_entry(LibraryEntry *entry, const double *features, double fitness, const Program *throttle_program, const Program *altitude_angle_program) {
+    memset(entry, 0, sizeof(LibraryEntry));
+    memcpy(entry->features, features, LIBRARY_FEATURES * sizeof(double));
+    entry->fitness = fitness;
+    entry->throttle_kind = (uint32_t)throttle_program->kind;
+    entry->altitude_angle_kind = (uint32_t)altitude_angle_program->kind;
+    entry->throttle_length = (uint32_t)throttle_program->length;
+    entry->altitude_angle_length = (uint32_t)altitude_angle_program->length;
+    memcpy(entry->throttle_altitudes, throttle_program->altitudes, throttle_program->length * sizeof(double));
+    memcpy(entry->throttle_settings, throttle_program->settings, throttle_program->length * sizeof(double));
+    memcpy(entry->altitude_angle_altitudes, altitude_angle_program->altitudes, altitude_angle_program->length * sizeof(double));
+    memcpy(entry->altitude_angle_settings, altitude_angle_program->settings, altitude_angle_program->length * sizeof(double));
+}
+
+static double library_snap(double value, double full_scale, unsigned intervals) {
+    return full_scale * round(value / full_scale * intervals) / intervals;
+}
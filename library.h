@@ -0,0 +1,69 @@
+#ifndef KERBAL_LAUNCH_LIBRARY_H
+#define KERBAL_LAUNCH_LIBRARY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "program.h"
+#include "rocket.h"
+#include "planetoid.h"
+
+#define LIBRARY_VERSION 2
+#define LIBRARY_FEATURES 8
+#define LIBRARY_MAX_LENGTH 16 //Longest program that can be stored.
+#define LIBRARY_NEIGHBOURS 4 //Neighbours blended into a warm start.
+
+/*
+ * A persistent library of optimized program pairs, keyed by dimensionless
+ * features of the rocket, planetoid and target.  The file is a header followed
+ * by fixed-size entries in native byte order; it is memory mapped, so opening
+ * and querying it costs no parsing, and entries are appended in place.
+ * Other processes are excluded with flock, and other threads with the mutex,
+ * so one open library can be shared by concurrent optimizers.
+ */
+typedef struct LibraryHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t features;
+    uint32_t max_length;
+    uint64_t count;
+} LibraryHeader;
+
+typedef struct LibraryEntry {
+    double features[LIBRARY_FEATURES];
+    double fitness;
+    uint32_t throttle_kind;
+    uint32_t altitude_angle_kind;
+    uint32_t throttle_length;
+    uint32_t altitude_angle_length;
+    double throttle_altitudes[LIBRARY_MAX_LENGTH];
+    double throttle_settings[LIBRARY_MAX_LENGTH];
+    double altitude_angle_altitudes[LIBRARY_MAX_LENGTH];
+    double altitude_angle_settings[LIBRARY_MAX_LENGTH];
+} LibraryEntry;
+
+typedef struct Library {
+    int fd;
+    size_t mapped_size;
+    LibraryHeader *header;
+    LibraryEntry *entries;
+    pthread_mutex_t mutex;
+} Library;
+
+Library *library_alloc(void);
+void library_dealloc(Library *self);
+Library *library_init(Library *self);
+
+bool library_open(Library *self, const char *path);
+void library_close(Library *self);
+size_t library_count(const Library *self);
+
+void library_features(double *features, const Rocket *rocket, const Planetoid *planetoid, double target_radius);
+
+bool library_add(Library *self, const double *features, double fitness, const Program *throttle_program, const Program *altitude_angle_program);
+size_t library_nearest(const Library *self, const double *features, size_t k, size_t *indices, double *distances);
+bool library_seed(Library *self, const double *features, Program **throttle_program, Program **altitude_angle_program);
+
+#endif
@@ -3,51 +3,527 @@
 #include <math.h>
 #include <time.h>
 #include <assert.h>
+#include <string.h>
 
+#include "kerbal_launch.h"
 #include "system.h"
 #include "optimizer.h"
+#include "scenario.h"
+#include "checkpoint.h"
+#include "library.h"
+#include "telemetry.h"
+#include "stream.h"
+#include "ensemble.h"
+#include "server.h"
+#include "evaluate.h"
+#include "kernel.h"
+#include "landscape.h"
+#include "perf.h"
+#include "trace.h"
+#include "parareal.h"
 
 #define OPTIMIZATION_SYSTEM_RUNS (16384)
+#define ROBUST_ENSEMBLE_SIZE 32 //Members per candidate when --robust is given without --ensemble.
+
+typedef struct Options {
+    OptimizerMode mode;
+    const char *checkpoint_path; //Write checkpoints here if set.
+    const char *resume_path; //Resume from this checkpoint if set.
+    const char *library_path; //Warm start from, and add to, this library if set.
+    const char *telemetry_path; //Publish Prometheus metrics to this textfile if set.
+    const char *stream_name; //Stream the optimized flight to this shared-memory name if set.
+    ProgramKind controller; //Kind of the seed programs.
+    size_t ensemble_size; //Report the best program over this many perturbed rockets if non-zero.
+    bool robust; //Optimize the ensemble's robust fitness.
+    const char *serve_path; //Run as a resident job server on this Unix socket if set.
+    unsigned beam_width; //Partial flights kept per breakpoint in the beam search.
+    unsigned replicas; //Chains in the parallel tempering search.
+    const char *evaluate_path; //Score the candidates in this file ("-" for stdin) if set.
+    KerbalLaunchRocket rocket; //Rocket flown by --evaluate and --landscape.
+    double target_altitude; //Throttle cutoff altitude for --evaluate.
+    bool kernel; //Fly through a kernel compiled for the scenario, where one can be built.
+    const char *landscape_path; //Sample the fitness landscape about the seed programs to this file if set.
+    unsigned long samples; //Design rows for --landscape.
+    LandscapeDesign design;
+    unsigned threads; //Simulation threads.
+    bool perf; //Count hardware events through the search, if built in.
+    const char *trace_path; //Write a timeline of the search's threads to this file if set.
+    unsigned targets; //Keep a best per target altitude, flying them all at once, if non-zero.
+    double target_altitudes[OPTIMIZER_MAX_TARGETS];
+    bool parareal; //Fly the final flight in parallel in time across the threads.
+} Options;
+
+void usage(const char *name);
+bool parse_targets(char *text, double *altitudes, unsigned *count);
+
+int optimize(const Options *options);
+bool optimize_uses_extras(const Options *options);
+int optimize_with_extras(const Options *options);
+void print_progress(const KerbalLaunchProgress *progress, void *context);
+int serve(const Options *options);
+int evaluate(const Options *options);
+int landscape(const Options *options);
+void init_seed_programs(ProgramKind controller, Program **throttle_program, Program **altitude_angle_program);
+InitFunc rocket_factory(KerbalLaunchRocket rocket);
+KerbalLaunchProgram library_program_view(const Program *program);
+Kernel *build_kernel(const Optimizer *optimizer, const Program *throttle_program, const Program *altitude_angle_program);
+void simulate_optimized_system(const Planetoid *planetoid, Rocket *rocket, const Program *throttle_program, const Program *altitude_angle_program,
+        double throttle_cutoff_radius, Stream *stream, unsigned parareal_workers);
 
-#define TWELFTH 0.16666666666666666
-#define FIFTEENTH 0.06666666666666667
+int simulate_vertical(void);
 
-int optimize(void);
-void simulate_optimized_system(Optimizer *optimizer);
+//Given a system who terminated at apex, calculate the best periapsis/apoapsis.
+bool biggest_orbit(const System *system, double *periapsis, double *apoapsis);
 
-int simulate_vertical(void);
+int main(int argc, char **argv){
+    //Options not named here default to off.
+    Options options = {
+        .mode = OPTIMIZER_MODE_GENERATIONAL,
+        .controller = PROGRAM_KIND_STEP,
+        .beam_width = OPTIMIZER_BEAM_WIDTH,
+        .replicas = OPTIMIZER_TEMPERING_REPLICAS,
+        .rocket = KERBAL_LAUNCH_ROCKET_LARGE,
+        .target_altitude = 80000.0,
+        .samples = 1024,
+        .design = LANDSCAPE_DESIGN_SOBOL,
+        .threads = OPTIMIZER_CHILDREN,
+    };
+    for(int i=1; i<argc; i++) {
+        if( strcmp(argv[i], "--successive-halving") == 0 ) {
+            options.mode = OPTIMIZER_MODE_SUCCESSIVE_HALVING;
+        } else if( strcmp(argv[i], "--steady-state") == 0 ) {
+            options.mode = OPTIMIZER_MODE_STEADY_STATE;
+        } else if( strcmp(argv[i], "--beam") == 0 && i+1 < argc && atoi(argv[i+1]) > 0 ) {
+            options.mode = OPTIMIZER_MODE_BEAM;
+            options.beam_width = (unsigned)atoi(argv[++i]);
+        } else if( strcmp(argv[i], "--tempering") == 0 && i+1 < argc && atoi(argv[i+1]) > 0 && atoi(argv[i+1]) <= OPTIMIZER_MAX_REPLICAS ) {
+            options.mode = OPTIMIZER_MODE_TEMPERING;
+            options.replicas = (unsigned)atoi(argv[++i]);
+        } else if( strcmp(argv[i], "--checkpoint") == 0 && i+1 < argc ) {
+            options.checkpoint_path = argv[++i];
+        } else if( strcmp(argv[i], "--resume") == 0 && i+1 < argc ) {
+            options.resume_path = argv[++i];
+        } else if( strcmp(argv[i], "--library") == 0 && i+1 < argc ) {
+            options.library_path = argv[++i];
+        } else if( strcmp(argv[i], "--telemetry") == 0 && i+1 < argc ) {
+            options.telemetry_path = argv[++i];
+        } else if( strcmp(argv[i], "--stream") == 0 ) {
+            options.stream_name = STREAM_DEFAULT_NAME;
+        } else if( strcmp(argv[i], "--controller") == 0 && i+1 < argc && program_kind_parse(argv[i+1], &options.controller) ) {
+            i++;
+        } else if( strcmp(argv[i], "--ensemble") == 0 && i+1 < argc && atoi(argv[i+1]) > 0 ) {
+            options.ensemble_size = (size_t)atoi(argv[++i]);
+        } else if( strcmp(argv[i], "--robust") == 0 ) {
+            options.robust = true;
+        } else if( strcmp(argv[i], "--serve") == 0 && i+1 < argc ) {
+            options.serve_path = argv[++i];
+        } else if( strcmp(argv[i], "--evaluate") == 0 && i+1 < argc ) {
+            options.evaluate_path = argv[++i];
+        } else if( strcmp(argv[i], "--rocket") == 0 && i+1 < argc && strcmp(argv[i+1], "small") == 0 ) {
+            options.rocket = KERBAL_LAUNCH_ROCKET_SMALL;
+            i++;
+        } else if( strcmp(argv[i], "--rocket") == 0 && i+1 < argc && strcmp(argv[i+1], "large") == 0 ) {
+            options.rocket = KERBAL_LAUNCH_ROCKET_LARGE;
+            i++;
+        } else if( strcmp(argv[i], "--target-altitude") == 0 && i+1 < argc && atof(argv[i+1]) > 0.0 ) {
+            options.target_altitude = atof(argv[++i]);
+        } else if( strcmp(argv[i], "--kernel") == 0 ) {
+            options.kernel = true;
+        } else if( strcmp(argv[i], "--landscape") == 0 && i+1 < argc ) {
+            options.landscape_path = argv[++i];
+        } else if( strcmp(argv[i], "--samples") == 0 && i+1 < argc && strtoul(argv[i+1], NULL, 10) > 0 ) {
+            options.samples = strtoul(argv[++i], NULL, 10);
+        } else if( strcmp(argv[i], "--design") == 0 && i+1 < argc && landscape_design_parse(argv[i+1], &options.design) ) {
+            i++;
+        } else if( strcmp(argv[i], "--threads") == 0 && i+1 < argc && atoi(argv[i+1]) > 0 ) {
+            options.threads = (unsigned)atoi(argv[++i]);
+        } else if( strcmp(argv[i], "--perf") == 0 ) {
+            options.perf = true;
+        } else if( strcmp(argv[i], "--trace") == 0 && i+1 < argc ) {
+            options.trace_path = argv[++i];
+        } else if( strcmp(argv[i], "--targets") == 0 && i+1 < argc && parse_targets(argv[i+1], options.target_altitudes, &options.targets) ) {
+            i++;
+        } else if( strcmp(argv[i], "--parareal") == 0 ) {
+            options.parareal = true;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
 
-Rocket *init_small_rocket(Rocket *rocket);
-Rocket *init_large_rocket(Rocket *rocket);
+    //The multi-target search is generational, and flies the nominal rocket without a kernel.
+    if(options.targets > 0 && (options.mode != OPTIMIZER_MODE_GENERATIONAL || options.robust || options.kernel)) {
+        usage(argv[0]);
+        return 1;
+    }
 
-Program *init_throttle_seed(Program *program);
-Program *init_altitude_angle_seed(Program *program);
+    //Each thread needs its own telemetry counters.
+    if(options.telemetry_path && options.threads > TELEMETRY_MAX_WORKERS) {
+        usage(argv[0]);
+        return 1;
+    }
 
-//Given a system who terminated at apex, calculate the best periapsis/apoapsis.
-bool biggest_orbit(const System *system, double *periapsis, double *apoapsis);
+    //Parareal flies slices more than once and out of order, so it cannot stream.
+    if(options.parareal && options.stream_name) {
+        usage(argv[0]);
+        return 1;
+    }
 
-double kerbin_radius;
+    if(options.serve_path)
+        return serve(&options);
+    if(options.evaluate_path)
+        return evaluate(&options);
+    if(options.landscape_path)
+        return landscape(&options);
 
-int main(void){
+    //clock() counts the CPU time of every thread, so the wall time is taken separately.
+    struct timespec wall_start, wall_stop;
+    clock_gettime(CLOCK_MONOTONIC, &wall_start);
     clock_t start = clock();
-    int result = optimize();
+    int result = optimize(&options);
     clock_t stop = clock();
-    clock_t delta_t = stop-start;
-    printf("TIME: %f ms\n", ((double)delta_t)/CLOCKS_PER_SEC);
+    clock_gettime(CLOCK_MONOTONIC, &wall_stop);
+    double wall = (wall_stop.tv_sec - wall_start.tv_sec) + 1e-9*(wall_stop.tv_nsec - wall_start.tv_nsec);
+    printf("TIME: %f s wall, %f s CPU\n", wall, ((double)(stop-start))/CLOCKS_PER_SEC);
+    return result;
+}
+
+void usage(const char *name) {
+    fprintf(stderr, "usage: %s [--successive-halving | --steady-state | --beam WIDTH | --tempering REPLICAS]\n", name);
+    fprintf(stderr, "       [--checkpoint FILE] [--resume FILE] [--library FILE]\n");
+    fprintf(stderr, "       [--telemetry FILE] [--stream]\n");
+    fprintf(stderr, "       [--controller step | linear | spline | gravity-turn]\n");
+    fprintf(stderr, "       [--ensemble N] [--robust] [--kernel] [--threads N] [--perf]\n");
+    fprintf(stderr, "       [--trace FILE] [--targets ALTITUDE,ALTITUDE,...] [--parareal]\n");
+    fprintf(stderr, "   or: %s --serve SOCKET [--library FILE] [--threads N]\n", name);
+    fprintf(stderr, "   or: %s --evaluate FILE|- [--rocket small | large] [--target-altitude M] [--kernel] [--threads N]\n", name);
+    fprintf(stderr, "   or: %s --landscape FILE [--samples N] [--design sobol | lhs] [--controller KIND]\n", name);
+    fprintf(stderr, "       [--rocket small | large] [--target-altitude M] [--kernel] [--threads N]\n");
+}
+
+//Parses comma-separated positive altitudes (m), in place; false if there are none, too many, or a bad one.
+bool parse_targets(char *text, double *altitudes, unsigned *count) {
+    *count = 0;
+    char *save = NULL;
+    for(char *item = strtok_r(text, ",", &save); item; item = strtok_r(NULL, ",", &save)) {
+        char *end;
+        double altitude = strtod(item, &end);
+        if(*count == OPTIMIZER_MAX_TARGETS || end == item || *end != '\0' || !(altitude > 0.0))
+            return false;
+        altitudes[(*count)++] = altitude;
+    }
+    return *count > 0;
+}
+
+//The internal factory of a library rocket, for the paths the library API does not cover.
+InitFunc rocket_factory(KerbalLaunchRocket rocket) {
+    return (rocket == KERBAL_LAUNCH_ROCKET_SMALL) ? (InitFunc)init_small_rocket : (InitFunc)init_large_rocket;
+}
+
+//Borrows the program's arrays for the library API; the built-in kinds have the same values in both enums.
+KerbalLaunchProgram library_program_view(const Program *program) {
+    KerbalLaunchProgram view = {(KerbalLaunchProgramKind)program->kind, program->length, program->altitudes, program->settings};
+    return view;
+}
+
+/*
+ * Builds a kernel for the optimizer's scenario and the programs' breakpoints,
+ * reporting to stderr; NULL if it could not be built, and the generic path is flown.
+ */
+Kernel *build_kernel(const Optimizer *optimizer, const Program *throttle_program, const Program *altitude_angle_program) {
+    System *system = optimizer_make_system(optimizer, throttle_program, altitude_angle_program);
+    Kernel *kernel = kernel_init(kernel_alloc());
+    bool ok = kernel_build(kernel, system);
+    rocket_dealloc(system->rocket);
+    system_dealloc(system);
+
+    if(!ok) {
+        fprintf(stderr, "Kernel: not used (%s)\n", kernel->error);
+        kernel_dealloc(kernel);
+        return NULL;
+    }
+    fprintf(stderr, "Kernel: compiled in %f s, %.2fx per tick\n", kernel->compile_seconds, kernel->tick_speedup);
+    return kernel;
+}
+
+int serve(const Options *options) {
+    //The standard rockets are placed with this.
+    Planetoid kerbin;
+    planetoid_init(&kerbin);
+    kerbin_radius = kerbin.radius;
+
+    Server *server = server_init(server_alloc(), options->serve_path, options->threads);
+    if(!server_open(server)) {
+        fprintf(stderr, "Could not listen on %s\n", options->serve_path);
+        server_dealloc(server);
+        return 1;
+    }
+
+    Library *library = NULL;
+    if(options->library_path) {
+        library = library_init(library_alloc());
+        if(!library_open(library, options->library_path)) {
+            fprintf(stderr, "Could not open library %s\n", options->library_path);
+            library_dealloc(library);
+            library = NULL;
+        }
+    }
+    server->library = library;
+
+    printf("Serving on %s\n", options->serve_path);
+    fflush(stdout);
+    server_run(server);
+
+    server_dealloc(server);
+    if(library)
+        library_dealloc(library);
+    return 0;
+}
+
+/*
+ * Score the candidates in a file or on stdin, writing one line per candidate
+ * to stdout; see evaluate.h for the formats.  They are flown through the
+ * library API, except with --kernel, which it does not offer.
+ */
+int evaluate(const Options *options) {
+    KerbalLaunchScenario *scenario = NULL;
+    Planetoid *kerbin = NULL;
+    Optimizer *optimizer = NULL;
+    Kernel *kernel = NULL;
+    if(options->kernel) {
+        kerbin = planetoid_init(planetoid_alloc());
+        kerbin_radius = kerbin->radius;
+
+        //Only the flight configuration is used; no search is run.
+        optimizer = optimizer_init(optimizer_alloc());
+        optimizer->rocket_factory_func = rocket_factory(options->rocket);
+        optimizer->planetoid = kerbin;
+        optimizer->throttle_cutoff_radius = kerbin_radius + options->target_altitude;
+
+        //Candidates on the seed breakpoints are flown through the kernel.
+        Program *throttle_program = init_throttle_seed(program_init(program_alloc(), SCENARIO_SEED_LENGTH));
+        Program *altitude_angle_program = init_altitude_angle_seed(program_init(program_alloc(), SCENARIO_SEED_LENGTH));
+        kernel = build_kernel(optimizer, throttle_program, altitude_angle_program);
+        optimizer->kernel = kernel;
+        program_dealloc(throttle_program);
+        program_dealloc(altitude_angle_program);
+    } else {
+        scenario = kerbal_launch_scenario_alloc();
+        if(kerbal_launch_scenario_init(scenario, options->rocket, options->target_altitude) == NULL) {
+            fprintf(stderr, "Could not make the scenario\n");
+            kerbal_launch_scenario_dealloc(scenario);
+            return 1;
+        }
+        kerbal_launch_set_threads(scenario, options->threads);
+    }
+
+    Evaluator *evaluator = evaluator_init(evaluator_alloc(), optimizer, options->threads);
+    evaluator->scenario = scenario;
+    bool ok = evaluator_run(evaluator, options->evaluate_path, stdout);
+    if(ok) {
+        fprintf(stderr, "Candidates: %lu (%lu errors) in %f s (%f/s, %.3g ticks/s)\n",
+                evaluator->candidates, evaluator->errors, evaluator->wall_seconds,
+                evaluator->candidates/evaluator->wall_seconds, evaluator->ticks/evaluator->wall_seconds);
+    } else {
+        fprintf(stderr, "Could not read candidates from %s\n", options->evaluate_path);
+    }
+
+    evaluator_dealloc(evaluator);
+    if(kernel)
+        kernel_dealloc(kernel);
+    if(optimizer)
+        optimizer_dealloc(optimizer);
+    if(kerbin)
+        planetoid_dealloc(kerbin);
+    kerbal_launch_scenario_dealloc(scenario);
+    return ok ? 0 : 1;
+}
+
+/*
+ * Samples the fitness landscape about the seed programs and prints each
+ * setting's sensitivity indices; the samples are streamed to the file.
+ */
+int landscape(const Options *options) {
+    Planetoid *kerbin = planetoid_init(planetoid_alloc());
+    kerbin_radius = kerbin->radius;
+
+    Program *throttle_program, *altitude_angle_program;
+    init_seed_programs(options->controller, &throttle_program, &altitude_angle_program);
+
+    Optimizer *optimizer = optimizer_init(optimizer_alloc());
+    optimizer->rocket_factory_func = rocket_factory(options->rocket);
+    optimizer->planetoid = kerbin;
+    optimizer->throttle_cutoff_radius = kerbin_radius + options->target_altitude;
+
+    Kernel *kernel = NULL;
+    if(options->kernel) {
+        kernel = build_kernel(optimizer, throttle_program, altitude_angle_program);
+        optimizer->kernel = kernel;
+    }
+
+    int result = 1;
+    FILE *out = fopen(options->landscape_path, "wb");
+    if(out) {
+        Landscape *landscape = landscape_init(landscape_alloc(), optimizer, throttle_program, altitude_angle_program, options->threads);
+        landscape->samples = options->samples;
+        landscape->design = options->design;
+        bool ok = landscape_run(landscape, out);
+        if(fclose(out) != 0)
+            ok = false;
+        landscape_display(landscape);
+        if(ok)
+            result = 0;
+        else
+            fprintf(stderr, "Could not write %s\n", options->landscape_path);
+        landscape_dealloc(landscape);
+    } else {
+        fprintf(stderr, "Could not open %s\n", options->landscape_path);
+    }
+
+    if(kernel)
+        kernel_dealloc(kernel);
+    optimizer_dealloc(optimizer);
+    program_dealloc(throttle_program);
+    program_dealloc(altitude_angle_program);
+    planetoid_dealloc(kerbin);
     return result;
 }
 
-int optimize(void) {
+//Builds the seed programs for the controller kind.
+void init_seed_programs(ProgramKind controller, Program **throttle_program, Program **altitude_angle_program) {
+    *throttle_program = init_throttle_seed(program_init(program_alloc(), SCENARIO_SEED_LENGTH));
+    if(controller == PROGRAM_KIND_GRAVITY_TURN) {
+        //The turn steers itself; the throttle has no closed-loop kind, so interpolate it.
+        (*throttle_program)->kind = PROGRAM_KIND_LINEAR;
+        *altitude_angle_program = init_gravity_turn_seed(program_init(program_alloc(), SCENARIO_GRAVITY_TURN_LENGTH));
+    } else {
+        (*throttle_program)->kind = controller;
+        *altitude_angle_program = init_altitude_angle_seed(program_init(program_alloc(), SCENARIO_SEED_LENGTH));
+        (*altitude_angle_program)->kind = controller;
+    }
+}
+
+/*
+ * Searches for the best programs for the large rocket to 80 km through the
+ * library API, then flies them once more for the full statistics; runs that
+ * need more than the API offers go to optimize_with_extras.
+ */
+int optimize(const Options *options) {
+    if(optimize_uses_extras(options))
+        return optimize_with_extras(options);
+
+    KerbalLaunchScenario *scenario = kerbal_launch_scenario_alloc();
+    if(kerbal_launch_scenario_init(scenario, KERBAL_LAUNCH_ROCKET_LARGE, 80000.0) == NULL) {
+        fprintf(stderr, "Could not make the scenario\n");
+        kerbal_launch_scenario_dealloc(scenario);
+        return 1;
+    }
+    kerbal_launch_set_threads(scenario, options->threads);
+
+    //Build the seed programs; mutation keeps their breakpoints, so the best are copies of them to overwrite.
+    Program *seed_throttle_program, *seed_altitude_angle_program;
+    init_seed_programs(options->controller, &seed_throttle_program, &seed_altitude_angle_program);
+    Program *best_throttle_program = program_init_copy(program_alloc(), seed_throttle_program);
+    Program *best_altitude_angle_program = program_init_copy(program_alloc(), seed_altitude_angle_program);
+    KerbalLaunchProgram seed_throttle = library_program_view(seed_throttle_program);
+    KerbalLaunchProgram seed_altitude_angle = library_program_view(seed_altitude_angle_program);
+    KerbalLaunchProgram best_throttle = library_program_view(best_throttle_program);
+    KerbalLaunchProgram best_altitude_angle = library_program_view(best_altitude_angle_program);
+
+    KerbalLaunchFlight seed_flight;
+    kerbal_launch_evaluate(scenario, 1, &seed_throttle, &seed_altitude_angle, &seed_flight);
+    printf("Seed Program Fitness: %f\n", seed_flight.fitness);
+
+    //The modes have the same values in both enums.
+    KerbalLaunchSearch search;
+    kerbal_launch_search_defaults(&search);
+    search.mode = (KerbalLaunchMode)options->mode;
+    search.generations = OPTIMIZATION_SYSTEM_RUNS/OPTIMIZER_CHILDREN;
+    search.seed = (unsigned long)time(NULL);
+    search.beam_width = options->beam_width;
+    search.replicas = options->replicas;
+    search.progress_func = print_progress;
+
+    //Run
+    double best_fitness;
+    KerbalLaunchSearchStats stats;
+    bool ok = kerbal_launch_optimize(scenario, &search, &seed_throttle, &seed_altitude_angle, &best_throttle, &best_altitude_angle, &best_fitness, &stats);
+    printf("\n");
+    kerbal_launch_scenario_dealloc(scenario);
+    program_dealloc(seed_throttle_program);
+    program_dealloc(seed_altitude_angle_program);
+    if(!ok) {
+        fprintf(stderr, "Search failed\n");
+        program_dealloc(best_throttle_program);
+        program_dealloc(best_altitude_angle_program);
+        return 1;
+    }
+    best_throttle_program->kind = (ProgramKind)best_throttle.kind;
+    best_altitude_angle_program->kind = (ProgramKind)best_altitude_angle.kind;
+
+    //Show Best Result
+    if(options->mode == OPTIMIZER_MODE_BEAM)
+        printf("Beam Width: %u\n", search.beam_width);
+    else
+        printf("Generations x Children: %d x %d = %d\n", stats.generations, stats.children, stats.children*search.generations);
+    if(stats.barrier_idle > 0.0)
+        printf("Barrier Idle: %.1f%%\n", 100.0*stats.barrier_idle);
+    printf("Evaluations: %lu in %f s (%f/s)\n", stats.evaluations, stats.wall_seconds, stats.evaluations/stats.wall_seconds);
+    printf("Core Utilization: %.1f%%\n", 100.0*stats.utilization);
+    printf("Fitness Cache Hit Rate: %.1f%%\n", 100.0*stats.cache_hit_rate);
+    printf("Fitness: %f\n", best_fitness);
+    printf("Throttle Program:\n");
+    program_display(best_throttle_program);
+    printf("Altitude Angle Program:\n");
+    program_display_converted(best_altitude_angle_program, 180.0/M_PI);
+
+    //The statistics of a flight are not part of the library API, so the final one is flown here.
+    Planetoid *kerbin = planetoid_init(planetoid_alloc());
+    kerbin_radius = kerbin->radius;
+    Stream *stream = NULL;
+    if(options->stream_name) {
+        stream = stream_init(stream_alloc(), options->stream_name, STREAM_DEFAULT_CAPACITY);
+        if(!stream_is_open(stream))
+            fprintf(stderr, "Could not create stream %s\n", options->stream_name);
+    }
+    simulate_optimized_system(kerbin, init_large_rocket(rocket_alloc()), best_throttle_program, best_altitude_angle_program,
+            kerbin_radius + 80000.0, stream, options->parareal ? options->threads : 0);
+    if(stream) {
+        stream_close(stream);
+        stream_dealloc(stream);
+    }
+
+    //Cleanup
+    planetoid_dealloc(kerbin);
+    program_dealloc(best_throttle_program);
+    program_dealloc(best_altitude_angle_program);
+    return 0;
+}
+
+//Whether the search needs what the library API does not offer: saved state, the program library, instrumentation, kernels, ensembles, targets, or the halving and tempering diagnostics.
+bool optimize_uses_extras(const Options *options) {
+    return options->checkpoint_path || options->resume_path || options->library_path || options->telemetry_path
+        || options->perf || options->trace_path || options->kernel || options->ensemble_size > 0 || options->robust
+        || options->targets > 0 || options->mode == OPTIMIZER_MODE_SUCCESSIVE_HALVING || options->mode == OPTIMIZER_MODE_TEMPERING;
+}
+
+//A dot per generation.
+void print_progress(const KerbalLaunchProgress *progress, void *context) {
+    (void)progress;
+    (void)context;
+    printf(".");
+    fflush(stdout);
+}
+
+//The search on the internal headers, for the options the library API lacks.
+int optimize_with_extras(const Options *options) {
     //Build the planetoid
     Planetoid *kerbin = planetoid_init(planetoid_alloc());
     kerbin_radius = kerbin->radius;
 
     //Builde the seed programs.
-    Program *seed_throttle_program = program_init(program_alloc(), 9);
-    init_throttle_seed(seed_throttle_program);
-
-    Program *seed_altitude_angle_program = program_init(program_alloc(), 9);
-    init_altitude_angle_seed(seed_altitude_angle_program);
+    Program *seed_throttle_program, *seed_altitude_angle_program;
+    init_seed_programs(options->controller, &seed_throttle_program, &seed_altitude_angle_program);
 
     double throttle_cutoff_radius = kerbin_radius + 80000.0;
 
@@ -60,22 +536,197 @@ int optimize(void) {
     optimizer->throttle_cutoff_radius = throttle_cutoff_radius;
     //optimizer->generations = (64*16)/OPTIMIZER_CHILDREN;
     optimizer->generations = OPTIMIZATION_SYSTEM_RUNS/OPTIMIZER_CHILDREN;
+    optimizer->mode = options->mode;
+    optimizer->beam_width = options->beam_width;
+    optimizer->tempering_replicas = options->replicas;
+    optimizer->workers = options->threads;
+    optimizer->cache = fitness_cache_init(fitness_cache_alloc(), FITNESS_CACHE_DEFAULT_CAPACITY);
+    if(options->targets > 0) {
+        double radii[OPTIMIZER_MAX_TARGETS];
+        for(unsigned t=0; t<options->targets; t++)
+            radii[t] = kerbin_radius + options->target_altitudes[t];
+        optimizer_set_targets(optimizer, radii, options->targets);
+    }
+
+    //Continue a previous search in the same mode and targets; its progress replaces the above.
+    if(options->resume_path && !optimizer_resume(optimizer, options->resume_path)) {
+        fprintf(stderr, "Could not resume from %s (missing, corrupt, or written for another mode or targets)\n", options->resume_path);
+        fitness_cache_dealloc(optimizer->cache);
+        optimizer_dealloc(optimizer);
+        planetoid_dealloc(kerbin);
+        program_dealloc(seed_throttle_program);
+        program_dealloc(seed_altitude_angle_program);
+        return 1;
+    }
+
+    if(options->checkpoint_path)
+        optimizer->checkpointer = checkpointer_init(checkpointer_alloc(), options->checkpoint_path);
+
+    if(options->library_path) {
+        optimizer->library = library_init(library_alloc());
+        if(library_open(optimizer->library, options->library_path)) {
+            printf("Library Entries: %zu\n", library_count(optimizer->library));
+        } else {
+            fprintf(stderr, "Could not open library %s\n", options->library_path);
+            library_dealloc(optimizer->library);
+            optimizer->library = NULL;
+        }
+    }
+
+    if(options->telemetry_path) {
+        optimizer->telemetry = telemetry_init(telemetry_alloc(), options->telemetry_path, TELEMETRY_INTERVAL_SECONDS);
+        telemetry_start(optimizer->telemetry);
+    }
+
+    Ensemble *ensemble = NULL;
+    if(options->ensemble_size > 0 || options->robust) {
+        size_t size = (options->ensemble_size > 0) ? options->ensemble_size : ROBUST_ENSEMBLE_SIZE;
+        EnsembleSpread spread;
+        ensemble_default_spread(&spread);
+        Rocket *rocket = optimizer_make_rocket(optimizer);
+        ensemble = ensemble_init(ensemble_alloc(), size, rocket, kerbin, &spread);
+        rocket_dealloc(rocket);
+        if(options->robust)
+            optimizer->ensemble = ensemble;
+    }
+
+    Kernel *kernel = NULL;
+    if(options->kernel) {
+        kernel = build_kernel(optimizer, seed_throttle_program, seed_altitude_angle_program);
+        optimizer->kernel = kernel;
+    }
+
+    Perf *perf = NULL;
+    if(options->perf) {
+        perf = perf_init(perf_alloc());
+        if(!perf_start(perf)) {
+            fprintf(stderr, "Perf: not used (%s)\n", perf->error);
+            perf_dealloc(perf);
+            perf = NULL;
+        }
+    }
+
+    Trace *trace = NULL;
+    if(options->trace_path) {
+        trace = trace_init(trace_alloc());
+        trace_start(trace);
+    }
 
     //Run
     optimizer_run(optimizer);
+    if(perf)
+        perf_stop(perf);
+
+    if(trace) {
+        trace_stop(trace);
+        FILE *out = fopen(options->trace_path, "w");
+        bool written = out && trace_write(trace, out);
+        if(out && fclose(out) != 0)
+            written = false;
+        if(written)
+            printf("Trace: %zu events written to %s\n", trace_events(trace), options->trace_path);
+        else
+            fprintf(stderr, "Could not write trace %s\n", options->trace_path);
+        trace_dealloc(trace);
+    }
+
+    if(optimizer->telemetry) {
+        telemetry_stop(optimizer->telemetry);
+        telemetry_dealloc(optimizer->telemetry);
+        optimizer->telemetry = NULL;
+    }
+
+    if(optimizer->checkpointer) {
+        checkpointer_finish(optimizer->checkpointer);
+        if(optimizer->checkpointer->failed)
+            fprintf(stderr, "Could not write checkpoint %s\n", options->checkpoint_path);
+        checkpointer_dealloc(optimizer->checkpointer);
+        optimizer->checkpointer = NULL;
+    }
+
+    if(optimizer->library) {
+        library_dealloc(optimizer->library);
+        optimizer->library = NULL;
+    }
 
     //Show Best Result
-    printf("Generations x Children: %d x %d = %d\n", optimizer->generation, OPTIMIZER_CHILDREN, OPTIMIZER_CHILDREN*optimizer->generations);
+    if(optimizer->mode == OPTIMIZER_MODE_SUCCESSIVE_HALVING) {
+        printf("Generations x Pool: %d x %d = %d\n", optimizer->generation, optimizer->halving_pool, optimizer->halving_pool*optimizer->generations);
+        for(unsigned rung=0; rung+1<optimizer->halving_rungs; rung++) {
+            printf(
+                "Rank Correlation %.0f Hz -> %.0f Hz: %f\n",
+                optimizer->halving_ticks_per_second[rung],
+                optimizer->halving_ticks_per_second[rung+1],
+                optimizer_halving_correlation(optimizer, rung)
+            );
+        }
+    } else if(optimizer->mode == OPTIMIZER_MODE_BEAM) {
+        printf("Beam Width: %u\n", optimizer->beam_width);
+    } else if(optimizer->mode == OPTIMIZER_MODE_TEMPERING) {
+        printf("Replicas: %u at %g to %g m/s\n", optimizer->tempering_replicas, optimizer->tempering_min_temperature, optimizer->tempering_max_temperature);
+        for(unsigned i=0; i<optimizer->tempering_replicas; i++) {
+            printf("Replica %u at %.3f m/s: %.1f%% of moves accepted", i, optimizer_tempering_temperature(optimizer, i), 100.0*optimizer_tempering_acceptance(optimizer, i));
+            if(i+1 < optimizer->tempering_replicas)
+                printf(", %.1f%% of swaps up\n", 100.0*optimizer_tempering_swap_rate(optimizer, i));
+            else
+                printf("\n");
+        }
+    } else {
+        printf("Generations x Children: %d x %d = %d\n", optimizer->generation, optimizer->children, optimizer->children*optimizer->generations);
+    }
+    if(optimizer->barrier_seconds > 0.0)
+        printf("Barrier Idle: %.1f%%\n", 100.0*optimizer_idle_fraction(optimizer));
+    printf("Evaluations: %lu in %f s (%f/s)\n", optimizer->evaluations, optimizer->wall_seconds, optimizer->evaluations/optimizer->wall_seconds);
+    printf("Core Utilization: %.1f%%\n", 100.0*optimizer_utilization(optimizer));
+    printf("Fitness Cache Hit Rate: %.1f%%\n", 100.0*fitness_cache_hit_rate(optimizer->cache));
+    if(perf) {
+        perf_display(perf);
+        perf_dealloc(perf);
+    }
     printf("Fitness: %f\n", optimizer->best_fitness);
     printf("Throttle Program:\n");
     program_display(optimizer->best_throttle_program);
     printf("Altitude Angle Program:\n");
     program_display_converted(optimizer->best_altitude_angle_program, 180.0/M_PI);
+    for(unsigned t=0; t<optimizer->targets; t++) {
+        printf("Target %.0f m Fitness: %f\n", optimizer->target_radii[t] - kerbin_radius, optimizer->target_fitness[t]);
+        printf("Throttle Program:\n");
+        program_display(optimizer->target_throttle_programs[t]);
+        printf("Altitude Angle Program:\n");
+        program_display_converted(optimizer->target_altitude_angle_programs[t], 180.0/M_PI);
+    }
+
+    //Show how the best program holds up on rockets that are not quite as specified.
+    if(ensemble) {
+        System *system = optimizer_make_system(optimizer, optimizer->best_throttle_program, optimizer->best_altitude_angle_program);
+        EnsembleResult *ensemble_result = ensemble_result_init(ensemble_result_alloc(), ensemble->size);
+        ensemble_evaluate(ensemble, system, optimizer->workers, ensemble_result);
+        ensemble_result_display(ensemble_result);
+        ensemble_result_dealloc(ensemble_result);
+        rocket_dealloc(system->rocket);
+        system_dealloc(system);
+    }
 
     //Simulate best program to gather statistics.
-    simulate_optimized_system(optimizer);
+    Stream *stream = NULL;
+    if(options->stream_name) {
+        stream = stream_init(stream_alloc(), options->stream_name, STREAM_DEFAULT_CAPACITY);
+        if(!stream_is_open(stream))
+            fprintf(stderr, "Could not create stream %s\n", options->stream_name);
+    }
+    simulate_optimized_system(kerbin, optimizer_make_rocket(optimizer), optimizer->best_throttle_program, optimizer->best_altitude_angle_program,
+            optimizer->throttle_cutoff_radius, stream, options->parareal ? options->threads : 0);
+    if(stream) {
+        stream_close(stream);
+        stream_dealloc(stream);
+    }
 
     //Cleanup
+    fitness_cache_dealloc(optimizer->cache);
+    if(ensemble)
+        ensemble_dealloc(ensemble);
+    if(kernel)
+        kernel_dealloc(kernel);
     optimizer_dealloc(optimizer);
     planetoid_dealloc(kerbin);
     program_dealloc(seed_throttle_program);
@@ -84,24 +735,38 @@ int optimize(void) {
     return 0;
 }
 
-void simulate_optimized_system(Optimizer *optimizer) {
+/*
+ * Flies the best programs once more, collecting statistics; the rocket is
+ * taken over and freed.  Serially it logs every tick to _optimized_rocket.csv;
+ * with parareal_workers it is flown by Parareal across that many workers
+ * instead, and nothing is logged.
+ */
+void simulate_optimized_system(const Planetoid *planetoid, Rocket *rocket, const Program *throttle_program, const Program *altitude_angle_program,
+        double throttle_cutoff_radius, Stream *stream, unsigned parareal_workers) {
     // Create the system.
     System *system = system_init(system_alloc());
-    system->planetoid = optimizer->planetoid;
-    system->rocket = optimizer_make_rocket(optimizer);
-    system->throttle_program = optimizer->best_throttle_program;
-    system->altitude_angle_program = optimizer->best_altitude_angle_program;
-    system->throttle_cutoff_radius = optimizer->throttle_cutoff_radius;
-    system->logging = true;
+    system->planetoid = planetoid;
+    system->rocket = rocket;
+    system->throttle_program = throttle_program;
+    system->altitude_angle_program = altitude_angle_program;
+    system->throttle_cutoff_radius = throttle_cutoff_radius;
+    system->logging = parareal_workers == 0;
     system->collect_stats = true;
+    system->stream = stream;
 
     //Simulate
-    system->log = fopen("_optimized_rocket.csv", "w+");
-
-    system_run(system);
-
-    fclose(system->log);
-    system->log = stdout;
+    if(parareal_workers > 0) {
+        Parareal *parareal = parareal_init(parareal_alloc(), parareal_workers);
+        parareal_run(parareal, system);
+        printf("Parareal: %u iterations over %u slices%s, %lu fine ticks for %lu\n",
+                parareal->iterations, parareal->slices, parareal->converged ? "" : " (not converged)", parareal->fine_ticks, system->ticks);
+        parareal_dealloc(parareal);
+    } else {
+        system->log = fopen("_optimized_rocket.csv", "w+");
+        system_run(system);
+        fclose(system->log);
+        system->log = stdout;
+    }
 
     //Calculate biggest possible orbit
     if( system->state == SYSTEM_STATE_SUCCESS ) {
@@ -211,65 +876,3 @@ int simulate_vertical(void) {
 
     return 0;
 }
-
-Rocket *init_small_rocket(Rocket *rocket) {
-    rocket_init(rocket);
-
-    rocket->mass = 4.45;
-    rocket->empty_mass = 4.45-2.0;
-
-    rocket->max_thrust = 215.0;
-    rocket->isp_vac = 370.0;
-    rocket->isp_atm = 320.0;
-
-    rocket->max_drag = 0.2;
-
-    rocket->position.v[1] = kerbin_radius + 72.0; // Small rocket sits at 72.0m on pad.
-    rocket->velocity.v[0] = kerbin_radius * 0.0002908882086657216; // Surface rotational velocity.
-
-    return rocket;
-}
-
-Rocket *init_large_rocket(Rocket *rocket) {
-    rocket_init(rocket);
-
-    rocket->mass = 15.70;
-    rocket->empty_mass = 15.70-12.0;
-
-    rocket->max_thrust = 215.0;
-    rocket->isp_vac = 370.0;
-    rocket->isp_atm = 320.0;
-
-    rocket->max_drag = 0.2;
-
-    rocket->position.v[1] = kerbin_radius + 72.0; // Small rocket sits at 72.0m on pad.
-    rocket->velocity.v[0] = kerbin_radius * 0.0002908882086657216; // Surface rotational velocity.
-
-    return rocket;
-}
-
-Program *init_throttle_seed(Program *program) {
-    const size_t dim = 9;
-    assert(program->length == dim);
-    double altitudes[] = {-600000.0, 1000.0, 2000.0, 5000.0, 12000.0, 23000.0, 35000.0, 45000.0, 60000.0};
-    //double settings[] = {1.0, 0.9, 0.7, 0.5, 0.6, 0.8, 0.8, 0.9, 1.0};
-    double settings[] = {15, 15, 15, 15, 15, 8, 12, 4, 8};
-    for(size_t i=0; i<dim; i++) {
-        program->altitudes[i] = altitudes[i];
-        program->settings[i] = settings[i] * FIFTEENTH;
-    }
-    return program;
-}
-
-Program *init_altitude_angle_seed(Program *program) {
-    const size_t dim = 9;
-    assert(program->length == dim);
-    double altitudes[] = {-600000.0, 1000.0, 2000.0, 5000.0, 12000.0, 23000.0, 35000.0, 45000.0, 60000.0};
-    //double settings[] = {90*DEGREE, 85*DEGREE, 85*DEGREE, 90*DEGREE, 45*DEGREE, 30*DEGREE, 10*DEGREE, 5*DEGREE, 0*DEGREE};
-    double settings_degree[] ={90.0, 90.0, 90.0, 85.0, 50.0, 20.0, 10.0, 5.0, 0.0};
-    for(size_t i=0; i<dim; i++) {
-        program->altitudes[i] = altitudes[i];
-        program->settings[i] = settings_degree[i] * DEGREE;
-    }
-    return program;
-}
@@ -1,24 +1,204 @@
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 #include <math.h>
 #include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <unistd.h>
 
 #include "optimizer.h"
+#include "queue.h"
+#include "checkpoint.h"
+#include "library.h"
+#include "telemetry.h"
+#include "ensemble.h"
+#include "cache.h"
+#include "pool.h"
+#include "genome.h"
+#include "perf.h"
+#include "trace.h"
+#include "targets.h"
 
 typedef void *(*pthread_func)(void *);
 
+typedef struct OptimizerRanked {
+    double fitness;
+    size_t index;
+} OptimizerRanked;
+
+//A candidate in flight in the steady-state mode; the node must come first.
+typedef struct OptimizerTask {
+    ChannelNode node;
+    PoolTask pool_task; //Used when running on a shared pool.
+    const struct Optimizer *optimizer;
+    Channel *results;
+    System *system;
+    unsigned long candidate; //Numbered in the order made, for the trace.
+    OptimizerSystemResult *result;
+} OptimizerTask;
+
+typedef struct OptimizerWorker {
+    WorkQueue *tasks;
+    const Optimizer *optimizer;
+    unsigned index;
+} OptimizerWorker;
+
+//A partial flight in the beam search, paused at a breakpoint altitude.
+typedef struct OptimizerBeamState {
+    System system; //Points at the rocket, frame and programs below.
+    Rocket rocket;
+    Frame frame;
+    Program *throttle_program;
+    Program *altitude_angle_program;
+    double score;
+    bool finished; //The flight ended before the breakpoint; score is its fitness.
+} OptimizerBeamState;
+
+//Flies every stride'th state from index on to the altitude.
+typedef struct OptimizerBeamWorker {
+    OptimizerBeamState **states;
+    size_t count;
+    double altitude;
+    unsigned index;
+    unsigned stride;
+    double seconds;
+} OptimizerBeamWorker;
+
+//The systems of one optimizer_run_systems call; its threads claim them in order.
+typedef struct OptimizerJobs {
+    const Optimizer *optimizer;
+    System **systems;
+    OptimizerSystemResult **results;
+    size_t count;
+    atomic_size_t next;
+    unsigned long first; //Candidate number of the first system, for the trace.
+} OptimizerJobs;
+
+//A thread of optimizer_run_systems.
+typedef struct OptimizerJob {
+    OptimizerJobs *jobs;
+    unsigned worker;
+    uint64_t finished; //Trace time it ran out of systems.
+} OptimizerJob;
+
+//What parallel tempering replicas swap: the programs (and genes, on the grid) and their fitness.
+typedef struct OptimizerTemperingState {
+    Program *throttle_program;
+    Program *altitude_angle_program;
+    uint8_t genes[GENOME_MAX_GENES];
+    double fitness;
+} OptimizerTemperingState;
+
+//A replica's state offered for a swap, on its stack while it waits for the decision.
+typedef struct OptimizerTemperingOffer {
+    OptimizerTemperingState state;
+    atomic_bool decided;
+} OptimizerTemperingOffer;
+
+/*
+ * Where replicas i and i+1 meet: the first to arrive posts its offer and
+ * waits; the second takes it, decides, swaps the states if accepted and
+ * marks the offer decided.  The decision draws from the slot's own rng, so a
+ * run does not depend on which replica arrives first.
+ */
+typedef struct OptimizerTemperingExchange {
+    _Atomic(OptimizerTemperingOffer *) offer;
+    Rng rng;
+    double colder_beta; //1/temperature of replica i.
+    double hotter_beta;
+    unsigned long attempts;
+    unsigned long swaps;
+} OptimizerTemperingExchange;
+
+typedef struct OptimizerTemperingShared {
+    atomic_ulong evaluations;
+    atomic_ullong best_fitness_bits;
+} OptimizerTemperingShared;
+
+//A Metropolis chain at one temperature, on its own thread.
+typedef struct OptimizerReplica {
+    const Optimizer *optimizer;
+    OptimizerTemperingShared *shared;
+    unsigned index;
+    double temperature;
+    unsigned long steps;
+    unsigned exchange_interval;
+    OptimizerTemperingExchange *colder; //With replica index-1; NULL for the coldest.
+    OptimizerTemperingExchange *hotter; //With replica index+1; NULL for the hottest.
+    Rng rng;
+
+    OptimizerTemperingState state;
+    Program *best_throttle_program;
+    Program *best_altitude_angle_program;
+    double best_fitness;
+
+    unsigned long moves;
+    unsigned long accepted;
+    double seconds;
+} OptimizerReplica;
+
+static void *optimizer_steady_state_worker(OptimizerWorker *worker);
+static void *optimizer_run_job(OptimizerJob *job);
+static void optimizer_submit_task(Optimizer *self, WorkQueue *tasks, PoolClient *client, OptimizerTask *task);
+static void optimizer_run_pool_task(PoolTask *pool_task, unsigned worker);
+static void optimizer_beam_fly(Optimizer *self, OptimizerBeamState **states, size_t count, double altitude);
+static void *optimizer_beam_worker(OptimizerBeamWorker *worker);
+static void *optimizer_replica_run(OptimizerReplica *replica);
+static void optimizer_tempering_exchange(OptimizerTemperingExchange *exchange, OptimizerTemperingState *state, bool colder);
+static void optimizer_tempering_publish(OptimizerTemperingShared *shared, double fitness);
+static void optimizer_mutate(const Optimizer *self, const Program *throttle_program, const Program *altitude_angle_program, const uint8_t *genes, Rng *rng, Program **throttle_mutant, Program **altitude_angle_mutant, uint8_t *mutant_genes);
+static double optimizer_beam_score(const System *system);
+static size_t optimizer_beam_breakpoints(const Optimizer *self, double **breakpoints);
+static bool optimizer_beam_breakpoint(const Program *program, double altitude, size_t *index);
+static OptimizerBeamState *optimizer_beam_state_copy(const OptimizerBeamState *state);
+static void optimizer_beam_state_dealloc(OptimizerBeamState *state);
+static bool optimizer_beam_same_flight(const OptimizerBeamState *a, const OptimizerBeamState *b);
+static int optimizer_beam_compare_descending(const void *a, const void *b);
+static int optimizer_double_compare_ascending(const void *a, const void *b);
+static OptimizerSystemResult *optimizer_evaluate(const Optimizer *self, System *system);
+static uint64_t optimizer_scenario_hash(const Optimizer *self);
+static uint64_t optimizer_hash_program(uint64_t hash, const Program *program);
+static void optimizer_record(const Optimizer *self, unsigned worker, const OptimizerSystemResult *result);
+static void optimizer_report_progress(const Optimizer *self, unsigned workers);
+static OptimizerTask *optimizer_make_task(Optimizer *self, Channel *results, unsigned long candidate);
+static bool optimizer_keep_if_best(Optimizer *self, const OptimizerSystemResult *result);
+static System *optimizer_make_mutant(Optimizer *self);
+static void optimizer_encode_best(Optimizer *self);
+static double optimizer_clock(void);
+static double optimizer_thread_clock(void);
+static int optimizer_ranked_compare_descending(const void *a, const void *b);
+static void optimizer_ranks(const double *values, size_t count, double *ranks);
+static double optimizer_mutate_turn_altitude(const Program *program, size_t i, Rng *rng);
+static void optimizer_start_targets(Optimizer *self);
+static System *optimizer_make_target_mutant(Optimizer *self, unsigned target);
+static void optimizer_keep_targets_if_best(Optimizer *self, const OptimizerSystemResult *result);
+
 Optimizer *optimizer_alloc(void) {
     return (Optimizer *)malloc(sizeof(Optimizer));
 }
 
 void optimizer_dealloc(Optimizer *self) {
-    program_dealloc(self->best_throttle_program);
-    program_dealloc(self->best_altitude_angle_program);
+    if(self->best_throttle_program)
+        program_dealloc(self->best_throttle_program);
+    if(self->best_altitude_angle_program)
+        program_dealloc(self->best_altitude_angle_program);
+    if(self->genome_table)
+        genome_table_dealloc(self->genome_table);
+    free(self->best_genome);
+    for(unsigned i=0; i<OPTIMIZER_MAX_TARGETS; i++) {
+        if(self->target_throttle_programs[i])
+            program_dealloc(self->target_throttle_programs[i]);
+        if(self->target_altitude_angle_programs[i])
+            program_dealloc(self->target_altitude_angle_programs[i]);
+    }
     free(self);
 }
 
 Optimizer *optimizer_init(Optimizer *self) {
     self->rocket_factory_func = NULL;
+    self->rocket_prototype = NULL;
 
     self->planetoid = NULL;
 
@@ -30,45 +210,146 @@ Optimizer *optimizer_init(Optimizer *self) {
     self->best_altitude_angle_program = NULL;
     self->best_fitness = -INFINITY;
 
-    srand(time(NULL));
+    self->genome_table = NULL;
+    self->best_genome = NULL;
+
     self->generation = 0;
     self->generations = 1;
 
+    self->mode = OPTIMIZER_MODE_GENERATIONAL;
+
+    rng_init(&self->rng, (uint64_t)time(NULL));
+
+    self->checkpointer = NULL;
+    self->checkpoint_interval = OPTIMIZER_CHECKPOINT_INTERVAL;
+
+    self->library = NULL;
+    self->telemetry = NULL;
+
+    self->halving_pool = OPTIMIZER_HALVING_POOL;
+    self->halving_rungs = 3;
+    self->halving_ticks_per_second[0] = 5.0;
+    self->halving_ticks_per_second[1] = 20.0;
+    self->halving_ticks_per_second[2] = SYSTEM_TICKS_PER_SECOND;
+    self->halving_keep_fraction = OPTIMIZER_HALVING_KEEP_FRACTION;
+    for(unsigned i=0; i<OPTIMIZER_MAX_RUNGS; i++) {
+        self->halving_correlation_sum[i] = 0.0;
+        self->halving_correlation_count[i] = 0;
+    }
+
+    self->ensemble = NULL;
+    self->cache = NULL;
+    self->scenario_hash = 0;
+    self->kernel = NULL;
+    self->beam_width = OPTIMIZER_BEAM_WIDTH;
+    self->tempering_replicas = OPTIMIZER_TEMPERING_REPLICAS;
+    self->tempering_min_temperature = OPTIMIZER_TEMPERING_MIN_TEMPERATURE;
+    self->tempering_max_temperature = OPTIMIZER_TEMPERING_MAX_TEMPERATURE;
+    self->tempering_exchange_interval = OPTIMIZER_TEMPERING_EXCHANGE_INTERVAL;
+    for(unsigned i=0; i<OPTIMIZER_MAX_REPLICAS; i++) {
+        self->tempering_moves[i] = 0;
+        self->tempering_accepted[i] = 0;
+        self->tempering_swap_attempts[i] = 0;
+        self->tempering_swaps[i] = 0;
+    }
+    self->targets = 0;
+    for(unsigned i=0; i<OPTIMIZER_MAX_TARGETS; i++) {
+        self->target_radii[i] = 0.0;
+        self->target_throttle_programs[i] = NULL;
+        self->target_altitude_angle_programs[i] = NULL;
+        self->target_fitness[i] = -INFINITY;
+    }
+    self->children = OPTIMIZER_CHILDREN;
+    self->workers = OPTIMIZER_CHILDREN;
+    self->pool = NULL;
+    self->progress_func = NULL;
+    self->quiet = false;
+    self->progress_context = NULL;
+
+    self->evaluations = 0;
+    self->wall_seconds = 0.0;
+    self->busy_seconds = 0.0;
+    self->barrier_seconds = 0.0;
+    self->idle_seconds = 0.0;
+    self->threads = 0;
+
     return self;
 }
 
 double optimizer_run(Optimizer *self) {
-    //Seed programs.
-    assert(self->seed_throttle_program != NULL);
-    assert(self->seed_altitude_angle_program != NULL);
-    self->best_throttle_program = program_init_copy(program_alloc(), self->seed_throttle_program);
-    self->best_altitude_angle_program = program_init_copy(program_alloc(), self->seed_altitude_angle_program);
+    self->scenario_hash = optimizer_scenario_hash(self);
 
-    //Run system with seed programs to find fitness to seed fitness.
-    System *system = system_init(system_alloc());
-    system->planetoid = self->planetoid;
-    system->rocket = optimizer_make_rocket(self);
-    system->throttle_program = self->best_throttle_program;
-    system->altitude_angle_program = self->best_altitude_angle_program;
-    system->throttle_cutoff_radius = self->throttle_cutoff_radius;
+    PerfStage stage = perf_set_stage(PERF_STAGE_SEED);
+    uint64_t seed_start = trace_now();
+    if(self->best_throttle_program == NULL) {
+        //Seed programs.
+        assert(self->seed_throttle_program != NULL);
+        assert(self->seed_altitude_angle_program != NULL);
+        self->best_throttle_program = program_init_copy(program_alloc(), self->seed_throttle_program);
+        self->best_altitude_angle_program = program_init_copy(program_alloc(), self->seed_altitude_angle_program);
 
-    OptimizerSystemResult *result = optimizer_run_system(system);
-    self->best_fitness = result->fitness;
-    printf("Seed Program Fitness: %f\n", self->best_fitness);
+        //Run system with seed programs to find fitness to seed fitness.
+        System *system = optimizer_make_system(self, self->best_throttle_program, self->best_altitude_angle_program);
 
-    free(result);
-    rocket_dealloc(system->rocket);
-    system_dealloc(system);
+        OptimizerSystemResult *result = optimizer_evaluate(self, system);
+        self->best_fitness = result->fitness;
+        if(!self->quiet)
+            printf("Seed Program Fitness: %f\n", self->best_fitness);
 
+        free(result);
+        rocket_dealloc(system->rocket);
+        system_dealloc(system);
 
-    //Now run generations.
+        if(self->library)
+            optimizer_warm_start(self);
+    } else {
+        //Resumed from a checkpoint.
+        if(!self->quiet)
+            printf("Resumed Generation %u Fitness: %f\n", self->generation, self->best_fitness);
+    }
+
+
+    optimizer_encode_best(self);
+    if(self->targets > 0 && self->target_throttle_programs[0] == NULL) //Not restored from a checkpoint.
+        optimizer_start_targets(self);
+    trace_span("seed", seed_start);
+    perf_set_stage(stage);
+
+    //Now run generations; the multi-target search is always generational.
+    OptimizerMode mode = (self->targets > 0) ? OPTIMIZER_MODE_GENERATIONAL : self->mode;
+    double start = optimizer_clock();
+    if(mode == OPTIMIZER_MODE_STEADY_STATE)
+        optimizer_run_steady_state(self);
+    else if(mode == OPTIMIZER_MODE_BEAM)
+        optimizer_run_beam(self);
+    else if(mode == OPTIMIZER_MODE_TEMPERING)
+        optimizer_run_tempering(self);
     while(self->generation < self->generations) {
+        if(!self->quiet) {
             printf(".");
             fflush(stdout);
-        optimizer_run_generation(self);
+        }
+        if(self->targets > 0)
+            optimizer_run_targets_generation(self);
+        else if(mode == OPTIMIZER_MODE_SUCCESSIVE_HALVING)
+            optimizer_run_halving_generation(self);
+        else
+            optimizer_run_generation(self);
         self->generation++;
+        optimizer_report_progress(self, self->workers);
+        if(self->generation % self->checkpoint_interval == 0)
+            optimizer_checkpoint(self);
+    }
+    if(!self->quiet)
+        printf("\n");
+    self->wall_seconds += optimizer_clock() - start;
+    optimizer_checkpoint(self);
+
+    if(self->library) {
+        double features[LIBRARY_FEATURES];
+        optimizer_library_features(self, features);
+        library_add(self->library, features, self->best_fitness, self->best_throttle_program, self->best_altitude_angle_program);
     }
-    printf("\n");
 
     //Return best fitness value.
     return self->best_fitness;
@@ -76,40 +357,862 @@ double optimizer_run(Optimizer *self) {
 
 double optimizer_run_generation(Optimizer *self) {
     //Initialize the systems.
-    System **systems = optimizer_make_systems(self);
-
-    //Run each system in a thread.
-    pthread_t threads[OPTIMIZER_CHILDREN];
-    for(unsigned i=0; i<OPTIMIZER_CHILDREN; i++)
-        pthread_create(&threads[i], NULL, (pthread_func)optimizer_run_system, systems[i]);
-
-    //Thread join, collect result, and keep if optimal.
-    for(unsigned i=0; i<OPTIMIZER_CHILDREN; i++) {
-        //Fetch
-        OptimizerSystemResult *result = NULL;
-        pthread_join(threads[i], (void *)(&result));
-        //Keep?
-        //printf("%f > %f\n", result ? result->fitness : 0.0, self->best_fitness);
-        if(result && (result->fitness > self->best_fitness)) {
-            program_dealloc(self->best_throttle_program);
-            self->best_throttle_program = program_init_copy(program_alloc(), result->throttle_program);
-            program_dealloc(self->best_altitude_angle_program);
-            self->best_altitude_angle_program = program_init_copy(program_alloc(), result->altitude_angle_program);
-            self->best_fitness = result->fitness;
-        }
-        //Cleanup
-        free(result);
+    PerfStage stage = perf_set_stage(PERF_STAGE_MUTATE);
+    uint64_t start = trace_now();
+    System **systems = optimizer_make_systems(self, self->children);
+    trace_span("mutate", start);
+
+    //Run the systems over the workers.
+    OptimizerSystemResult **results = (OptimizerSystemResult **)malloc(sizeof(OptimizerSystemResult *) * self->children);
+    perf_set_stage(PERF_STAGE_EVALUATE);
+    optimizer_run_systems(self, systems, self->children, results);
+
+    //Collect result, and keep if optimal.
+    perf_set_stage(PERF_STAGE_SELECT);
+    start = trace_now();
+    for(unsigned i=0; i<self->children; i++) {
+        optimizer_keep_if_best(self, results[i]);
+        free(results[i]);
     }
+    trace_span("select", start);
+    perf_set_stage(stage);
 
     //Cleanup
-    optimizer_destroy_systems(systems);
+    free(results);
+    optimizer_destroy_systems(systems, self->children);
     return self->best_fitness;
 }
 
-OptimizerSystemResult *optimizer_run_system(System *system) {
-    //Run system.
-    system_run(system);
+/*
+ * A generation of the multi-target search: the mutants are made from each
+ * target's incumbent in turn, each flown once against every target, and
+ * every target takes the best of them for it.
+ */
+double optimizer_run_targets_generation(Optimizer *self) {
+    assert(self->targets > 0);
+
+    PerfStage stage = perf_set_stage(PERF_STAGE_MUTATE);
+    uint64_t start = trace_now();
+    System **systems = (System **)malloc(sizeof(System *) * self->children);
+    for(unsigned i=0; i<self->children; i++)
+        systems[i] = optimizer_make_target_mutant(self, i % self->targets);
+    trace_span("mutate", start);
+
+    OptimizerSystemResult **results = (OptimizerSystemResult **)malloc(sizeof(OptimizerSystemResult *) * self->children);
+    perf_set_stage(PERF_STAGE_EVALUATE);
+    optimizer_run_systems(self, systems, self->children, results);
+
+    perf_set_stage(PERF_STAGE_SELECT);
+    start = trace_now();
+    for(unsigned i=0; i<self->children; i++) {
+        optimizer_keep_targets_if_best(self, results[i]);
+        optimizer_keep_if_best(self, results[i]);
+        free(results[i]);
+    }
+    trace_span("select", start);
+    perf_set_stage(stage);
+
+    free(results);
+    optimizer_destroy_systems(systems, self->children);
+    return self->best_fitness;
+}
+
+/*
+ * Sets the targets of a multi-target search as throttle cutoff radii, sorted
+ * ascending; the highest becomes the throttle cutoff radius.  False, changing
+ * nothing, if there are none or too many, or one is not positive.
+ */
+bool optimizer_set_targets(Optimizer *self, const double *cutoff_radii, unsigned count) {
+    if(count == 0 || count > OPTIMIZER_MAX_TARGETS)
+        return false;
+    for(unsigned i=0; i<count; i++) {
+        if(!(cutoff_radii[i] > 0.0))
+            return false;
+    }
+    memcpy(self->target_radii, cutoff_radii, sizeof(double) * count);
+    qsort(self->target_radii, count, sizeof(double), optimizer_double_compare_ascending);
+    self->targets = count;
+    self->throttle_cutoff_radius = self->target_radii[count-1];
+    return true;
+}
+
+//Flies the best programs against every target, making them each target's incumbent.
+static void optimizer_start_targets(Optimizer *self) {
+    System *system = optimizer_make_system(self, self->best_throttle_program, self->best_altitude_angle_program);
+    OptimizerSystemResult *result = optimizer_evaluate(self, system);
+    self->evaluations++;
+    self->busy_seconds += result->seconds;
+    for(unsigned t=0; t<self->targets; t++) {
+        if(self->target_throttle_programs[t])
+            program_dealloc(self->target_throttle_programs[t]);
+        if(self->target_altitude_angle_programs[t])
+            program_dealloc(self->target_altitude_angle_programs[t]);
+        self->target_throttle_programs[t] = program_init_copy(program_alloc(), self->best_throttle_program);
+        self->target_altitude_angle_programs[t] = program_init_copy(program_alloc(), self->best_altitude_angle_program);
+        self->target_fitness[t] = result->target_fitness[t];
+    }
+    free(result);
+    rocket_dealloc(system->rocket);
+    system_dealloc(system);
+}
+
+//A system flying a mutant of the target's incumbent.
+static System *optimizer_make_target_mutant(Optimizer *self, unsigned target) {
+    const Program *throttle_program = self->target_throttle_programs[target];
+    const Program *altitude_angle_program = self->target_altitude_angle_programs[target];
+    Program *throttle_mutant, *altitude_angle_mutant;
+    uint8_t genes[GENOME_MAX_GENES], mutant_genes[GENOME_MAX_GENES];
+    if(self->genome_table && genome_encode(self->genome_table, throttle_program, altitude_angle_program, genes)) {
+        optimizer_mutate(self, throttle_program, altitude_angle_program, genes, &self->rng, &throttle_mutant, &altitude_angle_mutant, mutant_genes);
+    } else {
+        throttle_mutant = optimizer_mutate_throttle_program(throttle_program, &self->rng);
+        altitude_angle_mutant = optimizer_mutate_altitude_angle_program(altitude_angle_program, &self->rng);
+    }
+    return optimizer_make_system(self, throttle_mutant, altitude_angle_mutant);
+}
+
+static void optimizer_keep_targets_if_best(Optimizer *self, const OptimizerSystemResult *result) {
+    for(unsigned t=0; t<self->targets; t++) {
+        if(!(result->target_fitness[t] > self->target_fitness[t]))
+            continue;
+        program_dealloc(self->target_throttle_programs[t]);
+        self->target_throttle_programs[t] = program_init_copy(program_alloc(), result->throttle_program);
+        program_dealloc(self->target_altitude_angle_programs[t]);
+        self->target_altitude_angle_programs[t] = program_init_copy(program_alloc(), result->altitude_angle_program);
+        self->target_fitness[t] = result->target_fitness[t];
+    }
+}
+
+double optimizer_run_halving_generation(Optimizer *self) {
+    assert(self->halving_rungs > 0 && self->halving_rungs <= OPTIMIZER_MAX_RUNGS);
+    assert(self->halving_keep_fraction > 0.0 && self->halving_keep_fraction <= 1.0);
+
+    //Initialize the pool; every candidate is a mutant of the best.
+    size_t pool = self->halving_pool;
+    PerfStage stage = perf_set_stage(PERF_STAGE_MUTATE);
+    System **systems = optimizer_make_systems(self, pool);
+    OptimizerSystemResult **results = (OptimizerSystemResult **)malloc(sizeof(OptimizerSystemResult *) * pool);
+    OptimizerRanked *ranked = (OptimizerRanked *)malloc(sizeof(OptimizerRanked) * pool);
+    double *previous_fitness = (double *)malloc(sizeof(double) * pool);
+    double *fitness = (double *)malloc(sizeof(double) * pool);
+
+    //The survivors of each rung are kept at the front of the systems array.
+    size_t survivors = pool;
+    for(unsigned rung=0; rung<self->halving_rungs; rung++) {
+        for(size_t i=0; i<survivors; i++)
+            optimizer_reset_system(self, systems[i], self->halving_ticks_per_second[rung]);
+        perf_set_stage(PERF_STAGE_EVALUATE);
+        optimizer_run_systems(self, systems, survivors, results);
+        perf_set_stage(PERF_STAGE_SELECT);
+
+        for(size_t i=0; i<survivors; i++) {
+            fitness[i] = results[i]->fitness;
+            ranked[i].fitness = results[i]->fitness;
+            ranked[i].index = i;
+        }
+
+        //Compare the ordering of the promoted candidates against the rung they were promoted from.
+        if(rung > 0) {
+            double correlation = optimizer_rank_correlation(previous_fitness, fitness, survivors);
+            if(!isnan(correlation)) {
+                self->halving_correlation_sum[rung-1] += correlation;
+                self->halving_correlation_count[rung-1]++;
+            }
+        }
+
+        //Only the last rung may replace the best, as the coarse rungs are biased.
+        if(rung == self->halving_rungs-1) {
+            for(size_t i=0; i<survivors; i++)
+                optimizer_keep_if_best(self, results[i]);
+        }
+        for(size_t i=0; i<survivors; i++)
+            free(results[i]);
+        if(rung == self->halving_rungs-1)
+            break;
+
+        //Promote the best to the front, preserving their fitness at this rung.
+        qsort(ranked, survivors, sizeof(OptimizerRanked), optimizer_ranked_compare_descending);
+        size_t promoted = (size_t)ceil(survivors * self->halving_keep_fraction);
+        System **promoted_systems = (System **)malloc(sizeof(System *) * survivors);
+        for(size_t i=0; i<survivors; i++)
+            promoted_systems[i] = systems[ranked[i].index];
+        for(size_t i=0; i<survivors; i++) {
+            systems[i] = promoted_systems[i];
+            previous_fitness[i] = ranked[i].fitness;
+        }
+        free(promoted_systems);
+        survivors = promoted;
+    }
+
+    //Cleanup
+    free(fitness);
+    free(previous_fitness);
+    free(ranked);
+    free(results);
+    optimizer_destroy_systems(systems, pool);
+    perf_set_stage(stage);
+    return self->best_fitness;
+}
+
+/*
+ * Loads the search state from a checkpoint written by a previous run, so that
+ * optimizer_run continues that search rather than starting from the seeds.
+ */
+bool optimizer_resume(Optimizer *self, const char *path) {
+    size_t size = 0;
+    unsigned char *image = checkpoint_read_file(path, &size);
+    if(image == NULL)
+        return false;
+    bool ok = checkpoint_decode(self, image, size);
+    free(image);
+    return ok;
+}
+
+/*
+ * Encodes the search state and hands it to the checkpointer's writer thread.
+ * Called between generations, so no evaluation is waiting on it.
+ */
+void optimizer_checkpoint(const Optimizer *self) {
+    if(self->checkpointer == NULL)
+        return;
+    uint64_t start = trace_now();
+    size_t size = 0;
+    unsigned char *image = checkpoint_encode(self, &size);
+    checkpointer_submit(self->checkpointer, image, size);
+    trace_span("checkpoint", start);
+}
+
+/*
+ * Evaluates the programs the library suggests for this scenario, and makes
+ * them the best if they beat the seeds.
+ */
+bool optimizer_warm_start(Optimizer *self) {
+    double features[LIBRARY_FEATURES];
+    optimizer_library_features(self, features);
+
+    Program *throttle_program = NULL;
+    Program *altitude_angle_program = NULL;
+    if(!library_seed(self->library, features, &throttle_program, &altitude_angle_program))
+        return false;
+
+    System *system = optimizer_make_system(self, throttle_program, altitude_angle_program);
+    OptimizerSystemResult *result = optimizer_evaluate(self, system);
+    bool kept = optimizer_keep_if_best(self, result);
+    if(!self->quiet)
+        printf("Warm Start Fitness: %f%s\n", result->fitness, kept ? "" : " (seed kept)");
+
+    free(result);
+    optimizer_destroy_system(system);
+    return kept;
+}
+
+void optimizer_library_features(const Optimizer *self, double *features) {
+    Rocket *rocket = optimizer_make_rocket(self);
+    library_features(features, rocket, self->planetoid, self->throttle_cutoff_radius);
+    rocket_dealloc(rocket);
+}
+
+/*
+ * Evaluates the candidates one after another as workers free up, replacing the
+ * best as soon as a better result arrives, so no worker waits on a slow flight.
+ * Runs the same number of evaluations as the remaining generations would.
+ */
+double optimizer_run_steady_state(Optimizer *self) {
+    //A shared pool replaces our own workers; its scheduler keeps us fair with its other clients.
+    WorkerPool *pool = self->pool;
+    unsigned workers = pool ? pool->workers : self->workers;
+    assert(workers > 0);
+    unsigned long total = (unsigned long)(self->generations - self->generation) * self->children;
+
+    //Keep a couple of candidates queued per worker so none go idle between results.
+    WorkQueue *tasks = NULL;
+    PoolClient client;
+    Channel *results = channel_init(channel_alloc());
+
+    OptimizerWorker *worker = NULL;
+    pthread_t *threads = NULL;
+    if(pool) {
+        pool_client_init(&client);
+    } else {
+        tasks = work_queue_init(work_queue_alloc(), 2*workers);
+        worker = (OptimizerWorker *)malloc(sizeof(OptimizerWorker) * workers);
+        threads = (pthread_t *)malloc(sizeof(pthread_t) * workers);
+        for(unsigned i=0; i<workers; i++) {
+            worker[i].tasks = tasks;
+            worker[i].optimizer = self;
+            worker[i].index = i;
+            pthread_create(&threads[i], NULL, (pthread_func)optimizer_steady_state_worker, &worker[i]);
+        }
+    }
+
+    unsigned long first = self->evaluations;
+    unsigned long submitted = 0;
+    while(submitted < total && submitted < 2*workers) {
+        optimizer_submit_task(self, tasks, &client, optimizer_make_task(self, results, first + submitted));
+        submitted++;
+    }
+
+    //Each result may move the best, so the next mutant is always made from the latest best.
+    PerfStage stage = perf_set_stage(PERF_STAGE_SELECT);
+    for(unsigned long completed=0; completed < total; completed++) {
+        uint64_t start = trace_now();
+        OptimizerTask *task = (OptimizerTask *)channel_receive(results);
+        trace_span("result wait", start);
+        optimizer_keep_if_best(self, task->result);
+        self->evaluations++;
+        self->busy_seconds += task->result->seconds;
+
+        free(task->result);
+        optimizer_destroy_system(task->system);
+        free(task);
+
+        if(submitted < total) {
+            optimizer_submit_task(self, tasks, &client, optimizer_make_task(self, results, first + submitted));
+            submitted++;
+        }
+
+        if((completed+1) % self->children == 0) {
+            self->generation++;
+            if(!self->quiet) {
+                printf(".");
+                fflush(stdout);
+            }
+            optimizer_report_progress(self, workers);
+            //Candidates still in flight are not saved; a resumed run draws fresh ones.
+            if(self->generation % self->checkpoint_interval == 0)
+                optimizer_checkpoint(self);
+        }
+    }
+
+    //Cleanup
+    if(!pool) {
+        work_queue_close(tasks);
+        for(unsigned i=0; i<workers; i++)
+            pthread_join(threads[i], NULL);
+        free(threads);
+        free(worker);
+        work_queue_dealloc(tasks);
+    }
+    channel_dealloc(results);
+    perf_set_stage(stage);
+
+    if(workers > self->threads)
+        self->threads = workers;
+    self->generation = self->generations;
+    return self->best_fitness;
+}
+
+static void optimizer_submit_task(Optimizer *self, WorkQueue *tasks, PoolClient *client, OptimizerTask *task) {
+    if(self->pool) {
+        task->pool_task.run = optimizer_run_pool_task;
+        worker_pool_submit(self->pool, client, &task->pool_task);
+    } else {
+        work_queue_push(tasks, task);
+    }
+}
+
+static void *optimizer_steady_state_worker(OptimizerWorker *worker) {
+    perf_thread_begin(worker->index, PERF_STAGE_EVALUATE);
+    trace_thread_begin(worker->index);
+    OptimizerTask *task;
+    uint64_t start = trace_now();
+    while((task = (OptimizerTask *)work_queue_pop(worker->tasks)) != NULL) {
+        trace_span("queue wait", start);
+        start = trace_now();
+        task->result = optimizer_evaluate(worker->optimizer, task->system);
+        trace_evaluation(start, task->candidate, task->result->ticks, task->result->fitness);
+        optimizer_record(worker->optimizer, worker->index, task->result);
+        start = trace_now();
+        channel_send(task->results, &task->node);
+    }
+    trace_thread_end();
+    perf_thread_end();
+    return NULL;
+}
+
+static void *optimizer_run_job(OptimizerJob *job) {
+    perf_thread_begin(job->worker, PERF_STAGE_EVALUATE);
+    trace_thread_begin(job->worker);
+    OptimizerJobs *jobs = job->jobs;
+    size_t i;
+    while((i = atomic_fetch_add(&jobs->next, 1)) < jobs->count) {
+        uint64_t start = trace_now();
+        jobs->results[i] = optimizer_evaluate(jobs->optimizer, jobs->systems[i]);
+        trace_evaluation(start, jobs->first + i, jobs->results[i]->ticks, jobs->results[i]->fitness);
+        optimizer_record(jobs->optimizer, job->worker, jobs->results[i]);
+    }
+    job->finished = trace_now();
+    trace_thread_end();
+    perf_thread_end();
+    return NULL;
+}
+
+static void optimizer_run_pool_task(PoolTask *pool_task, unsigned worker) {
+    OptimizerTask *task = (OptimizerTask *)((char *)pool_task - offsetof(OptimizerTask, pool_task));
+    task->result = optimizer_evaluate(task->optimizer, task->system);
+    optimizer_record(task->optimizer, worker, task->result);
+    channel_send(task->results, &task->node);
+}
+
+/*
+ * A step program's setting only acts above its own breakpoint, so the flight up
+ * to the next breakpoint depends only on the settings so far.  The beam search
+ * walks the breakpoints in order: every partial flight in the beam is copied
+ * once for each grid setting the mutations could choose at this breakpoint,
+ * each copy is flown only to the next breakpoint, and the best beam_width by
+ * optimizer_beam_score are carried on.  Flights that end on the way are finished candidates; the best of
+ * these is scored as usual (against the ensemble, if any) and may replace the best.
+ *
+ * Programs of other kinds look ahead to later settings, so for them this
+ * returns without running and the generations are run as usual.
+ */
+double optimizer_run_beam(Optimizer *self) {
+    if(self->best_throttle_program->kind != PROGRAM_KIND_STEP || self->best_altitude_angle_program->kind != PROGRAM_KIND_STEP)
+        return self->best_fitness;
+    assert(self->beam_width > 0);
+
+    double *breakpoints = NULL;
+    size_t breakpoint_count = optimizer_beam_breakpoints(self, &breakpoints);
+
+    //The beam starts as the one flight on the launch pad.
+    OptimizerBeamState *root = (OptimizerBeamState *)malloc(sizeof(OptimizerBeamState));
+    root->throttle_program = program_init_copy(program_alloc(), self->best_throttle_program);
+    root->altitude_angle_program = program_init_copy(program_alloc(), self->best_altitude_angle_program);
+    system_init(&root->system);
+    root->system.planetoid = self->planetoid;
+    root->system.rocket = optimizer_prepare_rocket(self, &root->rocket);
+    root->system.throttle_program = root->throttle_program;
+    root->system.altitude_angle_program = root->altitude_angle_program;
+    root->system.throttle_cutoff_radius = self->throttle_cutoff_radius;
+    system_start(&root->system, &root->frame);
+    root->score = 0.0;
+    root->finished = false;
+
+    OptimizerBeamState **beam = (OptimizerBeamState **)malloc(sizeof(OptimizerBeamState *) * self->beam_width);
+    beam[0] = root;
+    size_t beam_count = 1;
+    OptimizerBeamState *best = NULL;
+
+    for(size_t j=0; j<breakpoint_count && beam_count > 0; j++) {
+        size_t throttle_index = 0, altitude_angle_index = 0;
+        bool throttle_breakpoint = optimizer_beam_breakpoint(self->best_throttle_program, breakpoints[j], &throttle_index);
+        bool altitude_angle_breakpoint = optimizer_beam_breakpoint(self->best_altitude_angle_program, breakpoints[j], &altitude_angle_index);
+        size_t throttle_choices = throttle_breakpoint ? THROTTLE_INTERVALS+1 : 1;
+        size_t altitude_angle_choices = altitude_angle_breakpoint ? ALTITUDE_ANGLE_INTERVALS+1 : 1;
+
+        //Expand every partial flight by every setting on the mutation grid.
+        size_t count = beam_count * throttle_choices * altitude_angle_choices;
+        OptimizerBeamState **children = (OptimizerBeamState **)malloc(sizeof(OptimizerBeamState *) * count);
+        size_t n = 0;
+        for(size_t b=0; b<beam_count; b++) {
+            for(size_t t=0; t<throttle_choices; t++) {
+                for(size_t a=0; a<altitude_angle_choices; a++) {
+                    OptimizerBeamState *child = optimizer_beam_state_copy(beam[b]);
+                    if(throttle_breakpoint)
+                        child->throttle_program->settings[throttle_index] = (double)t / (double)THROTTLE_INTERVALS;
+                    if(altitude_angle_breakpoint)
+                        child->altitude_angle_program->settings[altitude_angle_index] = (M_PI/2.0) * ((double)a / (double)ALTITUDE_ANGLE_INTERVALS);
+                    children[n++] = child;
+                }
+            }
+            optimizer_beam_state_dealloc(beam[b]);
+        }
+
+        double altitude = (j+1 < breakpoint_count) ? breakpoints[j+1] : INFINITY;
+        optimizer_beam_fly(self, children, count, altitude);
+
+        //Finished flights leave the beam; the rest are ranked by their partial score.
+        size_t open = 0;
+        for(size_t i=0; i<count; i++) {
+            if(!children[i]->finished) {
+                children[open++] = children[i];
+                continue;
+            }
+            self->evaluations++;
+            if(best == NULL || children[i]->score > best->score) {
+                if(best)
+                    optimizer_beam_state_dealloc(best);
+                best = children[i];
+            } else {
+                optimizer_beam_state_dealloc(children[i]);
+            }
+        }
+        qsort(children, open, sizeof(OptimizerBeamState *), optimizer_beam_compare_descending);
+
+        //Settings that make no difference (a throttle after cutoff, say) give identical flights; keep one.
+        beam_count = 0;
+        for(size_t i=0; i<open; i++) {
+            bool duplicate = false;
+            for(size_t k=0; k<beam_count && !duplicate; k++)
+                duplicate = optimizer_beam_same_flight(beam[k], children[i]);
+            if(!duplicate && beam_count < self->beam_width)
+                beam[beam_count++] = children[i];
+            else
+                optimizer_beam_state_dealloc(children[i]);
+        }
+        free(children);
+
+        if(!self->quiet) {
+            printf(".");
+            fflush(stdout);
+        }
+        optimizer_report_progress(self, self->workers);
+    }
+
+    for(size_t i=0; i<beam_count; i++)
+        optimizer_beam_state_dealloc(beam[i]);
+    free(beam);
+    free(breakpoints);
+
+    //Score the best finished flight the same way as every other candidate.
+    if(best) {
+        System *system = optimizer_make_system(self, best->throttle_program, best->altitude_angle_program);
+        OptimizerSystemResult *result = optimizer_evaluate(self, system);
+        optimizer_keep_if_best(self, result);
+        self->evaluations++;
+        self->busy_seconds += result->seconds;
+        free(result);
+        rocket_dealloc(system->rocket);
+        system_dealloc(system);
+        optimizer_beam_state_dealloc(best);
+    }
+
+    self->generation = self->generations;
+    return self->best_fitness;
+}
+
+//Flies each state on to the altitude, spread over the workers.
+static void optimizer_beam_fly(Optimizer *self, OptimizerBeamState **states, size_t count, double altitude) {
+    unsigned workers = self->workers;
+    if(workers > count)
+        workers = (unsigned)count;
+    if(workers == 0)
+        return;
+
+    uint64_t start = trace_now();
+    pthread_t *threads = (pthread_t *)malloc(sizeof(pthread_t) * workers);
+    OptimizerBeamWorker *worker = (OptimizerBeamWorker *)malloc(sizeof(OptimizerBeamWorker) * workers);
+    for(unsigned i=0; i<workers; i++) {
+        worker[i].states = states;
+        worker[i].count = count;
+        worker[i].altitude = altitude;
+        worker[i].index = i;
+        worker[i].stride = workers;
+        worker[i].seconds = 0.0;
+        pthread_create(&threads[i], NULL, (pthread_func)optimizer_beam_worker, &worker[i]);
+    }
+    for(unsigned i=0; i<workers; i++) {
+        pthread_join(threads[i], NULL);
+        self->busy_seconds += worker[i].seconds;
+    }
+    trace_span("join", start);
+    free(worker);
+    free(threads);
+
+    if(workers > self->threads)
+        self->threads = workers;
+}
+
+static void *optimizer_beam_worker(OptimizerBeamWorker *worker) {
+    perf_thread_begin(worker->index, PERF_STAGE_EVALUATE);
+    trace_thread_begin(worker->index);
+    double start = optimizer_thread_clock();
+    for(size_t i=worker->index; i<worker->count; i+=worker->stride) {
+        uint64_t segment = trace_now();
+        OptimizerBeamState *state = worker->states[i];
+        if(system_run_to_altitude(&state->system, worker->altitude)) {
+            state->score = optimizer_beam_score(&state->system);
+        } else {
+            system_finish(&state->system);
+            state->finished = true;
+            state->score = optimizer_fitness(&state->system);
+        }
+        trace_span("segment", segment);
+    }
+    worker->seconds = optimizer_thread_clock() - start;
+    trace_thread_end();
+    perf_thread_end();
+    return NULL;
+}
+
+/*
+ * The partial score is the fitness of finishing the flight with the rest of
+ * the best programs, flown on a copy at the coarse rollout rate.  The tail is
+ * cheap next to the segment, and unlike an estimate from the current orbit it
+ * charges the drag and gravity still to come.
+ */
+static double optimizer_beam_score(const System *system) {
+    System rollout = *system;
+    Rocket rocket = *system->rocket;
+    Frame frame = *system->frame;
+    rollout.rocket = &rocket;
+    rollout.frame = &frame;
+    rollout.delta_t = 1.0/OPTIMIZER_BEAM_ROLLOUT_TICKS_PER_SECOND;
+    rollout.ticks = (unsigned long)(system_time(system) * OPTIMIZER_BEAM_ROLLOUT_TICKS_PER_SECOND); //The clock is ticks*delta_t.
+
+    while(system_step(&rollout))
+        ;
+    system_finish(&rollout);
+    return optimizer_fitness(&rollout);
+}
+
+//The sorted union of both programs' breakpoint altitudes.
+static size_t optimizer_beam_breakpoints(const Optimizer *self, double **breakpoints) {
+    const Program *throttle_program = self->best_throttle_program;
+    const Program *altitude_angle_program = self->best_altitude_angle_program;
+
+    double *altitudes = (double *)malloc(sizeof(double) * (throttle_program->length + altitude_angle_program->length));
+    size_t count = 0;
+    for(size_t i=0; i<throttle_program->length; i++)
+        altitudes[count++] = throttle_program->altitudes[i];
+    for(size_t i=0; i<altitude_angle_program->length; i++) {
+        size_t index;
+        if(!optimizer_beam_breakpoint(throttle_program, altitude_angle_program->altitudes[i], &index))
+            altitudes[count++] = altitude_angle_program->altitudes[i];
+    }
+    qsort(altitudes, count, sizeof(double), optimizer_double_compare_ascending);
+
+    *breakpoints = altitudes;
+    return count;
+}
 
+static bool optimizer_beam_breakpoint(const Program *program, double altitude, size_t *index) {
+    for(size_t i=0; i<program->length; i++) {
+        if(program->altitudes[i] == altitude) {
+            *index = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+//A copy that can be flown on independently of the original.
+static OptimizerBeamState *optimizer_beam_state_copy(const OptimizerBeamState *state) {
+    OptimizerBeamState *copy = (OptimizerBeamState *)malloc(sizeof(OptimizerBeamState));
+    *copy = *state;
+    copy->throttle_program = program_init_copy(program_alloc(), state->throttle_program);
+    copy->altitude_angle_program = program_init_copy(program_alloc(), state->altitude_angle_program);
+    copy->system.rocket = &copy->rocket;
+    copy->system.frame = &copy->frame;
+    copy->system.throttle_program = copy->throttle_program;
+    copy->system.altitude_angle_program = copy->altitude_angle_program;
+    return copy;
+}
+
+static void optimizer_beam_state_dealloc(OptimizerBeamState *state) {
+    program_dealloc(state->throttle_program);
+    program_dealloc(state->altitude_angle_program);
+    free(state);
+}
+
+static bool optimizer_beam_same_flight(const OptimizerBeamState *a, const OptimizerBeamState *b) {
+    return a->system.ticks == b->system.ticks
+        && a->rocket.mass == b->rocket.mass
+        && VX(a->rocket.position) == VX(b->rocket.position) && VY(a->rocket.position) == VY(b->rocket.position)
+        && VX(a->rocket.velocity) == VX(b->rocket.velocity) && VY(a->rocket.velocity) == VY(b->rocket.velocity);
+}
+
+static int optimizer_beam_compare_descending(const void *a, const void *b) {
+    double fa = (*(OptimizerBeamState * const *)a)->score;
+    double fb = (*(OptimizerBeamState * const *)b)->score;
+    return (fa < fb) - (fa > fb);
+}
+
+static int optimizer_double_compare_ascending(const void *a, const void *b) {
+    double fa = *(const double *)a;
+    double fb = *(const double *)b;
+    return (fa > fb) - (fa < fb);
+}
+
+//Runs the system (or its ensemble), unless the cache already knows the answer.
+static OptimizerSystemResult *optimizer_evaluate(const Optimizer *self, System *system) {
+    if(self->targets > 0)
+        return optimizer_run_targets(self, system);
+
+    uint64_t key = 0;
+    if(self->cache) {
+        key = self->scenario_hash;
+        key = optimizer_hash_program(key, system->throttle_program);
+        key = optimizer_hash_program(key, system->altitude_angle_program);
+        key = fitness_cache_hash(key, &system->delta_t, sizeof(system->delta_t));
+
+        double fitness;
+        unsigned long ticks;
+        if(fitness_cache_lookup(self->cache, key, &fitness, &ticks)) {
+            OptimizerSystemResult *result = (OptimizerSystemResult *)malloc(sizeof(OptimizerSystemResult));
+            result->throttle_program = system->throttle_program;
+            result->altitude_angle_program = system->altitude_angle_program;
+            result->fitness = fitness;
+            result->seconds = 0.0;
+            result->ticks = 0; //None simulated.
+            return result;
+        }
+    }
+
+    OptimizerSystemResult *result = self->ensemble ? optimizer_run_ensemble(system, self->ensemble) : optimizer_run_system(system);
+    if(self->cache)
+        fitness_cache_store(self->cache, key, result->fitness, result->ticks);
+    return result;
+}
+
+//Everything besides the programs and tick rate that a fitness depends on.
+static uint64_t optimizer_scenario_hash(const Optimizer *self) {
+    Rocket *rocket = optimizer_make_rocket(self);
+    double values[] = {
+        VX(rocket->position), VY(rocket->position), VX(rocket->velocity), VY(rocket->velocity),
+        rocket->mass, rocket->empty_mass, rocket->max_thrust, rocket->isp_vac, rocket->isp_atm, rocket->max_drag,
+        VX(self->planetoid->position), VY(self->planetoid->position), self->planetoid->radius,
+        self->planetoid->gravitational_parameter, self->planetoid->rotational_period,
+        self->planetoid->atmospheric_attenuation, self->planetoid->max_atmospheric_altitude,
+        self->throttle_cutoff_radius
+    };
+    rocket_dealloc(rocket);
+
+    uint64_t hash = fitness_cache_hash(FITNESS_CACHE_HASH_SEED, values, sizeof(values));
+    if(self->ensemble) {
+        const EnsembleSpread *spread = &self->ensemble->spread;
+        double ensemble_values[] = {
+            (double)self->ensemble->size, self->ensemble->robust_quantile,
+            spread->thrust, spread->isp, spread->drag, spread->dry_mass, spread->atmosphere
+        };
+        hash = fitness_cache_hash(hash, ensemble_values, sizeof(ensemble_values));
+    }
+    return hash;
+}
+
+static uint64_t optimizer_hash_program(uint64_t hash, const Program *program) {
+    uint64_t header[] = {(uint64_t)program->kind, (uint64_t)program->length, (uint64_t)(uintptr_t)program->func, (uint64_t)(uintptr_t)program->context};
+    hash = fitness_cache_hash(hash, header, sizeof(header));
+    hash = fitness_cache_hash(hash, program->altitudes, program->length * sizeof(double));
+    return fitness_cache_hash(hash, program->settings, program->length * sizeof(double));
+}
+
+static void optimizer_record(const Optimizer *self, unsigned worker, const OptimizerSystemResult *result) {
+    if(self->telemetry)
+        telemetry_record(self->telemetry, worker, result->fitness, result->ticks, result->seconds);
+}
+
+static void optimizer_report_progress(const Optimizer *self, unsigned workers) {
+    if(self->telemetry)
+        telemetry_set_progress(self->telemetry, self->generation, self->best_fitness, workers);
+    if(self->progress_func)
+        self->progress_func(self, self->progress_context);
+}
+
+static OptimizerTask *optimizer_make_task(Optimizer *self, Channel *results, unsigned long candidate) {
+    OptimizerTask *task = (OptimizerTask *)malloc(sizeof(OptimizerTask));
+    task->optimizer = self;
+    task->results = results;
+    task->candidate = candidate;
+    PerfStage stage = perf_set_stage(PERF_STAGE_MUTATE);
+    uint64_t start = trace_now();
+    task->system = optimizer_make_mutant(self);
+    trace_span("mutate", start);
+    perf_set_stage(stage);
+    task->result = NULL;
+    return task;
+}
+
+static bool optimizer_keep_if_best(Optimizer *self, const OptimizerSystemResult *result) {
+    if(!result || !(result->fitness > self->best_fitness))
+        return false;
+
+    uint64_t start = trace_now();
+    program_dealloc(self->best_throttle_program);
+    self->best_throttle_program = program_init_copy(program_alloc(), result->throttle_program);
+    program_dealloc(self->best_altitude_angle_program);
+    self->best_altitude_angle_program = program_init_copy(program_alloc(), result->altitude_angle_program);
+    self->best_fitness = result->fitness;
+
+    //A new best off the grid (from the beam search, say) ends the genome encoding.
+    if(self->genome_table && !genome_encode(self->genome_table, self->best_throttle_program, self->best_altitude_angle_program, self->best_genome)) {
+        genome_table_dealloc(self->genome_table);
+        self->genome_table = NULL;
+    }
+    trace_span("copy best", start);
+    return true;
+}
+
+//A system flying a mutant of the best programs.
+static System *optimizer_make_mutant(Optimizer *self) {
+    Program *throttle_program, *altitude_angle_program;
+    uint8_t genes[GENOME_MAX_GENES];
+    optimizer_mutate(self, self->best_throttle_program, self->best_altitude_angle_program, self->best_genome, &self->rng, &throttle_program, &altitude_angle_program, genes);
+    return optimizer_make_system(self, throttle_program, altitude_angle_program);
+}
+
+/*
+ * Mutants of the programs, made as mutants of their genes when on the grid;
+ * the genes are then given and the mutant's returned.  Only reads the
+ * optimizer, so it may be called from any thread with its own rng.
+ */
+static void optimizer_mutate(const Optimizer *self, const Program *throttle_program, const Program *altitude_angle_program, const uint8_t *genes, Rng *rng, Program **throttle_mutant, Program **altitude_angle_mutant, uint8_t *mutant_genes) {
+    if(self->genome_table) {
+        memcpy(mutant_genes, genes, self->genome_table->genes);
+        genome_mutate(self->genome_table, mutant_genes, rng);
+        genome_make_programs(self->genome_table, mutant_genes, throttle_mutant, altitude_angle_mutant);
+    } else {
+        *throttle_mutant = optimizer_mutate_throttle_program(throttle_program, rng);
+        *altitude_angle_mutant = optimizer_mutate_altitude_angle_program(altitude_angle_program, rng);
+    }
+}
+
+//Builds the genome table for this search from the best programs, if they encode.
+static void optimizer_encode_best(Optimizer *self) {
+    if(self->genome_table)
+        genome_table_dealloc(self->genome_table);
+    free(self->best_genome);
+    self->best_genome = NULL;
+
+    self->genome_table = genome_table_alloc();
+    if(!genome_table_init(self->genome_table, self->best_throttle_program, self->best_altitude_angle_program)) {
+        genome_table_dealloc(self->genome_table);
+        self->genome_table = NULL;
+        return;
+    }
+    self->best_genome = genome_alloc(self->genome_table, 1);
+    genome_encode(self->genome_table, self->best_throttle_program, self->best_altitude_angle_program, self->best_genome);
+}
+
+/*
+ * The fraction of the available cores that were simulating during the run.
+ */
+double optimizer_utilization(const Optimizer *self) {
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    double usable = (cores > 0 && (unsigned long)cores < self->threads) ? (double)cores : (double)self->threads;
+    if(self->wall_seconds <= 0.0 || usable <= 0.0)
+        return NAN;
+    return self->busy_seconds / (self->wall_seconds * usable);
+}
+
+/*
+ * The fraction of the thread time in optimizer_run_systems spent waiting at
+ * its barrier for the slowest system rather than simulating.
+ */
+double optimizer_idle_fraction(const Optimizer *self) {
+    if(self->barrier_seconds <= 0.0)
+        return NAN;
+    return self->idle_seconds / self->barrier_seconds;
+}
+
+static double optimizer_clock(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + 1e-9*now.tv_nsec;
+}
+
+//CPU time of the calling thread, so oversubscribed threads aren't counted as busy while descheduled.
+static double optimizer_thread_clock(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return now.tv_sec + 1e-9*now.tv_nsec;
+}
+
+/*
+ * The fitness of a finished system: the velocity to spare after circularizing
+ * at the target radius, or -INFINITY if the flight failed.
+ */
+double optimizer_fitness(const System *system) {
     //Circularize, and then calculate the excess velocity.
     double excess_delta_v = -INFINITY;
 
@@ -141,50 +1244,506 @@ OptimizerSystemResult *optimizer_run_system(System *system) {
         //printf("%f\t%f\t%f\t%f\t%f\n", excess_delta_v, radius, v_circ, initial_horizontal_velocity, rocket_delta_v);
     }
 
+    return excess_delta_v;
+}
+
+OptimizerSystemResult *optimizer_run_system(System *system) {
+    double start = optimizer_thread_clock();
+
+    //Run system.
+    system_run(system);
+    double excess_delta_v = optimizer_fitness(system);
+
     //Allocate and fillin result.
     OptimizerSystemResult *result = (OptimizerSystemResult *)malloc(sizeof(OptimizerSystemResult));
     result->throttle_program = system->throttle_program;
     result->altitude_angle_program = system->altitude_angle_program;
     result->fitness = excess_delta_v;
+    result->seconds = optimizer_thread_clock() - start;
+    result->ticks = system->ticks;
 
     //Return.
     return result;
 }
 
-System **optimizer_make_systems(const Optimizer *self) {
-    System **systems = (System **)malloc(sizeof(System *) * OPTIMIZER_CHILDREN);
+/*
+ * Flies the system's programs against every ensemble member on this thread;
+ * the system itself only supplies the programs, target and tick rate.
+ */
+OptimizerSystemResult *optimizer_run_ensemble(System *system, const Ensemble *ensemble) {
+    double start = optimizer_thread_clock();
 
-    for(size_t i=0; i<OPTIMIZER_CHILDREN; i++) {
-        systems[i] = system_init(system_alloc());
-        systems[i]->planetoid = self->planetoid;
-        systems[i]->rocket = optimizer_make_rocket(self);
-        systems[i]->throttle_program = optimizer_mutate_throttle_program(self->best_throttle_program);
-        systems[i]->altitude_angle_program = optimizer_mutate_altitude_angle_program(self->best_altitude_angle_program);
-        systems[i]->throttle_cutoff_radius = self->throttle_cutoff_radius;
+    EnsembleResult *ensemble_result = ensemble_result_init(ensemble_result_alloc(), ensemble->size);
+    ensemble_evaluate(ensemble, system, 1, ensemble_result);
+
+    OptimizerSystemResult *result = (OptimizerSystemResult *)malloc(sizeof(OptimizerSystemResult));
+    result->throttle_program = system->throttle_program;
+    result->altitude_angle_program = system->altitude_angle_program;
+    result->fitness = ensemble_result->robust_fitness;
+    result->seconds = optimizer_thread_clock() - start;
+    result->ticks = ensemble_result->ticks;
+
+    ensemble_result_dealloc(ensemble_result);
+    return result;
+}
+
+/*
+ * Flies the system's programs against every target of the optimizer at once
+ * (see targets.h); the fitness is the highest target's.  The system is only
+ * copied, and is left ready.
+ */
+OptimizerSystemResult *optimizer_run_targets(const Optimizer *self, System *system) {
+    double start = optimizer_thread_clock();
+
+    TargetFlight *flights = (TargetFlight *)malloc(sizeof(TargetFlight) * self->targets);
+    unsigned long ticks = targets_fly(system, self->target_radii, self->targets, flights);
+
+    OptimizerSystemResult *result = (OptimizerSystemResult *)malloc(sizeof(OptimizerSystemResult) + sizeof(double) * self->targets);
+    for(unsigned t=0; t<self->targets; t++)
+        result->target_fitness[t] = optimizer_fitness(&flights[t].system);
+    result->throttle_program = system->throttle_program;
+    result->altitude_angle_program = system->altitude_angle_program;
+    result->fitness = result->target_fitness[self->targets-1];
+    result->seconds = optimizer_thread_clock() - start;
+    result->ticks = ticks;
+
+    free(flights);
+    return result;
+}
+
+void optimizer_run_systems(Optimizer *self, System **systems, size_t count, OptimizerSystemResult **results) {
+    //At most workers threads, each taking the next system as it finishes one.
+    unsigned workers = self->workers;
+    if(workers > count)
+        workers = (unsigned)count;
+    if(workers == 0)
+        return;
+
+    OptimizerJobs jobs;
+    jobs.optimizer = self;
+    jobs.systems = systems;
+    jobs.results = results;
+    jobs.count = count;
+    atomic_init(&jobs.next, 0);
+    jobs.first = self->evaluations;
+
+    double start = optimizer_clock();
+    uint64_t trace_start = trace_now();
+    pthread_t *threads = (pthread_t *)malloc(sizeof(pthread_t) * workers);
+    OptimizerJob *job = (OptimizerJob *)malloc(sizeof(OptimizerJob) * workers);
+    for(unsigned i=0; i<workers; i++) {
+        job[i].jobs = &jobs;
+        job[i].worker = i;
+        job[i].finished = 0;
+        pthread_create(&threads[i], NULL, (pthread_func)optimizer_run_job, &job[i]);
     }
+    for(unsigned i=0; i<workers; i++)
+        pthread_join(threads[i], NULL);
 
-    return systems;
+    //Each worker's wait for the slowest is only known now.
+    uint64_t joined = trace_now();
+    trace_span("join", trace_start);
+    for(unsigned i=0; i<workers; i++)
+        trace_worker_span(i, "barrier wait", job[i].finished, joined);
+    free(job);
+    free(threads);
+    double elapsed = optimizer_clock() - start;
+
+    //What the threads did not spend simulating, they spent starting up or waiting on the last system.
+    double busy = 0.0;
+    for(size_t i=0; i<count; i++)
+        busy += results[i]->seconds;
+    self->evaluations += count;
+    self->busy_seconds += busy;
+    self->barrier_seconds += workers * elapsed;
+    if(workers * elapsed > busy)
+        self->idle_seconds += workers * elapsed - busy;
+    if(workers > self->threads)
+        self->threads = workers;
 }
 
-void optimizer_destroy_systems(System **systems) {
-    for(size_t i=0; i<OPTIMIZER_CHILDREN; i++) {
-        rocket_dealloc(systems[i]->rocket);
-        program_dealloc( (Program *)(systems[i]->throttle_program) ); //Cast from const to non-const for this call.
-        program_dealloc( (Program *)(systems[i]->altitude_angle_program) ); //Cast rom const to non-const for this call.
-        system_dealloc(systems[i]);
+/*
+ * Parallel tempering: each replica is a Metropolis chain at its own
+ * temperature T, on its own thread, that mutates its own programs and moves
+ * to the mutant with probability min(1, exp((mutant - current)/T)), so the
+ * hot ones wander across the failures and steps that trap a hill climber and
+ * the cold ones refine.  Every exchange interval steps, neighbouring replicas
+ * (alternately the even and odd pairs) offer to swap states, accepted with
+ * probability min(1, exp((1/T_i - 1/T_j)(fitness_j - fitness_i))), so good
+ * states find their way down to the cold end.
+ *
+ * The search is over the same evaluations as generations x children, and the
+ * best of every replica's flights is kept.  Each replica's rng is drawn from
+ * the optimizer's, so a seeded run repeats at any thread timing.  The best is
+ * only known after the run, so checkpoints are written at the end only.
+ */
+double optimizer_run_tempering(Optimizer *self) {
+    unsigned replicas = self->tempering_replicas;
+    assert(replicas > 0 && replicas <= OPTIMIZER_MAX_REPLICAS);
+    assert(self->tempering_min_temperature > 0.0 && self->tempering_max_temperature >= self->tempering_min_temperature);
+    assert(self->tempering_exchange_interval > 0);
+
+    unsigned long total = (unsigned long)(self->generations - self->generation) * self->children;
+    unsigned long steps = (total + replicas - 1) / replicas;
+
+    OptimizerTemperingShared shared;
+    atomic_init(&shared.evaluations, 0);
+    uint64_t bits;
+    memcpy(&bits, &self->best_fitness, sizeof(bits));
+    atomic_init(&shared.best_fitness_bits, bits);
+
+    OptimizerReplica *replica = (OptimizerReplica *)malloc(sizeof(OptimizerReplica) * replicas);
+    OptimizerTemperingExchange *exchange = (OptimizerTemperingExchange *)malloc(sizeof(OptimizerTemperingExchange) * replicas);
+    for(unsigned i=0; i<replicas; i++) {
+        OptimizerReplica *r = &replica[i];
+        r->optimizer = self;
+        r->shared = &shared;
+        r->index = i;
+        r->temperature = optimizer_tempering_temperature(self, i);
+        r->steps = steps;
+        r->exchange_interval = self->tempering_exchange_interval;
+        r->colder = (i > 0) ? &exchange[i-1] : NULL;
+        r->hotter = (i+1 < replicas) ? &exchange[i] : NULL;
+        rng_init(&r->rng, rng_next(&self->rng));
+
+        r->state.throttle_program = program_init_copy(program_alloc(), self->best_throttle_program);
+        r->state.altitude_angle_program = program_init_copy(program_alloc(), self->best_altitude_angle_program);
+        if(self->genome_table)
+            memcpy(r->state.genes, self->best_genome, self->genome_table->genes);
+        r->state.fitness = self->best_fitness;
+        r->best_throttle_program = NULL;
+        r->best_altitude_angle_program = NULL;
+        r->best_fitness = self->best_fitness;
+        r->moves = 0;
+        r->accepted = 0;
+        r->seconds = 0.0;
+    }
+    for(unsigned i=0; i+1<replicas; i++) {
+        atomic_init(&exchange[i].offer, NULL);
+        rng_init(&exchange[i].rng, rng_next(&self->rng));
+        exchange[i].colder_beta = 1.0/replica[i].temperature;
+        exchange[i].hotter_beta = 1.0/replica[i+1].temperature;
+        exchange[i].attempts = 0;
+        exchange[i].swaps = 0;
+    }
+
+    pthread_t *threads = (pthread_t *)malloc(sizeof(pthread_t) * replicas);
+    for(unsigned i=0; i<replicas; i++)
+        pthread_create(&threads[i], NULL, (pthread_func)optimizer_replica_run, &replica[i]);
+
+    //Report a generation per children evaluations while the replicas run.
+    unsigned first = self->generation;
+    unsigned long first_evaluation = self->evaluations;
+    unsigned long evaluations = 0;
+    while(evaluations < steps * replicas) {
+        struct timespec poll = {0, (long)(OPTIMIZER_TEMPERING_POLL_SECONDS * 1e9)};
+        nanosleep(&poll, NULL);
+        evaluations = atomic_load(&shared.evaluations);
+        self->evaluations = first_evaluation + evaluations;
+        bits = atomic_load(&shared.best_fitness_bits);
+        memcpy(&self->best_fitness, &bits, sizeof(bits));
+        while(self->generation < self->generations && self->generation < first + evaluations / self->children) {
+            self->generation++;
+            if(!self->quiet) {
+                printf(".");
+                fflush(stdout);
+            }
+            optimizer_report_progress(self, replicas);
+        }
+    }
+    for(unsigned i=0; i<replicas; i++)
+        pthread_join(threads[i], NULL);
+    free(threads);
+
+    //Keep the best of all the replicas.
+    for(unsigned i=0; i<replicas; i++) {
+        OptimizerReplica *r = &replica[i];
+        if(r->best_throttle_program) {
+            OptimizerSystemResult result = {r->best_fitness, 0.0, 0, r->best_throttle_program, r->best_altitude_angle_program};
+            optimizer_keep_if_best(self, &result);
+            program_dealloc(r->best_throttle_program);
+            program_dealloc(r->best_altitude_angle_program);
+        }
+        program_dealloc(r->state.throttle_program);
+        program_dealloc(r->state.altitude_angle_program);
+
+        self->tempering_moves[i] += r->moves;
+        self->tempering_accepted[i] += r->accepted;
+        self->busy_seconds += r->seconds;
+        if(i+1 < replicas) {
+            self->tempering_swap_attempts[i] += exchange[i].attempts;
+            self->tempering_swaps[i] += exchange[i].swaps;
+        }
+    }
+    self->evaluations = first_evaluation + steps * replicas;
+    free(exchange);
+    free(replica);
+
+    if(replicas > self->threads)
+        self->threads = replicas;
+    self->generation = self->generations;
+    return self->best_fitness;
+}
+
+static void *optimizer_replica_run(OptimizerReplica *replica) {
+    const Optimizer *optimizer = replica->optimizer;
+    OptimizerTemperingState *state = &replica->state;
+    perf_thread_begin(replica->index, PERF_STAGE_EVALUATE);
+    trace_thread_begin(replica->index);
+
+    for(unsigned long step=0; step<replica->steps; step++) {
+        Program *throttle_program, *altitude_angle_program;
+        uint8_t genes[GENOME_MAX_GENES];
+        optimizer_mutate(optimizer, state->throttle_program, state->altitude_angle_program, state->genes, &replica->rng, &throttle_program, &altitude_angle_program, genes);
+        System *system = optimizer_make_system(optimizer, throttle_program, altitude_angle_program);
+
+        uint64_t start = trace_now();
+        OptimizerSystemResult *result = optimizer_evaluate(optimizer, system);
+        trace_evaluation(start, replica->index * replica->steps + step, result->ticks, result->fitness);
+        optimizer_record(optimizer, replica->index, result);
+        replica->seconds += result->seconds;
+        double fitness = result->fitness;
+        free(result);
+        rocket_dealloc(system->rocket);
+        system_dealloc(system);
+
+        if(fitness > replica->best_fitness) {
+            if(replica->best_throttle_program) {
+                program_dealloc(replica->best_throttle_program);
+                program_dealloc(replica->best_altitude_angle_program);
+            }
+            replica->best_throttle_program = program_init_copy(program_alloc(), throttle_program);
+            replica->best_altitude_angle_program = program_init_copy(program_alloc(), altitude_angle_program);
+            replica->best_fitness = fitness;
+            optimizer_tempering_publish(replica->shared, fitness);
+        }
+
+        //Failed flights (-INFINITY) are never moved to, unless from another.
+        replica->moves++;
+        bool accept = fitness >= state->fitness;
+        if(!accept && isfinite(fitness))
+            accept = rng_double(&replica->rng) < exp((fitness - state->fitness) / replica->temperature);
+        if(accept) {
+            replica->accepted++;
+            program_dealloc(state->throttle_program);
+            program_dealloc(state->altitude_angle_program);
+            state->throttle_program = throttle_program;
+            state->altitude_angle_program = altitude_angle_program;
+            if(optimizer->genome_table)
+                memcpy(state->genes, genes, optimizer->genome_table->genes);
+            state->fitness = fitness;
+        } else {
+            program_dealloc(throttle_program);
+            program_dealloc(altitude_angle_program);
+        }
+        atomic_fetch_add(&replica->shared->evaluations, 1);
+
+        //Even rounds pair replicas 2k and 2k+1, odd rounds 2k+1 and 2k+2.
+        if((step+1) % replica->exchange_interval == 0) {
+            unsigned long round = (step+1) / replica->exchange_interval;
+            bool colder = (replica->index % 2) == (round % 2);
+            OptimizerTemperingExchange *exchange = colder ? replica->hotter : replica->colder;
+            if(exchange) {
+                uint64_t start = trace_now();
+                optimizer_tempering_exchange(exchange, state, colder);
+                trace_span("exchange", start);
+            }
+        }
+    }
+
+    trace_thread_end();
+    perf_thread_end();
+    return NULL;
+}
+
+//Offers the state for a swap with the neighbour, waiting for it if first; colder if this is replica i of the pair.
+static void optimizer_tempering_exchange(OptimizerTemperingExchange *exchange, OptimizerTemperingState *state, bool colder) {
+    OptimizerTemperingOffer offer;
+    offer.state = *state;
+    atomic_init(&offer.decided, false);
+
+    OptimizerTemperingOffer *posted = NULL;
+    if(atomic_compare_exchange_strong(&exchange->offer, &posted, &offer)) {
+        while(!atomic_load_explicit(&offer.decided, memory_order_acquire))
+            sched_yield();
+        *state = offer.state;
+        return;
+    }
+
+    //The neighbour is waiting on its offer; clear the slot for the next round before releasing it.
+    atomic_store(&exchange->offer, NULL);
+    OptimizerTemperingState *colder_state = colder ? state : &posted->state;
+    OptimizerTemperingState *hotter_state = colder ? &posted->state : state;
+    double log_ratio = (exchange->colder_beta - exchange->hotter_beta) * (hotter_state->fitness - colder_state->fitness);
+    exchange->attempts++;
+    if(log_ratio >= 0.0 || rng_double(&exchange->rng) < exp(log_ratio)) {
+        OptimizerTemperingState swap = *colder_state;
+        *colder_state = *hotter_state;
+        *hotter_state = swap;
+        exchange->swaps++;
     }
+    atomic_store_explicit(&posted->decided, true, memory_order_release);
+}
+
+//Raises the shared best fitness, for progress reports.
+static void optimizer_tempering_publish(OptimizerTemperingShared *shared, double fitness) {
+    uint64_t bits = atomic_load(&shared->best_fitness_bits);
+    double best;
+    memcpy(&best, &bits, sizeof(best));
+    uint64_t fitness_bits;
+    memcpy(&fitness_bits, &fitness, sizeof(fitness_bits));
+    while(fitness > best && !atomic_compare_exchange_weak(&shared->best_fitness_bits, &bits, fitness_bits))
+        memcpy(&best, &bits, sizeof(best));
+}
+
+//Spaced geometrically from the min for the first replica to the max for the last.
+double optimizer_tempering_temperature(const Optimizer *self, unsigned replica) {
+    if(self->tempering_replicas < 2)
+        return self->tempering_min_temperature;
+    double ratio = self->tempering_max_temperature / self->tempering_min_temperature;
+    return self->tempering_min_temperature * pow(ratio, (double)replica / (self->tempering_replicas - 1));
+}
+
+double optimizer_tempering_acceptance(const Optimizer *self, unsigned replica) {
+    if(replica >= OPTIMIZER_MAX_REPLICAS || self->tempering_moves[replica] == 0)
+        return NAN;
+    return (double)self->tempering_accepted[replica] / self->tempering_moves[replica];
+}
+
+double optimizer_tempering_swap_rate(const Optimizer *self, unsigned pair) {
+    if(pair >= OPTIMIZER_MAX_REPLICAS || self->tempering_swap_attempts[pair] == 0)
+        return NAN;
+    return (double)self->tempering_swaps[pair] / self->tempering_swap_attempts[pair];
+}
+
+double optimizer_halving_correlation(const Optimizer *self, unsigned rung) {
+    if(rung >= OPTIMIZER_MAX_RUNGS || self->halving_correlation_count[rung] == 0)
+        return NAN;
+    return self->halving_correlation_sum[rung] / self->halving_correlation_count[rung];
+}
+
+/*
+ * Spearman's rank correlation: the Pearson correlation of the ranks, with ties
+ * given their average rank.  Returns NAN if either ordering is constant.
+ */
+double optimizer_rank_correlation(const double *x, const double *y, size_t count) {
+    if(count < 2)
+        return NAN;
+
+    double *x_ranks = (double *)malloc(sizeof(double) * count);
+    double *y_ranks = (double *)malloc(sizeof(double) * count);
+    optimizer_ranks(x, count, x_ranks);
+    optimizer_ranks(y, count, y_ranks);
+
+    //Both rank sets have the same mean, (count+1)/2.
+    double mean = 0.5 * (count + 1.0);
+    double sxy = 0.0, sxx = 0.0, syy = 0.0;
+    for(size_t i=0; i<count; i++) {
+        double dx = x_ranks[i] - mean;
+        double dy = y_ranks[i] - mean;
+        sxy += dx*dy;
+        sxx += dx*dx;
+        syy += dy*dy;
+    }
+
+    free(x_ranks);
+    free(y_ranks);
+
+    if(sxx == 0.0 || syy == 0.0)
+        return NAN;
+    return sxy / sqrt(sxx*syy);
+}
+
+static void optimizer_ranks(const double *values, size_t count, double *ranks) {
+    OptimizerRanked *ranked = (OptimizerRanked *)malloc(sizeof(OptimizerRanked) * count);
+    for(size_t i=0; i<count; i++) {
+        ranked[i].fitness = values[i];
+        ranked[i].index = i;
+    }
+    qsort(ranked, count, sizeof(OptimizerRanked), optimizer_ranked_compare_descending);
+
+    //Runs of equal values (including -INFINITY failures) share their average rank.
+    size_t i = 0;
+    while(i < count) {
+        size_t j = i+1;
+        while(j < count && ranked[j].fitness == ranked[i].fitness)
+            j++;
+        double rank = 0.5 * (i + j + 1);
+        for(size_t k=i; k<j; k++)
+            ranks[ranked[k].index] = rank;
+        i = j;
+    }
+
+    free(ranked);
+}
+
+static int optimizer_ranked_compare_descending(const void *a, const void *b) {
+    double fa = ((const OptimizerRanked *)a)->fitness;
+    double fb = ((const OptimizerRanked *)b)->fitness;
+    return (fa < fb) - (fa > fb);
+}
+
+System *optimizer_make_system(const Optimizer *self, const Program *throttle_program, const Program *altitude_angle_program) {
+    System *system = system_init(system_alloc());
+    system->planetoid = self->planetoid;
+    system->rocket = optimizer_make_rocket(self);
+    system->throttle_program = throttle_program;
+    system->altitude_angle_program = altitude_angle_program;
+    system->throttle_cutoff_radius = self->throttle_cutoff_radius;
+    system->kernel = self->kernel;
+    return system;
+}
+
+/*
+ * Ready a system to be run again from the launch pad at the given tick rate,
+ * keeping its rocket allocation and programs.
+ */
+void optimizer_reset_system(const Optimizer *self, System *system, double ticks_per_second) {
+    Rocket *rocket = system->rocket;
+    const Program *throttle_program = system->throttle_program;
+    const Program *altitude_angle_program = system->altitude_angle_program;
+
+    system_init(system);
+    system->planetoid = self->planetoid;
+    system->rocket = optimizer_prepare_rocket(self, rocket);
+    system->throttle_program = throttle_program;
+    system->altitude_angle_program = altitude_angle_program;
+    system->throttle_cutoff_radius = self->throttle_cutoff_radius;
+    system->kernel = self->kernel;
+    system->delta_t = 1.0/ticks_per_second;
+}
+
+System **optimizer_make_systems(Optimizer *self, size_t count) {
+    System **systems = (System **)malloc(sizeof(System *) * count);
+
+    for(size_t i=0; i<count; i++)
+        systems[i] = optimizer_make_mutant(self);
+
+    return systems;
+}
+
+void optimizer_destroy_systems(System **systems, size_t count) {
+    for(size_t i=0; i<count; i++)
+        optimizer_destroy_system(systems[i]);
     free(systems);
 }
 
-Program *optimizer_mutate_throttle_program(const Program *program) {
+void optimizer_destroy_system(System *system) {
+    rocket_dealloc(system->rocket);
+    program_dealloc( (Program *)(system->throttle_program) ); //Cast from const to non-const for this call.
+    program_dealloc( (Program *)(system->altitude_angle_program) ); //Cast rom const to non-const for this call.
+    system_dealloc(system);
+}
+
+Program *optimizer_mutate_throttle_program(const Program *program, Rng *rng) {
     //Copy the seed program.
     Program *mutant_program = program_init_copy(program_alloc(), program);
 
     //Choose a value to modify.
-    size_t i = rand() % program->length;
+    size_t i = rng_uniform(rng, program->length);
 
     //Choose a value for it between 0.0-1.0, with the given number of intervals.
-    double throttle = (double)(rand() % (THROTTLE_INTERVALS+1)) / (double)THROTTLE_INTERVALS;
+    double throttle = (double)rng_uniform(rng, THROTTLE_INTERVALS+1) / (double)THROTTLE_INTERVALS;
     assert(throttle >= 0.0);
     assert(throttle <= 1.0);
 
@@ -195,15 +1754,32 @@ Program *optimizer_mutate_throttle_program(const Program *program) {
     return mutant_program;
 }
 
-Program *optimizer_mutate_altitude_angle_program(const Program *program) {
+//A grid altitude strictly between the neighbouring breakpoints, or the current one if there is no room.
+static double optimizer_mutate_turn_altitude(const Program *program, size_t i, Rng *rng) {
+    double low = fmax(0.0, program->altitudes[i-1]);
+    double high = (i+1 < program->length) ? program->altitudes[i+1] : TURN_ALTITUDE_MAX + TURN_ALTITUDE_STEP;
+    unsigned first = (unsigned)floor(low / TURN_ALTITUDE_STEP) + 1;
+    unsigned last = (unsigned)ceil(high / TURN_ALTITUDE_STEP) - 1;
+    if(last < first)
+        return program->altitudes[i];
+    return TURN_ALTITUDE_STEP * (first + rng_uniform(rng, last - first + 1));
+}
+
+Program *optimizer_mutate_altitude_angle_program(const Program *program, Rng *rng) {
     //Copy the seed program.
     Program *mutant_program = program_init_copy(program_alloc(), program);
 
     //Choose a value to modify.
-    size_t i = rand() % program->length;
+    size_t i = rng_uniform(rng, program->length);
+
+    //A gravity turn has so few settings that its breakpoints are genes too.
+    if(program->kind == PROGRAM_KIND_GRAVITY_TURN && i > 0 && rng_uniform(rng, 2) == 0) {
+        mutant_program->altitudes[i] = optimizer_mutate_turn_altitude(program, i, rng);
+        return mutant_program;
+    }
 
     //Choose a value for it.
-    double altitude_angle = (M_PI/2.0) * ((double)(rand() % (ALTITUDE_ANGLE_INTERVALS+1)) / (double)ALTITUDE_ANGLE_INTERVALS);
+    double altitude_angle = (M_PI/2.0) * ((double)rng_uniform(rng, ALTITUDE_ANGLE_INTERVALS+1) / (double)ALTITUDE_ANGLE_INTERVALS);
     assert(altitude_angle >= 0.0);
     assert(altitude_angle <= M_PI/2.0);
 
@@ -214,6 +1790,15 @@ Program *optimizer_mutate_altitude_angle_program(const Program *program) {
     return mutant_program;
 }
 
+//Fills the rocket from the prototype if there is one, else from the factory.
+Rocket *optimizer_prepare_rocket(const Optimizer *self, Rocket *rocket) {
+    if(self->rocket_prototype) {
+        *rocket = *self->rocket_prototype;
+        return rocket;
+    }
+    return (Rocket *)self->rocket_factory_func(rocket);
+}
+
 Rocket *optimizer_make_rocket(const Optimizer *self) {
-    return (Rocket *)self->rocket_factory_func(rocket_alloc());
+    return optimizer_prepare_rocket(self, rocket_alloc());
 }
@@ -5,22 +5,67 @@
 #include "planetoid.h"
 #include "rocket.h"
 #include "system.h"
+#include "rng.h"
 
 #define OPTIMIZER_CHILDREN 16
 #define THROTTLE_INTERVALS 15 //15->indicator marks; N intervals means throttle settings will be in [0.0,1.0] with step 1/N.
 #define ALTITUDE_ANGLE_INTERVALS 18 //18->5 degrees; N intervals means throttle settings will be in [0.0,2*PI] with step 2*PI/N.
+#define TURN_ALTITUDE_STEP 250.0 //Grid for the breakpoint altitudes of gravity turn programs.
+#define TURN_ALTITUDE_MAX 20000.0
+
+#define OPTIMIZER_MAX_RUNGS 8
+#define OPTIMIZER_HALVING_POOL 64
+#define OPTIMIZER_HALVING_KEEP_FRACTION 0.25
+
+#define OPTIMIZER_CHECKPOINT_INTERVAL 16 //Generations between checkpoints.
+
+#define OPTIMIZER_BEAM_WIDTH 8 //Partial flights kept at each breakpoint by the beam search.
+#define OPTIMIZER_BEAM_ROLLOUT_TICKS_PER_SECOND 20.0 //Rate of the flights that score the partial ones.
+
+#define OPTIMIZER_MAX_REPLICAS 32
+#define OPTIMIZER_TEMPERING_REPLICAS 8
+#define OPTIMIZER_TEMPERING_MIN_TEMPERATURE 0.05 //Fitness (m/s) scale of the coldest replica; nearly greedy.
+#define OPTIMIZER_TEMPERING_MAX_TEMPERATURE 50.0 //Of the hottest; it takes a step 100 m/s down about one time in seven.
+#define OPTIMIZER_TEMPERING_EXCHANGE_INTERVAL 8 //Steps each replica takes between swap attempts.
+#define OPTIMIZER_TEMPERING_POLL_SECONDS 0.01 //Between progress reports while the replicas run.
+
+#define OPTIMIZER_MAX_TARGETS 16
 
 typedef void *(*InitFunc)(void *);
 
+struct Checkpointer;
+struct Library;
+struct Telemetry;
+struct Ensemble;
+struct GenomeTable;
+struct FitnessCache;
+struct WorkerPool;
+struct Kernel;
+struct Optimizer;
+
+typedef void (*OptimizerProgressFunc)(const struct Optimizer *optimizer, void *context);
+
+typedef enum OptimizerMode {
+    OPTIMIZER_MODE_GENERATIONAL=0, //Each generation runs children mutants at the reference tick rate.
+    OPTIMIZER_MODE_SUCCESSIVE_HALVING, //Each generation screens a large pool at coarse tick rates, promoting only the best.
+    OPTIMIZER_MODE_STEADY_STATE, //Workers pull mutants of the latest best from a queue; there is no generation barrier.
+    OPTIMIZER_MODE_BEAM, //Walk the breakpoints in order, trying every grid setting on the best partial flights.
+    OPTIMIZER_MODE_TEMPERING //Metropolis chains at a ladder of temperatures, a thread each, swapping states with their neighbours.
+} OptimizerMode;
+
 typedef struct OptimizerSystemResult {
     double fitness;
+    double seconds; //CPU time spent simulating.
+    unsigned long ticks;
     const Program *throttle_program;
     const Program *altitude_angle_program;
+    double target_fitness[]; //Per target, when the optimizer has targets; allocated with the result.
 } OptimizerSystemResult;
 
 typedef struct Optimizer {
     // The function to call to get a fresh rocket instance for simulation.
     InitFunc rocket_factory_func;
+    const Rocket *rocket_prototype; //If set, rockets are copies of this instead.
 
     const Planetoid *planetoid;
 
@@ -32,8 +77,103 @@ typedef struct Optimizer {
     Program *best_altitude_angle_program;
     double best_fitness;
 
+    // Set by optimizer_run when the best programs are on the mutation grid;
+    // mutants are then made and mutated as genomes against this shared table.
+    struct GenomeTable *genome_table;
+    uint8_t *best_genome;
+
     unsigned generation;
     unsigned generations;
+
+    OptimizerMode mode;
+
+    Rng rng; //Only used from the thread calling optimizer_run.
+
+    // When set, the search state is handed to it every checkpoint_interval generations.
+    struct Checkpointer *checkpointer;
+    unsigned checkpoint_interval;
+
+    // When set, the search is also seeded from past results for similar
+    // scenarios, and its result is added to the library.
+    struct Library *library;
+
+    // When set, workers record each evaluation into it for live monitoring.
+    struct Telemetry *telemetry;
+
+    // Successive halving: the pool is scored at halving_ticks_per_second[0],
+    // and the best halving_keep_fraction of each rung is promoted to the next.
+    // The last rung should be the reference rate, as only it can replace the best.
+    unsigned halving_pool;
+    unsigned halving_rungs;
+    double halving_ticks_per_second[OPTIMIZER_MAX_RUNGS];
+    double halving_keep_fraction;
+
+    // Sum and count of the Spearman rank correlation between the fitness of
+    // the promoted candidates at rung i and at rung i+1; used to tune the schedule.
+    double halving_correlation_sum[OPTIMIZER_MAX_RUNGS];
+    unsigned halving_correlation_count[OPTIMIZER_MAX_RUNGS];
+
+    // When set, every candidate is flown against the ensemble and scored by
+    // its robust fitness rather than by the single nominal flight.
+    const struct Ensemble *ensemble;
+
+    // When set, fitness is looked up by a hash of the scenario and programs
+    // before flying; it may be shared by any number of optimizers.
+    struct FitnessCache *cache;
+    uint64_t scenario_hash; //Set by optimizer_run.
+
+    // When set, systems are flown through this kernel built for the scenario
+    // wherever it accepts them (see kernel.h).
+    const struct Kernel *kernel;
+
+    // Beam search: the number of partial flights carried from one breakpoint to the next.
+    unsigned beam_width;
+
+    // Parallel tempering: the replicas' temperatures are spaced geometrically
+    // from the min to the max, and neighbours try to swap states every
+    // exchange interval steps.
+    unsigned tempering_replicas;
+    double tempering_min_temperature;
+    double tempering_max_temperature;
+    unsigned tempering_exchange_interval;
+
+    // Mutants tried and accepted by replica i, and swaps tried and made between replicas i and i+1.
+    unsigned long tempering_moves[OPTIMIZER_MAX_REPLICAS];
+    unsigned long tempering_accepted[OPTIMIZER_MAX_REPLICAS];
+    unsigned long tempering_swap_attempts[OPTIMIZER_MAX_REPLICAS];
+    unsigned long tempering_swaps[OPTIMIZER_MAX_REPLICAS];
+
+    // Multi-target: when targets is set, every candidate is flown once against
+    // all the target cutoff radii (ascending), forking where each cutoff fires
+    // (see targets.h).  Each target keeps its own incumbent, and a
+    // generation's mutants are made from the incumbents in turn.  The search
+    // is generational whatever the mode, flies the nominal rocket only, and is
+    // not cached.  The best programs and fitness are the highest target's.
+    unsigned targets;
+    double target_radii[OPTIMIZER_MAX_TARGETS];
+    Program *target_throttle_programs[OPTIMIZER_MAX_TARGETS];
+    Program *target_altitude_angle_programs[OPTIMIZER_MAX_TARGETS];
+    double target_fitness[OPTIMIZER_MAX_TARGETS];
+
+    // Mutants per generation; the steady-state mode counts a generation per this many evaluations.
+    unsigned children;
+
+    // The number of worker threads, unless running on a shared pool.
+    unsigned workers;
+    struct WorkerPool *pool;
+
+    // Called on the optimizer's thread after each generation's worth of evaluations.
+    OptimizerProgressFunc progress_func;
+    void *progress_context;
+    bool quiet; //Print nothing to stdout.
+
+    // Throughput accounting, accumulated over runs.
+    unsigned long evaluations;
+    double wall_seconds;
+    double busy_seconds; //Summed over all threads.
+    double barrier_seconds; //Thread time in optimizer_run_systems, simulating or not.
+    double idle_seconds; //Of barrier_seconds, not simulating.
+    unsigned threads; //Most threads simulating at once.
 } Optimizer;
 
 Optimizer *optimizer_alloc(void);
@@ -41,15 +181,42 @@ void optimizer_dealloc(Optimizer *self);
 Optimizer *optimizer_init(Optimizer *self);
 
 double optimizer_run(Optimizer *self);
+bool optimizer_resume(Optimizer *self, const char *path);
+void optimizer_checkpoint(const Optimizer *self);
+bool optimizer_warm_start(Optimizer *self);
+void optimizer_library_features(const Optimizer *self, double *features);
 
 double optimizer_run_generation(Optimizer *self);
+double optimizer_run_halving_generation(Optimizer *self);
+double optimizer_run_steady_state(Optimizer *self);
+double optimizer_run_beam(Optimizer *self);
+double optimizer_run_tempering(Optimizer *self);
+double optimizer_run_targets_generation(Optimizer *self);
+bool optimizer_set_targets(Optimizer *self, const double *cutoff_radii, unsigned count);
 OptimizerSystemResult *optimizer_run_system(System *system); //Must be p_thread thread_function compliant sig.
+OptimizerSystemResult *optimizer_run_ensemble(System *system, const struct Ensemble *ensemble);
+OptimizerSystemResult *optimizer_run_targets(const Optimizer *self, System *system);
+double optimizer_fitness(const System *system);
+void optimizer_run_systems(Optimizer *self, System **systems, size_t count, OptimizerSystemResult **results);
+
+double optimizer_utilization(const Optimizer *self);
+double optimizer_idle_fraction(const Optimizer *self);
+
+double optimizer_halving_correlation(const Optimizer *self, unsigned rung);
+double optimizer_tempering_temperature(const Optimizer *self, unsigned replica);
+double optimizer_tempering_acceptance(const Optimizer *self, unsigned replica);
+double optimizer_tempering_swap_rate(const Optimizer *self, unsigned pair);
+double optimizer_rank_correlation(const double *x, const double *y, size_t count);
 
-System **optimizer_make_systems(const Optimizer *self);
-void optimizer_destroy_systems(System **systems);
+System *optimizer_make_system(const Optimizer *self, const Program *throttle_program, const Program *altitude_angle_program);
+void optimizer_reset_system(const Optimizer *self, System *system, double ticks_per_second);
+System **optimizer_make_systems(Optimizer *self, size_t count);
+void optimizer_destroy_systems(System **systems, size_t count);
+void optimizer_destroy_system(System *system);
+Rocket *optimizer_prepare_rocket(const Optimizer *self, Rocket *rocket);
 Rocket *optimizer_make_rocket(const Optimizer *self);
-Program *optimizer_mutate_throttle_program(const Program *program);
-Program *optimizer_mutate_altitude_angle_program(const Program *program);
+Program *optimizer_mutate_throttle_program(const Program *program, Rng *rng);
+Program *optimizer_mutate_altitude_angle_program(const Program *program, Rng *rng);
 Program *optimizer_make_copy_program(const Program *program);
 
 #endif
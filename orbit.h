@@ -0,0 +1,49 @@
+#ifndef KERBAL_LAUNCH_ORBIT_H
+#define KERBAL_LAUNCH_ORBIT_H
+
+#include <stdbool.h>
+#include <math.h>
+
+/*
+ * Orbit math on specific energy and angular momentum; header-only and static
+ * inline like vector.h, as the apses are computed every tick.
+ */
+
+static inline double orbit_eccentricity(double gravitational_parameter, double angular_momentum, double energy) {
+    double numerator = 2.0 * angular_momentum * angular_momentum * energy;
+    double denominator = gravitational_parameter * gravitational_parameter;
+
+    double radicand = 1.0 + numerator/denominator;
+    // Sometimes rounding errors on near circular orbits make the radicand negative when it should be near zero.
+    if(radicand < 0.0)
+        radicand = 0.0;
+
+    return sqrt(radicand);
+}
+
+/*
+ * Given an angular momentum and an energy, Calculate the periapsis and apopais radius.
+ * The return is true if the orbit is closed; the result is placed in the passed pointers.
+ * If the orbit is open, false is passed and the values of periapsis abd apoapsis are not defined.
+ *
+ * For closed orbits, the periapsis and apoapsis are as expected.
+ * For open orbits, the apoapsis is a negative value that approaches zero as the exces velocity increases.
+ * For hyperbolic orbits, the apoapsis is infinite.
+ */
+static inline bool orbit_apses(double gravitational_parameter, double angular_momentum, double energy, double *periapsis, double *apoapsis) {
+    if(energy == 0.0) {
+        *apoapsis = INFINITY;
+        *periapsis = angular_momentum*angular_momentum / (2.0*gravitational_parameter);
+        return false;
+    }
+
+    double eccentricity = orbit_eccentricity(gravitational_parameter, angular_momentum, energy);
+    double semimajor_axis = -(gravitational_parameter)/(2.0*energy);
+
+    *periapsis = semimajor_axis * (1.0 - eccentricity);
+    *apoapsis = semimajor_axis * (1.0 + eccentricity);
+
+    return (energy > 0.0) ? false : true;
+}
+
+#endif
@@ -0,0 +1,411 @@
+#include <stdlib.h>
+#include <assert.h>
+#include <math.h>
+#include <float.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "parareal.h"
+
+typedef void *(*pthread_func)(void *);
+
+//One time slice, with the fine flight last made over it.
+typedef struct PararealSlice {
+    unsigned long first_tick;
+    unsigned long ticks;
+    PararealState start;
+    PararealState fine; //Fine state at the end of the slice, from start.
+    PararealState coarse; //Coarse state at the end of the slice, from start.
+    bool ended; //The fine flight ended within the slice.
+
+    System system;
+    Rocket rocket;
+    Frame frame;
+} PararealSlice;
+
+//What can change the controls discontinuously: the throttle cutoff and the step tables' segments.
+typedef struct PararealSwitches {
+    bool cutoff;
+    size_t throttle_segment;
+    size_t altitude_angle_segment;
+} PararealSwitches;
+
+//A fine sweep over slices [next, count); workers claim slices by index.
+typedef struct PararealSweep {
+    const System *template;
+    PararealSlice *slices;
+    size_t count;
+    atomic_size_t next;
+    atomic_ulong ticks;
+} PararealSweep;
+
+static bool parareal_propagate(const System *template, PararealState *state, double delta_t, unsigned long first_tick, unsigned long ticks, bool coarse, System *system, Rocket *rocket, Frame *frame);
+static bool parareal_coarse_step(System *system);
+static void parareal_run_part(System *system, const Rocket *before, double duration);
+static void parareal_hold_apoapsis(System *system, double duration);
+static double parareal_burn_then_coast(System *system, const Rocket *start, double fraction, double duration);
+static PararealSwitches parareal_switches(const System *system);
+static bool parareal_same_switches(const PararealSwitches *a, const PararealSwitches *b);
+static void parareal_sweep(Parareal *self, const System *template, PararealSlice *slices, size_t first, size_t count);
+static void *parareal_worker(PararealSweep *sweep);
+static PararealState parareal_state(const Rocket *rocket);
+static double parareal_distance(const PararealState *a, const PararealState *b);
+
+Parareal *parareal_alloc(void) {
+    return (Parareal *)malloc(sizeof(Parareal));
+}
+
+void parareal_dealloc(Parareal *self) {
+    free(self);
+}
+
+Parareal *parareal_init(Parareal *self, unsigned workers) {
+    assert(workers > 0);
+    self->workers = workers;
+    self->slices = workers;
+    self->coarse_ticks_per_second = PARAREAL_COARSE_TICKS_PER_SECOND;
+    self->tolerance = 0.0;
+    self->max_iterations = 0;
+
+    self->iterations = 0;
+    self->converged = false;
+    self->fine_ticks = 0;
+    self->coarse_ticks = 0;
+    return self;
+}
+
+/*
+ * Runs the system as system_run would, leaving its rocket, ticks, state and
+ * stats as a serial run at its tick rate leaves them.  Returns whether the
+ * slice boundaries agreed to within the tolerance (or were exact) at the end.
+ */
+bool parareal_run(Parareal *self, System *system) {
+    assert(system->rocket);
+    assert(system->planetoid);
+    assert(system->throttle_program);
+    assert(system->altitude_angle_program);
+    assert(system->state == SYSTEM_STATE_READY);
+    assert(self->slices > 0);
+
+    size_t count = self->slices;
+    unsigned max_iterations = (self->max_iterations == 0 || self->max_iterations > count) ? (unsigned)count : self->max_iterations;
+    double fine_delta_t = system->delta_t;
+    double tolerance = (self->tolerance > 0.0) ? self->tolerance : PARAREAL_TOLERANCE_SPEED * fine_delta_t;
+    PararealSlice *slices = (PararealSlice *)malloc(sizeof(PararealSlice) * count);
+    self->iterations = 0;
+    self->converged = false;
+    self->fine_ticks = 0;
+    self->coarse_ticks = 0;
+
+    //Size the slices from a coarse flight of the whole mission.
+    System coarse;
+    Rocket coarse_rocket;
+    Frame coarse_frame;
+    double coarse_delta_t = 1.0/self->coarse_ticks_per_second;
+    PararealState state = parareal_state(system->rocket);
+    unsigned long limit = (unsigned long)ceil(SYSTEM_MAX_MISSION_TIME/coarse_delta_t) + 1;
+    parareal_propagate(system, &state, coarse_delta_t, 0, limit, true, &coarse, &coarse_rocket, &coarse_frame);
+    self->coarse_ticks += coarse.ticks;
+    double horizon = fmin(system_time(&coarse) * PARAREAL_HORIZON_MARGIN, SYSTEM_MAX_MISSION_TIME) + coarse_delta_t;
+
+    unsigned long slice_ticks = (unsigned long)ceil(horizon/fine_delta_t/count);
+    if(slice_ticks == 0)
+        slice_ticks = 1;
+    double slice_seconds = slice_ticks * fine_delta_t;
+    unsigned long coarse_slice_ticks = (unsigned long)lround(slice_seconds * self->coarse_ticks_per_second);
+    if(coarse_slice_ticks == 0)
+        coarse_slice_ticks = 1;
+    coarse_delta_t = slice_seconds / coarse_slice_ticks;
+
+    //The first coarse sweep proposes every slice's start.
+    state = parareal_state(system->rocket);
+    for(size_t n=0; n<count; n++) {
+        PararealSlice *slice = &slices[n];
+        slice->first_tick = n * slice_ticks;
+        slice->ticks = slice_ticks;
+        slice->start = state;
+        parareal_propagate(system, &state, coarse_delta_t, n * coarse_slice_ticks, coarse_slice_ticks, true, &coarse, &coarse_rocket, &coarse_frame);
+        self->coarse_ticks += coarse.ticks - n * coarse_slice_ticks;
+        slice->coarse = state;
+    }
+
+    //After iteration k the starts of slices [0, k] are exact, so only the rest are refined.
+    for(size_t k=0; k<max_iterations; k++) {
+        parareal_sweep(self, system, slices, k, count);
+        self->iterations++;
+
+        double change = 0.0;
+        for(size_t n=k; n+1<count; n++) {
+            //Slice k's start did not move, so its end is exactly the fine state.
+            PararealState start = slices[n].fine;
+            if(n > k) {
+                //Correct the coarse prediction from the new start by the last fine-coarse difference.
+                state = slices[n].start;
+                unsigned long first_coarse_tick = n * coarse_slice_ticks;
+                parareal_propagate(system, &state, coarse_delta_t, first_coarse_tick, coarse_slice_ticks, true, &coarse, &coarse_rocket, &coarse_frame);
+                self->coarse_ticks += coarse.ticks - first_coarse_tick;
+
+                start.position = vector_rect(
+                    VX(state.position) + VX(slices[n].fine.position) - VX(slices[n].coarse.position),
+                    VY(state.position) + VY(slices[n].fine.position) - VY(slices[n].coarse.position)
+                );
+                start.velocity = vector_rect(
+                    VX(state.velocity) + VX(slices[n].fine.velocity) - VX(slices[n].coarse.velocity),
+                    VY(state.velocity) + VY(slices[n].fine.velocity) - VY(slices[n].coarse.velocity)
+                );
+                start.mass = state.mass + slices[n].fine.mass - slices[n].coarse.mass;
+                slices[n].coarse = state;
+            }
+
+            change = fmax(change, parareal_distance(&start, &slices[n+1].start));
+            slices[n+1].start = start;
+        }
+
+        if(change <= tolerance || k+1 == count) {
+            self->converged = true;
+            break;
+        }
+    }
+
+    //The flight ends in the first slice whose fine flight ended; past the horizon, finish the last one serially.
+    size_t last = 0;
+    while(last+1 < count && !slices[last].ended)
+        last++;
+    PararealSlice *terminal = &slices[last];
+    if(!terminal->ended) {
+        unsigned long first_tick = terminal->system.ticks;
+        while(system_step(&terminal->system))
+            ;
+        system_finish(&terminal->system);
+        self->fine_ticks += terminal->system.ticks - first_tick;
+    }
+
+    //Hand the result back as a serial run leaves it.
+    Statistics stats = terminal->system.stats;
+    if(terminal->system.ticks == terminal->first_tick && last > 0)
+        stats.frame = slices[last-1].frame; //Ended on the boundary; the previous slice flew the last tick.
+    if(system->collect_stats) {
+        for(size_t n=0; n<last; n++) {
+            stats.distance_travelled += slices[n].system.stats.distance_travelled;
+            stats.delta_v_thrust += slices[n].system.stats.delta_v_thrust;
+            stats.delta_v_drag += slices[n].system.stats.delta_v_drag;
+            stats.delta_v_gravity += slices[n].system.stats.delta_v_gravity;
+            stats.work_thrust += slices[n].system.stats.work_thrust;
+            stats.work_drag += slices[n].system.stats.work_drag;
+            stats.work_gravity += slices[n].system.stats.work_gravity;
+        }
+    }
+    system->stats = stats;
+    *system->rocket = terminal->rocket;
+    system->ticks = terminal->system.ticks;
+    system->state = terminal->system.state;
+    system->frame = NULL;
+
+    free(slices);
+    return self->converged;
+}
+
+//Flies the fine propagator over slices [first, count) on the workers.
+static void parareal_sweep(Parareal *self, const System *template, PararealSlice *slices, size_t first, size_t count) {
+    PararealSweep sweep;
+    sweep.template = template;
+    sweep.slices = slices;
+    sweep.count = count;
+    atomic_init(&sweep.next, first);
+    atomic_init(&sweep.ticks, 0);
+
+    unsigned threads = (count - first < self->workers) ? (unsigned)(count - first) : self->workers;
+    pthread_t *thread_ids = (pthread_t *)malloc(sizeof(pthread_t) * threads);
+    for(unsigned t=1; t<threads; t++)
+        pthread_create(&thread_ids[t], NULL, (pthread_func)parareal_worker, &sweep);
+    parareal_worker(&sweep);
+    for(unsigned t=1; t<threads; t++)
+        pthread_join(thread_ids[t], NULL);
+    free(thread_ids);
+
+    self->fine_ticks += atomic_load(&sweep.ticks);
+}
+
+static void *parareal_worker(PararealSweep *sweep) {
+    double delta_t = sweep->template->delta_t;
+    size_t n;
+    while((n = atomic_fetch_add(&sweep->next, 1)) < sweep->count) {
+        PararealSlice *slice = &sweep->slices[n];
+        slice->fine = slice->start;
+        slice->ended = parareal_propagate(sweep->template, &slice->fine, delta_t, slice->first_tick, slice->ticks, false, &slice->system, &slice->rocket, &slice->frame);
+        atomic_fetch_add(&sweep->ticks, slice->system.ticks - slice->first_tick);
+    }
+    return NULL;
+}
+
+/*
+ * Flies the template's rocket and programs from the state for up to ticks
+ * ticks of delta_t, with the clock starting at first_tick, and leaves the end
+ * state in state.  Returns true if the flight ended (and was finished).  The
+ * fine propagator is exactly system_step; the coarse one is
+ * parareal_coarse_step.
+ */
+static bool parareal_propagate(const System *template, PararealState *state, double delta_t, unsigned long first_tick, unsigned long ticks, bool coarse, System *system, Rocket *rocket, Frame *frame) {
+    *rocket = *template->rocket;
+    rocket->position = state->position;
+    rocket->velocity = state->velocity;
+    rocket->mass = state->mass;
+
+    system_init(system);
+    system->rocket = rocket;
+    system->planetoid = template->planetoid;
+    system->throttle_program = template->throttle_program;
+    system->altitude_angle_program = template->altitude_angle_program;
+    system->throttle_cutoff_radius = template->throttle_cutoff_radius;
+    system->collect_stats = template->collect_stats && !coarse;
+    system->delta_t = delta_t;
+    system->ticks = first_tick;
+
+    system_start(system, frame);
+    unsigned long end = first_tick + ticks;
+    while(system->ticks < end && (coarse ? parareal_coarse_step(system) : system_step(system)))
+        ;
+    bool ended = system->state != SYSTEM_STATE_RUNNING;
+    if(ended)
+        system_finish(system);
+
+    *state = parareal_state(rocket);
+    return ended;
+}
+
+/*
+ * system_step, except that a switch of the controls (the throttle cutoff, a
+ * step breakpoint) within the tick is found by bisection and the tick split
+ * there, so that the end state moves smoothly with the start; a switch that
+ * jumps a whole coarse tick makes the corrections noisy and stalls the
+ * iteration.  Past the cutoff, while drag still lowers the apoapsis, the fine
+ * flight chatters about it with single-tick burns; a coarse tick models that
+ * as the burn then coast that ends it at the cutoff apoapsis.
+ */
+static bool parareal_coarse_step(System *system) {
+    Rocket before = *system->rocket;
+    PararealSwitches switches = parareal_switches(system);
+    unsigned long ticks = system->ticks;
+    double delta_t = system->delta_t;
+    if(!system_step(system))
+        return false;
+
+    PararealSwitches after = parareal_switches(system);
+    if(parareal_same_switches(&after, &switches))
+        return true;
+
+    double low = 0.0, high = 1.0;
+    for(int i=0; i<PARAREAL_SWITCH_BISECTIONS; i++) {
+        double middle = 0.5*(low + high);
+        parareal_run_part(system, &before, middle * delta_t);
+        after = parareal_switches(system);
+        if(parareal_same_switches(&after, &switches))
+            low = middle;
+        else
+            high = middle;
+    }
+
+    //Up to the switch with the old controls, then the rest with the new.
+    parareal_run_part(system, &before, high * delta_t);
+    after = parareal_switches(system);
+    if(after.cutoff != switches.cutoff) {
+        parareal_hold_apoapsis(system, (1.0 - high) * delta_t);
+    } else {
+        system->delta_t = (1.0 - high) * delta_t;
+        system_run_one_tick(system);
+    }
+    system->ticks = ticks+1;
+    system->delta_t = delta_t;
+    return true;
+}
+
+//Reruns the tick from before for duration seconds.
+static void parareal_run_part(System *system, const Rocket *before, double duration) {
+    *system->rocket = *before;
+    system->delta_t = duration;
+    system_run_one_tick(system);
+    system->ticks--;
+}
+
+/*
+ * Runs duration seconds from the cutoff apoapsis as a burn at the programmed
+ * throttle then a coast, with the fraction of burn (found by regula falsi,
+ * the end apoapsis being nearly linear in it) that ends at the cutoff again.
+ */
+static void parareal_hold_apoapsis(System *system, double duration) {
+    Rocket start = *system->rocket;
+    double low = 0.0, high = 1.0;
+    double low_error = parareal_burn_then_coast(system, &start, low, duration);
+    if(low_error >= 0.0)
+        return; //Coasting holds it.
+    double high_error = parareal_burn_then_coast(system, &start, high, duration);
+    if(high_error <= 0.0)
+        return; //Burning cannot.
+
+    for(int i=0; i<PARAREAL_HOLD_ITERATIONS; i++) {
+        double fraction = low - low_error * (high - low) / (high_error - low_error);
+        double error = parareal_burn_then_coast(system, &start, fraction, duration);
+        if(error < 0.0) {
+            low = fraction;
+            low_error = error;
+        } else {
+            high = fraction;
+            high_error = error;
+        }
+    }
+    parareal_burn_then_coast(system, &start, low - low_error * (high - low) / (high_error - low_error), duration);
+}
+
+//Returns how far above the cutoff the apoapsis ends.
+static double parareal_burn_then_coast(System *system, const Rocket *start, double fraction, double duration) {
+    double cutoff_radius = system->throttle_cutoff_radius;
+
+    *system->rocket = *start;
+    system->throttle_cutoff_radius = -1.0; //No cutoff: burn.
+    system->delta_t = fraction * duration;
+    system_run_one_tick(system);
+    system->throttle_cutoff_radius = DBL_MIN; //Below every apoapsis: coast.
+    system->delta_t = (1.0 - fraction) * duration;
+    system_run_one_tick(system);
+    system->ticks -= 2;
+    system->throttle_cutoff_radius = cutoff_radius;
+
+    double periapsis, apoapsis;
+    if(!system_apses(system, &periapsis, &apoapsis))
+        return INFINITY;
+    return apoapsis - cutoff_radius;
+}
+
+//Linear and spline programs are continuous, and the gravity turn only jumps where its step table does.
+static PararealSwitches parareal_switches(const System *system) {
+    PararealSwitches switches = {false, 0, 0};
+
+    double periapsis, apoapsis;
+    bool closed = system_apses(system, &periapsis, &apoapsis);
+    switches.cutoff = system->throttle_cutoff_radius > 0.0 && (!closed || apoapsis >= system->throttle_cutoff_radius);
+
+    double altitude = planetoid_position_altitude(system->planetoid, system->rocket->position);
+    int error = 0;
+    ProgramKind kind = system->throttle_program->kind;
+    if(kind == PROGRAM_KIND_STEP || kind == PROGRAM_KIND_GRAVITY_TURN)
+        switches.throttle_segment = program_segment(system->throttle_program, altitude, &error);
+    kind = system->altitude_angle_program->kind;
+    if(kind == PROGRAM_KIND_STEP || kind == PROGRAM_KIND_GRAVITY_TURN)
+        switches.altitude_angle_segment = program_segment(system->altitude_angle_program, altitude, &error);
+    return switches;
+}
+
+static bool parareal_same_switches(const PararealSwitches *a, const PararealSwitches *b) {
+    return a->cutoff == b->cutoff && a->throttle_segment == b->throttle_segment && a->altitude_angle_segment == b->altitude_angle_segment;
+}
+
+static PararealState parareal_state(const Rocket *rocket) {
+    PararealState state = {rocket->position, rocket->velocity, rocket->mass};
+    return state;
+}
+
+static double parareal_distance(const PararealState *a, const PararealState *b) {
+    double d = fmax(fabs(VX(a->position) - VX(b->position)), fabs(VY(a->position) - VY(b->position)));
+    d = fmax(d, fmax(fabs(VX(a->velocity) - VX(b->velocity)), fabs(VY(a->velocity) - VY(b->velocity))));
+    return fmax(d, fabs(a->mass - b->mass));
+}
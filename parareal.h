@@ -0,0 +1,57 @@
+#ifndef KERBAL_LAUNCH_PARAREAL_H
+#define KERBAL_LAUNCH_PARAREAL_H
+
+#include <stdbool.h>
+
+#include "system.h"
+
+#define PARAREAL_COARSE_TICKS_PER_SECOND 10.0
+#define PARAREAL_TOLERANCE_SPEED 2000.0 //The default tolerance is this times the fine tick: about how far a switch one tick late moves the rest of the flight.
+#define PARAREAL_HORIZON_MARGIN 1.05 //The slices cover the coarse flight's duration times this.
+#define PARAREAL_SWITCH_BISECTIONS 24 //Places a control switch within a coarse tick to 2^-24 of it.
+#define PARAREAL_HOLD_ITERATIONS 3 //Regula falsi steps for the burn fraction that holds the cutoff apoapsis.
+
+//The part of the rocket the integrator carries from one slice to the next.
+typedef struct PararealState {
+    Vector position;
+    Vector velocity;
+    double mass;
+} PararealState;
+
+/*
+ * Parallel-in-time integration of a single flight.  The flight is cut into
+ * time slices; a coarse propagator (the same integrator at a few ticks per
+ * second) proposes the state at every slice boundary, then each slice is flown
+ * at the system's own tick rate in parallel from its proposed start, and the
+ * coarse sweep is repeated with the fine results as corrections until the
+ * boundaries stop moving.  After k iterations the first k slices are exact,
+ * so it always ends within slices iterations; when the coarse propagator is
+ * good it ends after a few, and the wall time approaches a serial run's
+ * divided by the slice count.  The fine flight itself moves by up to a tick
+ * with every switch (throttle cutoff, step breakpoint), so the boundaries can
+ * only agree to about that, and the default tolerance scales with the tick.
+ *
+ * Logging and streaming are not supported, since slices are flown more than
+ * once and out of order.
+ */
+typedef struct Parareal {
+    unsigned workers;
+    unsigned slices; //Defaults to workers.
+    double coarse_ticks_per_second;
+    double tolerance; //Largest change in metres, m/s or tonnes at any slice boundary that counts as agreement; zero for the default.
+    unsigned max_iterations; //Zero means slices, which is always exact.
+
+    //The last run.
+    unsigned iterations;
+    bool converged;
+    unsigned long fine_ticks; //Over every slice and iteration.
+    unsigned long coarse_ticks;
+} Parareal;
+
+Parareal *parareal_alloc(void);
+void parareal_dealloc(Parareal *self);
+Parareal *parareal_init(Parareal *self, unsigned workers);
+
+bool parareal_run(Parareal *self, System *system);
+
+#endif
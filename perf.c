@@ -0,0 +1,392 @@
+#define _GNU_SOURCE //For syscall() under -std=c11.
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+#include "perf.h"
+
+const char *const perf_counter_names[PERF_COUNTERS] = {"cycles", "instructions", "branch-misses", "cache-misses", "fp-assists", "task-clock"};
+const char *const perf_stage_names[PERF_STAGES] = {"other", "seed", "mutate", "evaluate", "select"};
+const char *const perf_phase_names[PERF_PHASES] = {"-", "atmosphere-powered", "atmosphere-coast", "vacuum-powered", "vacuum-coast", "kernel"};
+
+#ifdef KERBAL_LAUNCH_PERF
+
+//The counters of one thread, read as a group.
+typedef struct PerfThread {
+    Perf *perf;
+    unsigned row;
+    int fds[PERF_COUNTERS];
+    PerfCounter order[PERF_COUNTERS]; //Of the values in a group read.
+    size_t opened;
+    uint64_t last[PERF_COUNTERS];
+
+    PerfStage stage;
+    PerfPhase phase;
+    PerfCounts counts[PERF_STAGES][PERF_PHASES];
+} PerfThread;
+
+static Perf *perf_active = NULL; //Set before the counted threads start, so read without a lock.
+static _Thread_local PerfThread *perf_thread = NULL;
+
+static int perf_open(PerfCounter counter, int group);
+static bool perf_open_group(PerfThread *thread, const bool *wanted, int *error);
+static void perf_sample(PerfThread *thread);
+static bool perf_intel(void);
+static void perf_thread_begin_row(unsigned row, PerfStage stage);
+
+#endif
+
+static void perf_print_ratio(double numerator, double denominator, bool available);
+
+Perf *perf_alloc(void) {
+    return calloc(1, sizeof(Perf));
+}
+
+void perf_dealloc(Perf *self) {
+    pthread_mutex_destroy(&self->mutex);
+    free(self);
+}
+
+Perf *perf_init(Perf *self) {
+    memset(self->counts, 0, sizeof(self->counts));
+    for(unsigned c=0; c<PERF_COUNTERS; c++)
+        self->available[c] = false;
+    for(unsigned row=0; row<=PERF_MAX_WORKERS; row++)
+        self->used[row] = false;
+    self->running = false;
+    self->error[0] = '\0';
+    pthread_mutex_init(&self->mutex, NULL);
+    return self;
+}
+
+/*
+ * Finds which counters can be opened and starts counting the calling thread
+ * (as PERF_MAIN) and any optimizer threads started until perf_stop.  Only one
+ * Perf runs at a time.
+ */
+bool perf_start(Perf *self) {
+#ifdef KERBAL_LAUNCH_PERF
+    if(perf_active) {
+        snprintf(self->error, sizeof(self->error), "another profile is running");
+        return false;
+    }
+
+    bool wanted[PERF_COUNTERS];
+    for(unsigned c=0; c<PERF_COUNTERS; c++)
+        wanted[c] = true;
+    wanted[PERF_COUNTER_FP_ASSISTS] = perf_intel();
+
+    PerfThread probe;
+    int error = 0;
+    if(!perf_open_group(&probe, wanted, &error)) {
+        snprintf(self->error, sizeof(self->error), "perf_event_open: %s", strerror(error));
+        return false;
+    }
+    for(size_t i=0; i<probe.opened; i++) {
+        self->available[probe.order[i]] = true;
+        close(probe.fds[i]);
+    }
+
+    perf_active = self;
+    self->running = true;
+    perf_thread_begin_row(PERF_MAIN, PERF_STAGE_OTHER);
+    return true;
+#else
+    snprintf(self->error, sizeof(self->error), "built without KERBAL_LAUNCH_PERF");
+    return false;
+#endif
+}
+
+//Stops counting; the counted threads other than the caller must have ended.
+void perf_stop(Perf *self) {
+#ifdef KERBAL_LAUNCH_PERF
+    if(perf_active != self)
+        return;
+    perf_thread_end();
+    perf_active = NULL;
+    self->running = false;
+#else
+    (void)self;
+#endif
+}
+
+/*
+ * Prints instructions per cycle and the misses per tick by stage and phase,
+ * over all threads, then the totals of each thread.
+ */
+void perf_display(const Perf *self) {
+    printf("Performance Counters (user space):");
+    for(unsigned c=0; c<PERF_COUNTERS; c++)
+        printf(" %s%s", perf_counter_names[c], self->available[c] ? "" : " (n/a)");
+    printf("\n");
+
+    const bool *available = self->available;
+    printf("%-8s %-18s %11s %10s %10s %10s %10s %10s %10s %10s %10s\n",
+            "stage", "phase", "ticks", "cpu ms", "IPC", "cycles/t", "instr/t", "br-miss/t", "$-miss/t", "fp-asst/t", "ns/t");
+    for(unsigned stage=0; stage<PERF_STAGES; stage++) {
+        for(unsigned phase=0; phase<PERF_PHASES; phase++) {
+            PerfCounts sum;
+            memset(&sum, 0, sizeof(sum));
+            for(unsigned row=0; row<=PERF_MAX_WORKERS; row++) {
+                const PerfCounts *counts = &self->counts[row][stage][phase];
+                for(unsigned c=0; c<PERF_COUNTERS; c++)
+                    sum.values[c] += counts->values[c];
+                sum.ticks += counts->ticks;
+            }
+            if(sum.ticks == 0 && sum.values[PERF_COUNTER_TASK_CLOCK] == 0 && sum.values[PERF_COUNTER_CYCLES] == 0)
+                continue;
+
+            //Rows outside flights have no ticks, so only their totals are shown.
+            double ticks = (double)sum.ticks;
+            printf("%-8s %-18s %11llu", perf_stage_names[stage], perf_phase_names[phase], (unsigned long long)sum.ticks);
+            perf_print_ratio(sum.values[PERF_COUNTER_TASK_CLOCK], 1e6, available[PERF_COUNTER_TASK_CLOCK]);
+            perf_print_ratio(sum.values[PERF_COUNTER_INSTRUCTIONS], sum.values[PERF_COUNTER_CYCLES],
+                    available[PERF_COUNTER_INSTRUCTIONS] && available[PERF_COUNTER_CYCLES]);
+            perf_print_ratio(sum.values[PERF_COUNTER_CYCLES], ticks, available[PERF_COUNTER_CYCLES]);
+            perf_print_ratio(sum.values[PERF_COUNTER_INSTRUCTIONS], ticks, available[PERF_COUNTER_INSTRUCTIONS]);
+            perf_print_ratio(sum.values[PERF_COUNTER_BRANCH_MISSES], ticks, available[PERF_COUNTER_BRANCH_MISSES]);
+            perf_print_ratio(sum.values[PERF_COUNTER_CACHE_MISSES], ticks, available[PERF_COUNTER_CACHE_MISSES]);
+            perf_print_ratio(sum.values[PERF_COUNTER_FP_ASSISTS], ticks, available[PERF_COUNTER_FP_ASSISTS]);
+            perf_print_ratio(sum.values[PERF_COUNTER_TASK_CLOCK], ticks, available[PERF_COUNTER_TASK_CLOCK]);
+            printf("\n");
+        }
+    }
+
+    printf("%-8s %11s %10s %10s %10s\n", "thread", "ticks", "cpu ms", "IPC", "ns/t");
+    for(unsigned row=0; row<=PERF_MAX_WORKERS; row++) {
+        if(!self->used[row])
+            continue;
+        PerfCounts sum;
+        memset(&sum, 0, sizeof(sum));
+        for(unsigned stage=0; stage<PERF_STAGES; stage++) {
+            for(unsigned phase=0; phase<PERF_PHASES; phase++) {
+                const PerfCounts *counts = &self->counts[row][stage][phase];
+                for(unsigned c=0; c<PERF_COUNTERS; c++)
+                    sum.values[c] += counts->values[c];
+                sum.ticks += counts->ticks;
+            }
+        }
+
+        if(row == PERF_MAIN)
+            printf("%-8s", "main");
+        else
+            printf("%-8u", row);
+        printf(" %11llu", (unsigned long long)sum.ticks);
+        perf_print_ratio(sum.values[PERF_COUNTER_TASK_CLOCK], 1e6, available[PERF_COUNTER_TASK_CLOCK]);
+        perf_print_ratio(sum.values[PERF_COUNTER_INSTRUCTIONS], sum.values[PERF_COUNTER_CYCLES],
+                available[PERF_COUNTER_INSTRUCTIONS] && available[PERF_COUNTER_CYCLES]);
+        perf_print_ratio(sum.values[PERF_COUNTER_TASK_CLOCK], (double)sum.ticks, available[PERF_COUNTER_TASK_CLOCK]);
+        printf("\n");
+    }
+}
+
+//A column of the perf_display tables: "n/a" for a missing counter, "-" for no denominator.
+static void perf_print_ratio(double numerator, double denominator, bool available) {
+    if(!available)
+        printf(" %10s", "n/a");
+    else if(denominator <= 0.0)
+        printf(" %10s", "-");
+    else
+        printf(" %10.2f", numerator / denominator);
+}
+
+#ifdef KERBAL_LAUNCH_PERF
+
+/*
+ * Starts counting the calling thread into the worker's row (workers past the
+ * last share it), in the stage.  Does nothing if no Perf is running or the
+ * thread is already counted.
+ */
+void perf_thread_begin(unsigned worker, PerfStage stage) {
+    //The row after the last worker's is PERF_MAIN's.
+    perf_thread_begin_row((worker < PERF_MAX_WORKERS) ? worker : PERF_MAX_WORKERS-1, stage);
+}
+
+static void perf_thread_begin_row(unsigned row, PerfStage stage) {
+    Perf *perf = perf_active;
+    if(perf == NULL || perf_thread != NULL)
+        return;
+
+    PerfThread *thread = (PerfThread *)calloc(1, sizeof(PerfThread));
+    int error = 0;
+    if(!perf_open_group(thread, perf->available, &error)) {
+        free(thread);
+        return;
+    }
+    thread->perf = perf;
+    thread->row = row;
+    thread->stage = stage;
+    thread->phase = PERF_PHASE_NONE;
+    perf_thread = thread;
+    perf_sample(thread);
+    memset(thread->counts, 0, sizeof(thread->counts));
+}
+
+//Folds the calling thread's counts into the Perf and stops counting it.
+void perf_thread_end(void) {
+    PerfThread *thread = perf_thread;
+    if(thread == NULL)
+        return;
+    perf_sample(thread);
+
+    Perf *perf = thread->perf;
+    pthread_mutex_lock(&perf->mutex);
+    for(unsigned stage=0; stage<PERF_STAGES; stage++) {
+        for(unsigned phase=0; phase<PERF_PHASES; phase++) {
+            PerfCounts *into = &perf->counts[thread->row][stage][phase];
+            const PerfCounts *from = &thread->counts[stage][phase];
+            for(unsigned c=0; c<PERF_COUNTERS; c++)
+                into->values[c] += from->values[c];
+            into->ticks += from->ticks;
+        }
+    }
+    perf->used[thread->row] = true;
+    pthread_mutex_unlock(&perf->mutex);
+
+    for(size_t i=0; i<thread->opened; i++)
+        close(thread->fds[i]);
+    free(thread);
+    perf_thread = NULL;
+}
+
+//Sets the calling thread's stage, returning the one it replaces.
+PerfStage perf_set_stage(PerfStage stage) {
+    PerfThread *thread = perf_thread;
+    if(thread == NULL)
+        return PERF_STAGE_OTHER;
+    PerfStage previous = thread->stage;
+    if(stage != previous) {
+        perf_sample(thread);
+        thread->stage = stage;
+    }
+    return previous;
+}
+
+void perf_set_phase(PerfPhase phase) {
+    PerfThread *thread = perf_thread;
+    if(thread == NULL || phase == thread->phase)
+        return;
+    perf_sample(thread);
+    thread->phase = phase;
+}
+
+//Counts ticks flown in the current phase other than by perf_tick.
+void perf_add_ticks(unsigned long ticks) {
+    PerfThread *thread = perf_thread;
+    if(thread)
+        thread->counts[thread->stage][thread->phase].ticks += ticks;
+}
+
+//Counts a tick about to be flown, in the phase it is flown in.
+void perf_tick(bool atmosphere, bool powered) {
+    PerfThread *thread = perf_thread;
+    if(thread == NULL)
+        return;
+    PerfPhase phase = atmosphere ?
+        (powered ? PERF_PHASE_ATMOSPHERE_POWERED : PERF_PHASE_ATMOSPHERE_COAST) :
+        (powered ? PERF_PHASE_VACUUM_POWERED : PERF_PHASE_VACUUM_COAST);
+    if(phase != thread->phase)
+        perf_set_phase(phase);
+    thread->counts[thread->stage][phase].ticks++;
+}
+
+static int perf_open(PerfCounter counter, int group) {
+#ifdef __linux__
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    switch(counter) {
+        case PERF_COUNTER_CYCLES:
+            attr.config = PERF_COUNT_HW_CPU_CYCLES;
+            break;
+        case PERF_COUNTER_INSTRUCTIONS:
+            attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+            break;
+        case PERF_COUNTER_BRANCH_MISSES:
+            attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+            break;
+        case PERF_COUNTER_CACHE_MISSES:
+            attr.config = PERF_COUNT_HW_CACHE_MISSES;
+            break;
+        case PERF_COUNTER_FP_ASSISTS:
+            attr.type = PERF_TYPE_RAW;
+            attr.config = PERF_FP_ASSIST_RAW;
+            break;
+        default:
+            attr.type = PERF_TYPE_SOFTWARE;
+            attr.config = PERF_COUNT_SW_TASK_CLOCK;
+            break;
+    }
+    attr.read_format = PERF_FORMAT_GROUP;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, group, 0);
+#else
+    (void)counter;
+    (void)group;
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+//Opens the wanted counters on the calling thread, led by the first that opens; false if none did.
+static bool perf_open_group(PerfThread *thread, const bool *wanted, int *error) {
+    thread->opened = 0;
+    for(unsigned c=0; c<PERF_COUNTERS; c++) {
+        if(!wanted[c])
+            continue;
+        int fd = perf_open((PerfCounter)c, thread->opened ? thread->fds[0] : -1);
+        if(fd < 0) {
+            if(thread->opened == 0)
+                *error = errno;
+            continue;
+        }
+        thread->fds[thread->opened] = fd;
+        thread->order[thread->opened] = (PerfCounter)c;
+        thread->opened++;
+    }
+    return thread->opened > 0;
+}
+
+//Adds the counts since the last sample to the thread's current stage and phase.
+static void perf_sample(PerfThread *thread) {
+    uint64_t buffer[1+PERF_COUNTERS];
+    if(read(thread->fds[0], buffer, sizeof(buffer)) < (ssize_t)sizeof(uint64_t))
+        return;
+
+    PerfCounts *counts = &thread->counts[thread->stage][thread->phase];
+    size_t values = (buffer[0] < thread->opened) ? (size_t)buffer[0] : thread->opened;
+    for(size_t i=0; i<values; i++) {
+        PerfCounter counter = thread->order[i];
+        counts->values[counter] += buffer[1+i] - thread->last[counter];
+        thread->last[counter] = buffer[1+i];
+    }
+}
+
+//The FP assist event is Intel's; the same raw code means something else on other CPUs.
+static bool perf_intel(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    FILE *cpuinfo = fopen("/proc/cpuinfo", "r");
+    if(cpuinfo == NULL)
+        return false;
+    char line[256];
+    bool intel = false;
+    while(!intel && fgets(line, sizeof(line), cpuinfo))
+        intel = strncmp(line, "vendor_id", 9) == 0 && strstr(line, "GenuineIntel") != NULL;
+    fclose(cpuinfo);
+    return intel;
+#else
+    return false;
+#endif
+}
+
+#endif
@@ -0,0 +1,109 @@
+#ifndef KERBAL_LAUNCH_PERF_H
+#define KERBAL_LAUNCH_PERF_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <pthread.h>
+
+#define PERF_MAX_WORKERS 64
+#define PERF_MAIN PERF_MAX_WORKERS //The row of the thread that called perf_start.
+#define PERF_FP_ASSIST_RAW 0x1eca //FP_ASSIST.ANY on Intel Sandy Bridge through Skylake; raw events differ elsewhere.
+
+typedef enum PerfCounter {
+    PERF_COUNTER_CYCLES=0,
+    PERF_COUNTER_INSTRUCTIONS,
+    PERF_COUNTER_BRANCH_MISSES,
+    PERF_COUNTER_CACHE_MISSES,
+    PERF_COUNTER_FP_ASSISTS,
+    PERF_COUNTER_TASK_CLOCK, //Nanoseconds on the CPU; a software counter, so nearly always there.
+    PERF_COUNTERS
+} PerfCounter;
+
+//What the optimizer is doing on a thread.
+typedef enum PerfStage {
+    PERF_STAGE_OTHER=0,
+    PERF_STAGE_SEED, //Flying the seed programs and warm starting.
+    PERF_STAGE_MUTATE, //Making candidate programs and their systems.
+    PERF_STAGE_EVALUATE, //Flying candidates.
+    PERF_STAGE_SELECT, //Ranking results and keeping the best.
+    PERF_STAGES
+} PerfStage;
+
+//The part of a flight being simulated on a thread, if any.
+typedef enum PerfPhase {
+    PERF_PHASE_NONE=0, //Not in a flight.
+    PERF_PHASE_ATMOSPHERE_POWERED,
+    PERF_PHASE_ATMOSPHERE_COAST,
+    PERF_PHASE_VACUUM_POWERED,
+    PERF_PHASE_VACUUM_COAST,
+    PERF_PHASE_KERNEL, //Flown whole by a compiled kernel (see kernel.h).
+    PERF_PHASES
+} PerfPhase;
+
+typedef struct PerfCounts {
+    uint64_t values[PERF_COUNTERS];
+    uint64_t ticks;
+} PerfCounts;
+
+/*
+ * Hardware performance counters (perf_event_open, Linux only) per thread,
+ * split by optimizer stage and flight phase, for aiming micro-optimization:
+ * instructions per cycle and branch, cache and floating point assist misses
+ * per tick show whether the tick is bound by latency, mispredicts or memory.
+ *
+ * Built only with KERBAL_LAUNCH_PERF defined; otherwise every hook below is
+ * an empty inline function and costs nothing.  Once built in, the hooks do
+ * nothing on threads that are not being counted.  Each counted thread opens
+ * its own counter group, user space only, and reads it (one system call)
+ * when its stage or phase changes, a few times a flight; per tick it only
+ * compares the phase and counts the tick.  Threads fold their counts into
+ * the Perf under its lock when they end.
+ *
+ * Counters the kernel or CPU does not offer (in most virtual machines, all
+ * but the task clock) are left out and shown as unavailable.  The FP assist
+ * count is a raw event, only asked for on Intel CPUs.
+ */
+typedef struct Perf {
+    bool available[PERF_COUNTERS];
+    PerfCounts counts[PERF_MAX_WORKERS+1][PERF_STAGES][PERF_PHASES];
+    bool used[PERF_MAX_WORKERS+1];
+    bool running;
+    char error[256]; //Why perf_start failed.
+
+    pthread_mutex_t mutex;
+} Perf;
+
+extern const char *const perf_counter_names[PERF_COUNTERS];
+extern const char *const perf_stage_names[PERF_STAGES];
+extern const char *const perf_phase_names[PERF_PHASES];
+
+Perf *perf_alloc(void);
+void perf_dealloc(Perf *self);
+Perf *perf_init(Perf *self);
+
+bool perf_start(Perf *self);
+void perf_stop(Perf *self);
+void perf_display(const Perf *self);
+
+#ifdef KERBAL_LAUNCH_PERF
+
+void perf_thread_begin(unsigned worker, PerfStage stage);
+void perf_thread_end(void);
+PerfStage perf_set_stage(PerfStage stage);
+void perf_set_phase(PerfPhase phase);
+void perf_add_ticks(unsigned long ticks);
+void perf_tick(bool atmosphere, bool powered);
+
+#else
+
+static inline void perf_thread_begin(unsigned worker, PerfStage stage) {(void)worker; (void)stage;}
+static inline void perf_thread_end(void) {}
+static inline PerfStage perf_set_stage(PerfStage stage) {(void)stage; return PERF_STAGE_OTHER;}
+static inline void perf_set_phase(PerfPhase phase) {(void)phase;}
+static inline void perf_add_ticks(unsigned long ticks) {(void)ticks;}
+static inline void perf_tick(bool atmosphere, bool powered) {(void)atmosphere; (void)powered;}
+
+#endif
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef KERBAL_LAUNCH_PHYSICS_H
+#define KERBAL_LAUNCH_PHYSICS_H
+
+#include "vector.h"
+#include "planetoid.h"
+#include "rocket.h"
+
+/*
+ * The 2D instance of physics_template.h, which System ticks with.  Directions
+ * are polar, as the model always had them; the steering plane is the xy
+ * plane, so there is no yaw and normal is unused.
+ */
+
+static inline Vector physics_directed(Vector v, double v_mag, double magnitude) {
+    (void)v_mag;
+    return vector_polar(magnitude, vector_azm(v));
+}
+
+/*
+ * The altitude angle is the complement of the zenith angle, so that to match
+ * KSP intuition 0.0 points in the positive-x direction of the local horizon
+ * frame and pi/2 points straight up.
+ */
+static inline Vector physics_thrust(double magnitude, double altitude_angle, double yaw, Vector relative, Vector normal) {
+    (void)yaw;
+    (void)normal;
+    return vector_polar(magnitude, vector_azm(relative) - M_PI/2.0 + altitude_angle);
+}
+
+#define PHYSICS_VECTOR Vector
+#define PHYSICS_VFN(name) vector_##name
+#define PHYSICS_FN(name) physics_##name
+#define PHYSICS_T(name) Physics##name
+#include "physics_template.h"
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef KERBAL_LAUNCH_PHYSICS3_H
+#define KERBAL_LAUNCH_PHYSICS3_H
+
+#include "vector3.h"
+#include "planetoid.h"
+#include "rocket.h"
+
+/*
+ * The 3D instance of physics_template.h, which System3 ticks with.  Directions
+ * come from unit vectors rather than angles.  The horizontal is up x normal,
+ * which for the normal (0,0,1) is the 2D model's horizontal, and a positive
+ * yaw turns it toward the normal.
+ */
+
+static inline Vector3 physics3_directed(Vector3 v, double v_mag, double magnitude) {
+    if(v_mag == 0.0)
+        return vector3_zero();
+    return vector3_scale(v, magnitude/v_mag);
+}
+
+static inline Vector3 physics3_thrust(double magnitude, double altitude_angle, double yaw, Vector3 relative, Vector3 normal) {
+    if(magnitude == 0.0)
+        return vector3_zero();
+
+    Vector3 up = vector3_scale(relative, 1.0/vector3_mag(relative));
+    Vector3 horizontal = vector3_cross(up, normal);
+    horizontal = vector3_scale(horizontal, 1.0/vector3_mag(horizontal));
+    if(yaw != 0.0)
+        horizontal = vector3_add(vector3_scale(horizontal, kerbal_cos(yaw)), vector3_scale(vector3_cross(horizontal, up), kerbal_sin(yaw)));
+
+    return vector3_add(vector3_scale(up, magnitude*kerbal_sin(altitude_angle)), vector3_scale(horizontal, magnitude*kerbal_cos(altitude_angle)));
+}
+
+#define PHYSICS_VECTOR Vector3
+#define PHYSICS_VFN(name) vector3_##name
+#define PHYSICS_FN(name) physics3_##name
+#define PHYSICS_T(name) Physics3##name
+#include "physics_template.h"
+
+#endif
@@ -0,0 +1,73 @@
+/*
+ * The flight physics of one tick, written once for any number of dimensions
+ * and included by physics.h (2D) and physics3.h (3D) with these defined:
+ *   PHYSICS_VECTOR    the vector type
+ *   PHYSICS_VFN(name) its functions, from vector_template.h
+ *   PHYSICS_FN(name)  the function name for name, e.g. physics_##name
+ *   PHYSICS_T(name)   the type name for name, e.g. Physics##name
+ * and these functions declared:
+ *   PHYSICS_FN(directed)(v, |v|, magnitude)
+ *     a vector of the magnitude along v;
+ *   PHYSICS_FN(thrust)(magnitude, altitude_angle, yaw, relative, normal)
+ *     the thrust, altitude_angle above the horizontal of the steering plane
+ *     (normal to normal) and yaw out of it, relative to the planetoid centre.
+ * The macros are undefined again at the end, so there is no include guard.
+ *
+ * Only the directions are left to each dimension: the 2D model keeps its
+ * polar form, so it flies exactly as before.
+ */
+
+//What one tick works out, before it is applied.
+typedef struct PHYSICS_T(Step) {
+    double atm;
+    double delta_mass;
+
+    PHYSICS_VECTOR force_gravity;
+    PHYSICS_VECTOR force_drag;
+    PHYSICS_VECTOR force_thrust;
+    PHYSICS_VECTOR force;
+
+    PHYSICS_VECTOR delta_position;
+    PHYSICS_VECTOR delta_velocity;
+} PHYSICS_T(Step);
+
+//Note that the magnitude is negative because it goes opposite the position.
+static inline PHYSICS_VECTOR PHYSICS_FN(gravity)(const Planetoid *planetoid, double mass, PHYSICS_VECTOR relative) {
+    double r = PHYSICS_VFN(mag)(relative);
+    double f_mag = -(mass * planetoid->gravitational_parameter)/(r*r);
+    return PHYSICS_FN(directed)(relative, r, f_mag);
+}
+
+//See planetoid_atmospheric_drag.
+static inline PHYSICS_VECTOR PHYSICS_FN(drag)(double atm, PHYSICS_VECTOR velocity, double drag, double mass) {
+    double v = PHYSICS_VFN(mag)(velocity);
+    double f_mag = -0.5 * planetoid_density(atm) * mass * drag * v * v;
+    return PHYSICS_FN(directed)(velocity, v, f_mag);
+}
+
+/*
+ * Works out the forces on the rocket and the changes they make over delta_t,
+ * from its position relative to the planetoid and its velocity; the rocket's
+ * throttle and altitude angle must already be set.
+ */
+static inline void PHYSICS_FN(step)(const Planetoid *planetoid, const Rocket *rocket, PHYSICS_VECTOR relative, PHYSICS_VECTOR velocity, double yaw, PHYSICS_VECTOR normal, double delta_t, PHYSICS_T(Step) *step) {
+    double m = rocket->mass;
+    double atm = planetoid_altitude_atm(planetoid, PHYSICS_VFN(mag)(relative) - planetoid->radius);
+    step->atm = atm;
+    step->delta_mass = rocket_mass_flow(rocket, atm) * delta_t;
+
+    step->force_gravity = PHYSICS_FN(gravity)(planetoid, m, relative);
+    step->force_drag = PHYSICS_FN(drag)(atm, velocity, rocket_drag(rocket), m);
+    step->force_thrust = PHYSICS_FN(thrust)(rocket_thrust(rocket, atm), rocket->altitude_angle, yaw, relative, normal);
+    step->force = PHYSICS_VFN(add)(PHYSICS_VFN(add)(step->force_gravity, step->force_drag), step->force_thrust);
+
+    //Move based on the acceleration.
+    PHYSICS_VECTOR a = {step->force.v / m};
+    step->delta_velocity.v = a.v*delta_t;
+    step->delta_position.v = 0.5*a.v*delta_t*delta_t + velocity.v*delta_t;
+}
+
+#undef PHYSICS_VECTOR
+#undef PHYSICS_VFN
+#undef PHYSICS_FN
+#undef PHYSICS_T
@@ -2,6 +2,7 @@
 #include <math.h>
 
 #include "planetoid.h"
+#include "physics.h"
 
 Planetoid *planetoid_alloc(void) {
     return (Planetoid *)malloc(sizeof(Planetoid));
@@ -26,8 +27,10 @@ Planetoid *planetoid_init(Planetoid *self) {
 }
 
 double planetoid_atm(const Planetoid *self, Vector position) {
-    double r = planetoid_position_radius(self, position);
-    double a = r - self->radius;
+    return planetoid_altitude_atm(self, planetoid_position_altitude(self, position));
+}
+
+double planetoid_altitude_atm(const Planetoid *self, double a) {
     if( a >= self->max_atmospheric_altitude )
         return 0.0;
     else if( a >= 0.0 )
@@ -37,8 +40,7 @@ double planetoid_atm(const Planetoid *self, Vector position) {
 }
 
 double planetoid_rho(const Planetoid *self, Vector position) {
-    double atm = planetoid_atm(self, position);
-    return atm * 1.2230948554874 * 0.008; /* This came from the wiki */
+    return planetoid_density(planetoid_atm(self, position));
 }
 
 Vector planetoid_relative_position(const Planetoid *self, Vector position) {
@@ -81,18 +83,7 @@ double planetoid_horizontal_velocity(const Planetoid *self, Vector position, Vec
 }
 
 Vector planetoid_gravitational_force(const Planetoid *self, double mass, Vector position) {
-    //Compute the relative position vector, r
-    Vector r_vec = planetoid_relative_position(self, position);
-    double r = vector_mag(r_vec);
-
-    //Compute the gravitational force magnitude. Note that it is negative because it goes opposite the position.
-    double f_mag = -(mass * self->gravitational_parameter)/(r*r);
-
-    //Compute the gravitational force angle. We take into account it's oppositeness with the negative magnitude.
-    double f_azm = vector_azm(r_vec);
-
-    //Return the vector.
-    return vector_polar(f_mag, f_azm);
+    return physics_gravity(self, mass, planetoid_relative_position(self, position));
 }
 
 /*
@@ -110,13 +101,7 @@ Vector planetoid_gravitational_force(const Planetoid *self, double mass, Vector
  * density ~ 0.01 Exp(-height/5000 m) km/meter^3
  */
 Vector planetoid_atmospheric_drag(const Planetoid *self, Vector position, Vector velocity, double drag, double mass) {
-    double v = vector_mag(velocity);
-
-    double rho = planetoid_rho(self, position);
-
-    double f_mag = -0.5 * rho * mass * drag * v * v;
-    double f_azm = vector_azm(velocity);
-    return vector_polar(f_mag, f_azm);
+    return physics_drag(planetoid_atm(self, position), velocity, drag, mass);
 }
 
 Vector planetoid_irl_atmospheric_drag(const Planetoid *self, Vector position, Vector velocity, double frontal_area, double coeff) {
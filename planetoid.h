@@ -12,11 +12,17 @@ typedef struct Planetoid {
     double max_atmospheric_altitude;
 } Planetoid;
 
+//Air density for a pressure in atmospheres; this came from the wiki.
+static inline double planetoid_density(double atm) {
+    return atm * 1.2230948554874 * 0.008;
+}
+
 Planetoid *planetoid_alloc(void);
 void planetoid_dealloc(Planetoid *self);
 Planetoid *planetoid_init(Planetoid *self);
 
 double planetoid_atm(const Planetoid *self, Vector position);
+double planetoid_altitude_atm(const Planetoid *self, double altitude);
 double planetoid_rho(const Planetoid *self, Vector position);
 
 Vector planetoid_relative_position(const Planetoid *self, Vector position);
@@ -0,0 +1,137 @@
+#include <stdlib.h>
+#include <assert.h>
+
+#include "pool.h"
+
+typedef struct PoolWorker {
+    WorkerPool *pool;
+    unsigned index;
+} PoolWorker;
+
+static void *worker_pool_worker(PoolWorker *worker);
+static PoolTask *worker_pool_take(WorkerPool *self);
+
+WorkerPool *worker_pool_alloc(void) {
+    return (WorkerPool *)malloc(sizeof(WorkerPool));
+}
+
+//Closes the pool if still open, and waits for the workers to exit.
+void worker_pool_dealloc(WorkerPool *self) {
+    worker_pool_close(self);
+    free(self->threads);
+    pthread_cond_destroy(&self->ready);
+    pthread_mutex_destroy(&self->mutex);
+    free(self);
+}
+
+WorkerPool *worker_pool_init(WorkerPool *self, unsigned workers) {
+    assert(workers > 0);
+    self->workers = workers;
+    self->ring = NULL;
+    self->closed = false;
+    pthread_mutex_init(&self->mutex, NULL);
+    pthread_cond_init(&self->ready, NULL);
+
+    self->threads = (pthread_t *)malloc(sizeof(pthread_t) * workers);
+    for(unsigned i=0; i<workers; i++) {
+        PoolWorker *worker = (PoolWorker *)malloc(sizeof(PoolWorker));
+        worker->pool = self;
+        worker->index = i;
+        pthread_create(&self->threads[i], NULL, (void *(*)(void *))worker_pool_worker, worker);
+    }
+    return self;
+}
+
+void worker_pool_submit(WorkerPool *self, PoolClient *client, PoolTask *task) {
+    task->next = NULL;
+    pthread_mutex_lock(&self->mutex);
+    assert(!self->closed);
+    if(client->tail)
+        client->tail->next = task;
+    else
+        client->head = task;
+    client->tail = task;
+
+    //Join the ring just behind the client to be served next, so it waits one full turn.
+    if(!client->waiting) {
+        client->waiting = true;
+        if(self->ring == NULL) {
+            client->next = client;
+            self->ring = client;
+        } else {
+            PoolClient *last = self->ring;
+            while(last->next != self->ring)
+                last = last->next;
+            last->next = client;
+            client->next = self->ring;
+        }
+    }
+    pthread_cond_signal(&self->ready);
+    pthread_mutex_unlock(&self->mutex);
+}
+
+//Lets the workers finish what is queued, then joins them.  Idempotent.
+void worker_pool_close(WorkerPool *self) {
+    pthread_mutex_lock(&self->mutex);
+    bool was_closed = self->closed;
+    self->closed = true;
+    pthread_cond_broadcast(&self->ready);
+    pthread_mutex_unlock(&self->mutex);
+
+    if(!was_closed) {
+        for(unsigned i=0; i<self->workers; i++)
+            pthread_join(self->threads[i], NULL);
+    }
+}
+
+PoolClient *pool_client_init(PoolClient *self) {
+    self->head = NULL;
+    self->tail = NULL;
+    self->next = NULL;
+    self->waiting = false;
+    return self;
+}
+
+static void *worker_pool_worker(PoolWorker *worker) {
+    WorkerPool *pool = worker->pool;
+    unsigned index = worker->index;
+    free(worker);
+
+    PoolTask *task;
+    while((task = worker_pool_take(pool)) != NULL)
+        task->run(task, index);
+    return NULL;
+}
+
+//Pops the next task round-robin across clients; NULL once closed and drained.
+static PoolTask *worker_pool_take(WorkerPool *self) {
+    pthread_mutex_lock(&self->mutex);
+    while(self->ring == NULL && !self->closed)
+        pthread_cond_wait(&self->ready, &self->mutex);
+
+    PoolTask *task = NULL;
+    PoolClient *client = self->ring;
+    if(client) {
+        task = client->head;
+        client->head = task->next;
+        if(client->head == NULL) {
+            //Drop the client from the ring.
+            client->tail = NULL;
+            client->waiting = false;
+            if(client->next == client) {
+                self->ring = NULL;
+            } else {
+                PoolClient *previous = client;
+                while(previous->next != client)
+                    previous = previous->next;
+                previous->next = client->next;
+                self->ring = client->next;
+            }
+            client->next = NULL;
+        } else {
+            self->ring = client->next;
+        }
+    }
+    pthread_mutex_unlock(&self->mutex);
+    return task;
+}
@@ -0,0 +1,48 @@
+#ifndef KERBAL_LAUNCH_POOL_H
+#define KERBAL_LAUNCH_POOL_H
+
+#include <stdbool.h>
+#include <pthread.h>
+
+/*
+ * A persistent pool of worker threads shared by many clients (optimizer runs).
+ * Each client has its own FIFO of tasks, and workers take one task from each
+ * client with pending work in turn, so a client that queues many tasks cannot
+ * starve the others.  Embed a PoolTask in the struct being run.
+ */
+struct PoolTask;
+typedef void (*PoolTaskFunc)(struct PoolTask *task, unsigned worker);
+
+typedef struct PoolTask {
+    struct PoolTask *next;
+    PoolTaskFunc run;
+} PoolTask;
+
+typedef struct PoolClient {
+    PoolTask *head;
+    PoolTask *tail;
+    struct PoolClient *next; //In the pool's ring of clients with pending tasks.
+    bool waiting;
+} PoolClient;
+
+typedef struct WorkerPool {
+    unsigned workers;
+    pthread_t *threads;
+
+    PoolClient *ring; //The client to serve next; NULL when nothing is pending.
+    bool closed;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t ready;
+} WorkerPool;
+
+WorkerPool *worker_pool_alloc(void);
+void worker_pool_dealloc(WorkerPool *self);
+WorkerPool *worker_pool_init(WorkerPool *self, unsigned workers);
+
+void worker_pool_submit(WorkerPool *self, PoolClient *client, PoolTask *task);
+void worker_pool_close(WorkerPool *self);
+
+PoolClient *pool_client_init(PoolClient *self);
+
+#endif
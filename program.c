@@ -1,5 +1,6 @@
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
 
 #include <stdio.h>
 
@@ -10,15 +11,20 @@ Program *program_alloc(void) {
 }
 
 void program_dealloc(Program *self) {
-    free(self->altitudes);
+    if(self->owns_altitudes)
+        free(self->altitudes);
     free(self->settings);
     free(self);
 }
 
 Program *program_init(Program *self, size_t length) {
+    self->kind = PROGRAM_KIND_STEP;
     self->length = length;
     self->altitudes = (double *)calloc(length, sizeof(double));
     self->settings = (double *)malloc(length*sizeof(double));
+    self->owns_altitudes = true;
+    self->func = NULL;
+    self->context = NULL;
     return self;
 }
 
@@ -27,14 +33,69 @@ Program *program_init_copy(Program *self, const Program *src) {
     size_t length_in_bytes = src->length * sizeof(double);
     memcpy(self->altitudes, src->altitudes, length_in_bytes);
     memcpy(self->settings, src->settings, length_in_bytes);
+    self->kind = src->kind;
+    self->func = src->func;
+    self->context = src->context;
 
     return self;
 }
 
-double program_lookup(const Program *self, double altitude, int *error) {
+/*
+ * A program that reads its altitudes from an array it does not own, which must
+ * outlive it; only the settings are allocated.  Copies own their altitudes.
+ */
+Program *program_init_shared(Program *self, size_t length, const double *altitudes) {
+    self->kind = PROGRAM_KIND_STEP;
+    self->length = length;
+    self->altitudes = (double *)altitudes;
+    self->settings = (double *)malloc(length*sizeof(double));
+    self->owns_altitudes = false;
+    self->func = NULL;
+    self->context = NULL;
+    return self;
+}
+
+/*
+ * Parses "ALTITUDE:SETTING..." with ascending altitudes into a new step
+ * program, multiplying the settings by conversion; NULL if it is malformed.
+ * The arguments are tokenized in place.
+ */
+Program *program_parse(char *arguments, double conversion) {
+    size_t capacity = 0;
+    for(const char *c = arguments; *c; c++)
+        if(*c == ':')
+            capacity++;
+    if(capacity == 0)
+        return NULL;
+
+    Program *program = program_init(program_alloc(), capacity);
+    size_t length = 0;
+    bool ok = true;
+    char *save = NULL;
+    for(char *pair = strtok_r(arguments, " \t\r\n", &save); pair && ok; pair = strtok_r(NULL, " \t\r\n", &save)) {
+        char *separator = strchr(pair, ':');
+        if(separator == NULL || length == capacity) {
+            ok = false;
+            break;
+        }
+        program->altitudes[length] = atof(pair);
+        program->settings[length] = atof(separator+1) * conversion;
+        if(length > 0 && !(program->altitudes[length] > program->altitudes[length-1]))
+            ok = false;
+        length++;
+    }
+    if(!ok || length != capacity) {
+        program_dealloc(program);
+        return NULL;
+    }
+    return program;
+}
+
+//Index of the breakpoint at or below the altitude.
+size_t program_segment(const Program *self, double altitude, int *error) {
     if( altitude < self->altitudes[0] ) {
         *error = 1;
-        return 0.0;
+        return 0;
     }
 
     size_t i = 0;
@@ -44,15 +105,115 @@ double program_lookup(const Program *self, double altitude, int *error) {
         i++;
     }
     *error = 0;
+    return i;
+}
+
+double program_lookup(const Program *self, double altitude, int *error) {
+    size_t i = program_segment(self, altitude, error);
+    if(*error)
+        return 0.0;
     return self->settings[i];
 }
 
+double program_lookup_linear(const Program *self, double altitude, int *error) {
+    size_t i = program_segment(self, altitude, error);
+    if(*error)
+        return 0.0;
+    if(i == self->length-1)
+        return self->settings[i];
+
+    double t = (altitude - self->altitudes[i]) / (self->altitudes[i+1] - self->altitudes[i]);
+    return self->settings[i] + t*(self->settings[i+1] - self->settings[i]);
+}
+
+static double program_secant(const Program *self, size_t i) {
+    return (self->settings[i+1] - self->settings[i]) / (self->altitudes[i+1] - self->altitudes[i]);
+}
+
+//Fritsch-Butland tangent: zero at extrema, so the curve stays within the settings.
+static double program_spline_tangent(const Program *self, size_t i) {
+    if(i == 0)
+        return program_secant(self, 0);
+    if(i == self->length-1)
+        return program_secant(self, i-1);
+
+    double d0 = program_secant(self, i-1);
+    double d1 = program_secant(self, i);
+    if(d0*d1 <= 0.0)
+        return 0.0;
+
+    double h0 = self->altitudes[i] - self->altitudes[i-1];
+    double h1 = self->altitudes[i+1] - self->altitudes[i];
+    double w0 = 2.0*h1 + h0;
+    double w1 = h1 + 2.0*h0;
+    return (w0 + w1) / (w0/d0 + w1/d1);
+}
+
+double program_lookup_spline(const Program *self, double altitude, int *error) {
+    size_t i = program_segment(self, altitude, error);
+    if(*error)
+        return 0.0;
+    if(i == self->length-1)
+        return self->settings[i];
+
+    double h = self->altitudes[i+1] - self->altitudes[i];
+    double t = (altitude - self->altitudes[i]) / h;
+    double t2 = t*t;
+    double t3 = t2*t;
+
+    //Cubic Hermite basis.
+    return (2.0*t3 - 3.0*t2 + 1.0) * self->settings[i]
+        + (t3 - 2.0*t2 + t) * h * program_spline_tangent(self, i)
+        + (-2.0*t3 + 3.0*t2) * self->settings[i+1]
+        + (t3 - t2) * h * program_spline_tangent(self, i+1);
+}
+
+/*
+ * A gravity turn: below the second breakpoint the first setting is held (the
+ * vertical climb); above it the rocket follows its surface-relative prograde
+ * angle, but never pitches above the step table, so the second setting is the
+ * initial kick.  A two breakpoint program is therefore a two parameter turn.
+ */
+double program_gravity_turn(const Program *self, const ProgramInput *input, int *error) {
+    size_t i = program_segment(self, input->altitude, error);
+    if(*error)
+        return 0.0;
+    if(i == 0)
+        return self->settings[0];
+
+    const Planetoid *planetoid = input->planetoid;
+    double radius = planetoid_position_radius(planetoid, input->position);
+    double surface_speed = 2.0*M_PI*radius / planetoid->rotational_period;
+    double radial = planetoid_radial_velocity(planetoid, input->position, input->velocity);
+    double horizontal = planetoid_horizontal_velocity(planetoid, input->position, input->velocity) - surface_speed;
+    double prograde = atan2(radial, horizontal);
+
+    return fmax(0.0, fmin(self->settings[i], prograde));
+}
+
+static const char *program_kind_names[] = {"step", "linear", "spline", "gravity-turn", "custom"};
+
+const char *program_kind_name(ProgramKind kind) {
+    return program_kind_names[kind];
+}
+
+//Parses a built-in kind name; custom programs can only be built in code.
+bool program_kind_parse(const char *name, ProgramKind *kind) {
+    for(int k=PROGRAM_KIND_STEP; k<PROGRAM_KIND_CUSTOM; k++) {
+        if(strcmp(name, program_kind_names[k]) == 0) {
+            *kind = (ProgramKind)k;
+            return true;
+        }
+    }
+    return false;
+}
+
 void program_display(const Program *self) {
     program_display_converted(self, 1.0);
 }
 
 void program_display_converted(const Program *self, double conversion) {
-    printf("<program\n");
+    printf("<program %s\n", program_kind_name(self->kind));
     for(size_t i=0; i<self->length; i++) {
         printf("\t[%lu] %6.0f -> %0.3f\n", i, self->altitudes[i], conversion*self->settings[i]);
     }
@@ -1,20 +1,81 @@
 #ifndef KERBAL_LAUNCH_PROGRAM_H
 #define KERBAL_LAUNCH_PROGRAM_H
 
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include "vector.h"
+#include "planetoid.h"
+
+/*
+ * How a program turns its breakpoint table into a setting.  The built-in kinds
+ * are dispatched with a switch so the tick loop pays no indirect call for them;
+ * only PROGRAM_KIND_CUSTOM calls through a function pointer.
+ */
+typedef enum ProgramKind {
+    PROGRAM_KIND_STEP=0, //Hold each setting until the next altitude breakpoint.
+    PROGRAM_KIND_LINEAR, //Interpolate linearly between breakpoints.
+    PROGRAM_KIND_SPLINE, //Monotone cubic between breakpoints; never overshoots the settings.
+    PROGRAM_KIND_GRAVITY_TURN, //Closed loop: follow surface prograde, limited by the step table.
+    PROGRAM_KIND_CUSTOM //Call func with the program and input.
+} ProgramKind;
+
+//The flight state a program may steer by.
+typedef struct ProgramInput {
+    double altitude;
+    Vector position;
+    Vector velocity;
+    const Planetoid *planetoid;
+} ProgramInput;
+
+struct Program;
+typedef double (*ProgramFunc)(const struct Program *program, const ProgramInput *input, int *error);
+
 typedef struct Program {
+    ProgramKind kind;
     size_t length;
     double *altitudes;
     double *settings;
+    bool owns_altitudes; //False when the altitudes are borrowed (see program_init_shared).
+
+    ProgramFunc func; //Only used by PROGRAM_KIND_CUSTOM.
+    void *context; //For func's use; not owned.
 } Program;
 
 Program *program_alloc(void);
 void program_dealloc(Program *self);
 Program *program_init(Program *self, size_t length);
 Program *program_init_copy(Program *self, const Program *src);
+Program *program_init_shared(Program *self, size_t length, const double *altitudes);
+Program *program_parse(char *arguments, double conversion);
 
+size_t program_segment(const Program *self, double altitude, int *error);
 double program_lookup(const Program *self, double input, int *error);
+double program_lookup_linear(const Program *self, double input, int *error);
+double program_lookup_spline(const Program *self, double input, int *error);
+double program_gravity_turn(const Program *self, const ProgramInput *input, int *error);
+
+const char *program_kind_name(ProgramKind kind);
+bool program_kind_parse(const char *name, ProgramKind *kind);
 
 void program_display_converted(const Program *self, double conversion);
 void program_display(const Program *self);
 
+static inline double program_evaluate(const Program *self, const ProgramInput *input, int *error) {
+    switch(self->kind) {
+        case PROGRAM_KIND_STEP:
+            return program_lookup(self, input->altitude, error);
+        case PROGRAM_KIND_LINEAR:
+            return program_lookup_linear(self, input->altitude, error);
+        case PROGRAM_KIND_SPLINE:
+            return program_lookup_spline(self, input->altitude, error);
+        case PROGRAM_KIND_GRAVITY_TURN:
+            return program_gravity_turn(self, input, error);
+        case PROGRAM_KIND_CUSTOM:
+            return self->func(self, input, error);
+    }
+    *error = 1;
+    return 0.0;
+}
+
 #endif
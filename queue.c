@@ -0,0 +1,149 @@
+#include <stdlib.h>
+#include <sched.h>
+
+#include "queue.h"
+
+static ChannelNode *channel_pop(Channel *self);
+
+WorkQueue *work_queue_alloc(void) {
+    return (WorkQueue *)malloc(sizeof(WorkQueue));
+}
+
+void work_queue_dealloc(WorkQueue *self) {
+    pthread_cond_destroy(&self->not_full);
+    pthread_cond_destroy(&self->not_empty);
+    pthread_mutex_destroy(&self->mutex);
+    free(self->items);
+    free(self);
+}
+
+WorkQueue *work_queue_init(WorkQueue *self, size_t capacity) {
+    self->items = (void **)malloc(sizeof(void *) * capacity);
+    self->capacity = capacity;
+    self->head = 0;
+    self->count = 0;
+    self->closed = false;
+
+    pthread_mutex_init(&self->mutex, NULL);
+    pthread_cond_init(&self->not_empty, NULL);
+    pthread_cond_init(&self->not_full, NULL);
+
+    return self;
+}
+
+void work_queue_push(WorkQueue *self, void *item) {
+    pthread_mutex_lock(&self->mutex);
+    while(self->count == self->capacity)
+        pthread_cond_wait(&self->not_full, &self->mutex);
+    self->items[(self->head + self->count) % self->capacity] = item;
+    self->count++;
+    pthread_cond_signal(&self->not_empty);
+    pthread_mutex_unlock(&self->mutex);
+}
+
+void *work_queue_pop(WorkQueue *self) {
+    pthread_mutex_lock(&self->mutex);
+    while(self->count == 0 && !self->closed)
+        pthread_cond_wait(&self->not_empty, &self->mutex);
+
+    void *item = NULL;
+    if(self->count > 0) {
+        item = self->items[self->head];
+        self->head = (self->head + 1) % self->capacity;
+        self->count--;
+        pthread_cond_signal(&self->not_full);
+    }
+    pthread_mutex_unlock(&self->mutex);
+    return item;
+}
+
+void work_queue_close(WorkQueue *self) {
+    pthread_mutex_lock(&self->mutex);
+    self->closed = true;
+    pthread_cond_broadcast(&self->not_empty);
+    pthread_mutex_unlock(&self->mutex);
+}
+
+Channel *channel_alloc(void) {
+    return (Channel *)malloc(sizeof(Channel));
+}
+
+void channel_dealloc(Channel *self) {
+    sem_destroy(&self->ready);
+    free(self);
+}
+
+Channel *channel_init(Channel *self) {
+    atomic_init(&self->stub.next, NULL);
+    atomic_init(&self->head, &self->stub);
+    self->tail = &self->stub;
+    sem_init(&self->ready, 0, 0);
+    return self;
+}
+
+void channel_send(Channel *self, ChannelNode *node) {
+    atomic_store_explicit(&node->next, NULL, memory_order_relaxed);
+    ChannelNode *prev = atomic_exchange_explicit(&self->head, node, memory_order_acq_rel);
+    atomic_store_explicit(&prev->next, node, memory_order_release);
+    sem_post(&self->ready);
+}
+
+ChannelNode *channel_receive(Channel *self) {
+    while(sem_wait(&self->ready) != 0)
+        ; //Retry on EINTR.
+
+    //A node is ready, but a sender that got in ahead of it may not have linked
+    //itself in yet; that window is a couple of instructions wide, so just yield.
+    ChannelNode *node;
+    while((node = channel_pop(self)) == NULL)
+        sched_yield();
+    return node;
+}
+
+ChannelNode *channel_try_receive(Channel *self) {
+    if(sem_trywait(&self->ready) != 0)
+        return NULL;
+
+    ChannelNode *node;
+    while((node = channel_pop(self)) == NULL)
+        sched_yield();
+    return node;
+}
+
+/*
+ * Returns NULL if the queue is empty or a sender is part way through linking.
+ */
+static ChannelNode *channel_pop(Channel *self) {
+    ChannelNode *tail = self->tail;
+    ChannelNode *next = atomic_load_explicit(&tail->next, memory_order_acquire);
+
+    //Skip over the stub.
+    if(tail == &self->stub) {
+        if(next == NULL)
+            return NULL;
+        self->tail = next;
+        tail = next;
+        next = atomic_load_explicit(&next->next, memory_order_acquire);
+    }
+
+    if(next != NULL) {
+        self->tail = next;
+        return tail;
+    }
+
+    //The tail is the last linked node; if it isn't also the head, a send is in progress.
+    if(tail != atomic_load_explicit(&self->head, memory_order_acquire))
+        return NULL;
+
+    //Re-insert the stub behind the tail so the tail can be handed out.
+    atomic_store_explicit(&self->stub.next, NULL, memory_order_relaxed);
+    ChannelNode *prev = atomic_exchange_explicit(&self->head, &self->stub, memory_order_acq_rel);
+    atomic_store_explicit(&prev->next, &self->stub, memory_order_release);
+
+    next = atomic_load_explicit(&tail->next, memory_order_acquire);
+    if(next != NULL) {
+        self->tail = next;
+        return tail;
+    }
+    return NULL;
+}
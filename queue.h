@@ -0,0 +1,59 @@
+#ifndef KERBAL_LAUNCH_QUEUE_H
+#define KERBAL_LAUNCH_QUEUE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <semaphore.h>
+
+/*
+ * A bounded multi-producer/multi-consumer queue of pointers.  Pushes block while
+ * full, and pops block while empty until the queue is closed, after which they
+ * drain what remains and then return NULL.
+ */
+typedef struct WorkQueue {
+    void **items;
+    size_t capacity;
+    size_t head;
+    size_t count;
+    bool closed;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+} WorkQueue;
+
+WorkQueue *work_queue_alloc(void);
+void work_queue_dealloc(WorkQueue *self);
+WorkQueue *work_queue_init(WorkQueue *self, size_t capacity);
+
+void work_queue_push(WorkQueue *self, void *item);
+void *work_queue_pop(WorkQueue *self);
+void work_queue_close(WorkQueue *self);
+
+/*
+ * A lock-free multi-producer/single-consumer channel (an intrusive Vyukov queue).
+ * Embed a ChannelNode as the first member of the struct being sent.
+ * Senders never block; the single receiver sleeps on a semaphore while empty.
+ */
+typedef struct ChannelNode {
+    _Atomic(struct ChannelNode *) next;
+} ChannelNode;
+
+typedef struct Channel {
+    _Atomic(ChannelNode *) head; //Producers push here.
+    ChannelNode *tail; //Only touched by the consumer.
+    ChannelNode stub;
+    sem_t ready;
+} Channel;
+
+Channel *channel_alloc(void);
+void channel_dealloc(Channel *self);
+Channel *channel_init(Channel *self);
+
+void channel_send(Channel *self, ChannelNode *node);
+ChannelNode *channel_receive(Channel *self);
+ChannelNode *channel_try_receive(Channel *self);
+
+#endif
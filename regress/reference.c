@@ -0,0 +1,193 @@
+#include <stdlib.h>
+#include <math.h>
+
+#include "reference.h"
+#include "system.h"
+#include "optimizer.h"
+
+typedef struct ReferenceState {
+    long double x, y, vx, vy, m;
+} ReferenceState;
+
+//What is held fixed over a step.
+typedef struct ReferenceControls {
+    long double throttle;
+    long double cos_altitude_angle;
+    long double sin_altitude_angle;
+} ReferenceControls;
+
+static void reference_derivative(const Rocket *rocket, const Planetoid *planetoid, const ReferenceControls *controls, const ReferenceState *s, ReferenceState *d);
+static void reference_axpy(const ReferenceState *s, long double h, const ReferenceState *d, ReferenceState *out);
+static void reference_controls(const Planetoid *planetoid, const Program *throttle_program, const Program *altitude_angle_program, double throttle_cutoff_radius, const ReferenceState *s, ReferenceControls *controls);
+
+void reference_run(const Rocket *rocket, const Planetoid *planetoid, const Program *throttle_program, const Program *altitude_angle_program, double throttle_cutoff_radius, double steps_per_second, ReferenceResult *result) {
+    long double h = 1.0L / steps_per_second;
+    ReferenceState s = {VX(rocket->position), VY(rocket->position), VX(rocket->velocity), VY(rocket->velocity), rocket->mass};
+    long double px = VX(planetoid->position);
+    long double py = VY(planetoid->position);
+
+    unsigned long steps = 0;
+    long double time = 0.0L;
+    result->success = true;
+    for(;;) {
+        long double rx = s.x - px, ry = s.y - py;
+        long double r = sqrtl(rx*rx + ry*ry);
+        long double vr = (rx*s.vx + ry*s.vy) / r;
+        if(r < planetoid->radius)
+            break;
+        if(time > SYSTEM_MAX_MISSION_TIME) {
+            result->success = false;
+            break;
+        }
+
+        ReferenceControls controls;
+        reference_controls(planetoid, throttle_program, altitude_angle_program, throttle_cutoff_radius, &s, &controls);
+
+        ReferenceState k1, k2, k3, k4, t;
+        reference_derivative(rocket, planetoid, &controls, &s, &k1);
+        reference_axpy(&s, h/2.0L, &k1, &t);
+        reference_derivative(rocket, planetoid, &controls, &t, &k2);
+        reference_axpy(&s, h/2.0L, &k2, &t);
+        reference_derivative(rocket, planetoid, &controls, &t, &k3);
+        reference_axpy(&s, h, &k3, &t);
+        reference_derivative(rocket, planetoid, &controls, &t, &k4);
+
+        ReferenceState next = s;
+        next.x += h/6.0L * (k1.x + 2.0L*k2.x + 2.0L*k3.x + k4.x);
+        next.y += h/6.0L * (k1.y + 2.0L*k2.y + 2.0L*k3.y + k4.y);
+        next.vx += h/6.0L * (k1.vx + 2.0L*k2.vx + 2.0L*k3.vx + k4.vx);
+        next.vy += h/6.0L * (k1.vy + 2.0L*k2.vy + 2.0L*k3.vy + k4.vy);
+        next.m += h/6.0L * (k1.m + 2.0L*k2.m + 2.0L*k3.m + k4.m);
+        if(next.m < rocket->empty_mass)
+            next.m = rocket->empty_mass;
+        steps++;
+
+        //Apex: interpolate to where the radial velocity crossed zero.
+        long double nrx = next.x - px, nry = next.y - py;
+        long double next_vr = (nrx*next.vx + nry*next.vy) / sqrtl(nrx*nrx + nry*nry);
+        if(vr >= 0.0L && next_vr < 0.0L) {
+            long double f = vr / (vr - next_vr);
+            s.x += f * (next.x - s.x);
+            s.y += f * (next.y - s.y);
+            s.vx += f * (next.vx - s.vx);
+            s.vy += f * (next.vy - s.vy);
+            s.m += f * (next.m - s.m);
+            time += f * h;
+            break;
+        }
+
+        s = next;
+        time += h;
+    }
+
+    result->steps = steps;
+    result->time = time;
+    result->x = s.x;
+    result->y = s.y;
+    result->vx = s.vx;
+    result->vy = s.vy;
+    result->mass = s.m;
+}
+
+/*
+ * The optimizer's fitness of the reference apex, by handing optimizer_fitness
+ * a finished system holding it.
+ */
+double reference_fitness(const ReferenceResult *result, const Rocket *rocket, const Planetoid *planetoid, double throttle_cutoff_radius) {
+    Rocket apex_rocket = *rocket;
+    apex_rocket.position = vector_rect((double)result->x, (double)result->y);
+    apex_rocket.velocity = vector_rect((double)result->vx, (double)result->vy);
+    apex_rocket.mass = (double)result->mass;
+
+    System system;
+    system_init(&system);
+    system.rocket = &apex_rocket;
+    system.planetoid = planetoid;
+    system.throttle_cutoff_radius = throttle_cutoff_radius;
+    system.state = result->success ? SYSTEM_STATE_SUCCESS : SYSTEM_STATE_ERROR;
+    system.stats.frame.position = apex_rocket.position;
+    system.stats.frame.velocity = apex_rocket.velocity;
+    system.stats.frame.radius = planetoid_position_radius(planetoid, apex_rocket.position);
+    return optimizer_fitness(&system);
+}
+
+static void reference_derivative(const Rocket *rocket, const Planetoid *planetoid, const ReferenceControls *controls, const ReferenceState *s, ReferenceState *d) {
+    long double rx = s->x - VX(planetoid->position);
+    long double ry = s->y - VY(planetoid->position);
+    long double r = sqrtl(rx*rx + ry*ry);
+    long double altitude = r - planetoid->radius;
+
+    long double atm;
+    if(altitude >= planetoid->max_atmospheric_altitude)
+        atm = 0.0L;
+    else if(altitude >= 0.0L)
+        atm = expl(-altitude / planetoid->atmospheric_attenuation);
+    else
+        atm = 1.0L;
+
+    //Gravity.
+    long double g = -planetoid->gravitational_parameter / (r*r*r);
+    long double ax = g*rx;
+    long double ay = g*ry;
+
+    //Drag is proportional to mass in this model, so its acceleration is not.
+    long double v = sqrtl(s->vx*s->vx + s->vy*s->vy);
+    long double rho = atm * 1.2230948554874L * 0.008L;
+    long double drag = -0.5L * rho * rocket->max_drag * v;
+    ax += drag * s->vx;
+    ay += drag * s->vy;
+
+    //Thrust, at altitude_angle above the local horizon.
+    long double thrust = (s->m > rocket->empty_mass) ? controls->throttle * rocket->max_thrust : 0.0L;
+    //This is rocket_thrust_force's azm - pi/2 + altitude_angle, rotated without the atan2.
+    long double cos_azimuth = rx/r, sin_azimuth = ry/r;
+    long double ca = controls->cos_altitude_angle, sa = controls->sin_altitude_angle;
+    ax += thrust / s->m * (sin_azimuth*ca + cos_azimuth*sa);
+    ay += thrust / s->m * (sin_azimuth*sa - cos_azimuth*ca);
+
+    long double isp = atm*rocket->isp_atm + (1.0L-atm)*rocket->isp_vac;
+
+    d->x = s->vx;
+    d->y = s->vy;
+    d->vx = ax;
+    d->vy = ay;
+    d->m = -thrust / (isp * ISP_SURFACE_GRAVITY);
+}
+
+static void reference_axpy(const ReferenceState *s, long double h, const ReferenceState *d, ReferenceState *out) {
+    out->x = s->x + h*d->x;
+    out->y = s->y + h*d->y;
+    out->vx = s->vx + h*d->vx;
+    out->vy = s->vy + h*d->vy;
+    out->m = s->m + h*d->m;
+}
+
+//The same decisions as system_set_throttle and system_set_altitude_angle.
+static void reference_controls(const Planetoid *planetoid, const Program *throttle_program, const Program *altitude_angle_program, double throttle_cutoff_radius, const ReferenceState *s, ReferenceControls *controls) {
+    long double rx = s->x - VX(planetoid->position);
+    long double ry = s->y - VY(planetoid->position);
+    long double r = sqrtl(rx*rx + ry*ry);
+    long double mu = planetoid->gravitational_parameter;
+
+    ProgramInput input = {(double)(r - planetoid->radius), vector_rect((double)s->x, (double)s->y), vector_rect((double)s->vx, (double)s->vy), planetoid};
+    int error = 0;
+
+    controls->throttle = program_evaluate(throttle_program, &input, &error);
+    if(throttle_cutoff_radius > 0.0) {
+        long double energy = 0.5L*(s->vx*s->vx + s->vy*s->vy) - mu/r;
+        long double angular_momentum = rx*s->vy - ry*s->vx;
+        bool closed = energy < 0.0L;
+        long double apoapsis = 0.0L;
+        if(closed) {
+            long double radicand = 1.0L + 2.0L*angular_momentum*angular_momentum*energy/(mu*mu);
+            long double eccentricity = sqrtl(radicand > 0.0L ? radicand : 0.0L);
+            apoapsis = -mu/(2.0L*energy) * (1.0L + eccentricity);
+        }
+        if(!closed || apoapsis >= throttle_cutoff_radius)
+            controls->throttle = 0.0L;
+    }
+
+    long double altitude_angle = program_evaluate(altitude_angle_program, &input, &error);
+    controls->cos_altitude_angle = cosl(altitude_angle);
+    controls->sin_altitude_angle = sinl(altitude_angle);
+}
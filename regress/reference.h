@@ -0,0 +1,33 @@
+#ifndef KERBAL_LAUNCH_REFERENCE_H
+#define KERBAL_LAUNCH_REFERENCE_H
+
+#include <stdbool.h>
+
+#include "rocket.h"
+#include "planetoid.h"
+#include "program.h"
+
+#define REFERENCE_STEPS_PER_SECOND 10000.0
+
+/*
+ * A slow, careful integrator for the same flight model as System: long double
+ * state, classical RK4 at a small fixed step, and the apex found by
+ * interpolating the step where the radial velocity changes sign.  The programs
+ * and the throttle cutoff are sampled at the start of each step, as System does.
+ */
+typedef struct ReferenceResult {
+    bool success; //False if the mission time ran out.
+    unsigned long steps;
+    long double time;
+    long double x;
+    long double y;
+    long double vx;
+    long double vy;
+    long double mass;
+} ReferenceResult;
+
+void reference_run(const Rocket *rocket, const Planetoid *planetoid, const Program *throttle_program, const Program *altitude_angle_program, double throttle_cutoff_radius, double steps_per_second, ReferenceResult *result);
+
+double reference_fitness(const ReferenceResult *result, const Rocket *rocket, const Planetoid *planetoid, double throttle_cutoff_radius);
+
+#endif
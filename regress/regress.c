@@ -0,0 +1,321 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "reference.h"
+#include "system.h"
+#include "scenario.h"
+#include "optimizer.h"
+
+/*
+ * Golden-trajectory regression: flies a fixed set of scenarios through the
+ * engine and compares each apex and fitness against golden data made by the
+ * reference integrator, within explicit tolerances.  Run with --update to
+ * regenerate the golden file (slow; the reference takes 10000 steps a second).
+ *
+ * The default tolerances pass the engine as it stands at 100 ticks a second;
+ * a faster numerical path should be checked at the same tolerances before it
+ * is switched on by default.
+ */
+
+#ifndef REGRESS_GOLDEN_PATH
+#define REGRESS_GOLDEN_PATH "regress/golden.txt"
+#endif
+
+#define REGRESS_NAME_LENGTH 32
+#define REGRESS_ALTITUDE_TOLERANCE 50.0 //m
+#define REGRESS_VELOCITY_TOLERANCE 1.5 //m/s
+#define REGRESS_MASS_TOLERANCE 0.005 //t
+#define REGRESS_FITNESS_TOLERANCE 1.0 //m/s
+
+typedef struct RegressScenario {
+    const char *name;
+    InitFunc rocket_func;
+    void (*program_func)(Program **throttle_program, Program **altitude_angle_program);
+} RegressScenario;
+
+typedef struct RegressGolden {
+    char name[REGRESS_NAME_LENGTH];
+    bool success;
+    double time;
+    double altitude;
+    double vx;
+    double vy;
+    double mass;
+    double fitness;
+} RegressGolden;
+
+typedef struct RegressTolerance {
+    double altitude;
+    double velocity;
+    double mass;
+    double fitness;
+} RegressTolerance;
+
+static void regress_seed_programs(Program **throttle_program, Program **altitude_angle_program);
+static void regress_vertical_programs(Program **throttle_program, Program **altitude_angle_program);
+static void regress_gravity_turn_programs(Program **throttle_program, Program **altitude_angle_program);
+static void regress_spline_programs(Program **throttle_program, Program **altitude_angle_program);
+static void regress_optimized_programs(Program **throttle_program, Program **altitude_angle_program);
+
+static void regress_reference(const RegressScenario *scenario, const Planetoid *planetoid, double steps_per_second, RegressGolden *golden);
+static void regress_engine(const RegressScenario *scenario, const Planetoid *planetoid, double ticks_per_second, RegressGolden *result);
+static int regress_update(const Planetoid *planetoid, const char *path);
+static int regress_check(const Planetoid *planetoid, const char *path, double ticks_per_second, const RegressTolerance *tolerance);
+static bool regress_read_golden(FILE *file, RegressGolden *golden);
+
+static const RegressScenario regress_scenarios[] = {
+    {"seed-large", (InitFunc)init_large_rocket, regress_seed_programs},
+    {"seed-small", (InitFunc)init_small_rocket, regress_seed_programs},
+    {"vertical", (InitFunc)init_large_rocket, regress_vertical_programs},
+    {"gravity-turn", (InitFunc)init_large_rocket, regress_gravity_turn_programs},
+    {"spline", (InitFunc)init_large_rocket, regress_spline_programs},
+    {"optimized", (InitFunc)init_large_rocket, regress_optimized_programs},
+};
+#define REGRESS_SCENARIO_COUNT (sizeof(regress_scenarios)/sizeof(regress_scenarios[0]))
+
+static double regress_cutoff_radius(void) {
+    return kerbin_radius + 80000.0;
+}
+
+static void usage(const char *name) {
+    fprintf(stderr, "usage: %s [--update] [--golden FILE] [--rate TICKS_PER_SECOND]\n", name);
+    fprintf(stderr, "       [--altitude-tolerance M] [--velocity-tolerance M/S] [--mass-tolerance T] [--fitness-tolerance M/S]\n");
+}
+
+int main(int argc, char **argv) {
+    bool update = false;
+    const char *path = REGRESS_GOLDEN_PATH;
+    double ticks_per_second = SYSTEM_TICKS_PER_SECOND;
+    RegressTolerance tolerance = {REGRESS_ALTITUDE_TOLERANCE, REGRESS_VELOCITY_TOLERANCE, REGRESS_MASS_TOLERANCE, REGRESS_FITNESS_TOLERANCE};
+
+    for(int i=1; i<argc; i++) {
+        if( strcmp(argv[i], "--update") == 0 ) {
+            update = true;
+        } else if( strcmp(argv[i], "--golden") == 0 && i+1 < argc ) {
+            path = argv[++i];
+        } else if( strcmp(argv[i], "--rate") == 0 && i+1 < argc && atof(argv[i+1]) > 0.0 ) {
+            ticks_per_second = atof(argv[++i]);
+        } else if( strcmp(argv[i], "--altitude-tolerance") == 0 && i+1 < argc ) {
+            tolerance.altitude = atof(argv[++i]);
+        } else if( strcmp(argv[i], "--velocity-tolerance") == 0 && i+1 < argc ) {
+            tolerance.velocity = atof(argv[++i]);
+        } else if( strcmp(argv[i], "--mass-tolerance") == 0 && i+1 < argc ) {
+            tolerance.mass = atof(argv[++i]);
+        } else if( strcmp(argv[i], "--fitness-tolerance") == 0 && i+1 < argc ) {
+            tolerance.fitness = atof(argv[++i]);
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    Planetoid *kerbin = planetoid_init(planetoid_alloc());
+    kerbin_radius = kerbin->radius;
+
+    int result = update ? regress_update(kerbin, path) : regress_check(kerbin, path, ticks_per_second, &tolerance);
+
+    planetoid_dealloc(kerbin);
+    return result;
+}
+
+/*
+ * Writes the golden file from the reference integrator.  Each scenario is also
+ * flown at half the step rate, and the difference printed, as evidence that the
+ * reference has converged well inside the check tolerances.
+ */
+static int regress_update(const Planetoid *planetoid, const char *path) {
+    FILE *file = fopen(path, "w");
+    if(!file) {
+        perror(path);
+        return 1;
+    }
+
+    fprintf(file, "# KerbalLaunch golden apexes: reference RK4 at %.0f steps/s.\n", REFERENCE_STEPS_PER_SECOND);
+    fprintf(file, "# name success time altitude vx vy mass fitness\n");
+
+    printf("%-14s %12s %12s %12s %12s\n", "scenario", "altitude", "d_altitude", "d_velocity", "d_fitness");
+    for(size_t i=0; i<REGRESS_SCENARIO_COUNT; i++) {
+        RegressGolden golden, coarse;
+        regress_reference(&regress_scenarios[i], planetoid, REFERENCE_STEPS_PER_SECOND, &golden);
+        regress_reference(&regress_scenarios[i], planetoid, REFERENCE_STEPS_PER_SECOND/2.0, &coarse);
+
+        fprintf(file, "%s %d %.17g %.17g %.17g %.17g %.17g %.17g\n", golden.name, golden.success ? 1 : 0, golden.time, golden.altitude, golden.vx, golden.vy, golden.mass, golden.fitness);
+        printf("%-14s %12.3f %12.3g %12.3g %12.3g\n", golden.name, golden.altitude,
+                fabs(golden.altitude - coarse.altitude),
+                hypot(golden.vx - coarse.vx, golden.vy - coarse.vy),
+                fabs(golden.fitness - coarse.fitness));
+    }
+
+    fclose(file);
+    printf("Wrote %s\n", path);
+    return 0;
+}
+
+static int regress_check(const Planetoid *planetoid, const char *path, double ticks_per_second, const RegressTolerance *tolerance) {
+    FILE *file = fopen(path, "r");
+    if(!file) {
+        perror(path);
+        return 1;
+    }
+
+    printf("Engine at %.0f ticks/s against %s\n", ticks_per_second, path);
+    printf("%-14s %12s %12s %12s %12s  %s\n", "scenario", "d_altitude", "d_velocity", "d_mass", "d_fitness", "result");
+
+    unsigned checked = 0, failed = 0;
+    RegressGolden golden;
+    while( regress_read_golden(file, &golden) ) {
+        const RegressScenario *scenario = NULL;
+        for(size_t i=0; i<REGRESS_SCENARIO_COUNT; i++)
+            if( strcmp(regress_scenarios[i].name, golden.name) == 0 )
+                scenario = &regress_scenarios[i];
+        if(!scenario) {
+            printf("%-14s unknown scenario  FAIL\n", golden.name);
+            failed++;
+            continue;
+        }
+
+        RegressGolden engine;
+        regress_engine(scenario, planetoid, ticks_per_second, &engine);
+
+        double d_altitude = fabs(engine.altitude - golden.altitude);
+        double d_velocity = hypot(engine.vx - golden.vx, engine.vy - golden.vy);
+        double d_mass = fabs(engine.mass - golden.mass);
+        double d_fitness = fabs(engine.fitness - golden.fitness);
+        bool pass = engine.success == golden.success
+            && d_altitude <= tolerance->altitude
+            && d_velocity <= tolerance->velocity
+            && d_mass <= tolerance->mass
+            && d_fitness <= tolerance->fitness;
+
+        printf("%-14s %12.3f %12.4f %12.5f %12.4f  %s\n", golden.name, d_altitude, d_velocity, d_mass, d_fitness, pass ? "PASS" : "FAIL");
+        checked++;
+        if(!pass)
+            failed++;
+    }
+    fclose(file);
+
+    if(checked == 0) {
+        fprintf(stderr, "%s: no golden scenarios\n", path);
+        return 1;
+    }
+    printf("%u of %u scenarios within tolerance (altitude %g m, velocity %g m/s, mass %g t, fitness %g m/s)\n",
+            checked - failed, checked, tolerance->altitude, tolerance->velocity, tolerance->mass, tolerance->fitness);
+    return failed ? 1 : 0;
+}
+
+static bool regress_read_golden(FILE *file, RegressGolden *golden) {
+    char line[512];
+    while( fgets(line, sizeof(line), file) ) {
+        if(line[0] == '#' || line[0] == '\n')
+            continue;
+
+        int success;
+        int count = sscanf(line, "%31s %d %lf %lf %lf %lf %lf %lf", golden->name, &success, &golden->time, &golden->altitude, &golden->vx, &golden->vy, &golden->mass, &golden->fitness);
+        if(count != 8)
+            continue;
+        golden->success = success != 0;
+        return true;
+    }
+    return false;
+}
+
+static void regress_reference(const RegressScenario *scenario, const Planetoid *planetoid, double steps_per_second, RegressGolden *golden) {
+    Program *throttle_program, *altitude_angle_program;
+    scenario->program_func(&throttle_program, &altitude_angle_program);
+    Rocket *rocket = scenario->rocket_func(rocket_alloc());
+
+    ReferenceResult result;
+    reference_run(rocket, planetoid, throttle_program, altitude_angle_program, regress_cutoff_radius(), steps_per_second, &result);
+
+    strncpy(golden->name, scenario->name, REGRESS_NAME_LENGTH-1);
+    golden->name[REGRESS_NAME_LENGTH-1] = '\0';
+    golden->success = result.success;
+    golden->time = (double)result.time;
+    golden->altitude = planetoid_position_altitude(planetoid, vector_rect((double)result.x, (double)result.y));
+    golden->vx = (double)result.vx;
+    golden->vy = (double)result.vy;
+    golden->mass = (double)result.mass;
+    golden->fitness = reference_fitness(&result, rocket, planetoid, regress_cutoff_radius());
+
+    rocket_dealloc(rocket);
+    program_dealloc(throttle_program);
+    program_dealloc(altitude_angle_program);
+}
+
+static void regress_engine(const RegressScenario *scenario, const Planetoid *planetoid, double ticks_per_second, RegressGolden *result) {
+    Program *throttle_program, *altitude_angle_program;
+    scenario->program_func(&throttle_program, &altitude_angle_program);
+    Rocket *rocket = scenario->rocket_func(rocket_alloc());
+
+    System *system = system_init(system_alloc());
+    system->planetoid = planetoid;
+    system->rocket = rocket;
+    system->throttle_program = throttle_program;
+    system->altitude_angle_program = altitude_angle_program;
+    system->throttle_cutoff_radius = regress_cutoff_radius();
+    system->delta_t = 1.0/ticks_per_second;
+
+    system_run(system);
+
+    strncpy(result->name, scenario->name, REGRESS_NAME_LENGTH-1);
+    result->name[REGRESS_NAME_LENGTH-1] = '\0';
+    result->success = system->state == SYSTEM_STATE_SUCCESS;
+    result->time = system->stats.frame.time;
+    result->altitude = system->stats.frame.altitude;
+    result->vx = VX(system->stats.frame.velocity);
+    result->vy = VY(system->stats.frame.velocity);
+    result->mass = system->stats.frame.mass;
+    result->fitness = optimizer_fitness(system);
+
+    system_dealloc(system);
+    rocket_dealloc(rocket);
+    program_dealloc(throttle_program);
+    program_dealloc(altitude_angle_program);
+}
+
+static void regress_seed_programs(Program **throttle_program, Program **altitude_angle_program) {
+    *throttle_program = init_throttle_seed(program_init(program_alloc(), SCENARIO_SEED_LENGTH));
+    *altitude_angle_program = init_altitude_angle_seed(program_init(program_alloc(), SCENARIO_SEED_LENGTH));
+}
+
+//The flight in main's simulate_vertical: full throttle, straight up.
+static void regress_vertical_programs(Program **throttle_program, Program **altitude_angle_program) {
+    *throttle_program = program_init(program_alloc(), 1);
+    (*throttle_program)->altitudes[0] = -600000.0;
+    (*throttle_program)->settings[0] = 1.0;
+
+    *altitude_angle_program = program_init(program_alloc(), 1);
+    (*altitude_angle_program)->altitudes[0] = -600000.0;
+    (*altitude_angle_program)->settings[0] = M_PI/2.0;
+}
+
+//As --controller gravity-turn seeds it.
+static void regress_gravity_turn_programs(Program **throttle_program, Program **altitude_angle_program) {
+    *throttle_program = init_throttle_seed(program_init(program_alloc(), SCENARIO_SEED_LENGTH));
+    (*throttle_program)->kind = PROGRAM_KIND_LINEAR;
+    *altitude_angle_program = init_gravity_turn_seed(program_init(program_alloc(), SCENARIO_GRAVITY_TURN_LENGTH));
+}
+
+static void regress_spline_programs(Program **throttle_program, Program **altitude_angle_program) {
+    regress_seed_programs(throttle_program, altitude_angle_program);
+    (*throttle_program)->kind = PROGRAM_KIND_SPLINE;
+    (*altitude_angle_program)->kind = PROGRAM_KIND_SPLINE;
+}
+
+//A program the optimizer found for the large rocket; it reaches the cutoff with fuel to spare.
+static void regress_optimized_programs(Program **throttle_program, Program **altitude_angle_program) {
+    static const double altitudes[SCENARIO_SEED_LENGTH] = {-600000.0, 1000.0, 2000.0, 5000.0, 12000.0, 23000.0, 35000.0, 45000.0, 60000.0};
+    static const double throttle_fifteenths[SCENARIO_SEED_LENGTH] = {15, 15, 15, 15, 15, 12, 9, 10, 2};
+    static const double altitude_angle_degrees[SCENARIO_SEED_LENGTH] = {90, 90, 90, 90, 70, 30, 15, 5, 5};
+
+    *throttle_program = program_init(program_alloc(), SCENARIO_SEED_LENGTH);
+    *altitude_angle_program = program_init(program_alloc(), SCENARIO_SEED_LENGTH);
+    for(size_t i=0; i<SCENARIO_SEED_LENGTH; i++) {
+        (*throttle_program)->altitudes[i] = altitudes[i];
+        (*throttle_program)->settings[i] = throttle_fifteenths[i] / 15.0;
+        (*altitude_angle_program)->altitudes[i] = altitudes[i];
+        (*altitude_angle_program)->settings[i] = altitude_angle_degrees[i] * DEGREE;
+    }
+}
@@ -0,0 +1,49 @@
+#include <math.h>
+
+#include "rng.h"
+
+static uint64_t rng_rotl(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+Rng *rng_init(Rng *self, uint64_t seed) {
+    //Expand the seed with splitmix64, which never produces the all-zero state.
+    for(int i=0; i<4; i++) {
+        uint64_t z = (seed += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        self->state[i] = z ^ (z >> 31);
+    }
+    return self;
+}
+
+uint64_t rng_next(Rng *self) {
+    uint64_t *s = self->state;
+    uint64_t result = rng_rotl(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rng_rotl(s[3], 45);
+
+    return result;
+}
+
+unsigned rng_uniform(Rng *self, unsigned n) {
+    //Multiply-shift; the bias is at most n/2^32, far below anything we care about.
+    return (unsigned)(((rng_next(self) >> 32) * (uint64_t)n) >> 32);
+}
+
+double rng_double(Rng *self) {
+    return (rng_next(self) >> 11) * 0x1.0p-53;
+}
+
+//Box-Muller; the second value is discarded so the state stays just the generator.
+double rng_gaussian(Rng *self) {
+    double u = 1.0 - rng_double(self); //In (0.0,1.0], so the log is finite.
+    double v = rng_double(self);
+    return sqrt(-2.0*log(u)) * cos(2.0*M_PI*v);
+}
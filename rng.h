@@ -0,0 +1,21 @@
+#ifndef KERBAL_LAUNCH_RNG_H
+#define KERBAL_LAUNCH_RNG_H
+
+#include <stdint.h>
+
+/*
+ * A small, fast pseudo-random generator (xoshiro256**) whose whole state can be
+ * saved and restored, unlike rand().  Not thread safe; give each thread its own.
+ */
+typedef struct Rng {
+    uint64_t state[4];
+} Rng;
+
+Rng *rng_init(Rng *self, uint64_t seed);
+
+uint64_t rng_next(Rng *self);
+unsigned rng_uniform(Rng *self, unsigned n); //In [0,n).
+double rng_double(Rng *self); //In [0.0,1.0).
+double rng_gaussian(Rng *self); //Standard normal.
+
+#endif
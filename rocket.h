@@ -28,7 +28,6 @@ Rocket *rocket_init(Rocket *self);
 
 double rocket_isp(const Rocket *self, double atm);
 double rocket_thrust(const Rocket *self, double atm);
-Vector rocket_thrust_force(const Rocket *self, double atm, double azm);
 double rocket_mass_flow(const Rocket *self, double atm);
 double rocket_drag(const Rocket *self);
 
@@ -0,0 +1,79 @@
+#include <stdlib.h>
+#include <assert.h>
+
+#include "scenario.h"
+
+double kerbin_radius;
+
+Rocket *init_small_rocket(Rocket *rocket) {
+    rocket_init(rocket);
+
+    rocket->mass = 4.45;
+    rocket->empty_mass = 4.45-2.0;
+
+    rocket->max_thrust = 215.0;
+    rocket->isp_vac = 370.0;
+    rocket->isp_atm = 320.0;
+
+    rocket->max_drag = 0.2;
+
+    return scenario_place_rocket(rocket, kerbin_radius);
+}
+
+Rocket *init_large_rocket(Rocket *rocket) {
+    rocket_init(rocket);
+
+    rocket->mass = 15.70;
+    rocket->empty_mass = 15.70-12.0;
+
+    rocket->max_thrust = 215.0;
+    rocket->isp_vac = 370.0;
+    rocket->isp_atm = 320.0;
+
+    rocket->max_drag = 0.2;
+
+    return scenario_place_rocket(rocket, kerbin_radius);
+}
+
+Rocket *scenario_place_rocket(Rocket *rocket, double planetoid_radius) {
+    rocket->position.v[1] = planetoid_radius + 72.0; // Small rocket sits at 72.0m on pad.
+    rocket->velocity.v[0] = planetoid_radius * 0.0002908882086657216; // Surface rotational velocity.
+    return rocket;
+}
+
+Program *init_throttle_seed(Program *program) {
+    const size_t dim = SCENARIO_SEED_LENGTH;
+    assert(program->length == dim);
+    double altitudes[] = {-600000.0, 1000.0, 2000.0, 5000.0, 12000.0, 23000.0, 35000.0, 45000.0, 60000.0};
+    //double settings[] = {1.0, 0.9, 0.7, 0.5, 0.6, 0.8, 0.8, 0.9, 1.0};
+    double settings[] = {15, 15, 15, 15, 15, 8, 12, 4, 8};
+    for(size_t i=0; i<dim; i++) {
+        program->altitudes[i] = altitudes[i];
+        program->settings[i] = settings[i] * FIFTEENTH;
+    }
+    return program;
+}
+
+Program *init_altitude_angle_seed(Program *program) {
+    const size_t dim = SCENARIO_SEED_LENGTH;
+    assert(program->length == dim);
+    double altitudes[] = {-600000.0, 1000.0, 2000.0, 5000.0, 12000.0, 23000.0, 35000.0, 45000.0, 60000.0};
+    //double settings[] = {90*DEGREE, 85*DEGREE, 85*DEGREE, 90*DEGREE, 45*DEGREE, 30*DEGREE, 10*DEGREE, 5*DEGREE, 0*DEGREE};
+    double settings_degree[] ={90.0, 90.0, 90.0, 85.0, 50.0, 20.0, 10.0, 5.0, 0.0};
+    for(size_t i=0; i<dim; i++) {
+        program->altitudes[i] = altitudes[i];
+        program->settings[i] = settings_degree[i] * DEGREE;
+    }
+    return program;
+}
+
+//Climb vertically to 1km, then kick to 80 degrees and follow prograde.
+Program *init_gravity_turn_seed(Program *program) {
+    assert(program->length == SCENARIO_GRAVITY_TURN_LENGTH);
+    program->kind = PROGRAM_KIND_GRAVITY_TURN;
+    program->altitudes[0] = -600000.0;
+    program->settings[0] = 90.0 * DEGREE;
+    program->altitudes[1] = 1000.0;
+    program->settings[1] = 80.0 * DEGREE;
+    return program;
+}
@@ -0,0 +1,30 @@
+#ifndef KERBAL_LAUNCH_SCENARIO_H
+#define KERBAL_LAUNCH_SCENARIO_H
+
+#include <stdlib.h>
+
+#include "rocket.h"
+#include "program.h"
+
+#define TWELFTH 0.16666666666666666
+#define FIFTEENTH 0.06666666666666667
+
+#define SCENARIO_SEED_LENGTH 9
+#define SCENARIO_GRAVITY_TURN_LENGTH 2
+
+/*
+ * The standard rockets and seed programs for launching from Kerbin.
+ * The rockets are placed on the pad using kerbin_radius, which must be set first;
+ * scenario_place_rocket moves one onto the pad of another planetoid.
+ */
+extern double kerbin_radius;
+
+Rocket *init_small_rocket(Rocket *rocket);
+Rocket *init_large_rocket(Rocket *rocket);
+Rocket *scenario_place_rocket(Rocket *rocket, double planetoid_radius);
+
+Program *init_throttle_seed(Program *program);
+Program *init_altitude_angle_seed(Program *program);
+Program *init_gravity_turn_seed(Program *program);
+
+#endif
@@ -0,0 +1,313 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "server.h"
+#include "optimizer.h"
+#include "scenario.h"
+
+#define SERVER_DEFAULT_EVALUATIONS 4096
+#define SERVER_DEFAULT_TARGET_ALTITUDE 80000.0
+#define SERVER_PAD_ALTITUDE 72.0
+
+//A connection and everything its job owns.
+typedef struct ServerJob {
+    Server *server;
+    unsigned long id;
+    FILE *in;
+    FILE *out;
+
+    Rocket rocket;
+    Planetoid planetoid;
+    Program *throttle_program;
+    Program *altitude_angle_program;
+    double target_altitude;
+    unsigned long evaluations;
+    uint64_t seed;
+    bool seeded;
+} ServerJob;
+
+static volatile sig_atomic_t server_stopping = 0;
+
+static void server_handle_signal(int signal_number);
+static void *server_job_main(ServerJob *job);
+static bool server_job_read(ServerJob *job, char *error, size_t error_size);
+static void server_write_program(FILE *out, const char *name, const Program *program, double conversion);
+static void server_job_progress(const Optimizer *optimizer, void *context);
+static void server_job_dealloc(ServerJob *job);
+
+Server *server_alloc(void) {
+    return (Server *)malloc(sizeof(Server));
+}
+
+void server_dealloc(Server *self) {
+    if(self->fd >= 0) {
+        close(self->fd);
+        unlink(self->path);
+    }
+    worker_pool_dealloc(self->pool);
+    fitness_cache_dealloc(self->cache);
+    pthread_cond_destroy(&self->idle);
+    pthread_mutex_destroy(&self->mutex);
+    free(self->path);
+    free(self);
+}
+
+Server *server_init(Server *self, const char *path, unsigned workers) {
+    self->path = strdup(path);
+    self->fd = -1;
+    self->pool = worker_pool_init(worker_pool_alloc(), workers);
+    self->cache = fitness_cache_init(fitness_cache_alloc(), FITNESS_CACHE_DEFAULT_CAPACITY);
+    self->library = NULL;
+    self->next_job = 1;
+    self->running = 0;
+    pthread_mutex_init(&self->mutex, NULL);
+    pthread_cond_init(&self->idle, NULL);
+    return self;
+}
+
+//Binds the socket, replacing a stale one left by a previous server.
+bool server_open(Server *self) {
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if(strlen(self->path) >= sizeof(address.sun_path))
+        return false;
+    strcpy(address.sun_path, self->path);
+
+    self->fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(self->fd < 0)
+        return false;
+    unlink(self->path);
+    if(bind(self->fd, (struct sockaddr *)&address, sizeof(address)) != 0 || listen(self->fd, SERVER_BACKLOG) != 0) {
+        close(self->fd);
+        self->fd = -1;
+        return false;
+    }
+    return true;
+}
+
+/*
+ * Accepts jobs until SIGINT or SIGTERM, then waits for the running jobs to
+ * finish.
+ */
+void server_run(Server *self) {
+    //A client hanging up mid-reply must not kill the server.
+    signal(SIGPIPE, SIG_IGN);
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = server_handle_signal;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, NULL); //No SA_RESTART, so accept returns.
+    sigaction(SIGTERM, &action, NULL);
+
+    while(!server_stopping) {
+        int fd = accept(self->fd, NULL, NULL);
+        if(fd < 0) {
+            if(errno == EINTR || errno == ECONNABORTED)
+                continue;
+            break;
+        }
+
+        ServerJob *job = (ServerJob *)calloc(1, sizeof(ServerJob));
+        job->server = self;
+        job->in = fdopen(fd, "r");
+        job->out = fdopen(dup(fd), "w");
+
+        pthread_mutex_lock(&self->mutex);
+        job->id = self->next_job++;
+        self->running++;
+        pthread_mutex_unlock(&self->mutex);
+
+        pthread_t thread;
+        pthread_create(&thread, NULL, (void *(*)(void *))server_job_main, job);
+        pthread_detach(thread);
+    }
+
+    pthread_mutex_lock(&self->mutex);
+    while(self->running > 0)
+        pthread_cond_wait(&self->idle, &self->mutex);
+    pthread_mutex_unlock(&self->mutex);
+}
+
+static void server_handle_signal(int signal_number) {
+    (void)signal_number;
+    server_stopping = 1;
+}
+
+static void *server_job_main(ServerJob *job) {
+    Server *server = job->server;
+    char error[256];
+
+    if(!server_job_read(job, error, sizeof(error))) {
+        fprintf(job->out, "error %s\n", error);
+    } else {
+        fprintf(job->out, "accepted %lu\n", job->id);
+        fflush(job->out);
+
+        Optimizer *optimizer = optimizer_init(optimizer_alloc());
+        optimizer->rocket_prototype = &job->rocket;
+        optimizer->planetoid = &job->planetoid;
+        optimizer->seed_throttle_program = job->throttle_program;
+        optimizer->seed_altitude_angle_program = job->altitude_angle_program;
+        optimizer->throttle_cutoff_radius = job->planetoid.radius + job->target_altitude;
+        optimizer->generations = (unsigned)((job->evaluations + optimizer->children - 1) / optimizer->children);
+        optimizer->mode = OPTIMIZER_MODE_STEADY_STATE;
+        optimizer->pool = server->pool;
+        optimizer->cache = server->cache;
+        optimizer->library = server->library;
+        optimizer->progress_func = server_job_progress;
+        optimizer->progress_context = job;
+        optimizer->quiet = true;
+        if(job->seeded)
+            rng_init(&optimizer->rng, job->seed);
+
+        optimizer_run(optimizer);
+
+        fprintf(job->out, "result %f\n", optimizer->best_fitness);
+        server_write_program(job->out, "throttle", optimizer->best_throttle_program, 1.0);
+        server_write_program(job->out, "altitude_angle", optimizer->best_altitude_angle_program, 180.0/M_PI);
+        fprintf(job->out, "cache %f\n", fitness_cache_hit_rate(server->cache));
+        fprintf(job->out, "done\n");
+        optimizer_dealloc(optimizer);
+    }
+
+    server_job_dealloc(job);
+
+    pthread_mutex_lock(&server->mutex);
+    server->running--;
+    pthread_cond_signal(&server->idle);
+    pthread_mutex_unlock(&server->mutex);
+    return NULL;
+}
+
+static bool server_job_read(ServerJob *job, char *error, size_t error_size) {
+    planetoid_init(&job->planetoid);
+    init_large_rocket(&job->rocket);
+    job->target_altitude = SERVER_DEFAULT_TARGET_ALTITUDE;
+    job->evaluations = SERVER_DEFAULT_EVALUATIONS;
+    ProgramKind controller = PROGRAM_KIND_STEP;
+
+    char line[SERVER_LINE_LENGTH];
+    bool run = false;
+    while(!run && fgets(line, sizeof(line), job->in)) {
+        char *save = NULL;
+        char *key = strtok_r(line, " \t\r\n", &save);
+        char *value = strtok_r(NULL, " \t\r\n", &save);
+        char *rest = strtok_r(NULL, "\r\n", &save);
+        double number = value ? atof(value) : 0.0;
+        if(key == NULL || key[0] == '#') {
+            continue;
+        } else if(strcmp(key, "run") == 0) {
+            run = true;
+        } else if(value == NULL) {
+            snprintf(error, error_size, "%s needs a value", key);
+            return false;
+        } else if(strcmp(key, "rocket") == 0 && strcmp(value, "small") == 0) {
+            init_small_rocket(&job->rocket);
+        } else if(strcmp(key, "rocket") == 0 && strcmp(value, "large") == 0) {
+            init_large_rocket(&job->rocket);
+        } else if(strcmp(key, "mass") == 0) {
+            job->rocket.mass = number;
+        } else if(strcmp(key, "empty_mass") == 0) {
+            job->rocket.empty_mass = number;
+        } else if(strcmp(key, "max_thrust") == 0) {
+            job->rocket.max_thrust = number;
+        } else if(strcmp(key, "isp_vac") == 0) {
+            job->rocket.isp_vac = number;
+        } else if(strcmp(key, "isp_atm") == 0) {
+            job->rocket.isp_atm = number;
+        } else if(strcmp(key, "max_drag") == 0) {
+            job->rocket.max_drag = number;
+        } else if(strcmp(key, "radius") == 0) {
+            job->planetoid.radius = number;
+        } else if(strcmp(key, "gravitational_parameter") == 0) {
+            job->planetoid.gravitational_parameter = number;
+        } else if(strcmp(key, "rotational_period") == 0) {
+            job->planetoid.rotational_period = number;
+        } else if(strcmp(key, "atmospheric_attenuation") == 0) {
+            job->planetoid.atmospheric_attenuation = number;
+        } else if(strcmp(key, "max_atmospheric_altitude") == 0) {
+            job->planetoid.max_atmospheric_altitude = number;
+        } else if(strcmp(key, "target_altitude") == 0) {
+            job->target_altitude = number;
+        } else if(strcmp(key, "evaluations") == 0) {
+            job->evaluations = strtoul(value, NULL, 10);
+        } else if(strcmp(key, "seed") == 0) {
+            job->seed = strtoull(value, NULL, 10);
+            job->seeded = true;
+        } else if(strcmp(key, "controller") == 0 && program_kind_parse(value, &controller)) {
+            continue;
+        } else if(strcmp(key, "throttle") == 0 || strcmp(key, "altitude_angle") == 0) {
+            bool throttle = strcmp(key, "throttle") == 0;
+            Program **program = throttle ? &job->throttle_program : &job->altitude_angle_program;
+            ProgramKind kind;
+            if(*program || !rest || !program_kind_parse(value, &kind) || (*program = program_parse(rest, throttle ? 1.0 : M_PI/180.0)) == NULL) {
+                snprintf(error, error_size, "bad %s program", key);
+                return false;
+            }
+            (*program)->kind = kind;
+        } else {
+            snprintf(error, error_size, "unknown %s", key);
+            return false;
+        }
+    }
+    if(!run) {
+        snprintf(error, error_size, "request ended without run");
+        return false;
+    }
+    if(job->evaluations == 0 || !(job->rocket.mass > job->rocket.empty_mass) || !(job->planetoid.radius > 0.0)) {
+        snprintf(error, error_size, "bad scenario");
+        return false;
+    }
+
+    //Sit the rocket on the pad of this planetoid, turning with it.
+    double radius = job->planetoid.radius;
+    job->rocket.position = vector_rect(0.0, radius + SERVER_PAD_ALTITUDE);
+    job->rocket.velocity = vector_rect(2.0*M_PI*radius/job->planetoid.rotational_period, 0.0);
+
+    //Seeds not given in full come from the standard scenario.
+    if(job->throttle_program == NULL) {
+        job->throttle_program = init_throttle_seed(program_init(program_alloc(), SCENARIO_SEED_LENGTH));
+        job->throttle_program->kind = (controller == PROGRAM_KIND_GRAVITY_TURN) ? PROGRAM_KIND_LINEAR : controller;
+    }
+    if(job->altitude_angle_program == NULL) {
+        if(controller == PROGRAM_KIND_GRAVITY_TURN) {
+            job->altitude_angle_program = init_gravity_turn_seed(program_init(program_alloc(), SCENARIO_GRAVITY_TURN_LENGTH));
+        } else {
+            job->altitude_angle_program = init_altitude_angle_seed(program_init(program_alloc(), SCENARIO_SEED_LENGTH));
+            job->altitude_angle_program->kind = controller;
+        }
+    }
+    return true;
+}
+
+static void server_write_program(FILE *out, const char *name, const Program *program, double conversion) {
+    fprintf(out, "%s %s", name, program_kind_name(program->kind));
+    for(size_t i=0; i<program->length; i++)
+        fprintf(out, " %.0f:%.6f", program->altitudes[i], conversion*program->settings[i]);
+    fprintf(out, "\n");
+}
+
+static void server_job_progress(const Optimizer *optimizer, void *context) {
+    ServerJob *job = (ServerJob *)context;
+    fprintf(job->out, "progress %u %u %lu %f\n", optimizer->generation, optimizer->generations, optimizer->evaluations, optimizer->best_fitness);
+    fflush(job->out);
+}
+
+static void server_job_dealloc(ServerJob *job) {
+    if(job->throttle_program)
+        program_dealloc(job->throttle_program);
+    if(job->altitude_angle_program)
+        program_dealloc(job->altitude_angle_program);
+    fclose(job->out);
+    fclose(job->in);
+    free(job);
+}
@@ -0,0 +1,60 @@
+#ifndef KERBAL_LAUNCH_SERVER_H
+#define KERBAL_LAUNCH_SERVER_H
+
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "pool.h"
+#include "cache.h"
+#include "library.h"
+
+#define SERVER_BACKLOG 16
+#define SERVER_LINE_LENGTH 4096
+
+/*
+ * A resident optimizer.  It listens on a Unix socket, and runs each connection
+ * as a job on its own thread, all sharing one worker pool (scheduled fairly
+ * between jobs), one fitness cache, and optionally one warm-start library, so
+ * a job starts with everything already warm.
+ *
+ * A job is a request of "key value..." lines ending with "run":
+ *   rocket small|large                  the starting rocket (default large)
+ *   mass|empty_mass|max_thrust|isp_vac|isp_atm|max_drag VALUE
+ *   radius|gravitational_parameter|rotational_period|atmospheric_attenuation|max_atmospheric_altitude VALUE
+ *   target_altitude METRES              (default 80000)
+ *   controller step|linear|spline|gravity-turn
+ *   throttle|altitude_angle KIND ALTITUDE:SETTING...   explicit seed; angles in degrees
+ *   evaluations N                       the budget (default 4096)
+ *   seed N                              for the random generator
+ * and the reply is streamed back as lines:
+ *   accepted ID
+ *   progress GENERATION GENERATIONS EVALUATIONS BEST_FITNESS
+ *   result FITNESS
+ *   throttle KIND ALTITUDE:SETTING...
+ *   altitude_angle KIND ALTITUDE:SETTING...
+ *   cache HIT_RATE
+ *   done
+ * or "error MESSAGE" if the request was refused.
+ */
+typedef struct Server {
+    char *path;
+    int fd;
+
+    WorkerPool *pool;
+    FitnessCache *cache;
+    Library *library; //Not owned; may be NULL.
+
+    unsigned long next_job;
+    unsigned running;
+    pthread_mutex_t mutex;
+    pthread_cond_t idle;
+} Server;
+
+Server *server_alloc(void);
+void server_dealloc(Server *self);
+Server *server_init(Server *self, const char *path, unsigned workers);
+
+bool server_open(Server *self);
+void server_run(Server *self);
+
+#endif
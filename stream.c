@@ -0,0 +1,192 @@
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "stream.h"
+
+static const char stream_magic[4] = {'K', 'L', 'S', 'T'};
+
+Stream *stream_alloc(void) {
+    return (Stream *)malloc(sizeof(Stream));
+}
+
+void stream_dealloc(Stream *self) {
+    if(self->header)
+        munmap(self->header, self->size);
+    free(self->name);
+    free(self);
+}
+
+/*
+ * Creates the shared-memory segment, replacing any earlier one of the same name;
+ * readers still attached to an old segment keep it until they detach.
+ * On failure the stream is left closed; check with stream_is_open.
+ */
+Stream *stream_init(Stream *self, const char *name, uint32_t capacity) {
+    self->name = strdup(name);
+    self->size = sizeof(StreamHeader) + (size_t)capacity * sizeof(StreamSlot);
+    self->header = NULL;
+    self->slots = NULL;
+    self->head = 0;
+
+    shm_unlink(name);
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0644);
+    if(fd < 0)
+        return self;
+
+    void *map = MAP_FAILED;
+    if(ftruncate(fd, (off_t)self->size) == 0)
+        map = mmap(NULL, self->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if(map == MAP_FAILED) {
+        shm_unlink(name);
+        return self;
+    }
+
+    //The segment is zero filled, so every slot starts with sequence 0 (never written).
+    self->header = (StreamHeader *)map;
+    self->slots = (StreamSlot *)((char *)map + sizeof(StreamHeader));
+    self->header->version = STREAM_VERSION;
+    self->header->capacity = capacity;
+    self->header->frame_size = sizeof(Frame);
+    atomic_store_explicit(&self->header->head, 0, memory_order_relaxed);
+    atomic_store_explicit(&self->header->closed, 0, memory_order_relaxed);
+
+    //Publishing the magic last tells readers the header is ready.
+    atomic_thread_fence(memory_order_release);
+    memcpy(self->header->magic, stream_magic, sizeof(stream_magic));
+
+    return self;
+}
+
+bool stream_is_open(const Stream *self) {
+    return self->header != NULL;
+}
+
+void stream_publish(Stream *self, const Frame *frame) {
+    if(self->header == NULL)
+        return;
+
+    uint64_t n = self->head;
+    StreamSlot *slot = &self->slots[n % self->header->capacity];
+
+    atomic_store_explicit(&slot->sequence, 2*n + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    slot->frame = *frame;
+    atomic_store_explicit(&slot->sequence, 2*(n + 1), memory_order_release);
+
+    self->head = n + 1;
+    atomic_store_explicit(&self->header->head, n + 1, memory_order_release);
+}
+
+/*
+ * Tells readers no more frames are coming.  The segment name stays until the
+ * next stream of the same name is created, so late readers can still drain it.
+ */
+void stream_close(Stream *self) {
+    if(self->header)
+        atomic_store_explicit(&self->header->closed, 1, memory_order_release);
+}
+
+StreamReader *stream_reader_alloc(void) {
+    return (StreamReader *)malloc(sizeof(StreamReader));
+}
+
+void stream_reader_dealloc(StreamReader *self) {
+    if(self->header)
+        munmap((void *)self->header, self->size);
+    free(self);
+}
+
+/*
+ * Attaches to a stream, starting from the oldest frame still in the buffer.
+ * On failure the reader is left closed; check with stream_reader_is_open.
+ */
+StreamReader *stream_reader_init(StreamReader *self, const char *name) {
+    self->size = 0;
+    self->header = NULL;
+    self->slots = NULL;
+    self->next = 0;
+    self->dropped = 0;
+
+    int fd = shm_open(name, O_RDONLY, 0);
+    if(fd < 0)
+        return self;
+
+    struct stat st;
+    void *map = MAP_FAILED;
+    if(fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(StreamHeader))
+        map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if(map == MAP_FAILED)
+        return self;
+
+    const StreamHeader *header = (const StreamHeader *)map;
+    bool ok = memcmp(header->magic, stream_magic, sizeof(stream_magic)) == 0;
+    atomic_thread_fence(memory_order_acquire);
+    ok = ok && header->version == STREAM_VERSION
+        && header->frame_size == sizeof(Frame)
+        && sizeof(StreamHeader) + (size_t)header->capacity * sizeof(StreamSlot) <= (size_t)st.st_size;
+    if(!ok) {
+        munmap(map, (size_t)st.st_size);
+        return self;
+    }
+
+    self->size = (size_t)st.st_size;
+    self->header = header;
+    self->slots = (const StreamSlot *)((const char *)map + sizeof(StreamHeader));
+
+    uint64_t head = atomic_load_explicit(&header->head, memory_order_acquire);
+    self->next = (head > header->capacity) ? head - header->capacity : 0;
+
+    return self;
+}
+
+bool stream_reader_is_open(const StreamReader *self) {
+    return self->header != NULL;
+}
+
+/*
+ * Copies out the next frame if there is one.  Never blocks.
+ */
+StreamRead stream_reader_next(StreamReader *self, Frame *frame) {
+    if(self->header == NULL)
+        return STREAM_READ_CLOSED;
+
+    uint32_t capacity = self->header->capacity;
+    while(true) {
+        //Check closed before head, so a frame published just before closing isn't missed.
+        bool closed = atomic_load_explicit(&self->header->closed, memory_order_acquire) != 0;
+        uint64_t head = atomic_load_explicit(&self->header->head, memory_order_acquire);
+        if(self->next >= head)
+            return closed ? STREAM_READ_CLOSED : STREAM_READ_EMPTY;
+
+        //Fell behind by more than the buffer holds.
+        if(head - self->next > capacity) {
+            self->dropped += (head - capacity) - self->next;
+            self->next = head - capacity;
+        }
+
+        const StreamSlot *slot = &self->slots[self->next % capacity];
+        uint64_t expected = 2*(self->next + 1);
+        uint64_t before = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        if(before == expected) {
+            *frame = slot->frame;
+            atomic_thread_fence(memory_order_acquire);
+            uint64_t after = atomic_load_explicit(&slot->sequence, memory_order_relaxed);
+            if(after == expected) {
+                self->next++;
+                return STREAM_READ_FRAME;
+            }
+        }
+
+        //The writer has lapped this slot since head was read; skip the lost frame.
+        if(before > expected || before % 2 == 1) {
+            self->next++;
+            self->dropped++;
+        }
+    }
+}
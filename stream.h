@@ -0,0 +1,78 @@
+#ifndef KERBAL_LAUNCH_STREAM_H
+#define KERBAL_LAUNCH_STREAM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+#include "frame.h"
+
+#define STREAM_VERSION 1
+#define STREAM_DEFAULT_CAPACITY 4096 //Frames; a power of two.
+#define STREAM_DEFAULT_NAME "/kerbal_launch"
+
+/*
+ * A live feed of Frames through a POSIX shared-memory ring buffer, so local
+ * plotters can follow a simulation while it runs.
+ *
+ * There is one writer and any number of readers; readers never block or slow
+ * the writer.  Frame n is written to slot n % capacity, guarded by a per-slot
+ * sequence number: odd while the slot is being written, 2(n+1) once frame n is
+ * complete.  A reader copies the frame and rechecks the sequence, so it either
+ * gets a whole frame or learns that the writer lapped it and skips ahead.
+ * Frames are stored in the writer's native layout, so readers must be built
+ * from the same frame.h on the same machine.
+ */
+typedef struct StreamSlot {
+    _Alignas(64) atomic_uint_fast64_t sequence;
+    Frame frame;
+} StreamSlot;
+
+typedef struct StreamHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t capacity;
+    uint32_t frame_size;
+    _Alignas(64) atomic_uint_fast64_t head; //Frames published so far.
+    atomic_uint closed; //Set when the writer is done.
+} StreamHeader;
+
+typedef struct Stream {
+    char *name;
+    size_t size;
+    StreamHeader *header;
+    StreamSlot *slots;
+    uint64_t head; //Writer's own copy of header->head.
+} Stream;
+
+typedef enum StreamRead {
+    STREAM_READ_FRAME=0, //A frame was copied out.
+    STREAM_READ_EMPTY, //Nothing new yet.
+    STREAM_READ_CLOSED //Nothing new, and the writer has finished.
+} StreamRead;
+
+typedef struct StreamReader {
+    size_t size;
+    const StreamHeader *header;
+    const StreamSlot *slots;
+    uint64_t next; //Sequence of the next frame to read.
+    unsigned long dropped; //Frames overwritten before they could be read.
+} StreamReader;
+
+Stream *stream_alloc(void);
+void stream_dealloc(Stream *self);
+Stream *stream_init(Stream *self, const char *name, uint32_t capacity);
+bool stream_is_open(const Stream *self);
+
+void stream_publish(Stream *self, const Frame *frame);
+void stream_close(Stream *self);
+
+StreamReader *stream_reader_alloc(void);
+void stream_reader_dealloc(StreamReader *self);
+StreamReader *stream_reader_init(StreamReader *self, const char *name);
+bool stream_reader_is_open(const StreamReader *self);
+
+StreamRead stream_reader_next(StreamReader *self, Frame *frame);
+
+#endif
@@ -2,6 +2,10 @@
 #include <assert.h>
 
 #include "system.h"
+#include "stream.h"
+#include "kernel.h"
+#include "physics.h"
+#include "perf.h"
 
 System *system_alloc(void) {
     return (System *)malloc(sizeof(System));
@@ -32,10 +36,35 @@ System *system_init(System *self) {
     self->logging = false;
     self->log = stdout;
 
+    self->stream = NULL;
+    self->stream_interval = 1;
+
+    self->kernel = NULL;
+
     return self;
 }
 
 void system_run(System *self) {
+    if(self->kernel && kernel_accepts(self->kernel, self)) {
+        perf_set_phase(PERF_PHASE_KERNEL);
+        kernel_run(self->kernel, self);
+        perf_add_ticks(self->ticks);
+        perf_set_phase(PERF_PHASE_NONE);
+        return;
+    }
+
+    Frame frame;
+    system_start(self, &frame);
+    while(system_step(self))
+        ;
+    system_finish(self);
+}
+
+/*
+ * system_run in pieces, so that a caller can advance many systems in lockstep.
+ * The frame must outlive the run; it holds the apex frame until system_finish.
+ */
+void system_start(System *self, Frame *frame) {
     //Sanity check
     assert(self->rocket);
     assert(self->planetoid);
@@ -45,33 +74,58 @@ void system_run(System *self) {
 
     //Setup
     system_log_header(self);
-    Frame frame;
-    frame_init(&frame);
-    self->frame = &frame;
+    frame_init(frame);
+    self->frame = frame;
 
-    //Run
     self->state = SYSTEM_STATE_RUNNING;
+}
+
+//Runs one tick unless the flight is over; returns false once it is.
+bool system_step(System *self) {
+    if(self->state != SYSTEM_STATE_RUNNING)
+        return false;
+
     double altitude = planetoid_position_altitude(self->planetoid, self->rocket->position);
     double radial_velocity = planetoid_radial_velocity(self->planetoid, self->rocket->position, self->rocket->velocity);
 
     //We have the radial velocity cutoff a little below 0.0, because high tick rates with float precision can cause this to abort early.
-    while( altitude >= 0.0 && radial_velocity >= -0.0001 ) {
-        if( system_time(self) > SYSTEM_MAX_MISSION_TIME ) {
-            self->state = SYSTEM_STATE_ERROR;
-            break;
-        }
-        system_run_one_tick(self);
-        altitude = planetoid_position_altitude(self->planetoid, self->rocket->position);
-        radial_velocity = planetoid_radial_velocity(self->planetoid, self->rocket->position, self->rocket->velocity);
+    if( altitude < 0.0 || radial_velocity < -0.0001 ) {
+        self->state = SYSTEM_STATE_SUCCESS;
+        return false;
+    }
+    if( system_time(self) > SYSTEM_MAX_MISSION_TIME ) {
+        self->state = SYSTEM_STATE_ERROR;
+        return false;
     }
 
+    //Placed by the throttle of the last tick, as this one's is not set yet.
+    perf_tick(altitude < self->planetoid->max_atmospheric_altitude, self->rocket->throttle > 0.0 && self->rocket->mass > self->rocket->empty_mass);
+    system_run_one_tick(self);
+    return true;
+}
+
+/*
+ * Steps until the rocket reaches the altitude; returns false if the flight ended
+ * first.  A running system can be copied here (repointing its rocket and frame
+ * at copies) and each copy continued with different programs above the altitude.
+ */
+bool system_run_to_altitude(System *self, double altitude) {
+    while( planetoid_position_altitude(self->planetoid, self->rocket->position) < altitude ) {
+        if(!system_step(self))
+            return false;
+    }
+    return self->state == SYSTEM_STATE_RUNNING;
+}
+
+void system_finish(System *self) {
     //If we didn't collect stats, we take the last frame for the stats as it was at apex.
-    self->stats.frame = frame;
+    self->stats.frame = *self->frame;
 
     //Cleanup
     if(self->state >= 0)
         self->state = SYSTEM_STATE_SUCCESS;
     self->frame = NULL;
+    perf_set_phase(PERF_PHASE_NONE);
 }
 
 void system_run_one_tick(System *self) {
@@ -84,21 +138,13 @@ void system_run_one_tick(System *self) {
     system_set_throttle(self);
     system_set_altitude_angle(self);
 
-    //Calcualte the mass and mass change.
+    //Get the forces and the changes they make.
     double m = self->rocket->mass;
-    double dm = rocket_mass_flow(self->rocket, planetoid_atm(self->planetoid, self->rocket->position)) * delta_t;
-
-    //Get net force and acceleration.
-    Vector f = system_net_force(self);
-    Vector a = vector_rect(f.v[0]/m, f.v[1]/m);
-
-    //Move based on the acceleration.
-    double dvx = a.v[0]*delta_t;
-    double dvy = a.v[1]*delta_t;
-    Vector delta_v = vector_rect(dvx,dvy);
-    double dx = 0.5*a.v[0]*delta_t*delta_t + self->rocket->velocity.v[0]*delta_t;
-    double dy = 0.5*a.v[1]*delta_t*delta_t + self->rocket->velocity.v[1]*delta_t;
-    Vector delta_r = vector_rect(dx,dy);
+    PhysicsStep step;
+    physics_step(self->planetoid, self->rocket, planetoid_relative_position(self->planetoid, self->rocket->position), self->rocket->velocity, 0.0, vector(), delta_t, &step);
+    double dm = step.delta_mass;
+    Vector delta_v = step.delta_velocity;
+    Vector delta_r = step.delta_position;
 
     //Set the parts of the frame that didn't come from other places.
     self->frame->ticks = self->ticks;
@@ -110,6 +156,10 @@ void system_run_one_tick(System *self) {
     self->frame->delta_mass = dm;
     self->frame->delta_position = delta_r;
     self->frame->delta_velocity = delta_v;
+    self->frame->force = step.force;
+    self->frame->force_thrust = step.force_thrust;
+    self->frame->force_gravity = step.force_gravity;
+    self->frame->force_drag = step.force_drag;
     self->frame->radius = planetoid_position_radius(self->planetoid, self->frame->position);
     self->frame->altitude = planetoid_position_altitude(self->planetoid, self->frame->position);
     self->frame->azimuth = planetoid_position_azimuth(self->planetoid, self->frame->position);
@@ -121,13 +171,12 @@ void system_run_one_tick(System *self) {
     //Then record the rame statistics.
     system_update_stats(self);
     system_log_tick(self);
+    system_stream_tick(self);
 
     // Now apply the changes just before cleanup.
     self->rocket->mass -= dm;
-    self->rocket->velocity.v[0] += dvx;
-    self->rocket->velocity.v[1] += dvy;
-    self->rocket->position.v[0] += dx;
-    self->rocket->position.v[1] += dy;
+    self->rocket->velocity = vector_add(self->rocket->velocity, delta_v);
+    self->rocket->position = vector_add(self->rocket->position, delta_r);
     self->ticks++;
 }
 
@@ -137,43 +186,9 @@ double system_time(const System *self) {
     return self->ticks * self->delta_t;
 }
 
-Vector system_net_force(const System *self) {
-    // Get gravity.
-    Vector gravity = planetoid_gravitational_force(
-        self->planetoid,
-        self->rocket->mass,
-        self->rocket->position
-    );
-
-    // Get air resistance.
-    Vector drag = planetoid_atmospheric_drag(
-        self->planetoid,
-        self->rocket->position,
-        self->rocket->velocity,
-        rocket_drag(self->rocket),
-        self->rocket->mass
-    );
-
-    // Get thrust.
-    Vector thrust = rocket_thrust_force(
-        self->rocket,
-        planetoid_atm(self->planetoid, self->rocket->position),
-        planetoid_position_azimuth(self->planetoid, self->rocket->position)
-    );
-
-    // Sum.
-    double fx = VX(gravity) + VX(drag) + VX(thrust);
-    double fy = VY(gravity) + VY(drag) + VY(thrust);
-    Vector f = vector_rect(fx, fy);
-
-    // Put in frame.
-    self->frame->force = f;
-    self->frame->force_thrust = thrust;
-    self->frame->force_gravity = gravity;
-    self->frame->force_drag = drag;
-
-    // Return;;
-    return vector_rect(fx, fy);
+ProgramInput system_program_input(const System *self, double altitude) {
+    ProgramInput input = {altitude, self->rocket->position, self->rocket->velocity, self->planetoid};
+    return input;
 }
 
 void system_set_throttle(System *self) {
@@ -193,9 +208,9 @@ void system_set_throttle(System *self) {
     if(consider_cutoff && (!closed || (apoapsis >= self->throttle_cutoff_radius))) {
         throttle = 0.0;
     } else {
-        double altitude = planetoid_position_altitude(self->planetoid, self->rocket->position);
+        ProgramInput input = system_program_input(self, planetoid_position_altitude(self->planetoid, self->rocket->position));
         int error=0;
-        throttle = program_lookup(self->throttle_program, altitude, &error);
+        throttle = program_evaluate(self->throttle_program, &input, &error);
         assert(error==0);
     }
 
@@ -206,9 +221,10 @@ void system_set_throttle(System *self) {
 
 void system_set_altitude_angle(System *self) {
     double altitude = planetoid_position_radius(self->planetoid, self->rocket->position) - self->planetoid->radius;
+    ProgramInput input = system_program_input(self, altitude);
 
     int error=0;
-    double altitude_angle = program_lookup(self->altitude_angle_program, altitude, &error);
+    double altitude_angle = program_evaluate(self->altitude_angle_program, &input, &error);
     assert(error==0);
 
     self->rocket->altitude_angle = altitude_angle;
@@ -287,35 +303,10 @@ void system_log_tick(const System *self) {
         );
 }
 
-/*
- * For closed orbits, the periapsis and apoapsis are as expected.
- * For open orbits, the apoapsis is a negative value that approaches zero as the exces velocity increases.
- * For hyperbolic orbits, the apoapsis is infinite.
- */
-bool orbit_apses(double gravitational_parameter, double angular_momentum, double energy, double *periapsis, double *apoapsis) {
-    if(energy == 0.0) {
-        *apoapsis = INFINITY;
-        *periapsis = angular_momentum*angular_momentum / (2.0*gravitational_parameter);
-        return false;
-    }
-
-    double eccentricity = orbit_eccentricity(gravitational_parameter, angular_momentum, energy);
-    double semimajor_axis = -(gravitational_parameter)/(2.0*energy);
-
-    *periapsis = semimajor_axis * (1.0 - eccentricity);
-    *apoapsis = semimajor_axis * (1.0 + eccentricity);
-
-    return (energy > 0.0) ? false : true;
-}
-
-double orbit_eccentricity(double gravitational_parameter, double angular_momentum, double energy) {
-    double numerator = 2.0 * angular_momentum * angular_momentum * energy;
-    double denominator = gravitational_parameter * gravitational_parameter;
-
-    double radicand = 1.0 + numerator/denominator;
-    // Sometimes rounding errors on near circular orbits make the radicand negative when it should be near zero.
-    if(radicand < 0.0)
-        radicand = 0.0;
+void system_stream_tick(const System *self) {
+    if(!self->stream)
+        return;
 
-    return sqrt(radicand);
+    if( (self->ticks % self->stream_interval) == 0 )
+        stream_publish(self->stream, self->frame);
 }
@@ -9,6 +9,10 @@
 #include "planetoid.h"
 #include "statistics.h"
 #include "frame.h"
+#include "orbit.h"
+
+struct Stream;
+struct Kernel;
 
 #define SYSTEM_TICKS_PER_SECOND 100
 #define SYSTEM_LOG_INTERVAL_SECONDS 1
@@ -41,6 +45,11 @@ typedef struct System {
 
     bool logging;
     FILE *log; //Set this to a file pointer when you want to log to something other than the default (stdout).
+
+    struct Stream *stream; //If set, every stream_interval'th frame is published to it for live viewers.
+    unsigned stream_interval;
+
+    const struct Kernel *kernel; //If set, system_run flies through it whenever it accepts the system.
 } System;
 
 System *system_alloc(void);
@@ -48,11 +57,15 @@ void system_dealloc(System *self);
 System *system_init(System *self);
 
 void system_run(System *self);
+void system_start(System *self, Frame *frame);
+bool system_step(System *self);
+bool system_run_to_altitude(System *self, double altitude);
+void system_finish(System *self);
 void system_run_one_tick(System *self);
 
 double system_time(const System *self);
 
-Vector system_net_force(const System *self);
+ProgramInput system_program_input(const System *self, double altitude);
 void system_set_throttle(System *self);
 void system_set_altitude_angle(System *self);
 
@@ -63,13 +76,6 @@ double system_angular_momentum(const System *self);
 void system_update_stats(System *self);
 void system_log_header(const System *self);
 void system_log_tick(const System *self);
-
-/*
- * Given an angular momentum and an energy, Calculate the periapsis and apopais radius.
- * The return is true if the orbit is closed; the result is placed in the passed pointers.
- * If the orbit is open, false is passed and the values of periapsis abd apoapsis are not defined.
- */
-bool orbit_apses(double graviational_parameter, double angluar_momentum, double energy, double *periapsis, double *apoapsis);
-double orbit_eccentricity(double graviational_parameter, double angular_momentum, double energy);
+void system_stream_tick(const System *self);
 
 #endif
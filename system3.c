@@ -0,0 +1,159 @@
+#include <stdlib.h>
+#include <assert.h>
+
+#include "system3.h"
+#include "physics3.h"
+#include "orbit.h"
+
+static double system3_program(const System3 *self, const Program *program, double altitude);
+static inline bool system3_supported(const Program *program);
+
+System3 *system3_alloc(void) {
+    return (System3 *)malloc(sizeof(System3));
+}
+
+void system3_dealloc(System3 *self) {
+    free(self);
+}
+
+System3 *system3_init(System3 *self) {
+    self->rocket = NULL;
+    self->planetoid = NULL;
+
+    self->position = vector3_zero();
+    self->velocity = vector3_zero();
+    self->plane_normal = vector3_rect(0.0, 0.0, 1.0);
+
+    self->throttle_program = NULL;
+    self->altitude_angle_program = NULL;
+    self->yaw_program = NULL;
+    self->throttle_cutoff_radius = -1.0;
+
+    self->delta_t = 1.0/SYSTEM_TICKS_PER_SECOND;
+
+    self->ticks = 0;
+    self->state = SYSTEM_STATE_READY;
+
+    self->last_position = vector3_zero();
+    self->last_velocity = vector3_zero();
+    self->last_mass = 0.0;
+
+    return self;
+}
+
+/*
+ * Starts from the rocket's 2D position and velocity in the xy plane and steers
+ * in a plane tilted by the inclination about the line from the planetoid centre
+ * to the rocket, so a launch from the equator reaches an orbit of that
+ * inclination.
+ */
+void system3_place(System3 *self, const Rocket *rocket, double inclination) {
+    self->position = vector3_from_vector(rocket->position);
+    self->velocity = vector3_from_vector(rocket->velocity);
+
+    //Rotate (0,0,1) about the unit radial u by the inclination (Rodrigues).
+    Vector3 u = system3_relative_position(self, self->position);
+    u = vector3_scale(u, 1.0/vector3_mag(u));
+    Vector3 z = vector3_rect(0.0, 0.0, 1.0);
+    self->plane_normal = vector3_add(vector3_scale(z, kerbal_cos(inclination)), vector3_scale(vector3_cross(u, z), kerbal_sin(inclination)));
+}
+
+void system3_run(System3 *self) {
+    assert(self->rocket);
+    assert(self->planetoid);
+    assert(self->throttle_program);
+    assert(self->altitude_angle_program);
+    assert(self->state == SYSTEM_STATE_READY);
+
+    assert(system3_supported(self->throttle_program));
+    assert(system3_supported(self->altitude_angle_program));
+    assert(system3_supported(self->yaw_program));
+
+    self->state = SYSTEM_STATE_RUNNING;
+    while(system3_step(self))
+        ;
+    if(self->state >= 0)
+        self->state = SYSTEM_STATE_SUCCESS;
+}
+
+//Runs one tick unless the flight is over; returns false once it is.
+bool system3_step(System3 *self) {
+    if(self->state != SYSTEM_STATE_RUNNING)
+        return false;
+
+    Vector3 relative = system3_relative_position(self, self->position);
+    double radius = vector3_mag(relative);
+    double altitude = radius - self->planetoid->radius;
+    double radial_velocity = vector3_inner(self->velocity, relative) / radius;
+
+    //As System, a little below 0.0.
+    if( altitude < 0.0 || radial_velocity < -0.0001 ) {
+        self->state = SYSTEM_STATE_SUCCESS;
+        return false;
+    }
+    if( system3_time(self) > SYSTEM_MAX_MISSION_TIME ) {
+        self->state = SYSTEM_STATE_ERROR;
+        return false;
+    }
+
+    system3_run_one_tick(self);
+    return true;
+}
+
+void system3_run_one_tick(System3 *self) {
+    Rocket *rocket = self->rocket;
+    Vector3 relative = system3_relative_position(self, self->position);
+    double altitude = vector3_mag(relative) - self->planetoid->radius;
+
+    //Set rocket according to program, with the throttle cutoff as System.
+    double periapsis, apoapsis;
+    bool closed = system3_apses(self, &periapsis, &apoapsis);
+    if(self->throttle_cutoff_radius > 0.0 && (!closed || (apoapsis >= self->throttle_cutoff_radius)))
+        rocket->throttle = 0.0;
+    else
+        rocket->throttle = system3_program(self, self->throttle_program, altitude);
+    rocket->altitude_angle = system3_program(self, self->altitude_angle_program, altitude);
+    double yaw = self->yaw_program ? system3_program(self, self->yaw_program, altitude) : 0.0;
+
+    Physics3Step step;
+    physics3_step(self->planetoid, rocket, relative, self->velocity, yaw, self->plane_normal, self->delta_t, &step);
+
+    self->last_position = self->position;
+    self->last_velocity = self->velocity;
+    self->last_mass = rocket->mass;
+
+    rocket->mass -= step.delta_mass;
+    self->velocity = vector3_add(self->velocity, step.delta_velocity);
+    self->position = vector3_add(self->position, step.delta_position);
+    self->ticks++;
+}
+
+double system3_time(const System3 *self) {
+    return self->ticks * self->delta_t;
+}
+
+Vector3 system3_relative_position(const System3 *self, Vector3 position) {
+    return vector3_sub(position, vector3_from_vector(self->planetoid->position));
+}
+
+bool system3_apses(const System3 *self, double *periapsis, double *apoapsis) {
+    Vector3 relative = system3_relative_position(self, self->position);
+    double v = vector3_mag(self->velocity);
+    double angular_momentum = vector3_mag(vector3_cross(relative, self->velocity));
+    double energy = 0.5 * v * v + -(self->planetoid->gravitational_parameter) / vector3_mag(relative);
+
+    return orbit_apses(self->planetoid->gravitational_parameter, angular_momentum, energy, periapsis, apoapsis);
+}
+
+static double system3_program(const System3 *self, const Program *program, double altitude) {
+    ProgramInput input = {altitude, vector(), vector(), self->planetoid};
+    int error = 0;
+    double setting = program_evaluate(program, &input, &error);
+    assert(error == 0);
+    return setting;
+}
+
+//Programs are flown by altitude only; see system3.h.
+static inline bool system3_supported(const Program *program) {
+    return program == NULL || program->kind == PROGRAM_KIND_STEP || program->kind == PROGRAM_KIND_LINEAR || program->kind == PROGRAM_KIND_SPLINE;
+}
@@ -0,0 +1,67 @@
+#ifndef KERBAL_LAUNCH_SYSTEM3_H
+#define KERBAL_LAUNCH_SYSTEM3_H
+
+#include <stdbool.h>
+
+#include "vector3.h"
+#include "rocket.h"
+#include "program.h"
+#include "planetoid.h"
+#include "system.h"
+
+/*
+ * A flight in three dimensions, for inclined launches and out-of-plane
+ * steering.  It ticks with the 3D instance of the same physics as System
+ * (physics_template.h), and is otherwise kept lean: there are no frames,
+ * stats, logs or streams, only the state at the last tick.
+ *
+ * The rocket supplies the engine, drag and mass (which is burned as with
+ * System); its 2D position and velocity are only read by system3_place.  The
+ * rocket steers in the plane normal to plane_normal: the altitude angle is
+ * measured from that plane's horizontal, and the yaw program, if any, turns
+ * the thrust out of it toward plane_normal.  With plane_normal (0,0,1) and no
+ * yaw a flight from the xy plane is the System flight.  The rocket must not
+ * be on the line through the planetoid centre along plane_normal.
+ *
+ * Programs are flown by altitude only, so gravity turn and custom programs
+ * are not supported.
+ */
+typedef struct System3 {
+    Rocket *rocket;
+    const Planetoid *planetoid;
+
+    Vector3 position;
+    Vector3 velocity;
+    Vector3 plane_normal; //Unit length.
+
+    const Program *throttle_program;
+    const Program *altitude_angle_program;
+    const Program *yaw_program; //Radians; no yaw if NULL.
+    double throttle_cutoff_radius; //As System.
+
+    double delta_t;
+
+    unsigned long ticks;
+    SystemState state;
+
+    //The state as the last tick started, which at the end is the apex.
+    Vector3 last_position;
+    Vector3 last_velocity;
+    double last_mass;
+} System3;
+
+System3 *system3_alloc(void);
+void system3_dealloc(System3 *self);
+System3 *system3_init(System3 *self);
+
+void system3_place(System3 *self, const Rocket *rocket, double inclination);
+
+void system3_run(System3 *self);
+bool system3_step(System3 *self);
+void system3_run_one_tick(System3 *self);
+
+double system3_time(const System3 *self);
+Vector3 system3_relative_position(const System3 *self, Vector3 position);
+bool system3_apses(const System3 *self, double *periapsis, double *apoapsis);
+
+#endif
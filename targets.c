@@ -0,0 +1,77 @@
+#include <stdlib.h>
+#include <assert.h>
+
+#include "targets.h"
+
+static void targets_split(const TargetFlight *trunk, double cutoff_radius, TargetFlight *flight);
+static unsigned long targets_finish(TargetFlight *flight);
+static bool targets_cuts(const System *system, double cutoff_radius);
+
+/*
+ * Flies the ready system's programs against each cutoff radius, which must be
+ * ascending, leaving flight i as the system would have ended with cutoff
+ * radius i.  The system itself is only copied.  Returns the ticks simulated,
+ * counting the shared climb once.
+ */
+unsigned long targets_fly(const System *system, const double *cutoff_radii, size_t count, TargetFlight *flights) {
+    assert(count > 0);
+    assert(system->state == SYSTEM_STATE_READY);
+    for(size_t i=1; i<count; i++)
+        assert(cutoff_radii[i] >= cutoff_radii[i-1]);
+
+    //The trunk is the highest target's flight; the others split off it.
+    TargetFlight *trunk = &flights[count-1];
+    trunk->system = *system;
+    trunk->rocket = *system->rocket;
+    trunk->system.rocket = &trunk->rocket;
+    trunk->system.kernel = NULL;
+    trunk->system.throttle_cutoff_radius = cutoff_radii[count-1];
+    system_start(&trunk->system, &trunk->frame);
+
+    unsigned long ticks = 0;
+    size_t next = 0;
+    while(next < count-1 && trunk->system.state == SYSTEM_STATE_RUNNING) {
+        if(targets_cuts(&trunk->system, cutoff_radii[next])) {
+            targets_split(trunk, cutoff_radii[next], &flights[next]);
+            ticks += targets_finish(&flights[next]);
+            next++;
+        } else {
+            system_step(&trunk->system);
+        }
+    }
+
+    //Targets the flight ended short of end with it.
+    for(; next < count-1; next++) {
+        targets_split(trunk, cutoff_radii[next], &flights[next]);
+        ticks += targets_finish(&flights[next]);
+    }
+
+    //Once only the trunk is left it flies as on its own.
+    targets_finish(trunk);
+    return ticks + trunk->system.ticks;
+}
+
+static void targets_split(const TargetFlight *trunk, double cutoff_radius, TargetFlight *flight) {
+    *flight = *trunk;
+    flight->system.rocket = &flight->rocket;
+    flight->system.frame = &flight->frame;
+    flight->system.throttle_cutoff_radius = cutoff_radius;
+}
+
+//Runs the flight to its end; returns the ticks it took from where it was.
+static unsigned long targets_finish(TargetFlight *flight) {
+    unsigned long start = flight->system.ticks;
+    while(system_step(&flight->system))
+        ;
+    system_finish(&flight->system);
+    return flight->system.ticks - start;
+}
+
+//Whether system_set_throttle would cut the throttle this tick at the cutoff radius.
+static bool targets_cuts(const System *system, double cutoff_radius) {
+    if(cutoff_radius <= 0.0)
+        return false;
+    double periapsis, apoapsis;
+    bool closed = system_apses(system, &periapsis, &apoapsis);
+    return !closed || apoapsis >= cutoff_radius;
+}
@@ -0,0 +1,30 @@
+#ifndef KERBAL_LAUNCH_TARGETS_H
+#define KERBAL_LAUNCH_TARGETS_H
+
+#include <stddef.h>
+
+#include "rocket.h"
+#include "frame.h"
+#include "system.h"
+
+/*
+ * One flight of a program pair against several throttle cutoff radii.
+ *
+ * The throttle is cut on the first tick the apoapsis reaches the cutoff
+ * radius, so until the lowest target's cutoff fires every target's flight is
+ * the same tick for tick.  The flight is flown once, as the highest target's,
+ * and before each tick it checks, exactly as system_set_throttle will, whether
+ * the lowest target not yet split off would cut now; if so it copies itself
+ * there and the copy is finished alone as that target's flight.  Each target
+ * so gets the flight it would have had on its own, bit for bit, while the
+ * shared climb is flown only once.
+ */
+typedef struct TargetFlight {
+    System system; //Finished; points at the rocket and frame below.
+    Rocket rocket;
+    Frame frame;
+} TargetFlight;
+
+unsigned long targets_fly(const System *system, const double *cutoff_radii, size_t count, TargetFlight *flights);
+
+#endif
@@ -0,0 +1,261 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+#include <errno.h>
+
+#include "telemetry.h"
+
+//Upper bounds of the fitness (excess delta-v, m/s) histogram buckets.
+const double telemetry_fitness_bounds[TELEMETRY_FITNESS_BUCKETS] = {
+    -INFINITY, -1000.0, -500.0, -250.0, 0.0, 100.0, 200.0, 300.0, 350.0, 400.0, 425.0, 450.0
+};
+
+static void *telemetry_main(Telemetry *self);
+static double telemetry_clock(void);
+
+static inline void telemetry_bump(atomic_ulong *counter, unsigned long amount) {
+    //Single writer, so a plain load and store is enough; readers only need untorn values.
+    atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + amount, memory_order_relaxed);
+}
+
+Telemetry *telemetry_alloc(void) {
+    Telemetry *self = NULL;
+    if(posix_memalign((void **)&self, 64, sizeof(Telemetry)) != 0)
+        return NULL;
+    return self;
+}
+
+void telemetry_dealloc(Telemetry *self) {
+    pthread_cond_destroy(&self->cond);
+    pthread_mutex_destroy(&self->mutex);
+    free(self->path);
+    free(self);
+}
+
+Telemetry *telemetry_init(Telemetry *self, const char *path, double interval) {
+    for(unsigned i=0; i<TELEMETRY_MAX_WORKERS; i++) {
+        TelemetryWorker *worker = &self->workers[i];
+        atomic_init(&worker->evaluations, 0);
+        atomic_init(&worker->failures, 0);
+        atomic_init(&worker->ticks, 0);
+        atomic_init(&worker->busy_nanoseconds, 0);
+        for(unsigned b=0; b<=TELEMETRY_FITNESS_BUCKETS; b++)
+            atomic_init(&worker->fitness_buckets[b], 0);
+        double zero = 0.0;
+        uint64_t zero_bits;
+        memcpy(&zero_bits, &zero, sizeof(zero_bits));
+        atomic_init(&worker->fitness_sum_bits, zero_bits);
+    }
+
+    double best = -INFINITY;
+    uint64_t bits;
+    memcpy(&bits, &best, sizeof(bits));
+    atomic_init(&self->generation, 0);
+    atomic_init(&self->best_fitness_bits, bits);
+    atomic_init(&self->active_workers, 0);
+
+    self->path = strdup(path);
+    self->interval = interval;
+    self->start_time = telemetry_clock();
+
+    pthread_mutex_init(&self->mutex, NULL);
+    pthread_cond_init(&self->cond, NULL);
+    self->stopping = false;
+
+    self->last_sample_time = self->start_time;
+    self->last_evaluations = 0;
+
+    return self;
+}
+
+void telemetry_start(Telemetry *self) {
+    pthread_create(&self->thread, NULL, (void *(*)(void *))telemetry_main, self);
+}
+
+/*
+ * Stops the sampler, writing one last sample.
+ */
+void telemetry_stop(Telemetry *self) {
+    pthread_mutex_lock(&self->mutex);
+    self->stopping = true;
+    pthread_cond_signal(&self->cond);
+    pthread_mutex_unlock(&self->mutex);
+    pthread_join(self->thread, NULL);
+    telemetry_write(self);
+}
+
+/*
+ * Called by a worker after each evaluation; only that worker may use its index.
+ */
+void telemetry_record(Telemetry *self, unsigned worker, double fitness, unsigned long ticks, double seconds) {
+    TelemetryWorker *counters = &self->workers[worker % TELEMETRY_MAX_WORKERS];
+    telemetry_bump(&counters->evaluations, 1);
+    telemetry_bump(&counters->ticks, ticks);
+    telemetry_bump(&counters->busy_nanoseconds, (unsigned long)(seconds * 1e9));
+    if(fitness == -INFINITY)
+        telemetry_bump(&counters->failures, 1);
+
+    unsigned bucket = 0;
+    while(bucket < TELEMETRY_FITNESS_BUCKETS && fitness > telemetry_fitness_bounds[bucket])
+        bucket++;
+    telemetry_bump(&counters->fitness_buckets[bucket], 1);
+
+    //Failures would make the sum -Inf forever, so only finite fitnesses are summed.
+    if(isfinite(fitness)) {
+        uint64_t bits = atomic_load_explicit(&counters->fitness_sum_bits, memory_order_relaxed);
+        double sum;
+        memcpy(&sum, &bits, sizeof(sum));
+        sum += fitness;
+        memcpy(&bits, &sum, sizeof(bits));
+        atomic_store_explicit(&counters->fitness_sum_bits, bits, memory_order_relaxed);
+    }
+}
+
+void telemetry_set_progress(Telemetry *self, unsigned generation, double best_fitness, unsigned workers) {
+    uint64_t bits;
+    memcpy(&bits, &best_fitness, sizeof(bits));
+    atomic_store_explicit(&self->generation, generation, memory_order_relaxed);
+    atomic_store_explicit(&self->best_fitness_bits, bits, memory_order_relaxed);
+    atomic_store_explicit(&self->active_workers, workers, memory_order_relaxed);
+}
+
+/*
+ * Writes a sample in the Prometheus text exposition format, to a temporary
+ * file renamed over the target so scrapers never see a partial file.
+ */
+bool telemetry_write(Telemetry *self) {
+    size_t path_length = strlen(self->path);
+    char *temp_path = (char *)malloc(path_length + 5);
+    memcpy(temp_path, self->path, path_length);
+    memcpy(temp_path + path_length, ".tmp", 5);
+
+    FILE *file = fopen(temp_path, "w");
+    if(file == NULL) {
+        free(temp_path);
+        return false;
+    }
+
+    double now = telemetry_clock();
+    double elapsed = now - self->start_time;
+    unsigned workers = atomic_load_explicit(&self->active_workers, memory_order_relaxed);
+    if(workers > TELEMETRY_MAX_WORKERS)
+        workers = TELEMETRY_MAX_WORKERS;
+
+    unsigned long evaluations = 0, failures = 0, ticks = 0;
+    unsigned long buckets[TELEMETRY_FITNESS_BUCKETS+1] = {0};
+    double fitness_sum = 0.0;
+
+    fprintf(file, "# HELP kerbal_launch_worker_evaluations_total Flights simulated by each worker.\n");
+    fprintf(file, "# TYPE kerbal_launch_worker_evaluations_total counter\n");
+    for(unsigned i=0; i<workers; i++) {
+        unsigned long count = atomic_load_explicit(&self->workers[i].evaluations, memory_order_relaxed);
+        fprintf(file, "kerbal_launch_worker_evaluations_total{worker=\"%u\"} %lu\n", i, count);
+        evaluations += count;
+    }
+
+    fprintf(file, "# HELP kerbal_launch_worker_utilization Fraction of the run each worker spent simulating.\n");
+    fprintf(file, "# TYPE kerbal_launch_worker_utilization gauge\n");
+    for(unsigned i=0; i<workers; i++) {
+        double busy = 1e-9 * atomic_load_explicit(&self->workers[i].busy_nanoseconds, memory_order_relaxed);
+        fprintf(file, "kerbal_launch_worker_utilization{worker=\"%u\"} %f\n", i, (elapsed > 0.0) ? busy/elapsed : 0.0);
+    }
+
+    for(unsigned i=0; i<TELEMETRY_MAX_WORKERS; i++) {
+        const TelemetryWorker *worker = &self->workers[i];
+        failures += atomic_load_explicit(&worker->failures, memory_order_relaxed);
+        ticks += atomic_load_explicit(&worker->ticks, memory_order_relaxed);
+        for(unsigned b=0; b<=TELEMETRY_FITNESS_BUCKETS; b++)
+            buckets[b] += atomic_load_explicit(&worker->fitness_buckets[b], memory_order_relaxed);
+        uint64_t sum_bits = atomic_load_explicit(&worker->fitness_sum_bits, memory_order_relaxed);
+        double sum;
+        memcpy(&sum, &sum_bits, sizeof(sum));
+        fitness_sum += sum;
+    }
+
+    double rate = (now > self->last_sample_time) ? (evaluations - self->last_evaluations) / (now - self->last_sample_time) : 0.0;
+    self->last_sample_time = now;
+    self->last_evaluations = evaluations;
+
+    uint64_t bits = atomic_load_explicit(&self->best_fitness_bits, memory_order_relaxed);
+    double best_fitness;
+    memcpy(&best_fitness, &bits, sizeof(best_fitness));
+
+    fprintf(file, "# HELP kerbal_launch_failed_evaluations_total Flights scored -Inf (crashed, stalled or timed out).\n");
+    fprintf(file, "# TYPE kerbal_launch_failed_evaluations_total counter\n");
+    fprintf(file, "kerbal_launch_failed_evaluations_total %lu\n", failures);
+    fprintf(file, "# HELP kerbal_launch_ticks_total Simulation ticks run.\n");
+    fprintf(file, "# TYPE kerbal_launch_ticks_total counter\n");
+    fprintf(file, "kerbal_launch_ticks_total %lu\n", ticks);
+    fprintf(file, "# HELP kerbal_launch_evaluations_per_second Evaluation rate since the previous sample.\n");
+    fprintf(file, "# TYPE kerbal_launch_evaluations_per_second gauge\n");
+    fprintf(file, "kerbal_launch_evaluations_per_second %f\n", rate);
+    fprintf(file, "# HELP kerbal_launch_generation Generations completed.\n");
+    fprintf(file, "# TYPE kerbal_launch_generation gauge\n");
+    fprintf(file, "kerbal_launch_generation %u\n", atomic_load_explicit(&self->generation, memory_order_relaxed));
+    fprintf(file, "# HELP kerbal_launch_best_fitness Best fitness so far, in m/s of excess delta-v.\n");
+    fprintf(file, "# TYPE kerbal_launch_best_fitness gauge\n");
+    if(isfinite(best_fitness))
+        fprintf(file, "kerbal_launch_best_fitness %f\n", best_fitness);
+    else
+        fprintf(file, "kerbal_launch_best_fitness -Inf\n");
+    fprintf(file, "# HELP kerbal_launch_uptime_seconds Seconds since telemetry started.\n");
+    fprintf(file, "# TYPE kerbal_launch_uptime_seconds gauge\n");
+    fprintf(file, "kerbal_launch_uptime_seconds %f\n", elapsed);
+
+    //Prometheus histograms are cumulative.
+    fprintf(file, "# HELP kerbal_launch_fitness Fitness of evaluated candidates; the sum is of finite fitnesses only.\n");
+    fprintf(file, "# TYPE kerbal_launch_fitness histogram\n");
+    unsigned long cumulative = 0;
+    for(unsigned b=0; b<TELEMETRY_FITNESS_BUCKETS; b++) {
+        cumulative += buckets[b];
+        if(isinf(telemetry_fitness_bounds[b]))
+            fprintf(file, "kerbal_launch_fitness_bucket{le=\"-Inf\"} %lu\n", cumulative);
+        else
+            fprintf(file, "kerbal_launch_fitness_bucket{le=\"%g\"} %lu\n", telemetry_fitness_bounds[b], cumulative);
+    }
+    cumulative += buckets[TELEMETRY_FITNESS_BUCKETS];
+    fprintf(file, "kerbal_launch_fitness_bucket{le=\"+Inf\"} %lu\n", cumulative);
+    fprintf(file, "kerbal_launch_fitness_sum %f\n", fitness_sum);
+    fprintf(file, "kerbal_launch_fitness_count %lu\n", cumulative);
+
+    bool ok = fclose(file) == 0;
+    ok = ok && rename(temp_path, self->path) == 0;
+    free(temp_path);
+    return ok;
+}
+
+static void *telemetry_main(Telemetry *self) {
+    pthread_mutex_lock(&self->mutex);
+    while(!self->stopping) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        double seconds = floor(self->interval);
+        deadline.tv_sec += (time_t)seconds;
+        deadline.tv_nsec += (long)((self->interval - seconds) * 1e9);
+        if(deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+
+        int status = 0;
+        while(!self->stopping && status != ETIMEDOUT)
+            status = pthread_cond_timedwait(&self->cond, &self->mutex, &deadline);
+        if(self->stopping)
+            break;
+
+        pthread_mutex_unlock(&self->mutex);
+        telemetry_write(self);
+        pthread_mutex_lock(&self->mutex);
+    }
+    pthread_mutex_unlock(&self->mutex);
+    return NULL;
+}
+
+static double telemetry_clock(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + 1e-9*now.tv_nsec;
+}
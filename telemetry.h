@@ -0,0 +1,66 @@
+#ifndef KERBAL_LAUNCH_TELEMETRY_H
+#define KERBAL_LAUNCH_TELEMETRY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#define TELEMETRY_MAX_WORKERS 64
+#define TELEMETRY_FITNESS_BUCKETS 12
+#define TELEMETRY_INTERVAL_SECONDS 5.0
+
+/*
+ * Live optimizer counters, published as a Prometheus textfile.
+ *
+ * Each worker owns one TelemetryWorker, on its own cache lines, and is its only
+ * writer, so recording an evaluation is a few relaxed loads and stores with no
+ * locks or contended atomics.  A sampler thread reads every worker periodically
+ * and rewrites the textfile atomically; nothing is recorded per tick.
+ */
+typedef struct TelemetryWorker {
+    _Alignas(64) atomic_ulong evaluations;
+    atomic_ulong failures; //Flights that crashed, stalled or ran out of time (fitness -INFINITY).
+    atomic_ulong ticks;
+    atomic_ulong busy_nanoseconds;
+    atomic_ulong fitness_buckets[TELEMETRY_FITNESS_BUCKETS+1]; //The last is +Inf.
+    _Atomic uint64_t fitness_sum_bits; //Sum of the finite fitnesses, as double bits.
+} TelemetryWorker;
+
+typedef struct Telemetry {
+    TelemetryWorker workers[TELEMETRY_MAX_WORKERS];
+
+    //Written by the coordinating thread.
+    atomic_uint generation;
+    _Atomic uint64_t best_fitness_bits;
+    atomic_uint active_workers;
+
+    char *path;
+    double interval;
+    double start_time;
+
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    bool stopping;
+
+    //Sampler state for rates between samples.
+    double last_sample_time;
+    unsigned long last_evaluations;
+} Telemetry;
+
+extern const double telemetry_fitness_bounds[TELEMETRY_FITNESS_BUCKETS];
+
+Telemetry *telemetry_alloc(void);
+void telemetry_dealloc(Telemetry *self);
+Telemetry *telemetry_init(Telemetry *self, const char *path, double interval);
+
+void telemetry_start(Telemetry *self);
+void telemetry_stop(Telemetry *self);
+
+void telemetry_record(Telemetry *self, unsigned worker, double fitness, unsigned long ticks, double seconds);
+void telemetry_set_progress(Telemetry *self, unsigned generation, double best_fitness, unsigned workers);
+
+bool telemetry_write(Telemetry *self);
+
+#endif
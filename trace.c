@@ -0,0 +1,171 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "trace.h"
+
+static Trace *trace_active = NULL; //Set before the traced threads start, so read without a lock.
+static _Thread_local TraceBuffer *trace_buffer = NULL;
+
+static uint64_t trace_clock(void);
+static void trace_push(TraceBuffer *buffer, const TraceEvent *event);
+
+Trace *trace_alloc(void) {
+    Trace *self = NULL;
+    if(posix_memalign((void **)&self, 64, sizeof(Trace)) != 0)
+        return NULL;
+    return self;
+}
+
+void trace_dealloc(Trace *self) {
+    for(unsigned i=0; i<=TRACE_MAX_WORKERS; i++)
+        free(self->buffers[i].events);
+    free(self);
+}
+
+Trace *trace_init(Trace *self) {
+    for(unsigned i=0; i<=TRACE_MAX_WORKERS; i++) {
+        self->buffers[i].events = NULL;
+        self->buffers[i].count = 0;
+        self->buffers[i].capacity = 0;
+        self->buffers[i].dropped = 0;
+    }
+    self->origin = 0;
+    return self;
+}
+
+//Starts tracing the calling thread (as TRACE_MAIN) and any optimizer threads started until trace_stop.
+void trace_start(Trace *self) {
+    self->origin = trace_clock();
+    trace_active = self;
+    trace_buffer = &self->buffers[TRACE_MAIN];
+}
+
+//Stops tracing; the traced threads other than the caller must have ended.
+void trace_stop(Trace *self) {
+    if(trace_active != self)
+        return;
+    trace_active = NULL;
+    trace_buffer = NULL;
+}
+
+size_t trace_events(const Trace *self) {
+    size_t events = 0;
+    for(unsigned i=0; i<=TRACE_MAX_WORKERS; i++)
+        events += self->buffers[i].count;
+    return events;
+}
+
+/*
+ * Writes the spans as complete ("X") events, with microsecond times, and
+ * names the tracks: tid 0 is main and tid w+1 is worker w.  A fitness that is
+ * not finite (a failed flight) is written as null.
+ */
+bool trace_write(const Trace *self, FILE *out) {
+    fprintf(out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fprintf(out, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"kerbal_launch\"}}");
+    for(unsigned i=0; i<=TRACE_MAX_WORKERS; i++) {
+        const TraceBuffer *buffer = &self->buffers[i];
+        if(buffer->count == 0)
+            continue;
+
+        unsigned tid = (i == TRACE_MAIN) ? 0 : i+1;
+        if(i == TRACE_MAIN)
+            fprintf(out, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"main\"}}");
+        else
+            fprintf(out, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"worker %u\"}}", tid, i);
+        fprintf(out, ",\n{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"sort_index\":%u}}", tid, tid);
+
+        for(size_t e=0; e<buffer->count; e++) {
+            const TraceEvent *event = &buffer->events[e];
+            fprintf(out, ",\n{\"name\":\"%s\",\"cat\":\"optimizer\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f",
+                    event->name, tid, event->start/1e3, (event->end - event->start)/1e3);
+            if(event->evaluation) {
+                fprintf(out, ",\"args\":{\"candidate\":%lu,\"ticks\":%lu,\"fitness\":", event->candidate, event->ticks);
+                if(isfinite(event->fitness))
+                    fprintf(out, "%.6f}", event->fitness);
+                else
+                    fprintf(out, "null}");
+            }
+            fprintf(out, "}");
+        }
+        if(buffer->dropped > 0)
+            fprintf(out, ",\n{\"name\":\"dropped events\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"args\":{\"dropped\":%lu}}",
+                    tid, buffer->events[buffer->count-1].end/1e3, buffer->dropped);
+    }
+    fprintf(out, "\n]}\n");
+    return !ferror(out);
+}
+
+//Traces the calling thread as the worker, if a trace is running.
+void trace_thread_begin(unsigned worker) {
+    Trace *trace = trace_active;
+    if(trace == NULL || worker >= TRACE_MAX_WORKERS)
+        return;
+    trace_buffer = &trace->buffers[worker];
+}
+
+void trace_thread_end(void) {
+    trace_buffer = NULL;
+}
+
+//The time to start a span at, or 0 if the calling thread is not traced.
+uint64_t trace_now(void) {
+    if(trace_buffer == NULL)
+        return 0;
+    return trace_clock() - trace_active->origin;
+}
+
+//Records a span from start until now.
+void trace_span(const char *name, uint64_t start) {
+    if(trace_buffer == NULL)
+        return;
+    TraceEvent event = {name, start, trace_now(), false, 0, 0, 0.0};
+    trace_push(trace_buffer, &event);
+}
+
+void trace_evaluation(uint64_t start, unsigned long candidate, unsigned long ticks, double fitness) {
+    if(trace_buffer == NULL)
+        return;
+    TraceEvent event = {"evaluate", start, trace_now(), true, candidate, ticks, fitness};
+    trace_push(trace_buffer, &event);
+}
+
+/*
+ * Records a span on another worker's track, for what is only known once its
+ * thread has been joined (the wait at the barrier, say).  Only call it while
+ * no thread is running as that worker.
+ */
+void trace_worker_span(unsigned worker, const char *name, uint64_t start, uint64_t end) {
+    Trace *trace = trace_active;
+    if(trace == NULL || trace_buffer == NULL || worker >= TRACE_MAX_WORKERS || end <= start)
+        return;
+    TraceEvent event = {name, start, end, false, 0, 0, 0.0};
+    trace_push(&trace->buffers[worker], &event);
+}
+
+static uint64_t trace_clock(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec*1000000000u + (uint64_t)now.tv_nsec;
+}
+
+static void trace_push(TraceBuffer *buffer, const TraceEvent *event) {
+    if(buffer->count == buffer->capacity) {
+        if(buffer->capacity >= TRACE_MAX_EVENTS) {
+            buffer->dropped++;
+            return;
+        }
+        size_t capacity = buffer->capacity ? 2*buffer->capacity : 256;
+        TraceEvent *events = (TraceEvent *)realloc(buffer->events, sizeof(TraceEvent) * capacity);
+        if(events == NULL) {
+            buffer->dropped++;
+            return;
+        }
+        buffer->events = events;
+        buffer->capacity = capacity;
+    }
+    buffer->events[buffer->count++] = *event;
+}
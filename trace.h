@@ -0,0 +1,64 @@
+#ifndef KERBAL_LAUNCH_TRACE_H
+#define KERBAL_LAUNCH_TRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define TRACE_MAX_WORKERS 64
+#define TRACE_MAIN TRACE_MAX_WORKERS //The buffer of the thread that called trace_start.
+#define TRACE_MAX_EVENTS (1<<22) //Per buffer; later events are counted as dropped.
+
+//A span on one thread; times are nanoseconds from trace_start.
+typedef struct TraceEvent {
+    const char *name; //A string literal; only the pointer is kept.
+    uint64_t start;
+    uint64_t end;
+    bool evaluation; //Has the arguments below.
+    unsigned long candidate;
+    unsigned long ticks;
+    double fitness;
+} TraceEvent;
+
+typedef struct TraceBuffer {
+    _Alignas(64) TraceEvent *events;
+    size_t count;
+    size_t capacity;
+    unsigned long dropped;
+} TraceBuffer;
+
+/*
+ * A timeline of what the optimizer's threads were doing, written as Chrome
+ * trace-event JSON for chrome://tracing or Perfetto: a track per worker with
+ * a span per evaluation (carrying its candidate number, ticks and fitness)
+ * and the time idle at the generation barrier, and a main track with the
+ * mutating, joining, selecting and copying between them.
+ *
+ * Each worker index has its own buffer, written only by the thread running as
+ * that worker, so recording takes no locks; a worker's threads never overlap,
+ * as each generation's are joined before the next start.  Buffers are kept
+ * until trace_write.  With no trace running the hooks return at once, and
+ * threads past TRACE_MAX_WORKERS are not traced.
+ */
+typedef struct Trace {
+    TraceBuffer buffers[TRACE_MAX_WORKERS+1];
+    uint64_t origin; //CLOCK_MONOTONIC nanoseconds at trace_start.
+} Trace;
+
+Trace *trace_alloc(void);
+void trace_dealloc(Trace *self);
+Trace *trace_init(Trace *self);
+
+void trace_start(Trace *self);
+void trace_stop(Trace *self);
+bool trace_write(const Trace *self, FILE *out);
+size_t trace_events(const Trace *self);
+
+void trace_thread_begin(unsigned worker);
+void trace_thread_end(void);
+uint64_t trace_now(void);
+void trace_span(const char *name, uint64_t start);
+void trace_evaluation(uint64_t start, unsigned long candidate, unsigned long ticks, double fitness);
+void trace_worker_span(unsigned worker, const char *name, uint64_t start, uint64_t end);
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef KERBAL_LAUNCH_VECTOR3_H
+#define KERBAL_LAUNCH_VECTOR3_H
+
+#include "vector.h"
+
+#define VECTOR3_DIMS 3
+#define VECTOR3_LANES 4 //Padded to a power of two so each vector is one 256-bit (or two 128-bit) register.
+
+#define VZ(vec) ((vec).v[2])
+
+/*
+ * Three dimensional vectors for inclined flights (see system3.h), from the
+ * same template as Vector.  The fourth lane is padding: it is kept zero and
+ * left out of the reductions.
+ */
+#define VECTOR_T Vector3
+#define VECTOR_T_COMPONENTS Vector3Components
+#define VECTOR_T_DIMS VECTOR3_DIMS
+#define VECTOR_T_LANES VECTOR3_LANES
+#define VECTOR_FN(name) vector3_##name
+#include "vector_template.h"
+
+static inline Vector3 vector3_rect(double x, double y, double z) {
+    Vector3 w = {{x, y, z, 0.0}};
+    return w;
+}
+
+//The 2D vector in the z = 0 plane.
+static inline Vector3 vector3_from_vector(Vector v) {
+    return vector3_rect(VX(v), VY(v), 0.0);
+}
+
+static inline Vector3 vector3_cross(Vector3 v, Vector3 u) {
+    return vector3_rect(
+        VY(v)*VZ(u) - VZ(v)*VY(u),
+        VZ(v)*VX(u) - VX(v)*VZ(u),
+        VX(v)*VY(u) - VY(v)*VX(u)
+    );
+}
+
+#endif
@@ -0,0 +1,60 @@
+/*
+ * The dimension-generic part of the vector math, written once and included by
+ * vector.h and vector3.h with these defined:
+ *   VECTOR_T             the struct type, e.g. Vector
+ *   VECTOR_T_COMPONENTS  its components' GCC/Clang vector type
+ *   VECTOR_T_DIMS        the dimensions
+ *   VECTOR_T_LANES       the components stored, a power of two >= the dimensions;
+ *                        lanes past the dimensions are padding and kept zero
+ *   VECTOR_FN(name)      the function name for name, e.g. vector_##name
+ * They are undefined again at the end, so there is no include guard.
+ *
+ * Lane-wise operations work on all the lanes at once; reductions sum only the
+ * dimensions, in order, so a 2D instance does exactly the arithmetic of the
+ * hand-written 2D functions it replaced.
+ */
+
+typedef double VECTOR_T_COMPONENTS __attribute__((vector_size(VECTOR_T_LANES*sizeof(double))));
+
+typedef struct VECTOR_T {
+    VECTOR_T_COMPONENTS v;
+} VECTOR_T;
+
+static inline VECTOR_T VECTOR_FN(zero)(void) {
+    VECTOR_T w = {{0.0}};
+    return w;
+}
+
+static inline double VECTOR_FN(inner)(VECTOR_T v, VECTOR_T u) {
+    VECTOR_T_COMPONENTS w = v.v * u.v;
+    double sum = w[0];
+    for(int i=1; i<VECTOR_T_DIMS; i++)
+        sum += w[i];
+    return sum;
+}
+
+static inline double VECTOR_FN(mag)(VECTOR_T v) {
+    return sqrt(VECTOR_FN(inner)(v,v));
+}
+
+static inline VECTOR_T VECTOR_FN(add)(VECTOR_T v, VECTOR_T u) {
+    VECTOR_T w = {v.v + u.v};
+    return w;
+}
+
+/* Calculate v-u */
+static inline VECTOR_T VECTOR_FN(sub)(VECTOR_T v, VECTOR_T u) {
+    VECTOR_T w = {v.v - u.v};
+    return w;
+}
+
+static inline VECTOR_T VECTOR_FN(scale)(VECTOR_T v, double s) {
+    VECTOR_T w = {v.v * s};
+    return w;
+}
+
+#undef VECTOR_T
+#undef VECTOR_T_COMPONENTS
+#undef VECTOR_T_DIMS
+#undef VECTOR_T_LANES
+#undef VECTOR_FN